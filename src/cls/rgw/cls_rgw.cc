@@ -54,13 +54,15 @@ CLS_NAME(rgw)
 #define BI_BUCKET_LOG_INDEX           1
 #define BI_BUCKET_OBJ_INSTANCE_INDEX  2
 #define BI_BUCKET_OLH_DATA_INDEX      3
+#define BI_BUCKET_RESHARD_LOG_INDEX   4
 
-#define BI_BUCKET_LAST_INDEX          4
+#define BI_BUCKET_LAST_INDEX          5
 
 static std::string bucket_index_prefixes[] = { "", /* special handling for the objs list index */
 					       "0_",     /* bucket log index */
 					       "1000_",  /* obj instance index */
 					       "1001_",  /* olh data index */
+					       "2000_",  /* reshard log index */
 
 					       /* this must be the last index */
 					       "9999_",};
@@ -476,6 +478,89 @@ static int read_bucket_header(cls_method_context_t hctx,
   return 0;
 }
 
+static void reshard_log_prefix(std::string& key)
+{
+  key = BI_PREFIX_CHAR;
+  key.append(bucket_index_prefixes[BI_BUCKET_RESHARD_LOG_INDEX]);
+}
+
+static void reshard_log_index_key(const std::string& name, std::string& key)
+{
+  reshard_log_prefix(key);
+  key.append(name);
+}
+
+/*
+ * Set on the shard object for as long as it is in IN_LOGRECORD state, so
+ * ops that don't otherwise need the header can tell whether they have to
+ * read it. The object's xattrs are loaded along with it, its omap header
+ * is not.
+ */
+#define RGW_RESHARD_LOGRECORD_ATTR "rgw.reshard.logrecord"
+
+static int set_reshard_logrecord_attr(cls_method_context_t hctx,
+				      bool logrecord)
+{
+  bufferlist bl;
+  encode(logrecord, bl);
+  return cls_cxx_setxattr(hctx, RGW_RESHARD_LOGRECORD_ATTR, &bl);
+}
+
+static bool reshard_logrecord_attr(cls_method_context_t hctx)
+{
+  bufferlist bl;
+  if (cls_cxx_getxattr(hctx, RGW_RESHARD_LOGRECORD_ATTR, &bl) < 0) {
+    return false;
+  }
+  bool logrecord = false;
+  try {
+    auto iter = bl.cbegin();
+    decode(logrecord, iter);
+  } catch (ceph::buffer::error& err) {
+    CLS_LOG(1, "ERROR: %s: failed to decode %s", __func__,
+	    RGW_RESHARD_LOGRECORD_ATTR);
+    // read the header to be sure
+    return true;
+  }
+  return logrecord;
+}
+
+/*
+ * While the shard is in IN_LOGRECORD state, a reshard is copying its
+ * entries to the target index with writes still allowed. Record the
+ * name of every object whose entries change, along with the object
+ * version of the change, so the reshard can copy those entries again
+ * before it switches layouts. If header is null it is read here, but
+ * only when the shard is marked as recording.
+ */
+static int reshard_log_index_operation(cls_method_context_t hctx,
+				       const std::string& name,
+				       const rgw_bucket_dir_header* header = nullptr)
+{
+  rgw_bucket_dir_header h;
+  if (!header) {
+    if (!reshard_logrecord_attr(hctx)) {
+      return 0;
+    }
+    int rc = read_bucket_header(hctx, &h);
+    if (rc < 0) {
+      return rc;
+    }
+    header = &h;
+  }
+  if (!header->resharding_in_logrecord()) {
+    return 0;
+  }
+
+  std::string key;
+  reshard_log_index_key(name, key);
+
+  bufferlist bl;
+  encode(cls_current_version(hctx), bl);
+  CLS_LOG(20, "%s: recording key=%s", __func__, escape_str(key).c_str());
+  return cls_cxx_map_set_val(hctx, key, &bl);
+}
+
 int rgw_bucket_list(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
 {
   CLS_LOG(10, "entered %s", __func__);
@@ -946,6 +1031,14 @@ int rgw_bucket_prepare_op(cls_method_context_t hctx, bufferlist *in, bufferlist
     return rc;
   }
 
+  rc = reshard_log_index_operation(hctx, op.key.name);
+  if (rc < 0) {
+    CLS_LOG_BITX(bitx_inst, 1,
+		 "ERROR: %s failed to record reshard log, key=%s, rc=%d",
+		 __func__, escape_str(idx).c_str(), rc);
+    return rc;
+  }
+
   CLS_LOG_BITX(bitx_inst, 10, "EXITING %s, returning 0", __func__);
   return 0;
 } // rgw_bucket_prepare_op
@@ -1043,7 +1136,7 @@ static int read_key_entry(cls_method_context_t hctx, const cls_rgw_obj_key& key,
   return 0;
 }
 
-// called by rgw_bucket_complete_op() for each item in op.remove_objs
+// called by complete_op() for each item in op.remove_objs
 static int complete_remove_obj(cls_method_context_t hctx,
                                rgw_bucket_dir_header& header,
                                const cls_rgw_obj_key& key, bool log_op)
@@ -1077,31 +1170,14 @@ static int complete_remove_obj(cls_method_context_t hctx,
     CLS_LOG(1, "%s: cls_cxx_map_remove_key failed with %d", __func__, ret);
     return ret;
   }
-  return ret;
+  return reshard_log_index_operation(hctx, key.name, &header);
 }
 
-int rgw_bucket_complete_op(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
+// applies a single complete op to the index entries and to the header,
+// which the caller writes back
+static int complete_op(cls_method_context_t hctx, rgw_bucket_dir_header& header,
+                       rgw_cls_obj_complete_op& op, bool bitx_inst)
 {
-  const ConfigProxy& conf = cls_get_config(hctx);
-  const object_info_t& oi = cls_get_object_info(hctx);
-
-  // bucket index transaction instrumentation
-  const bool bitx_inst =
-    conf->rgw_bucket_index_transaction_instrumentation;
-
-  CLS_LOG_BITX(bitx_inst, 10, "ENTERING %s for object oid=%s key=%s",
-	       __func__, oi.soid.oid.name.c_str(), oi.soid.get_key().c_str());
-
-  // decode request
-  rgw_cls_obj_complete_op op;
-  auto iter = in->cbegin();
-  try {
-    decode(op, iter);
-  } catch (ceph::buffer::error& err) {
-    CLS_LOG_BITX(bitx_inst, 1, "ERROR: %s: failed to decode request", __func__);
-    return -EINVAL;
-  }
-
   CLS_LOG_BITX(bitx_inst, 1,
 	       "INFO: %s: request: op=%s name=%s ver=%lu:%llu tag=%s",
 	       __func__,
@@ -1109,19 +1185,11 @@ int rgw_bucket_complete_op(cls_method_context_t hctx, bufferlist *in, bufferlist
 	       (unsigned long)op.ver.pool, (unsigned long long)op.ver.epoch,
 	       op.tag.c_str());
 
-  rgw_bucket_dir_header header;
-  int rc = read_bucket_header(hctx, &header);
-  if (rc < 0) {
-    CLS_LOG_BITX(bitx_inst, 1, "ERROR: %s: failed to read header, rc=%d",
-		 __func__, rc);
-    return -EINVAL;
-  }
-
   rgw_bucket_dir_entry entry;
   bool ondisk = true;
 
   std::string idx;
-  rc = read_key_entry(hctx, op.key, &idx, &entry);
+  int rc = read_key_entry(hctx, op.key, &idx, &entry);
   if (rc == -ENOENT) {
     entry.key = op.key;
     entry.ver = op.ver;
@@ -1260,6 +1328,14 @@ int rgw_bucket_complete_op(cls_method_context_t hctx, bufferlist *in, bufferlist
     }
   } // CLS_RGW_OP_ADD
 
+  rc = reshard_log_index_operation(hctx, op.key.name, &header);
+  if (rc < 0) {
+    CLS_LOG_BITX(bitx_inst, 0,
+		 "ERROR: %s: reshard_log_index_operation failed with rc=%d",
+		 __func__, rc);
+    return rc;
+  }
+
   if (log_op) {
     rc = log_index_operation(hctx, op.key, op.op, op.tag, entry.meta.mtime,
 			     entry.ver, CLS_RGW_STATE_COMPLETE, header.ver,
@@ -1289,6 +1365,44 @@ int rgw_bucket_complete_op(cls_method_context_t hctx, bufferlist *in, bufferlist
     }
   } // remove loop
 
+  return 0;
+} // complete_op
+
+int rgw_bucket_complete_op(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
+{
+  const ConfigProxy& conf = cls_get_config(hctx);
+  const object_info_t& oi = cls_get_object_info(hctx);
+
+  // bucket index transaction instrumentation
+  const bool bitx_inst =
+    conf->rgw_bucket_index_transaction_instrumentation;
+
+  CLS_LOG_BITX(bitx_inst, 10, "ENTERING %s for object oid=%s key=%s",
+	       __func__, oi.soid.oid.name.c_str(), oi.soid.get_key().c_str());
+
+  // decode request
+  rgw_cls_obj_complete_op op;
+  auto iter = in->cbegin();
+  try {
+    decode(op, iter);
+  } catch (ceph::buffer::error& err) {
+    CLS_LOG_BITX(bitx_inst, 1, "ERROR: %s: failed to decode request", __func__);
+    return -EINVAL;
+  }
+
+  rgw_bucket_dir_header header;
+  int rc = read_bucket_header(hctx, &header);
+  if (rc < 0) {
+    CLS_LOG_BITX(bitx_inst, 1, "ERROR: %s: failed to read header, rc=%d",
+		 __func__, rc);
+    return -EINVAL;
+  }
+
+  rc = complete_op(hctx, header, op, bitx_inst);
+  if (rc < 0) {
+    return rc;
+  }
+
   CLS_LOG_BITX(bitx_inst, 20,
 	       "INFO: %s: writing bucket header", __func__);
   rc = write_bucket_header(hctx, &header);
@@ -1303,6 +1417,77 @@ int rgw_bucket_complete_op(cls_method_context_t hctx, bufferlist *in, bufferlist
   return rc;
 } // rgw_bucket_complete_op
 
+int rgw_bucket_complete_ops(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
+{
+  const ConfigProxy& conf = cls_get_config(hctx);
+  const object_info_t& oi = cls_get_object_info(hctx);
+
+  // bucket index transaction instrumentation
+  const bool bitx_inst =
+    conf->rgw_bucket_index_transaction_instrumentation;
+
+  CLS_LOG_BITX(bitx_inst, 10, "ENTERING %s for object oid=%s key=%s",
+	       __func__, oi.soid.oid.name.c_str(), oi.soid.get_key().c_str());
+
+  rgw_cls_obj_complete_ops_op call;
+  auto iter = in->cbegin();
+  try {
+    decode(call, iter);
+  } catch (ceph::buffer::error& err) {
+    CLS_LOG_BITX(bitx_inst, 1, "ERROR: %s: failed to decode request", __func__);
+    return -EINVAL;
+  }
+
+  // omap reads don't see the writes of the same transaction, so an op
+  // would read a stale entry if an earlier op in the batch changed it
+  std::set<std::string> names;
+  for (const auto& op : call.ops) {
+    bool unique = names.insert(op.key.name).second;
+    for (const auto& key : op.remove_objs) {
+      unique = names.insert(key.name).second && unique;
+    }
+    if (!unique) {
+      CLS_LOG_BITX(bitx_inst, 1, "ERROR: %s: name=%s appears more than once",
+		   __func__, op.key.name.c_str());
+      return -EINVAL;
+    }
+  }
+
+  rgw_bucket_dir_header header;
+  int rc = read_bucket_header(hctx, &header);
+  if (rc < 0) {
+    CLS_LOG_BITX(bitx_inst, 1, "ERROR: %s: failed to read header, rc=%d",
+		 __func__, rc);
+    return -EINVAL;
+  }
+
+  for (auto op = call.ops.begin(); op != call.ops.end(); ++op) {
+    if (op != call.ops.begin()) {
+      // each op gets its own index version, as if the header had been
+      // written in between, so their bilog entries don't collide
+      ++header.ver;
+    }
+    rc = complete_op(hctx, header, *op, bitx_inst);
+    if (rc < 0) {
+      return rc;
+    }
+  }
+
+  CLS_LOG_BITX(bitx_inst, 20,
+	       "INFO: %s: writing bucket header after %zu ops",
+	       __func__, call.ops.size());
+  rc = write_bucket_header(hctx, &header);
+  if (rc < 0) {
+    CLS_LOG_BITX(bitx_inst, 0,
+		 "ERROR: %s: failed to write bucket header ret=%d",
+		 __func__, rc);
+  }
+
+  CLS_LOG_BITX(bitx_inst, 10,
+	       "EXITING %s: returning %d", __func__, rc);
+  return rc;
+} // rgw_bucket_complete_ops
+
 template <class T>
 static int write_entry(cls_method_context_t hctx, T& entry, const string& key)
 {
@@ -1728,9 +1913,14 @@ static int rgw_bucket_link_olh(cls_method_context_t hctx, bufferlist *in, buffer
     return -EINVAL;
   }
 
+  int ret = reshard_log_index_operation(hctx, op.key.name);
+  if (ret < 0) {
+    return ret;
+  }
+
   /* read instance entry */
   BIVerObjEntry obj(hctx, op.key);
-  int ret = obj.init(op.delete_marker);
+  ret = obj.init(op.delete_marker);
 
   /* NOTE: When a delete is issued, a key instance is always provided,
    * either the one for which the delete is requested or a new random
@@ -1963,6 +2153,11 @@ static int rgw_bucket_unlink_instance(cls_method_context_t hctx, bufferlist *in,
     return -EINVAL;
   }
 
+  int ret = reshard_log_index_operation(hctx, op.key.name);
+  if (ret < 0) {
+    return ret;
+  }
+
   cls_rgw_obj_key dest_key = op.key;
   if (dest_key.instance == "null") {
     dest_key.instance.clear();
@@ -1971,7 +2166,7 @@ static int rgw_bucket_unlink_instance(cls_method_context_t hctx, bufferlist *in,
   BIVerObjEntry obj(hctx, dest_key);
   BIOLHEntry olh(hctx, dest_key);
 
-  int ret = obj.init();
+  ret = obj.init();
   if (ret == -ENOENT) {
     return 0; /* already removed */
   }
@@ -2207,7 +2402,7 @@ static int rgw_bucket_trim_olh_log(cls_method_context_t hctx, bufferlist *in, bu
     return ret;
   }
 
-  return 0;
+  return reshard_log_index_operation(hctx, op.olh.name);
 }
 
 static int rgw_bucket_clear_olh(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
@@ -2243,6 +2438,11 @@ static int rgw_bucket_clear_olh(cls_method_context_t hctx, bufferlist *in, buffe
     return -ECANCELED;
   }
 
+  ret = reshard_log_index_operation(hctx, op.key.name);
+  if (ret < 0) {
+    return ret;
+  }
+
   ret = cls_cxx_map_remove_key(hctx, olh_data_key);
   if (ret < 0) {
     CLS_LOG(1, "NOTICE: %s: can't remove key %s ret=%d", __func__, olh_data_key.c_str(), ret);
@@ -2474,6 +2674,13 @@ int rgw_dir_suggest_changes(cls_method_context_t hctx,
         }
         break;
       } // switch(op)
+
+      ret = reshard_log_index_operation(hctx, cur_change.key.name, &header);
+      if (ret < 0) {
+	CLS_LOG_BITX(bitx_inst, 0, "ERROR: %s: failed to record reshard log ret=%d",
+		     __func__, ret);
+	return ret;
+      }
     } // if (cur_disk.pending_map.empty())
   } // while (!in_iter.end())
 
@@ -2770,9 +2977,214 @@ static int rgw_bi_put_op(cls_method_context_t hctx, bufferlist *in, bufferlist *
     CLS_LOG(0, "ERROR: %s: cls_cxx_map_set_val() returned r=%d", __func__, r);
   }
 
+  cls_rgw_obj_key key;
+  RGWObjCategory category;
+  rgw_bucket_category_stats stats;
+  try {
+    entry.get_info(&key, &category, &stats);
+  } catch (ceph::buffer::error& err) {
+    CLS_LOG(1, "WARNING: %s: failed to decode entry idx=%s", __func__,
+	    escape_str(entry.idx).c_str());
+  }
+  if (!key.name.empty()) {
+    r = reshard_log_index_operation(hctx, key.name);
+    if (r < 0) {
+      return r;
+    }
+  }
+
   return 0;
 }
 
+// stats of an entry as accounted by the reshard copier
+static bool bi_entry_stats(rgw_cls_bi_entry& entry, RGWObjCategory* category,
+			   rgw_bucket_category_stats* stats)
+{
+  cls_rgw_obj_key key;
+  try {
+    return entry.get_info(&key, category, stats);
+  } catch (ceph::buffer::error& err) {
+    CLS_LOG(0, "ERROR: %s: failed to decode entry idx=%s", __func__,
+	    escape_str(entry.idx).c_str());
+    return false;
+  }
+}
+
+static void bi_entry_unaccount(cls_method_context_t hctx,
+			       rgw_bucket_dir_header& header,
+			       const std::string& idx, BIIndexType type)
+{
+  rgw_cls_bi_entry existing;
+  existing.idx = idx;
+  existing.type = type;
+  if (cls_cxx_map_get_val(hctx, idx, &existing.data) < 0) {
+    return;
+  }
+  RGWObjCategory category;
+  rgw_bucket_category_stats stats;
+  if (bi_entry_stats(existing, &category, &stats)) {
+    auto& dest = header.stats[category];
+    dest.num_entries -= stats.num_entries;
+    dest.total_size -= stats.total_size;
+    dest.total_size_rounded -= stats.total_size_rounded;
+    dest.actual_size -= stats.actual_size;
+  }
+}
+
+/*
+ * Write and remove several index entries in one call, keeping the
+ * header stats consistent. Used by reshard to copy entries into the
+ * target index; with check_existing it may replace entries it wrote
+ * earlier.
+ */
+static int rgw_bi_put_entries(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
+{
+  CLS_LOG(10, "entered %s", __func__);
+  rgw_cls_bi_put_entries_op op;
+  auto iter = in->cbegin();
+  try {
+    decode(op, iter);
+  } catch (ceph::buffer::error& err) {
+    CLS_LOG(0, "ERROR: %s: failed to decode request", __func__);
+    return -EINVAL;
+  }
+
+  rgw_bucket_dir_header header;
+  int r = read_bucket_header(hctx, &header);
+  if (r < 0) {
+    CLS_LOG(1, "ERROR: %s: failed to read header", __func__);
+    return r;
+  }
+
+  for (const auto& idx : op.remove) {
+    const int t = bi_entry_type(idx);
+    const BIIndexType type = t == BI_BUCKET_OBJ_INSTANCE_INDEX ? BIIndexType::Instance :
+      t == BI_BUCKET_OLH_DATA_INDEX ? BIIndexType::OLH : BIIndexType::Plain;
+    bi_entry_unaccount(hctx, header, idx, type);
+    r = cls_cxx_map_remove_key(hctx, idx);
+    if (r < 0 && r != -ENOENT) {
+      CLS_LOG(0, "ERROR: %s: cls_cxx_map_remove_key() returned r=%d", __func__, r);
+      return r;
+    }
+  }
+
+  for (auto& entry : op.entries) {
+    if (op.check_existing) {
+      bi_entry_unaccount(hctx, header, entry.idx, entry.type);
+    }
+    RGWObjCategory category;
+    rgw_bucket_category_stats stats;
+    if (bi_entry_stats(entry, &category, &stats)) {
+      auto& dest = header.stats[category];
+      dest.num_entries += stats.num_entries;
+      dest.total_size += stats.total_size;
+      dest.total_size_rounded += stats.total_size_rounded;
+      dest.actual_size += stats.actual_size;
+    }
+    r = cls_cxx_map_set_val(hctx, entry.idx, &entry.data);
+    if (r < 0) {
+      CLS_LOG(0, "ERROR: %s: cls_cxx_map_set_val() returned r=%d", __func__, r);
+      return r;
+    }
+  }
+
+  return write_bucket_header(hctx, &header);
+}
+
+static int rgw_reshard_log_list(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
+{
+  CLS_LOG(10, "entered %s", __func__);
+  rgw_cls_reshard_log_list_op op;
+  auto iter = in->cbegin();
+  try {
+    decode(op, iter);
+  } catch (ceph::buffer::error& err) {
+    CLS_LOG(0, "ERROR: %s: failed to decode request", __func__);
+    return -EINVAL;
+  }
+
+  constexpr uint32_t MAX_RESHARD_LOG_ENTRIES = 1000;
+  const uint32_t max = std::min(op.max, MAX_RESHARD_LOG_ENTRIES);
+
+  std::string prefix;
+  reshard_log_prefix(prefix);
+  std::string start_after;
+  reshard_log_index_key(op.marker, start_after);
+
+  std::map<std::string, bufferlist> keys;
+  rgw_cls_reshard_log_list_ret op_ret;
+  int r = cls_cxx_map_get_vals(hctx, start_after, prefix, max, &keys,
+			       &op_ret.is_truncated);
+  if (r < 0) {
+    return r;
+  }
+  for (auto& [key, bl] : keys) {
+    uint64_t ver;
+    auto biter = bl.cbegin();
+    try {
+      decode(ver, biter);
+    } catch (ceph::buffer::error& err) {
+      CLS_LOG(0, "ERROR: %s: failed to decode entry key=%s", __func__,
+	      escape_str(key).c_str());
+      return -EIO;
+    }
+    op_ret.entries.emplace(key.substr(prefix.size()), ver);
+  }
+
+  encode(op_ret, *out);
+  return 0;
+}
+
+static int rgw_reshard_log_trim(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
+{
+  CLS_LOG(10, "entered %s", __func__);
+  rgw_cls_reshard_log_trim_op op;
+  auto iter = in->cbegin();
+  try {
+    decode(op, iter);
+  } catch (ceph::buffer::error& err) {
+    CLS_LOG(0, "ERROR: %s: failed to decode request", __func__);
+    return -EINVAL;
+  }
+
+  for (const auto& [name, ver] : op.entries) {
+    std::string key;
+    reshard_log_index_key(name, key);
+    bufferlist bl;
+    int r = cls_cxx_map_get_val(hctx, key, &bl);
+    if (r == -ENOENT) {
+      continue;
+    } else if (r < 0) {
+      return r;
+    }
+    uint64_t cur;
+    auto biter = bl.cbegin();
+    try {
+      decode(cur, biter);
+    } catch (ceph::buffer::error& err) {
+      return -EIO;
+    }
+    if (cur != ver) {
+      continue; // modified again since it was listed
+    }
+    r = cls_cxx_map_remove_key(hctx, key);
+    if (r < 0) {
+      return r;
+    }
+  }
+  return 0;
+}
+
+// remove the whole reshard log, e.g. when a reshard is canceled
+static int reshard_log_clear(cls_method_context_t hctx)
+{
+  std::string begin, end;
+  reshard_log_prefix(begin);
+  end = BI_PREFIX_CHAR;
+  end.append(bucket_index_prefixes[BI_BUCKET_RESHARD_LOG_INDEX + 1]);
+  return cls_cxx_map_remove_range(hctx, begin, end);
+}
+
 
 /* The plain entries in the bucket index are divided into two regions
  * divided by the special entries that begin with 0x80. Those below
@@ -4476,7 +4888,28 @@ static int rgw_set_bucket_resharding(cls_method_context_t hctx, bufferlist *in,
     return rc;
   }
 
+  if (op.entry.reshard_status == cls_rgw_reshard_status::NOT_RESHARDING &&
+      header.new_instance.reshard_status != cls_rgw_reshard_status::NOT_RESHARDING) {
+    rc = reshard_log_clear(hctx);
+    if (rc < 0) {
+      CLS_LOG(1, "ERROR: %s: failed to clear reshard log", __func__);
+      return rc;
+    }
+  }
+  const bool logrecord =
+    op.entry.reshard_status == cls_rgw_reshard_status::IN_LOGRECORD;
+  if (logrecord != header.resharding_in_logrecord()) {
+    rc = set_reshard_logrecord_attr(hctx, logrecord);
+    if (rc < 0) {
+      CLS_LOG(1, "ERROR: %s: failed to set %s", __func__,
+	      RGW_RESHARD_LOGRECORD_ATTR);
+      return rc;
+    }
+  }
   header.new_instance.set_status(op.entry.reshard_status);
+  // set again by the reshard to extend it
+  header.new_instance.logrecord_expire =
+    logrecord ? op.entry.logrecord_expire : real_time();
 
   return write_bucket_header(hctx, &header);
 }
@@ -4500,6 +4933,21 @@ static int rgw_clear_bucket_resharding(cls_method_context_t hctx, bufferlist *in
     CLS_LOG(1, "ERROR: %s: failed to read header", __func__);
     return rc;
   }
+  if (header.new_instance.reshard_status != cls_rgw_reshard_status::NOT_RESHARDING) {
+    rc = reshard_log_clear(hctx);
+    if (rc < 0) {
+      CLS_LOG(1, "ERROR: %s: failed to clear reshard log", __func__);
+      return rc;
+    }
+  }
+  if (header.resharding_in_logrecord()) {
+    rc = set_reshard_logrecord_attr(hctx, false);
+    if (rc < 0) {
+      CLS_LOG(1, "ERROR: %s: failed to set %s", __func__,
+	      RGW_RESHARD_LOGRECORD_ATTR);
+      return rc;
+    }
+  }
   header.new_instance.clear();
 
   return write_bucket_header(hctx, &header);
@@ -4525,7 +4973,9 @@ static int rgw_guard_bucket_resharding(cls_method_context_t hctx, bufferlist *in
     return rc;
   }
 
-  if (header.resharding()) {
+  // a reshard that stopped extending its logrecord phase is blocked
+  // like one in progress, so that rgw takes over and clears it
+  if (header.resharding() || header.logrecord_expired(real_clock::now())) {
     return op.ret_err;
   }
 
@@ -4574,6 +5024,7 @@ CLS_INIT(rgw)
   cls_method_handle_t h_rgw_bucket_update_stats;
   cls_method_handle_t h_rgw_bucket_prepare_op;
   cls_method_handle_t h_rgw_bucket_complete_op;
+  cls_method_handle_t h_rgw_bucket_complete_ops;
   cls_method_handle_t h_rgw_bucket_link_olh;
   cls_method_handle_t h_rgw_bucket_unlink_instance_op;
   cls_method_handle_t h_rgw_bucket_read_olh_log;
@@ -4586,6 +5037,7 @@ CLS_INIT(rgw)
   cls_method_handle_t h_rgw_bi_get_op;
   cls_method_handle_t h_rgw_bi_put_op;
   cls_method_handle_t h_rgw_bi_list_op;
+  cls_method_handle_t h_rgw_bi_put_entries_op;
   cls_method_handle_t h_rgw_bi_log_list_op;
   cls_method_handle_t h_rgw_bi_log_resync_op;
   cls_method_handle_t h_rgw_bi_log_stop_op;
@@ -4612,6 +5064,8 @@ CLS_INIT(rgw)
   cls_method_handle_t h_rgw_clear_bucket_resharding;
   cls_method_handle_t h_rgw_guard_bucket_resharding;
   cls_method_handle_t h_rgw_get_bucket_resharding;
+  cls_method_handle_t h_rgw_reshard_log_list;
+  cls_method_handle_t h_rgw_reshard_log_trim;
 
   cls_register(RGW_CLASS, &h_class);
 
@@ -4624,6 +5078,7 @@ CLS_INIT(rgw)
   cls_register_cxx_method(h_class, RGW_BUCKET_UPDATE_STATS, CLS_METHOD_RD | CLS_METHOD_WR, rgw_bucket_update_stats, &h_rgw_bucket_update_stats);
   cls_register_cxx_method(h_class, RGW_BUCKET_PREPARE_OP, CLS_METHOD_RD | CLS_METHOD_WR, rgw_bucket_prepare_op, &h_rgw_bucket_prepare_op);
   cls_register_cxx_method(h_class, RGW_BUCKET_COMPLETE_OP, CLS_METHOD_RD | CLS_METHOD_WR, rgw_bucket_complete_op, &h_rgw_bucket_complete_op);
+  cls_register_cxx_method(h_class, RGW_BUCKET_COMPLETE_OPS, CLS_METHOD_RD | CLS_METHOD_WR, rgw_bucket_complete_ops, &h_rgw_bucket_complete_ops);
   cls_register_cxx_method(h_class, RGW_BUCKET_LINK_OLH, CLS_METHOD_RD | CLS_METHOD_WR, rgw_bucket_link_olh, &h_rgw_bucket_link_olh);
   cls_register_cxx_method(h_class, RGW_BUCKET_UNLINK_INSTANCE, CLS_METHOD_RD | CLS_METHOD_WR, rgw_bucket_unlink_instance, &h_rgw_bucket_unlink_instance_op);
   cls_register_cxx_method(h_class, RGW_BUCKET_READ_OLH_LOG, CLS_METHOD_RD, rgw_bucket_read_olh_log, &h_rgw_bucket_read_olh_log);
@@ -4638,6 +5093,7 @@ CLS_INIT(rgw)
   cls_register_cxx_method(h_class, RGW_BI_GET, CLS_METHOD_RD, rgw_bi_get_op, &h_rgw_bi_get_op);
   cls_register_cxx_method(h_class, RGW_BI_PUT, CLS_METHOD_RD | CLS_METHOD_WR, rgw_bi_put_op, &h_rgw_bi_put_op);
   cls_register_cxx_method(h_class, RGW_BI_LIST, CLS_METHOD_RD, rgw_bi_list_op, &h_rgw_bi_list_op);
+  cls_register_cxx_method(h_class, RGW_BI_PUT_ENTRIES, CLS_METHOD_RD | CLS_METHOD_WR, rgw_bi_put_entries, &h_rgw_bi_put_entries_op);
 
   cls_register_cxx_method(h_class, RGW_BI_LOG_LIST, CLS_METHOD_RD, rgw_bi_log_list, &h_rgw_bi_log_list_op);
   cls_register_cxx_method(h_class, RGW_BI_LOG_TRIM, CLS_METHOD_RD | CLS_METHOD_WR, rgw_bi_log_trim, &h_rgw_bi_log_list_op);
@@ -4682,6 +5138,10 @@ CLS_INIT(rgw)
 			  rgw_guard_bucket_resharding, &h_rgw_guard_bucket_resharding);
   cls_register_cxx_method(h_class, RGW_GET_BUCKET_RESHARDING, CLS_METHOD_RD ,
 			  rgw_get_bucket_resharding, &h_rgw_get_bucket_resharding);
+  cls_register_cxx_method(h_class, RGW_RESHARD_LOG_LIST, CLS_METHOD_RD,
+			  rgw_reshard_log_list, &h_rgw_reshard_log_list);
+  cls_register_cxx_method(h_class, RGW_RESHARD_LOG_TRIM, CLS_METHOD_RD | CLS_METHOD_WR,
+			  rgw_reshard_log_trim, &h_rgw_reshard_log_trim);
 
   return;
 }
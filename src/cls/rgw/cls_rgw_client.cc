@@ -307,6 +307,16 @@ void cls_rgw_bucket_complete_op(ObjectWriteOperation& o, RGWModifyOp op, const s
   o.exec(RGW_CLASS, RGW_BUCKET_COMPLETE_OP, in);
 }
 
+void cls_rgw_bucket_complete_ops(ObjectWriteOperation& o,
+                                 std::vector<rgw_cls_obj_complete_op> ops)
+{
+  bufferlist in;
+  rgw_cls_obj_complete_ops_op call;
+  call.ops = std::move(ops);
+  encode(call, in);
+  o.exec(RGW_CLASS, RGW_BUCKET_COMPLETE_OPS, in);
+}
+
 void cls_rgw_bucket_list_op(librados::ObjectReadOperation& op,
                             const cls_rgw_obj_key& start_obj,
                             const std::string& filter_prefix,
@@ -494,6 +504,58 @@ int cls_rgw_bi_list(librados::IoCtx& io_ctx, const std::string& oid,
   return 0;
 }
 
+void cls_rgw_bi_put_entries(ObjectWriteOperation& op,
+                            std::vector<rgw_cls_bi_entry> entries,
+                            std::vector<std::string> remove,
+                            bool check_existing)
+{
+  bufferlist in;
+  rgw_cls_bi_put_entries_op call;
+  call.entries = std::move(entries);
+  call.remove = std::move(remove);
+  call.check_existing = check_existing;
+  encode(call, in);
+  op.exec(RGW_CLASS, RGW_BI_PUT_ENTRIES, in);
+}
+
+int cls_rgw_reshard_log_list(librados::IoCtx& io_ctx, const std::string& oid,
+                             const std::string& marker, uint32_t max,
+                             std::map<std::string, uint64_t> *entries,
+                             bool *is_truncated)
+{
+  bufferlist in, out;
+  rgw_cls_reshard_log_list_op call;
+  call.marker = marker;
+  call.max = max;
+  encode(call, in);
+  int r = io_ctx.exec(oid, RGW_CLASS, RGW_RESHARD_LOG_LIST, in, out);
+  if (r < 0)
+    return r;
+
+  rgw_cls_reshard_log_list_ret op_ret;
+  auto iter = out.cbegin();
+  try {
+    decode(op_ret, iter);
+  } catch (ceph::buffer::error& err) {
+    return -EIO;
+  }
+
+  entries->swap(op_ret.entries);
+  *is_truncated = op_ret.is_truncated;
+
+  return 0;
+}
+
+void cls_rgw_reshard_log_trim(ObjectWriteOperation& op,
+                              std::map<std::string, uint64_t> entries)
+{
+  bufferlist in;
+  rgw_cls_reshard_log_trim_op call;
+  call.entries = std::move(entries);
+  encode(call, in);
+  op.exec(RGW_CLASS, RGW_RESHARD_LOG_TRIM, in);
+}
+
 int cls_rgw_bucket_link_olh(librados::IoCtx& io_ctx, const string& oid,
                             const cls_rgw_obj_key& key, const bufferlist& olh_tag,
                             bool delete_marker, const string& op_tag, const rgw_bucket_dir_entry_meta *meta,
@@ -357,6 +357,11 @@ void cls_rgw_bucket_complete_op(librados::ObjectWriteOperation& o, RGWModifyOp o
 				const std::list<cls_rgw_obj_key> *remove_objs, bool log_op,
                                 uint16_t bilog_op, const rgw_zone_set *zones_trace);
 
+/* applies all of @ops, or none of them if one fails. OSDs that predate
+ * this return -EOPNOTSUPP */
+void cls_rgw_bucket_complete_ops(librados::ObjectWriteOperation& o,
+                                 std::vector<rgw_cls_obj_complete_op> ops);
+
 void cls_rgw_remove_obj(librados::ObjectWriteOperation& o, std::list<std::string>& keep_attr_prefixes);
 void cls_rgw_obj_store_pg_ver(librados::ObjectWriteOperation& o, const std::string& attr);
 void cls_rgw_obj_check_attrs_prefix(librados::ObjectOperation& o, const std::string& prefix, bool fail_if_exist);
@@ -370,6 +375,20 @@ void cls_rgw_bi_put(librados::ObjectWriteOperation& op, const std::string oid, c
 int cls_rgw_bi_list(librados::IoCtx& io_ctx, const std::string& oid,
                    const std::string& name, const std::string& marker, uint32_t max,
                    std::list<rgw_cls_bi_entry> *entries, bool *is_truncated);
+void cls_rgw_bi_put_entries(librados::ObjectWriteOperation& op,
+                            std::vector<rgw_cls_bi_entry> entries,
+                            std::vector<std::string> remove,
+                            bool check_existing);
+
+/* names of objects modified while a reshard copied the shard
+ * (cls_rgw_reshard_status::IN_LOGRECORD), with the version of their
+ * last modification */
+int cls_rgw_reshard_log_list(librados::IoCtx& io_ctx, const std::string& oid,
+                             const std::string& marker, uint32_t max,
+                             std::map<std::string, uint64_t> *entries,
+                             bool *is_truncated);
+void cls_rgw_reshard_log_trim(librados::ObjectWriteOperation& op,
+                              std::map<std::string, uint64_t> entries);
 
 
 void cls_rgw_bucket_link_olh(librados::ObjectWriteOperation& op,
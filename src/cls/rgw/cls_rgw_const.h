@@ -21,6 +21,7 @@ constexpr int RGWBIAdvanceAndRetryError = -EFBIG;
 #define RGW_BUCKET_UPDATE_STATS "bucket_update_stats"
 #define RGW_BUCKET_PREPARE_OP "bucket_prepare_op"
 #define RGW_BUCKET_COMPLETE_OP "bucket_complete_op"
+#define RGW_BUCKET_COMPLETE_OPS "bucket_complete_ops"
 #define RGW_BUCKET_LINK_OLH "bucket_link_olh"
 #define RGW_BUCKET_UNLINK_INSTANCE "bucket_unlink_instance"
 #define RGW_BUCKET_READ_OLH_LOG "bucket_read_olh_log"
@@ -35,6 +36,7 @@ constexpr int RGWBIAdvanceAndRetryError = -EFBIG;
 #define RGW_BI_GET "bi_get"
 #define RGW_BI_PUT "bi_put"
 #define RGW_BI_LIST "bi_list"
+#define RGW_BI_PUT_ENTRIES "bi_put_entries"
 
 #define RGW_BI_LOG_LIST "bi_log_list"
 #define RGW_BI_LOG_TRIM "bi_log_trim"
@@ -75,3 +77,5 @@ constexpr int RGWBIAdvanceAndRetryError = -EFBIG;
 #define RGW_CLEAR_BUCKET_RESHARDING "clear_bucket_resharding"
 #define RGW_GUARD_BUCKET_RESHARDING "guard_bucket_resharding"
 #define RGW_GET_BUCKET_RESHARDING "get_bucket_resharding"
+#define RGW_RESHARD_LOG_LIST "reshard_log_list"
+#define RGW_RESHARD_LOG_TRIM "reshard_log_trim"
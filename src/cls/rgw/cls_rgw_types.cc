@@ -822,6 +822,10 @@ void cls_rgw_reshard_entry::generate_test_instances(list<cls_rgw_reshard_entry*>
 void cls_rgw_bucket_instance_entry::dump(Formatter *f) const
 {
   encode_json("reshard_status", to_string(reshard_status), f);
+  if (!ceph::real_clock::is_zero(logrecord_expire)) {
+    utime_t ut(logrecord_expire);
+    encode_json("logrecord_expire", ut, f);
+  }
 }
 
 void cls_rgw_bucket_instance_entry::generate_test_instances(
@@ -830,6 +834,9 @@ list<cls_rgw_bucket_instance_entry*>& ls)
   ls.push_back(new cls_rgw_bucket_instance_entry);
   ls.push_back(new cls_rgw_bucket_instance_entry);
   ls.back()->reshard_status = RESHARD_STATUS::IN_PROGRESS;
+  ls.push_back(new cls_rgw_bucket_instance_entry);
+  ls.back()->reshard_status = RESHARD_STATUS::IN_LOGRECORD;
+  ls.back()->logrecord_expire = ceph::real_clock::from_time_t(1700000000);
 }
 
 void cls_rgw_lc_entry::dump(Formatter *f) const
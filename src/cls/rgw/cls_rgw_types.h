@@ -784,7 +784,10 @@ inline bool operator!=(const rgw_bucket_category_stats& lhs,
 enum class cls_rgw_reshard_status : uint8_t {
   NOT_RESHARDING  = 0,
   IN_PROGRESS     = 1,
-  DONE            = 2
+  DONE            = 2,
+  // the target index is being filled while writes continue; changes
+  // are recorded so they can be replayed before writes are blocked
+  IN_LOGRECORD    = 3
 };
 
 inline std::string to_string(const cls_rgw_reshard_status status)
@@ -796,6 +799,8 @@ inline std::string to_string(const cls_rgw_reshard_status status)
     return "in-progress";
   case cls_rgw_reshard_status::DONE:
     return "done";
+  case cls_rgw_reshard_status::IN_LOGRECORD:
+    return "in-logrecord";
   };
   return "Unknown reshard status";
 }
@@ -804,9 +809,12 @@ struct cls_rgw_bucket_instance_entry {
   using RESHARD_STATUS = cls_rgw_reshard_status;
   
   cls_rgw_reshard_status reshard_status{RESHARD_STATUS::NOT_RESHARDING};
+  // in IN_LOGRECORD, the time after which the reshard is considered
+  // abandoned unless it extends it. zero if it never expires
+  ceph::real_time logrecord_expire;
 
   void encode(ceph::buffer::list& bl) const {
-    ENCODE_START(3, 1, bl);
+    ENCODE_START(4, 1, bl);
     encode((uint8_t)reshard_status, bl);
     { // fields removed in v2 but added back as empty in v3
       std::string bucket_instance_id;
@@ -814,11 +822,12 @@ struct cls_rgw_bucket_instance_entry {
       int32_t num_shards{-1};
       encode(num_shards, bl);
     }
+    encode(logrecord_expire, bl);
     ENCODE_FINISH(bl);
   }
 
   void decode(ceph::buffer::list::const_iterator& bl) {
-    DECODE_START(3, bl);
+    DECODE_START(4, bl);
     uint8_t s;
     decode(s, bl);
     reshard_status = (cls_rgw_reshard_status)s;
@@ -828,6 +837,11 @@ struct cls_rgw_bucket_instance_entry {
       int32_t num_shards{-1};
       decode(num_shards, bl);
     }
+    if (struct_v >= 4) {
+      decode(logrecord_expire, bl);
+    } else {
+      logrecord_expire = ceph::real_time();
+    }
     DECODE_FINISH(bl);
   }
 
@@ -836,18 +850,31 @@ struct cls_rgw_bucket_instance_entry {
 
   void clear() {
     reshard_status = RESHARD_STATUS::NOT_RESHARDING;
+    logrecord_expire = ceph::real_time();
   }
 
   void set_status(cls_rgw_reshard_status s) {
     reshard_status = s;
   }
 
+  // true if writes to the index are blocked
   bool resharding() const {
-    return reshard_status != RESHARD_STATUS::NOT_RESHARDING;
+    return reshard_status != RESHARD_STATUS::NOT_RESHARDING &&
+      reshard_status != RESHARD_STATUS::IN_LOGRECORD;
   }
   bool resharding_in_progress() const {
     return reshard_status == RESHARD_STATUS::IN_PROGRESS;
   }
+  bool resharding_in_logrecord() const {
+    return reshard_status == RESHARD_STATUS::IN_LOGRECORD;
+  }
+  // the reshard that started recording stopped extending it, e.g. because
+  // its radosgw died; writes are blocked until it is cleared
+  bool logrecord_expired(ceph::real_time now) const {
+    return resharding_in_logrecord() &&
+      !ceph::real_clock::is_zero(logrecord_expire) &&
+      logrecord_expire < now;
+  }
 };
 WRITE_CLASS_ENCODER(cls_rgw_bucket_instance_entry)
 
@@ -911,6 +938,12 @@ struct rgw_bucket_dir_header {
   bool resharding_in_progress() const {
     return new_instance.resharding_in_progress();
   }
+  bool resharding_in_logrecord() const {
+    return new_instance.resharding_in_logrecord();
+  }
+  bool logrecord_expired(ceph::real_time now) const {
+    return new_instance.logrecord_expired(now);
+  }
 };
 WRITE_CLASS_ENCODER(rgw_bucket_dir_header)
 
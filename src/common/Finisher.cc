@@ -94,3 +94,110 @@ void *Finisher::finisher_thread_entry()
   return 0;
 }
 
+
+ShardedFinisher::ShardedFinisher(CephContext *cct_, std::string name,
+				 std::string tn, unsigned num_threads)
+  : cct(cct_), thread_name(tn)
+{
+  num_threads = std::max(num_threads, 1u);
+  for (unsigned i = 0; i < num_threads; ++i) {
+    shards.emplace_back(std::make_unique<Shard>(
+      this, "ShardedFinisher::" + name + "::" + std::to_string(i)));
+  }
+  PerfCountersBuilder b(cct, std::string("finisher-") + name,
+			l_finisher_first, l_finisher_last);
+  b.add_u64(l_finisher_queue_len, "queue_len");
+  b.add_time_avg(l_finisher_complete_lat, "complete_latency");
+  b.add_time_avg(l_finisher_queue_lat, "queue_latency",
+		 "Time a context waited before its completion started");
+  b.add_u64_avg(l_finisher_batch_size, "batch_size",
+		"Contexts completed per worker wakeup");
+  logger = b.create_perf_counters();
+  cct->get_perfcounters_collection()->add(logger);
+  logger->set(l_finisher_queue_len, 0);
+  logger->set(l_finisher_complete_lat, 0);
+}
+
+ShardedFinisher::~ShardedFinisher()
+{
+  if (logger && cct) {
+    cct->get_perfcounters_collection()->remove(logger);
+    delete logger;
+  }
+}
+
+void ShardedFinisher::start()
+{
+  ldout(cct, 10) << __func__ << " " << shards.size() << " threads" << dendl;
+  for (unsigned i = 0; i < shards.size(); ++i) {
+    auto name = shards.size() == 1 ? thread_name :
+      thread_name + std::to_string(i);
+    shards[i]->thread.create(name.c_str());
+  }
+}
+
+void ShardedFinisher::stop()
+{
+  ldout(cct, 10) << __func__ << dendl;
+  for (auto& s : shards) {
+    std::lock_guard l(s->lock);
+    s->stop = true;
+    s->cond.notify_all();
+  }
+  for (auto& s : shards) {
+    s->thread.join();
+  }
+  ldout(cct, 10) << __func__ << " finish" << dendl;
+}
+
+void ShardedFinisher::wait_for_empty()
+{
+  std::unique_lock ul(empty_lock);
+  while (outstanding) {
+    ldout(cct, 10) << "wait_for_empty waiting" << dendl;
+    empty_cond.wait(ul);
+  }
+  ldout(cct, 10) << "wait_for_empty empty" << dendl;
+}
+
+void *ShardedFinisher::Shard::entry()
+{
+  CephContext *cct = fin->cct;
+  PerfCounters *logger = fin->logger;
+  std::unique_lock ul(lock);
+  ldout(cct, 10) << "finisher_thread start" << dendl;
+
+  while (!stop) {
+    while (!queue.empty()) {
+      in_progress.swap(queue);
+      ul.unlock();
+
+      const auto start = ceph::mono_clock::now();
+      if (logger) {
+	for (auto& i : in_progress) {
+	  logger->tinc(l_finisher_queue_lat, start - i.queued);
+	}
+	logger->inc(l_finisher_batch_size, in_progress.size());
+      }
+      for (auto& i : in_progress) {
+	i.c->complete(i.r);
+      }
+      if (logger) {
+	logger->dec(l_finisher_queue_len, in_progress.size());
+	logger->tinc(l_finisher_complete_lat, ceph::mono_clock::now() - start);
+      }
+      const auto n = in_progress.size();
+      in_progress.clear();
+      fin->put_outstanding(n);
+
+      ul.lock();
+    }
+    if (stop)
+      break;
+    cond.wait(ul);
+  }
+
+  ldout(cct, 10) << "finisher_thread stop" << dendl;
+  stop = false;
+  return 0;
+}
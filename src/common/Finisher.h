@@ -15,12 +15,16 @@
 #ifndef CEPH_FINISHER_H
 #define CEPH_FINISHER_H
 
+#include <atomic>
+#include <memory>
+
 #include "include/Context.h"
 #include "include/common_fwd.h"
 #include "common/Thread.h"
 #include "common/ceph_mutex.h"
 #include "common/perf_counters.h"
 #include "common/Cond.h"
+#include "common/ceph_time.h"
 
 
 /// Finisher queue length performance counter ID.
@@ -28,6 +32,8 @@ enum {
   l_finisher_first = 997082,
   l_finisher_queue_len,
   l_finisher_complete_lat,
+  l_finisher_queue_lat,   ///< ShardedFinisher only
+  l_finisher_batch_size,  ///< ShardedFinisher only
   l_finisher_last
 };
 
@@ -167,6 +173,152 @@ class Finisher {
   }
 };
 
+/** @brief Finisher with several worker threads.
+ * Contexts queued with the same lane key are completed in order on the
+ * same thread; contexts in different lanes may complete concurrently
+ * and in any order.  Contexts queued without a key go to any thread,
+ * so use that only where the caller does not depend on ordering.
+ *
+ * Each wakeup of a worker completes everything queued to it since the
+ * last one, so the locking cost per context falls as the load rises.
+ * With one thread this behaves like Finisher.
+ */
+class ShardedFinisher {
+  struct Item {
+    Context *c;
+    int r;
+    ceph::mono_time queued;
+  };
+
+  struct Shard {
+    ShardedFinisher *fin;
+    ceph::mutex lock;
+    ceph::condition_variable cond;
+    bool stop = false;
+    std::vector<Item> queue;
+    std::vector<Item> in_progress;
+
+    void *entry();
+
+    struct ShardThread : public Thread {
+      Shard *shard;
+      explicit ShardThread(Shard *s) : shard(s) {}
+      void* entry() override { return shard->entry(); }
+    } thread;
+
+    Shard(ShardedFinisher *f, const std::string& name)
+      : fin(f), lock(ceph::make_mutex(name)), thread(this) {}
+  };
+
+  CephContext *cct;
+  std::string thread_name;
+  std::vector<std::unique_ptr<Shard>> shards;
+  std::atomic<unsigned> next_shard = {0};
+  PerfCounters *logger = nullptr;
+
+  // contexts queued or completing on any shard.  a context may queue more
+  // work onto another shard, so emptiness is only meaningful across all of
+  // them; counted before the push and released after the completion, this
+  // never reads zero while such a chain is still going.
+  std::atomic<uint64_t> outstanding = {0};
+  ceph::mutex empty_lock = ceph::make_mutex("ShardedFinisher::empty_lock");
+  ceph::condition_variable empty_cond;
+
+  void put_outstanding(uint64_t n) {
+    if (outstanding.fetch_sub(n) == n) {
+      std::lock_guard l(empty_lock);
+      empty_cond.notify_all();
+    }
+  }
+
+  Shard& shard_for(uint64_t lane) {
+    // lanes are often pointers; mix so alignment does not skew the choice
+    return *shards[((lane * 0x9e3779b97f4a7c15ull) >> 32) % shards.size()];
+  }
+  Shard& any_shard() {
+    return *shards[next_shard++ % shards.size()];
+  }
+
+  void queue_lane(Shard& s, Context *c, int r) {
+    ++outstanding;
+    {
+      std::unique_lock ul(s.lock);
+      bool was_empty = s.queue.empty();
+      s.queue.push_back(Item{c, r, ceph::mono_clock::now()});
+      if (was_empty) {
+	s.cond.notify_one();
+      }
+      if (logger)
+	logger->inc(l_finisher_queue_len);
+    }
+  }
+  template <typename It>
+  void _queue(Shard& s, It first, It last, std::size_t n) {
+    auto now = ceph::mono_clock::now();
+    outstanding += n;
+    {
+      std::unique_lock ul(s.lock);
+      bool was_empty = s.queue.empty();
+      for (; first != last; ++first) {
+	s.queue.push_back(Item{*first, 0, now});
+      }
+      if (was_empty) {
+	s.cond.notify_one();
+      }
+      if (logger)
+	logger->inc(l_finisher_queue_len, n);
+    }
+  }
+
+ public:
+  /// Add a context to complete on any thread.
+  void queue(Context *c, int r = 0) {
+    queue_lane(any_shard(), c, r);
+  }
+  /// Add a context to complete after everything queued to @p lane before it.
+  void queue(uint64_t lane, Context *c, int r = 0) {
+    queue_lane(shard_for(lane), c, r);
+  }
+
+  /// Add contexts to complete, in order, on any thread.
+  template <typename C>
+  void queue(C& ls) {
+    _queue(any_shard(), ls.begin(), ls.end(), ls.size());
+    ls.clear();
+  }
+  /// Add contexts to complete, in order, after everything queued to @p lane.
+  template <typename C>
+  void queue(uint64_t lane, C& ls) {
+    _queue(shard_for(lane), ls.begin(), ls.end(), ls.size());
+    ls.clear();
+  }
+
+  /// Start the worker threads.
+  void start();
+
+  /** @brief Stop the worker threads.
+   *
+   * As with Finisher::stop(), outstanding contexts are not waited for;
+   * call wait_for_empty() first. */
+  void stop();
+
+  /** @brief Blocks until no thread has anything left to process.
+   *
+   * This includes anything a completing context queues, on any shard,
+   * before it returns. */
+  void wait_for_empty();
+
+  unsigned get_num_threads() const {
+    return shards.size();
+  }
+
+  /// Construct a named finisher with @p num_threads worker threads.
+  ShardedFinisher(CephContext *cct_, std::string name, std::string tn,
+		  unsigned num_threads);
+  ~ShardedFinisher();
+
+};
+
 /// Context that is completed asynchronously on the supplied finisher.
 class C_OnFinisher : public Context {
   Context *con;
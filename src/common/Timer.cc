@@ -20,8 +20,6 @@
 #undef dout_prefix
 #define dout_prefix *_dout << "timer(" << this << ")."
 
-using std::pair;
-
 using ceph::operator <<;
 
 template <class Mutex>
@@ -83,16 +81,10 @@ void CommonSafeTimer<Mutex>::timer_thread()
   while (!stopping) {
     auto now = clock_t::now();
 
-    while (!schedule.empty()) {
-      auto p = schedule.begin();
-
-      // is the future now?
-      if (p->first > now)
-	break;
-
-      Context *callback = p->second;
+    schedule.advance(now);
+    while (auto p = schedule.pop_due()) {
+      Context *callback = static_cast<event_t*>(p)->callback;
       events.erase(callback);
-      schedule.erase(p);
       ldout(cct,10) << "timer_thread executing " << callback << dendl;
       
       if (!safe_callbacks) {
@@ -112,7 +104,7 @@ void CommonSafeTimer<Mutex>::timer_thread()
     if (schedule.empty()) {
       cond.wait(l);
     } else {
-      auto when = schedule.begin()->first;
+      auto when = schedule.next_expiry();
       cond.wait_until(l, when);
     }
     ldout(cct,20) << "timer_thread awake" << dendl;
@@ -145,18 +137,17 @@ Context* CommonSafeTimer<Mutex>::add_event_at(CommonSafeTimer<Mutex>::clock_t::t
     delete callback;
     return nullptr;
   }
-  scheduled_map_t::value_type s_val(when, callback);
-  scheduled_map_t::iterator i = schedule.insert(s_val);
-
-  event_lookup_map_t::value_type e_val(callback, i);
-  pair < event_lookup_map_t::iterator, bool > rval(events.insert(e_val));
+  auto [p, inserted] = events.try_emplace(callback);
 
   /* If you hit this, you tried to insert the same Context* twice. */
-  ceph_assert(rval.second);
+  ceph_assert(inserted);
 
   /* If the event we have just inserted comes before everything else, we need to
    * adjust our timeout. */
-  if (i == schedule.begin())
+  auto prev = schedule.next_expiry();
+  p->second.callback = callback;
+  schedule.add(p->second, when);
+  if (schedule.next_expiry() < prev)
     cond.notify_all();
   return callback;
 }
@@ -185,10 +176,10 @@ bool CommonSafeTimer<Mutex>::cancel_event(Context *callback)
     return false;
   }
 
-  ldout(cct,10) << "cancel_event " << p->second->first << " -> " << callback << dendl;
+  ldout(cct,10) << "cancel_event " << p->second.get_when() << " -> " << callback << dendl;
   delete p->first;
 
-  schedule.erase(p->second);
+  schedule.remove(p->second);
   events.erase(p);
   return true;
 }
@@ -201,9 +192,9 @@ void CommonSafeTimer<Mutex>::cancel_all_events()
 
   while (!events.empty()) {
     auto p = events.begin();
-    ldout(cct,10) << " cancelled " << p->second->first << " -> " << p->first << dendl;
+    ldout(cct,10) << " cancelled " << p->second.get_when() << " -> " << p->first << dendl;
     delete p->first;
-    schedule.erase(p->second);
+    schedule.remove(p->second);
     events.erase(p);
   }
 }
@@ -215,10 +206,8 @@ void CommonSafeTimer<Mutex>::dump(const char *caller) const
     caller = "";
   ldout(cct,10) << "dump " << caller << dendl;
 
-  for (scheduled_map_t::const_iterator s = schedule.begin();
-       s != schedule.end();
-       ++s)
-    ldout(cct,10) << " " << s->first << "->" << s->second << dendl;
+  for (auto& [callback, e] : events)
+    ldout(cct,10) << " " << e.get_when() << "->" << callback << dendl;
 }
 
 template class CommonSafeTimer<ceph::mutex>;
@@ -15,11 +15,12 @@
 #ifndef CEPH_TIMER_H
 #define CEPH_TIMER_H
 
-#include <map>
+#include <unordered_map>
 #include "include/common_fwd.h"
 #include "ceph_time.h"
 #include "ceph_mutex.h"
 #include "fair_mutex.h"
+#include "timer_wheel.h"
 #include <condition_variable>
 
 class Context;
@@ -41,9 +42,14 @@ class CommonSafeTimer
   void _shutdown();
 
   using clock_t = ceph::mono_clock;
-  using scheduled_map_t = std::multimap<clock_t::time_point, Context*>;
-  scheduled_map_t schedule;
-  using event_lookup_map_t = std::map<Context*, scheduled_map_t::iterator>;
+  // events are kept in a timing wheel so that adding and cancelling
+  // stay O(1) with many outstanding timeouts
+  using schedule_t = ceph::timer_wheel<clock_t>;
+  struct event_t : schedule_t::node {
+    Context *callback = nullptr;
+  };
+  schedule_t schedule;
+  using event_lookup_map_t = std::unordered_map<Context*, event_t>;
   event_lookup_map_t events;
   bool stopping;
 
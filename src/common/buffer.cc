@@ -12,6 +12,8 @@
  *
  */
 
+#include <algorithm>
+#include <array>
 #include <atomic>
 #include <cstring>
 #include <errno.h>
@@ -25,6 +27,7 @@
 #include "include/compat.h"
 #include "include/mempool.h"
 #include "armor.h"
+#include "common/ceph_time.h"
 #include "common/environment.h"
 #include "common/errno.h"
 #include "common/error_code.h"
@@ -81,6 +84,291 @@ static ceph::spinlock debug_lock;
     return buffer_missed_crc;
   }
 
+  static ceph::atomic<uint64_t> buffer_slab_hits { 0 };
+  static ceph::atomic<uint64_t> buffer_slab_misses { 0 };
+
+  static bool buffer_track_slab = get_env_bool("CEPH_BUFFER_TRACK");
+  // the caches hide use-after-free from valgrind/ASan; allow opting out
+  static const bool buffer_slab_enabled = !get_env_bool("CEPH_BUFFER_NO_SLAB");
+
+  void buffer::track_slab_cache(bool b) {
+    buffer_track_slab = b;
+  }
+  uint64_t buffer::get_slab_cache_hits() {
+    return buffer_slab_hits;
+  }
+  uint64_t buffer::get_slab_cache_misses() {
+    return buffer_slab_misses;
+  }
+
+  /*
+   * Per-thread caches of fixed-size blocks for ptr_node and small
+   * raw_combined buffers.
+   *
+   * Every block is its own heap allocation, so any thread may cache a
+   * block that another thread allocated.  A thread whose cache overflows
+   * hands a batch of blocks to a shared depot, which is where a thread
+   * with an empty cache refills from.  This keeps the usual pattern of
+   * allocating on a messenger thread and releasing on a worker off the
+   * heap without any cross-thread synchronization per block.
+   *
+   * Cached blocks are counted in mempool buffer_slab; a thread's count is
+   * brought up to date when it goes to the depot, so it may lag by a
+   * couple of batches.  Batches that sit in the depot for a whole
+   * trim_interval without being needed are freed.
+   */
+  template <std::size_t BlockSize, std::size_t Align>
+  class slab_cache {
+  public:
+    static constexpr std::size_t block_size = BlockSize;
+    static constexpr std::size_t align = Align;
+
+    static void* allocate() {
+#ifndef WITH_SEASTAR
+      if (auto& tc = local; likely(buffer_slab_enabled && !tc.destructed)) {
+	if (tc.n == 0) {
+	  refill(tc);
+	}
+	if (tc.n > 0) {
+	  if (buffer_track_slab) {
+	    buffer_slab_hits++;
+	  }
+	  return tc.blocks[--tc.n];
+	}
+      }
+#endif
+      if (buffer_track_slab) {
+	buffer_slab_misses++;
+      }
+      return heap_allocate();
+    }
+
+    static void deallocate(void* p) {
+#ifndef WITH_SEASTAR
+      if (auto& tc = local; likely(buffer_slab_enabled && !tc.destructed)) {
+	if (tc.n == tc.blocks.size()) {
+	  spill(tc);
+	}
+	tc.blocks[tc.n++] = p;
+	return;
+      }
+#endif
+      aligned_free(p);
+    }
+
+  private:
+    // keep roughly 32KB per batch, and at most 4MB per size class in
+    // the depot
+    static constexpr std::size_t batch_len =
+      std::clamp<std::size_t>(32768 / BlockSize, 4, 64);
+    static constexpr std::size_t max_depot_batches =
+      std::max<std::size_t>((4u << 20) / (BlockSize * batch_len), 1);
+    static constexpr auto trim_interval = std::chrono::seconds(5);
+
+    using batch_t = std::array<void*, batch_len>;
+
+    struct depot_t {
+      ceph::spinlock lock;
+      std::vector<batch_t> batches; // oldest first
+      // fewest batches held since the last trim
+      std::size_t low_water = 0;
+      ceph::coarse_mono_time last_trim;
+    };
+
+    struct thread_cache {
+      std::array<void*, 2 * batch_len> blocks;
+      std::size_t n = 0;
+      std::size_t accounted = 0; // blocks counted in the mempool
+      // like CachedStackStringStream's cache, we may be destructed
+      // before other thread_locals that still release buffers
+      bool destructed = false;
+
+      ~thread_cache() {
+	while (n >= batch_len) {
+	  spill(*this);
+	}
+	while (n > 0) {
+	  aligned_free(blocks[--n]);
+	}
+	account(*this, 0);
+	destructed = true;
+      }
+    };
+
+    static void* heap_allocate() {
+#ifdef DARWIN
+      void *p = valloc(BlockSize);
+#else
+      void *p = nullptr;
+      if (::posix_memalign(&p, Align, BlockSize)) {
+	throw buffer::bad_alloc();
+      }
+#endif
+      if (!p) {
+	throw buffer::bad_alloc();
+      }
+      return p;
+    }
+
+    static depot_t& depot() {
+      // never destroyed: threads may still release buffers during exit
+      static depot_t* d = new depot_t;
+      return *d;
+    }
+
+    /// count @p tc's blocks and @p depot_delta blocks added to the depot
+    static void account(thread_cache& tc, ssize_t depot_delta) {
+      const ssize_t delta = depot_delta + (ssize_t)tc.n - (ssize_t)tc.accounted;
+      tc.accounted = tc.n;
+      if (delta != 0) {
+	mempool::get_pool(mempool::mempool_buffer_slab).adjust_count(
+	  delta, delta * (ssize_t)BlockSize);
+      }
+    }
+
+    /// with the depot locked, take out the batches it held on to for a
+    /// whole trim_interval without needing them, to be freed once unlocked
+    static void trim(depot_t& d, std::vector<batch_t>* unused) {
+      const auto now = ceph::coarse_mono_clock::now();
+      if (now - d.last_trim < trim_interval) {
+	return;
+      }
+      d.last_trim = now;
+      if (d.low_water > 0) {
+	auto end = d.batches.begin() + d.low_water;
+	unused->assign(d.batches.begin(), end);
+	d.batches.erase(d.batches.begin(), end);
+      }
+      d.low_water = d.batches.size();
+    }
+
+    static void free_batches(const std::vector<batch_t>& batches) {
+      for (auto& b : batches) {
+	std::for_each(b.begin(), b.end(), aligned_free);
+      }
+      if (!batches.empty()) {
+	const ssize_t blocks = batches.size() * batch_len;
+	mempool::get_pool(mempool::mempool_buffer_slab).adjust_count(
+	  -blocks, -blocks * (ssize_t)BlockSize);
+      }
+    }
+
+    static void refill(thread_cache& tc) {
+      auto& d = depot();
+      std::vector<batch_t> unused;
+      ssize_t taken = 0;
+      {
+	std::lock_guard l(d.lock);
+	if (!d.batches.empty()) {
+	  auto& b = d.batches.back();
+	  std::copy(b.begin(), b.end(), tc.blocks.begin());
+	  tc.n = b.size();
+	  taken = b.size();
+	  d.batches.pop_back();
+	  d.low_water = std::min(d.low_water, d.batches.size());
+	}
+	trim(d, &unused);
+      }
+      account(tc, -taken);
+      free_batches(unused);
+    }
+
+    /// move the newest batch_len blocks of @p tc to the depot (or heap)
+    static void spill(thread_cache& tc) {
+      tc.n -= batch_len;
+      auto first = tc.blocks.begin() + tc.n;
+      auto& d = depot();
+      std::vector<batch_t> unused;
+      bool kept = false;
+      {
+	std::lock_guard l(d.lock);
+	trim(d, &unused);
+	if (d.batches.size() < max_depot_batches) {
+	  std::copy(first, first + batch_len, d.batches.emplace_back().begin());
+	  kept = true;
+	}
+      }
+      if (!kept) {
+	std::for_each(first, first + batch_len, aligned_free);
+      }
+      account(tc, kept ? batch_len : 0);
+      free_batches(unused);
+    }
+
+    static thread_local thread_cache local;
+  };
+
+  template <std::size_t BlockSize, std::size_t Align>
+  thread_local typename slab_cache<BlockSize, Align>::thread_cache
+  slab_cache<BlockSize, Align>::local;
+
+  using ptr_node_cache =
+    slab_cache<round_up_to(sizeof(buffer::ptr_node), alignof(std::max_align_t)),
+	       alignof(std::max_align_t)>;
+
+  void* buffer::ptr_node::operator new(size_t size) {
+    ceph_assert(size == sizeof(ptr_node));
+    mempool::get_pool(mempool::mempool_buffer_meta).adjust_count(1, size);
+    return ptr_node_cache::allocate();
+  }
+
+  void buffer::ptr_node::operator delete(void* p) {
+    mempool::get_pool(mempool::mempool_buffer_meta).adjust_count(
+      -1, -(int)sizeof(ptr_node));
+    ptr_node_cache::deallocate(p);
+  }
+
+  // size classes for the total (data + raw_combined) allocation of small
+  // buffers; CEPH_BUFFER_ALLOC_UNIT is what append() refills with.
+  static constexpr std::size_t raw_slab_align = 64;
+  using raw_cache_512 = slab_cache<512, raw_slab_align>;
+  using raw_cache_1k = slab_cache<1024, raw_slab_align>;
+  using raw_cache_2k = slab_cache<2048, raw_slab_align>;
+  using raw_cache_4k = slab_cache<CEPH_BUFFER_ALLOC_UNIT, raw_slab_align>;
+
+  enum : uint8_t {
+    RAW_SLAB_NONE = 0,
+    RAW_SLAB_512,
+    RAW_SLAB_1K,
+    RAW_SLAB_2K,
+    RAW_SLAB_4K,
+  };
+
+  static uint8_t raw_slab_class(std::size_t total, unsigned align) {
+    if (align > raw_slab_align) {
+      return RAW_SLAB_NONE;
+    } else if (total <= raw_cache_512::block_size) {
+      return RAW_SLAB_512;
+    } else if (total <= raw_cache_1k::block_size) {
+      return RAW_SLAB_1K;
+    } else if (total <= raw_cache_2k::block_size) {
+      return RAW_SLAB_2K;
+    } else if (total <= raw_cache_4k::block_size) {
+      return RAW_SLAB_4K;
+    }
+    return RAW_SLAB_NONE;
+  }
+
+  static void* raw_slab_allocate(uint8_t cls) {
+    switch (cls) {
+    case RAW_SLAB_512: return raw_cache_512::allocate();
+    case RAW_SLAB_1K: return raw_cache_1k::allocate();
+    case RAW_SLAB_2K: return raw_cache_2k::allocate();
+    case RAW_SLAB_4K: return raw_cache_4k::allocate();
+    }
+    ceph_abort();
+  }
+
+  static void raw_slab_deallocate(uint8_t cls, void* p) {
+    switch (cls) {
+    case RAW_SLAB_512: return raw_cache_512::deallocate(p);
+    case RAW_SLAB_1K: return raw_cache_1k::deallocate(p);
+    case RAW_SLAB_2K: return raw_cache_2k::deallocate(p);
+    case RAW_SLAB_4K: return raw_cache_4k::deallocate(p);
+    }
+    ceph_abort();
+  }
+
   /*
    * raw_combined is always placed within a single allocation along
    * with the data buffer.  the data goes at the beginning, and
@@ -88,8 +376,8 @@ static ceph::spinlock debug_lock;
    */
   class buffer::raw_combined : public buffer::raw {
   public:
-    raw_combined(char *dataptr, unsigned l, int mempool)
-      : raw(dataptr, l, mempool) {
+    raw_combined(char *dataptr, unsigned l, int mempool, uint8_t cls)
+      : raw(dataptr, l, mempool), slab_class(cls) {
     }
 
     static ceph::unique_leakable_ptr<buffer::raw>
@@ -103,27 +391,39 @@ static ceph::spinlock debug_lock;
 				  alignof(buffer::raw_combined));
       size_t datalen = round_up_to(len, alignof(buffer::raw_combined));
 
+      char *ptr = 0;
+      const uint8_t slab_class = raw_slab_class(rawlen + datalen, align);
+      if (slab_class != RAW_SLAB_NONE) {
+	ptr = (char *)raw_slab_allocate(slab_class);
+      } else {
 #ifdef DARWIN
-      char *ptr = (char *) valloc(rawlen + datalen);
+	ptr = (char *) valloc(rawlen + datalen);
 #else
-      char *ptr = 0;
-      int r = ::posix_memalign((void**)(void*)&ptr, align, rawlen + datalen);
-      if (r)
-	throw bad_alloc();
+	int r = ::posix_memalign((void**)(void*)&ptr, align, rawlen + datalen);
+	if (r)
+	  throw bad_alloc();
 #endif /* DARWIN */
+      }
       if (!ptr)
 	throw bad_alloc();
 
       // actual data first, since it has presumably larger alignment restriction
       // then put the raw_combined at the end
       return ceph::unique_leakable_ptr<buffer::raw>(
-	new (ptr + datalen) raw_combined(ptr, len, mempool));
+	new (ptr + datalen) raw_combined(ptr, len, mempool, slab_class));
     }
 
     static void operator delete(void *ptr) {
       raw_combined *raw = (raw_combined *)ptr;
-      aligned_free((void *)raw->data);
+      if (raw->slab_class != RAW_SLAB_NONE) {
+	raw_slab_deallocate(raw->slab_class, (void *)raw->data);
+      } else {
+	aligned_free((void *)raw->data);
+      }
     }
+
+  private:
+    const uint8_t slab_class;
   };
 
   class buffer::raw_malloc : public buffer::raw {
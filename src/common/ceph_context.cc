@@ -283,6 +283,8 @@ public:
       "log_file",
       "log_max_new",
       "log_max_recent",
+      "log_thread_ring_size",
+      "log_file_format",
       "log_to_file",
       "log_to_syslog",
       "err_to_syslog",
@@ -342,6 +344,14 @@ public:
       log->set_max_recent(conf->log_max_recent);
     }
 
+    if (changed.count("log_thread_ring_size")) {
+      log->set_thread_ring_size(conf.get_val<uint64_t>("log_thread_ring_size"));
+    }
+
+    if (changed.count("log_file_format")) {
+      log->set_binary(conf.get_val<std::string>("log_file_format") == "binary");
+    }
+
     // graylog
     if (changed.count("log_to_graylog") || changed.count("err_to_graylog")) {
       int l = conf->log_to_graylog ? 99 : (conf->err_to_graylog ? -1 : -2);
@@ -28,6 +28,7 @@
 #include "include/compat.h"
 
 #include "common/detail/construct_suspended.h"
+#include "common/timer_wheel.h"
 
 namespace bi = boost::intrusive;
 namespace ceph {
@@ -46,32 +47,31 @@ namespace ceph {
 // you want to wait UNTIL a specific moment of wallclock time.  If
 // you want you can set up a timer that executes a function after
 // you use up ten seconds of CPU time.
+//
+// Events are kept in a timer_wheel, so scheduling and cancelling do
+// not slow down with the number of outstanding events; an event may
+// run up to a millisecond after its deadline.
 
 template<typename TC>
 class timer {
   using sh = bi::set_member_hook<bi::link_mode<bi::normal_link>>;
+  using schedule_t = timer_wheel<TC>;
 
-  struct event {
-    typename TC::time_point t = typename TC::time_point::min();
+  struct event : schedule_t::node {
     std::uint64_t id = 0;
     fu2::unique_function<void()> f;
 
-    sh schedule_link;
     sh event_link;
 
     event() = default;
-    event(typename TC::time_point t, std::uint64_t id,
-	  fu2::unique_function<void()> f) : t(t), id(id), f(std::move(f)) {}
+    event(std::uint64_t id, fu2::unique_function<void()> f)
+      : id(id), f(std::move(f)) {}
 
     event(const event&) = delete;
     event& operator =(const event&) = delete;
 
     event(event&&) = delete;
     event& operator =(event&&) = delete;
-
-    bool operator <(const event& e) const noexcept {
-      return t == e.t ? id < e.id : t < e.t;
-    }
   };
   struct id_key {
     using type = std::uint64_t;
@@ -80,8 +80,7 @@ class timer {
     }
   };
 
-  bi::set<event, bi::member_hook<event, sh, &event::schedule_link>,
-	  bi::constant_time_size<false>> schedule;
+  schedule_t schedule;
 
   bi::set<event, bi::member_hook<event, sh, &event::event_link>,
 	  bi::constant_time_size<false>,
@@ -99,16 +98,10 @@ class timer {
   void timer_thread() {
     std::unique_lock l(lock);
     while (!suspended) {
-      auto now = TC::now();
+      schedule.advance(TC::now());
 
-      while (!schedule.empty()) {
-	auto p = schedule.begin();
-	// Should we wait for the future?
-	if (p->t > now)
-	  break;
-
-	auto& e = *p;
-	schedule.erase(e);
+      while (auto p = schedule.pop_due()) {
+	auto& e = static_cast<event&>(*p);
 	events.erase(e.id);
 
 	// Since we have only one thread it is impossible to have more
@@ -116,7 +109,7 @@ class timer {
 	running = &e;
 
 	l.unlock();
-	p->f();
+	e.f();
 	l.lock();
 
 	if (running) {
@@ -130,10 +123,7 @@ class timer {
       if (schedule.empty()) {
 	cond.wait(l);
       } else {
-	// Since wait_until takes its parameter by reference, passing
-	// the time /in the event/ is unsafe, as it might be canceled
-	// while we wait.
-	const auto t = schedule.begin()->t;
+	const auto t = schedule.next_expiry();
 	cond.wait_until(l, t);
       }
     }
@@ -195,16 +185,18 @@ public:
   std::uint64_t add_event(typename TC::time_point when,
 			  Callable&& f, Args&&... args) {
     std::lock_guard l(lock);
-    auto e = std::make_unique<event>(when, ++next_id,
+    auto e = std::make_unique<event>(++next_id,
 				     std::bind(std::forward<Callable>(f),
 					       std::forward<Args>(args)...));
     auto id = e->id;
-    auto i = schedule.insert(*e);
-    events.insert(*(e.release()));
+    auto prev = schedule.next_expiry();
+    schedule.add(*e, when);
+    // ids only grow, so this is amortized constant time
+    events.insert(events.end(), *(e.release()));
 
     /* If the event we have just inserted comes before everything
      * else, we need to adjust our timeout. */
-    if (i.first == schedule.begin())
+    if (schedule.next_expiry() < prev)
       cond.notify_one();
 
     // Previously each event was a context, identified by a
@@ -232,9 +224,11 @@ public:
 
     auto& e = *it;
 
-    schedule.erase(e);
-    e.t = when;
-    schedule.insert(e);
+    auto prev = schedule.next_expiry();
+    schedule.remove(e);
+    schedule.add(e, when);
+    if (schedule.next_expiry() < prev)
+      cond.notify_one();
 
     return true;
   }
@@ -251,7 +245,7 @@ public:
 
     auto& e = *p;
     events.erase(e.id);
-    schedule.erase(e);
+    schedule.remove(e);
     delete &e;
 
     return true;
@@ -282,11 +276,10 @@ public:
   std::uint64_t reschedule_me(typename TC::time_point when) {
     assert(std::this_thread::get_id() == thread.get_id());
     std::lock_guard l(lock);
-    running->t = when;
     std::uint64_t id = ++next_id;
     running->id = id;
-    schedule.insert(*running);
-    events.insert(*running);
+    schedule.add(*running, when);
+    events.insert(events.end(), *running);
 
     // Hacky, but keeps us from being deleted
     running = nullptr;
@@ -301,7 +294,7 @@ public:
     while (!events.empty()) {
       auto p = events.begin();
       event& e = *p;
-      schedule.erase(e);
+      schedule.remove(e);
       events.erase(e.id);
       delete &e;
     }
@@ -1,6 +1,9 @@
 #ifndef CEPH_LRU_MAP_H
 #define CEPH_LRU_MAP_H
 
+#include <list>
+#include <map>
+
 #include "common/ceph_mutex.h"
 
 template <class K, class V>
@@ -0,0 +1,301 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef COMMON_TIMER_WHEEL_H
+#define COMMON_TIMER_WHEEL_H
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+#include <boost/intrusive/list.hpp>
+
+namespace ceph {
+
+/**
+ * Hierarchical hashed timing wheel.
+ *
+ * Time is cut into ticks of a fixed length counted from the moment the
+ * wheel was constructed.  Level 0 holds one slot per tick for the next
+ * 64 ticks, level 1 one slot per 64 ticks for the next 64^2, and so on;
+ * anything further out than the top level sits in an overflow list.
+ * A node is linked into the slot for its expiry at the lowest level
+ * that shares all higher digits with the current tick, so add() and
+ * remove() are O(1).  When the current tick reaches the start of a
+ * higher level slot its nodes are cascaded down a level.
+ *
+ * Expiry is rounded up to a whole tick, so a node never becomes due
+ * before its deadline but may become due up to one tick after it.
+ * Nodes that become due in the same advance() are handed out in
+ * (deadline, insertion) order.
+ *
+ * The wheel does no locking and owns no memory; callers embed (or
+ * derive from) a node and keep it alive while it is linked.
+ */
+template <typename Clock>
+class timer_wheel {
+public:
+  using clock_type = Clock;
+  using time_point = typename Clock::time_point;
+  using duration = typename Clock::duration;
+
+  class node {
+    friend class timer_wheel;
+    boost::intrusive::list_member_hook<> link;
+    time_point when;
+    std::uint64_t seq = 0;
+    std::uint64_t expires = 0;  ///< deadline in ticks, rounded up
+    std::uint8_t level = 0;
+    std::uint8_t slot = 0;
+  public:
+    node() = default;
+    node(const node&) = delete;
+    node& operator=(const node&) = delete;
+
+    time_point get_when() const {
+      return when;
+    }
+    bool is_linked() const {
+      return link.is_linked();
+    }
+  };
+
+  explicit timer_wheel(duration tick = std::chrono::milliseconds(1),
+		       time_point base = Clock::now())
+    : tick(std::max(tick, duration(1))), base(base) {}
+  timer_wheel(const timer_wheel&) = delete;
+  timer_wheel& operator=(const timer_wheel&) = delete;
+  ~timer_wheel() {
+    clear();
+  }
+
+  bool empty() const {
+    return count == 0;
+  }
+  std::size_t size() const {
+    return count;
+  }
+
+  /// schedule @p n, which must not be linked, to become due at @p when
+  void add(node& n, time_point when) {
+    n.when = when;
+    n.seq = next_seq++;
+    n.expires = std::max(to_tick_ceil(when), current + 1);
+    place(n);
+    ++count;
+  }
+
+  /// unlink @p n, whether it is still pending or already due
+  void remove(node& n) {
+    list_for(n).erase(list_t::s_iterator_to(n));
+    if (n.level < LEVELS && wheel[n.level][n.slot].empty()) {
+      occupied[n.level] &= ~(std::uint64_t(1) << n.slot);
+    }
+    --count;
+  }
+
+  /// unlink everything
+  void clear() {
+    for (unsigned l = 0; l < LEVELS; ++l) {
+      for (auto& s : wheel[l]) {
+	s.clear();
+      }
+      occupied[l] = 0;
+    }
+    overflow.clear();
+    due.clear();
+    count = 0;
+  }
+
+  /// move every node whose deadline is at or before @p now to the due list
+  void advance(time_point now) {
+    const std::uint64_t target = to_tick_floor(now);
+    if (target <= current) {
+      return;
+    }
+    for (;;) {
+      const std::uint64_t t = next_tick();
+      if (t > target) {
+	current = target;
+	break;
+      }
+      current = t;
+      if ((t & low_mask(LEVELS)) == 0) {
+	cascade(overflow);
+      }
+      for (unsigned l = LEVELS - 1; l > 0; --l) {
+	if ((t & low_mask(l)) == 0) {
+	  cascade_slot(l, digit(t, l));
+	}
+      }
+      cascade_slot(0, digit(t, 0));
+    }
+    if (!expired.empty()) {
+      std::sort(expired.begin(), expired.end(),
+		[](const node* a, const node* b) {
+		  return a->when == b->when ? a->seq < b->seq : a->when < b->when;
+		});
+      for (auto n : expired) {
+	n->level = DUE;
+	due.push_back(*n);
+      }
+      expired.clear();
+    }
+  }
+
+  /// unlink and return the first due node, or nullptr
+  node* pop_due() {
+    if (due.empty()) {
+      return nullptr;
+    }
+    node& n = due.front();
+    due.pop_front();
+    --count;
+    return &n;
+  }
+
+  /**
+   * When advance() next has work to do: the deadline of the earliest
+   * level 0 slot, the time a higher level slot must be cascaded, or
+   * a time in the past if nodes are already due.  time_point::max() if
+   * the wheel is empty.
+   */
+  time_point next_expiry() const {
+    if (!due.empty()) {
+      return to_time(current);
+    }
+    const std::uint64_t t = next_tick();
+    return t == NEVER ? time_point::max() : to_time(t);
+  }
+
+private:
+  static constexpr unsigned BITS = 6;
+  static constexpr unsigned SLOTS = 1u << BITS;
+  static constexpr unsigned LEVELS = 6;
+  static constexpr std::uint8_t OVERFLOW = LEVELS;
+  static constexpr std::uint8_t DUE = LEVELS + 1;
+  static constexpr std::uint64_t NEVER = UINT64_MAX;
+
+  using list_t = boost::intrusive::list<
+    node,
+    boost::intrusive::member_hook<node, boost::intrusive::list_member_hook<>,
+				  &node::link>,
+    boost::intrusive::constant_time_size<false>>;
+
+  const duration tick;
+  const time_point base;
+  std::uint64_t current = 0;  ///< every tick <= current has been processed
+  std::uint64_t next_seq = 0;
+  std::size_t count = 0;
+  std::array<std::uint64_t, LEVELS> occupied = {};  ///< non-empty slots
+  std::array<std::array<list_t, SLOTS>, LEVELS> wheel;
+  list_t overflow;
+  list_t due;
+  std::vector<node*> expired;
+
+  static constexpr std::uint64_t low_mask(unsigned level) {
+    return (std::uint64_t(1) << (BITS * level)) - 1;
+  }
+  static constexpr unsigned digit(std::uint64_t t, unsigned level) {
+    return (t >> (BITS * level)) & (SLOTS - 1);
+  }
+
+  std::uint64_t to_tick_floor(time_point t) const {
+    return t <= base ? 0 : (t - base) / tick;
+  }
+  std::uint64_t to_tick_ceil(time_point t) const {
+    if (t <= base) {
+      return 0;
+    }
+    const auto d = t - base;
+    const std::uint64_t n = d / tick;
+    return d % tick == duration::zero() ? n : n + 1;
+  }
+  time_point to_time(std::uint64_t t) const {
+    return base + tick * static_cast<typename duration::rep>(t);
+  }
+
+  list_t& list_for(node& n) {
+    switch (n.level) {
+    case OVERFLOW:
+      return overflow;
+    case DUE:
+      return due;
+    default:
+      return wheel[n.level][n.slot];
+    }
+  }
+
+  // requires n.expires > current
+  void place(node& n) {
+    const std::uint64_t diff = n.expires ^ current;
+    if (diff >> (BITS * LEVELS)) {
+      n.level = OVERFLOW;
+      overflow.push_back(n);
+      return;
+    }
+    const unsigned l = (63 - std::countl_zero(diff)) / BITS;
+    n.level = l;
+    n.slot = digit(n.expires, l);
+    wheel[l][n.slot].push_back(n);
+    occupied[l] |= std::uint64_t(1) << n.slot;
+  }
+
+  void cascade(list_t& from) {
+    while (!from.empty()) {
+      node& n = from.front();
+      from.pop_front();
+      if (n.expires <= current) {
+	expired.push_back(&n);
+      } else {
+	place(n);
+      }
+    }
+  }
+
+  void cascade_slot(unsigned l, unsigned s) {
+    if (occupied[l] & (std::uint64_t(1) << s)) {
+      occupied[l] &= ~(std::uint64_t(1) << s);
+      cascade(wheel[l][s]);
+    }
+  }
+
+  // the next tick after current at which advance() must stop
+  std::uint64_t next_tick() const {
+    std::uint64_t best = NEVER;
+    for (unsigned l = 0; l < LEVELS; ++l) {
+      const unsigned d = digit(current, l);
+      if (d == SLOTS - 1) {
+	continue;  // occupied slots are always ahead of the current digit
+      }
+      const std::uint64_t ahead = occupied[l] & (~std::uint64_t(0) << (d + 1));
+      if (!ahead) {
+	continue;
+      }
+      const unsigned shift = BITS * (l + 1);
+      const std::uint64_t t = ((current >> shift) << shift) |
+	(std::uint64_t(std::countr_zero(ahead)) << (BITS * l));
+      best = std::min(best, t);
+    }
+    if (!overflow.empty()) {
+      const unsigned shift = BITS * LEVELS;
+      best = std::min(best, ((current >> shift) + 1) << shift);
+    }
+    return best;
+  }
+};
+
+} // namespace ceph
+
+#endif
@@ -118,6 +118,12 @@ struct error_code;
   int get_missed_crc();
   /// enable/disable tracking of cached crcs
   void track_cached_crc(bool b);
+  /// count of ptr_node/small buffer allocations served by the slab caches
+  uint64_t get_slab_cache_hits();
+  /// count of ptr_node/small buffer allocations that went to the heap
+  uint64_t get_slab_cache_misses();
+  /// enable/disable tracking of slab cache hits and misses
+  void track_slab_cache(bool b);
 
   /*
    * an abstract raw buffer.  with a reference count.
@@ -370,6 +376,10 @@ struct error_code;
 
     ~ptr_node() = default;
 
+    // served from per-thread slab caches; see common/buffer.cc
+    static void* operator new(size_t size);
+    static void operator delete(void* p);
+
     static std::unique_ptr<ptr_node, disposer>
     create(ceph::unique_leakable_ptr<raw> r) {
       return create_hypercombined(std::move(r));
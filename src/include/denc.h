@@ -28,6 +28,7 @@
 #include <bit>
 #include <cstring>
 #include <concepts>
+#include <iterator>
 #include <map>
 #include <optional>
 #include <set>
@@ -41,6 +42,10 @@
 #include <boost/intrusive/set.hpp>
 #include <boost/optional.hpp>
 
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
+
 #include "include/cpp_lib_backport.h"
 #include "include/compat.h"
 #include "include/int_types.h"
@@ -209,6 +214,15 @@ template<typename T> int DencDumper<T>::i = 0;
       static void decode(T& o, ceph::buffer::ptr::const_iterator &p, uint64_t f=0);
     };
 
+  - A denc_traits<T> may additionally declare
+
+      static constexpr bool raw_layout = true;
+
+  when the encoding of T is byte-for-byte its in-memory representation
+  (e.g. a struct whose only member is a little-endian fixed-width
+  integer).  Contiguous containers of such types are then encoded and
+  decoded with a single memcpy; see _denc::is_raw_layout_v.
+
   - denc_traits<T> is normally declared via the WRITE_CLASS_DENC(type) macro,
   which is used in place of the old-style WRITE_CLASS_ENCODER(type) macro.
   There are _FEATURED and _BOUNDED variants.  The class traits simply call
@@ -312,6 +326,7 @@ struct denc_traits<T> {
   static constexpr bool featured = false;
   static constexpr bool bounded = true;
   static constexpr bool need_contiguous = false;
+  static constexpr bool raw_layout = true;
   static void bound_encode(const T &o, size_t& p, uint64_t f=0) {
     p += sizeof(T);
   }
@@ -385,6 +400,10 @@ struct denc_traits<T>
   static constexpr bool bounded = true;
   static constexpr bool need_contiguous = false;
   using etype = _denc::ExtType_t<T>;
+  // on little-endian hosts the wire format is the in-memory format
+  static constexpr bool raw_layout =
+    !std::is_same_v<T, bool> && sizeof(T) == sizeof(etype) &&
+    boost::endian::order::native == boost::endian::order::little;
   static void bound_encode(const T &o, size_t& p, uint64_t f=0) {
     p += sizeof(etype);
   }
@@ -425,8 +444,48 @@ inline void denc_varint(T v, ceph::buffer::list::contiguous_appender& p) {
   get_pos_add<__u8>(p) = byte;
 }
 
+namespace _denc {
+// Decode a varint of at most 8 bytes held in the little-endian word
+// @p w, without looping over the bytes: the first byte with its high bit
+// clear ends the varint, and the 7-bit groups are packed together with
+// three shift/mask steps (or a single pext where BMI2 is available).
+// Returns the encoded length, or 0 if the varint is longer than 8 bytes.
+inline unsigned varint_decode_word(uint64_t w, uint64_t* v) {
+  const uint64_t stops = ~w & 0x8080808080808080ull;
+  if (!stops) {
+    return 0;
+  }
+  const unsigned len = (std::countr_zero(stops) >> 3) + 1;
+  if (len < 8) {
+    w &= (1ull << (len * 8)) - 1;
+  }
+#ifdef __BMI2__
+  *v = _pext_u64(w, 0x7f7f7f7f7f7f7f7full);
+#else
+  w &= 0x7f7f7f7f7f7f7f7full;
+  w = ((w & 0x7f007f007f007f00ull) >> 1) | (w & 0x007f007f007f007full);
+  w = ((w & 0x3fff00003fff0000ull) >> 2) | (w & 0x00003fff00003fffull);
+  w = ((w & 0x0fffffff00000000ull) >> 4) | (w & 0x000000000fffffffull);
+  *v = w;
+#endif
+  return len;
+}
+} // namespace _denc
+
 template<typename T>
 inline void denc_varint(T& v, ceph::buffer::ptr::const_iterator& p) {
+  if (const char* pos = p.get_pos();
+      p.get_end() - pos >= (std::ptrdiff_t)sizeof(uint64_t)) {
+    uint64_t w;
+    memcpy(&w, pos, sizeof(w));
+    uint64_t x;
+    if (const unsigned len = _denc::varint_decode_word(
+	  boost::endian::little_to_native(w), &x); len > 0) {
+      p += len;
+      v = (T)x;
+      return;
+    }
+  }
   uint8_t byte = *(__u8*)p.get_pos_add(1);
   v = byte & 0x7f;
   int shift = 7;
@@ -915,6 +974,28 @@ struct denc_traits<
 };
 
 namespace _denc {
+  // true if denc_traits<T> declares raw_layout, i.e. the encoding of T
+  // is byte-for-byte its in-memory representation.  The trivially
+  // copyable and no-padding checks keep a wrongly declared raw_layout
+  // from leaking padding bytes onto the wire or memcpy'ing objects that
+  // need constructing.
+  template<typename T>
+  inline constexpr bool is_raw_layout_v = [] {
+    if constexpr (requires { denc_traits<T>::raw_layout; }) {
+      return denc_traits<T>::raw_layout &&
+	std::is_trivially_copyable_v<T> &&
+	std::has_unique_object_representations_v<T>;
+    } else {
+      return false;
+    }
+  }();
+
+  // runs of elements of such containers are copied with one memcpy
+  template<typename Container>
+  inline constexpr bool is_raw_contiguous_v =
+    std::contiguous_iterator<typename Container::const_iterator> &&
+    is_raw_layout_v<typename Container::value_type>;
+
   template<template<class...> class C, typename Details, typename ...Ts>
   struct container_base {
   private:
@@ -992,23 +1073,39 @@ namespace _denc {
     // nohead
     static void encode_nohead(const container& s, ceph::buffer::list::contiguous_appender& p,
 			      uint64_t f = 0) {
-      for (const T& e : s) {
-        if constexpr (traits::featured) {
-          denc(e, p, f);
-        } else {
-          denc(e, p);
-        }
+      if constexpr (is_raw_contiguous_v<container>) {
+	if (const size_t len = s.size() * sizeof(T); len > 0) {
+	  memcpy(p.get_pos_add(len), s.data(), len);
+	}
+      } else {
+	for (const T& e : s) {
+	  if constexpr (traits::featured) {
+	    denc(e, p, f);
+	  } else {
+	    denc(e, p);
+	  }
+	}
       }
     }
     static void decode_nohead(size_t num, container& s,
 			      ceph::buffer::ptr::const_iterator& p,
 			      uint64_t f=0) {
       s.clear();
-      Details::reserve(s, num);
-      while (num--) {
-	T t;
-	denc(t, p, f);
-	Details::insert(s, std::move(t));
+      if constexpr (is_raw_contiguous_v<container>) {
+	// consume (and bounds-check) before sizing the container
+	const size_t len = num * sizeof(T);
+	const char* src = p.get_pos_add(len);
+	s.resize(num);
+	if (len > 0) {
+	  memcpy(s.data(), src, len);
+	}
+      } else {
+	Details::reserve(s, num);
+	while (num--) {
+	  T t;
+	  denc(t, p, f);
+	  Details::insert(s, std::move(t));
+	}
       }
     }
     template<typename U=T>
@@ -1016,11 +1113,20 @@ namespace _denc {
     decode_nohead(size_t num, container& s,
 		  ceph::buffer::list::const_iterator& p) {
       s.clear();
-      Details::reserve(s, num);
-      while (num--) {
-	T t;
-	denc(t, p);
-	Details::insert(s, std::move(t));
+      if constexpr (is_raw_contiguous_v<container>) {
+	const size_t len = num * sizeof(T);
+	if (p.get_remaining() < len) {
+	  throw ceph::buffer::end_of_buffer();
+	}
+	s.resize(num);
+	p.copy(len, reinterpret_cast<char*>(s.data()));
+      } else {
+	Details::reserve(s, num);
+	while (num--) {
+	  T t;
+	  denc(t, p);
+	  Details::insert(s, std::move(t));
+	}
       }
     }
   };
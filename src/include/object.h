@@ -123,6 +123,7 @@ struct denc_traits<snapid_t> {
   static constexpr bool featured = false;
   static constexpr bool bounded = true;
   static constexpr bool need_contiguous = true;
+  static constexpr bool raw_layout = denc_traits<uint64_t>::raw_layout;
   static void bound_encode(const snapid_t& o, size_t& p) {
     denc(o.val, p);
   }
@@ -0,0 +1,88 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#ifndef CEPH_LOG_BINARYFORMAT_H
+#define CEPH_LOG_BINARYFORMAT_H
+
+#include <cstring>
+#include <string_view>
+
+#include "include/byteorder.h"
+
+#include "log/Entry.h"
+
+namespace ceph {
+namespace logging {
+namespace binary {
+
+/*
+ * Compact on-disk log record.  Formatting of the timestamp, thread id
+ * and priority is deferred to the reader (ceph-log-decode), so the
+ * flusher only copies a fixed header and the message bytes.
+ *
+ * Records may be interleaved with plain text lines (e.g. the crash
+ * dump, or a log file whose format was switched at runtime); a reader
+ * that does not find a valid header at the current offset should pass
+ * bytes through up to the next newline.
+ */
+constexpr uint32_t RECORD_MAGIC = 0x1e06f1ce;  // "\xce\xf1\x06\x1e" on disk
+constexpr uint32_t MAX_RECORD_LEN = 1 << 24;
+
+enum : uint8_t {
+  FLAG_COARSE = 1 << 0,  ///< m_stamp came from the coarse clock
+};
+
+struct __attribute__((packed)) record_header {
+  ceph_le32 magic;
+  ceph_le32 len;      ///< bytes of message following the header
+  ceph_le64 stamp;    ///< ns since epoch
+  ceph_le64 thread;
+  ceph_le16 prio;
+  ceph_le16 subsys;
+  uint8_t flags;
+  uint8_t reserved[3];
+};
+static_assert(sizeof(record_header) == 32);
+
+/// append a record for @p e at @p out; caller provides
+/// sizeof(record_header) + e.size() bytes
+inline std::size_t encode(const Entry& e, char* out)
+{
+  const auto rep = e.m_stamp.time_since_epoch().count();
+  const auto str = e.strv();
+  record_header h;
+  h.magic = RECORD_MAGIC;
+  h.len = str.size();
+  h.stamp = rep.count;
+  h.thread = (uint64_t)e.m_thread;
+  h.prio = e.m_prio;
+  h.subsys = e.m_subsys;
+  h.flags = rep.coarse ? FLAG_COARSE : 0;
+  memset(h.reserved, 0, sizeof(h.reserved));
+  memcpy(out, &h, sizeof(h));
+  memcpy(out + sizeof(h), str.data(), str.size());
+  return sizeof(h) + str.size();
+}
+
+/// true if @p buf (of at least @p avail bytes) starts with a sane header
+inline bool decode_header(const char* buf, std::size_t avail,
+			  record_header* h)
+{
+  if (avail < sizeof(record_header)) {
+    return false;
+  }
+  memcpy(h, buf, sizeof(*h));
+  return h->magic == RECORD_MAGIC && h->len <= MAX_RECORD_LEN;
+}
+
+inline log_time stamp_of(const record_header& h)
+{
+  return log_time(log_clock::duration(
+    _logclock::taggedrep(h.stamp, h.flags & FLAG_COARSE)));
+}
+
+}
+}
+}
+
+#endif
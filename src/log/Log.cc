@@ -14,14 +14,17 @@
 #include "include/on_exit.h"
 #include "include/uuid.h"
 
+#include "BinaryFormat.h"
 #include "Entry.h"
 #include "LogClock.h"
+#include "SubmitRing.h"
 #include "SubsystemMap.h"
 
 #include <errno.h>
 #include <fcntl.h>
 #include <syslog.h>
 
+#include <algorithm>
 #include <iostream>
 #include <set>
 
@@ -35,6 +38,25 @@ namespace logging {
 
 static OnExitManager exit_callbacks;
 
+static std::atomic<uint64_t> next_log_id = {1};
+
+namespace {
+// rings this thread has registered, one per Log it has submitted to.
+// Like CachedStackStringStream's cache, this may be destructed before
+// other thread_local objects that still log, so note when it is gone.
+struct ThreadRings {
+  std::vector<std::pair<uint64_t, std::shared_ptr<SubmitRing>>> rings;
+  bool destructed = false;
+  ~ThreadRings() {
+    for (auto& [id, ring] : rings) {
+      ring->close();
+    }
+    destructed = true;
+  }
+};
+thread_local ThreadRings thread_rings;
+}
+
 static void log_on_exit(void *p)
 {
   Log *l = *(Log **)p;
@@ -45,6 +67,7 @@ static void log_on_exit(void *p)
 
 Log::Log(const SubsystemMap *s)
   : m_indirect_this(nullptr),
+    m_id(next_log_id++),
     m_subs(s),
     m_recent(DEFAULT_MAX_RECENT)
 {
@@ -58,6 +81,9 @@ Log::~Log()
   }
 
   ceph_assert(!is_started());
+  for (auto& ring : m_rings) {
+    ring->close();
+  }
   if (m_fd >= 0)
     VOID_TEMP_FAILURE_RETRY(::close(m_fd));
 }
@@ -97,6 +123,18 @@ void Log::set_max_recent(std::size_t n)
   m_recent.set_capacity(n);
 }
 
+void Log::set_thread_ring_size(std::size_t n)
+{
+  // only affects threads that have not registered a ring yet
+  m_ring_size = n;
+}
+
+void Log::set_binary(bool binary)
+{
+  std::scoped_lock lock(m_flush_mutex);
+  m_binary = binary;
+}
+
 void Log::set_log_file(std::string_view fn)
 {
   std::scoped_lock lock(m_flush_mutex);
@@ -206,14 +244,86 @@ void Log::stop_journald_logger()
   m_journald.reset();
 }
 
-void Log::submit_entry(Entry&& e)
+SubmitRing* Log::_get_thread_ring()
 {
-  std::unique_lock lock(m_queue_mutex);
-  m_queue_mutex_holder = pthread_self();
+  if (thread_rings.destructed) {
+    return nullptr;
+  }
+  auto& rings = thread_rings.rings;
+  for (auto& [id, ring] : rings) {
+    if (id == m_id) {
+      return ring.get();
+    }
+  }
+  // forget rings of Logs that have since been destroyed
+  std::erase_if(rings, [](auto& p) { return p.second->is_closed(); });
+
+  auto ring = std::make_shared<SubmitRing>(m_ring_size);
+  {
+    std::scoped_lock lock(m_queue_mutex);
+    m_queue_mutex_holder = pthread_self();
+    std::erase_if(m_rings, [](auto& r) { return r->is_closed() && r->empty(); });
+    m_rings.push_back(ring);
+    m_queue_mutex_holder = 0;
+  }
+  rings.emplace_back(m_id, ring);
+  return ring.get();
+}
+
+bool Log::_rings_pending()
+{
+  // caller holds m_queue_mutex
+  return std::any_of(m_rings.begin(), m_rings.end(),
+		     [](auto& ring) { return !ring->empty(); });
+}
+
+void Log::_drain_rings(EntryVector& q)
+{
+  // caller holds m_flush_mutex, which makes us the only consumer
+  std::vector<std::shared_ptr<SubmitRing>> rings;
+  {
+    std::scoped_lock lock(m_queue_mutex);
+    m_queue_mutex_holder = pthread_self();
+    rings = m_rings;
+    m_queue_mutex_holder = 0;
+  }
+  std::size_t drained = 0;
+  for (auto& ring : rings) {
+    drained += ring->drain(q);
+  }
+  if (drained) {
+    // each ring is in order; merge them (and anything that spilled into
+    // m_new) back into submission order
+    std::stable_sort(q.begin(), q.end(),
+		     [](const ConcreteEntry& a, const ConcreteEntry& b) {
+		       return a.m_stamp < b.m_stamp;
+		     });
+  }
+}
 
+void Log::submit_entry(Entry&& e)
+{
   if (unlikely(m_inject_segv))
     *(volatile int *)(0) = 0xdead;
 
+  if (m_ring_size.load(std::memory_order_relaxed) > 0) {
+    if (auto ring = _get_thread_ring(); ring && ring->try_push(e)) {
+      // pairs with the fence in entry(): either the flusher sees our
+      // entry before it sleeps, or we see that it is (about to be)
+      // waiting and wake it up
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (m_flusher_waiting.load(std::memory_order_relaxed)) {
+	std::scoped_lock lock(m_queue_mutex);
+	m_cond_flusher.notify_all();
+      }
+      return;
+    }
+    // ring full: fall back to the shared queue, which applies backpressure
+  }
+
+  std::unique_lock lock(m_queue_mutex);
+  m_queue_mutex_holder = pthread_self();
+
   // wait for flush to catch up
   while (is_started() &&
 	 m_new.size() > m_max_new) {
@@ -239,6 +349,7 @@ void Log::flush()
     m_cond_loggers.notify_all();
     m_queue_mutex_holder = 0;
   }
+  _drain_rings(m_flush);
 
   _flush(m_flush, false);
   m_flush_mutex_holder = 0;
@@ -290,6 +401,18 @@ void Log::_flush(EntryVector& t, bool crash)
     bool do_graylog2 = m_graylog_crash >= prio && should_log;
     bool do_journald = m_journald_crash >= prio && should_log;
 
+    if (do_fd && m_binary && !crash) {
+      // the crash dump stays in text form, interleaved with the
+      // _log_message() banners
+      const std::size_t cur = m_log_buf.size();
+      m_log_buf.resize(cur + sizeof(binary::record_header) + e.size());
+      binary::encode(e, m_log_buf.data() + cur);
+      do_fd = false;
+      if (m_log_buf.size() > MAX_LOG_BUF) {
+        _flush_logbuf();
+      }
+    }
+
     if (do_fd || do_syslog || do_stderr) {
       const std::size_t cur = m_log_buf.size();
       std::size_t used = 0;
@@ -323,7 +446,7 @@ void Log::_flush(EntryVector& t, bool crash)
       if (do_fd) {
         m_log_buf.resize(cur + used);
       } else {
-        m_log_buf.resize(0);
+        m_log_buf.resize(cur);
       }
 
       if (m_log_buf.size() > MAX_LOG_BUF) {
@@ -385,6 +508,7 @@ void Log::dump_recent()
     m_flush.swap(m_new);
     m_queue_mutex_holder = 0;
   }
+  _drain_rings(m_flush);
 
   _flush(m_flush, false);
 
@@ -423,6 +547,7 @@ void Log::dump_recent()
 
   _log_message(fmt::format("  max_recent {:9}", m_recent.capacity()), true);
   _log_message(fmt::format("  max_new    {:9}", m_max_new), true);
+  _log_message(fmt::format("  thread_ring_size {:3}", m_ring_size.load()), true);
   _log_message(fmt::format("  log_file {}", m_log_file), true);
 
   _log_message("--- end dump of recent events ---", true);
@@ -462,7 +587,7 @@ void *Log::entry()
     std::unique_lock lock(m_queue_mutex);
     m_queue_mutex_holder = pthread_self();
     while (!m_stop) {
-      if (!m_new.empty()) {
+      if (!m_new.empty() || _rings_pending()) {
         m_queue_mutex_holder = 0;
         lock.unlock();
         flush();
@@ -471,7 +596,12 @@ void *Log::entry()
         continue;
       }
 
-      m_cond_flusher.wait(lock);
+      m_flusher_waiting = true;
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (!_rings_pending()) {
+        m_cond_flusher.wait(lock);
+      }
+      m_flusher_waiting = false;
     }
     m_queue_mutex_holder = 0;
   }
@@ -6,6 +6,7 @@
 
 #include <boost/circular_buffer.hpp>
 
+#include <atomic>
 #include <condition_variable>
 #include <memory>
 #include <mutex>
@@ -25,6 +26,7 @@ namespace logging {
 
 class Graylog;
 class JournaldLogger;
+class SubmitRing;
 class SubsystemMap;
 
 class Log : private Thread
@@ -39,6 +41,8 @@ private:
 
   Log **m_indirect_this;
 
+  const uint64_t m_id; ///< process-unique, keys the per-thread ring lookup
+
   const SubsystemMap *m_subs;
 
   std::mutex m_queue_mutex;
@@ -53,12 +57,19 @@ private:
   EntryRing m_recent; ///< recent (less new) entries we've already written at low detail
   EntryVector m_flush; ///< entries to be flushed (here to optimize heap allocations)
 
+  /// per-thread submission rings; registration is under m_queue_mutex,
+  /// draining under m_flush_mutex
+  std::vector<std::shared_ptr<SubmitRing>> m_rings;
+  std::atomic<std::size_t> m_ring_size = {0}; ///< 0 disables the lock-free path
+  std::atomic<bool> m_flusher_waiting = {false};
+
   std::string m_log_file;
   int m_fd = -1;
   uid_t m_uid = 0;
   gid_t m_gid = 0;
 
   int m_fd_last_error = 0;  ///< last error we say writing to fd (if any)
+  bool m_binary = false;    ///< write binary records (see BinaryFormat.h) to fd
 
   int m_syslog_log = -2, m_syslog_crash = -2;
   int m_stderr_log = -1, m_stderr_crash = -1;
@@ -83,6 +94,10 @@ private:
   void _log_safe_write(std::string_view sv);
   void _flush_logbuf();
   void _log_message(std::string_view s, bool crash);
+
+  SubmitRing* _get_thread_ring();
+  bool _rings_pending();
+  void _drain_rings(EntryVector& q);
 protected:
   virtual void _flush(EntryVector& q, bool crash);
 
@@ -97,6 +112,8 @@ public:
   void set_coarse_timestamps(bool coarse);
   void set_max_new(std::size_t n);
   void set_max_recent(std::size_t n);
+  void set_thread_ring_size(std::size_t n);
+  void set_binary(bool binary);
   void set_log_file(std::string_view fn);
   void reopen_log_file();
   void chown_log_file(uid_t uid, gid_t gid);
@@ -0,0 +1,81 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#ifndef CEPH_LOG_SUBMITRING_H
+#define CEPH_LOG_SUBMITRING_H
+
+#include <atomic>
+#include <optional>
+#include <vector>
+
+#include "log/Entry.h"
+
+namespace ceph {
+namespace logging {
+
+/**
+ * Bounded single-producer/single-consumer queue of log entries.
+ *
+ * Each thread that submits to a Log gets its own ring, so the submit
+ * path only touches memory owned by the submitting thread plus two
+ * atomics.  The flusher (holding Log::m_flush_mutex) is the only
+ * consumer.  Slots keep their ConcreteEntry storage inline, so pushing
+ * an entry that fits in the small_vector does not allocate.
+ */
+class SubmitRing {
+public:
+  explicit SubmitRing(std::size_t capacity)
+    : m_slots(capacity) {}
+  SubmitRing(const SubmitRing&) = delete;
+  SubmitRing& operator=(const SubmitRing&) = delete;
+
+  /// producer side; false if the ring is full
+  bool try_push(const Entry& e) {
+    const auto tail = m_tail.load(std::memory_order_relaxed);
+    if (tail - m_head.load(std::memory_order_acquire) >= m_slots.size()) {
+      return false;
+    }
+    m_slots[tail % m_slots.size()].emplace(e);
+    m_tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /// consumer side; move all published entries to the end of @p out
+  template <typename Container>
+  std::size_t drain(Container& out) {
+    auto head = m_head.load(std::memory_order_relaxed);
+    const auto tail = m_tail.load(std::memory_order_acquire);
+    const std::size_t n = tail - head;
+    for (; head != tail; ++head) {
+      auto& slot = m_slots[head % m_slots.size()];
+      out.emplace_back(std::move(*slot));
+      slot.reset();
+    }
+    m_head.store(head, std::memory_order_release);
+    return n;
+  }
+
+  bool empty() const {
+    return m_head.load(std::memory_order_acquire) ==
+	   m_tail.load(std::memory_order_acquire);
+  }
+
+  /// set by whichever side (thread or Log) goes away first
+  void close() {
+    m_closed.store(true, std::memory_order_release);
+  }
+  bool is_closed() const {
+    return m_closed.load(std::memory_order_acquire);
+  }
+
+private:
+  std::vector<std::optional<ConcreteEntry>> m_slots;
+  alignas(64) std::atomic<std::size_t> m_head = {0};  ///< next slot to consume
+  alignas(64) std::atomic<std::size_t> m_tail = {0};  ///< next slot to fill
+  std::atomic<bool> m_closed = {false};
+};
+
+}
+}
+
+#endif
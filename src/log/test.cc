@@ -1,6 +1,7 @@
 #include <gtest/gtest.h>
 
 #include "log/Log.h"
+#include "log/BinaryFormat.h"
 #include "common/Clock.h"
 #include "include/coredumpctl.h"
 #include "SubsystemMap.h"
@@ -10,6 +11,10 @@
 #include "global/global_context.h"
 #include "common/dout.h"
 
+#include <fstream>
+#include <iterator>
+#include <thread>
+
 using namespace std;
 using namespace ceph::logging;
 
@@ -281,6 +286,89 @@ TEST(Log, TimeFormat)
   }
 }
 
+class CountingLog : public Log {
+public:
+  using Log::Log;
+  std::atomic<int> flushed = {0};
+protected:
+  void _flush(EntryVector& q, bool crash) override {
+    flushed += q.size();
+    Log::_flush(q, crash);
+  }
+};
+
+TEST(Log, ThreadRings)
+{
+  SubsystemMap subs;
+  subs.set_log_level(1, 20);
+  subs.set_gather_level(1, 10);
+  CountingLog log(&subs);
+  log.set_thread_ring_size(16);
+  log.set_max_new(64);
+  log.start();
+  log.set_log_file("thread_rings_log");
+  log.reopen_log_file();
+
+  constexpr int nthreads = 8;
+  constexpr int per_thread = 5000;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < nthreads; ++t) {
+    threads.emplace_back([&log, t] {
+      for (int i = 0; i < per_thread; ++i) {
+        MutableEntry e(10, 1);
+        e.get_ostream() << "thread " << t << " entry " << i;
+        log.submit_entry(std::move(e));
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  log.flush();
+  log.stop();
+  ASSERT_EQ(nthreads * per_thread, log.flushed.load());
+}
+
+TEST(Log, BinaryFormat)
+{
+  static const char* test_file = "binary_log";
+  SubsystemMap subs;
+  subs.set_log_level(1, 20);
+  subs.set_gather_level(1, 10);
+  Log log(&subs);
+  log.set_binary(true);
+  log.start();
+  unlink(test_file);
+  log.set_log_file(test_file);
+  log.reopen_log_file();
+  constexpr int n = 100;
+  for (int i = 0; i < n; ++i) {
+    MutableEntry e(5, 1);
+    e.get_ostream() << "binary entry " << i;
+    log.submit_entry(std::move(e));
+  }
+  log.flush();
+  log.stop();
+
+  std::ifstream in(test_file, std::ios::binary);
+  std::string buf((std::istreambuf_iterator<char>(in)),
+                  std::istreambuf_iterator<char>());
+  std::size_t pos = 0;
+  int count = 0;
+  binary::record_header h;
+  while (binary::decode_header(buf.data() + pos, buf.size() - pos, &h)) {
+    ASSERT_EQ(5, h.prio);
+    ASSERT_EQ(1, h.subsys);
+    ASSERT_LE(pos + sizeof(h) + h.len, buf.size());
+    std::string_view msg(buf.data() + pos + sizeof(h), h.len);
+    ASSERT_EQ("binary entry " + std::to_string(count), msg);
+    pos += sizeof(h) + h.len;
+    ++count;
+  }
+  ASSERT_EQ(n, count);
+  ASSERT_EQ(buf.size(), pos);
+}
+
 #define dout_subsys ceph_subsys_context
 
 template <int depth, int x> struct do_log
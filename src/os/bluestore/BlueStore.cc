@@ -4654,7 +4654,8 @@ BlueStore::BlueStore(CephContext *cct,
   uint64_t _min_alloc_size)
   : ObjectStore(cct, path),
     throttle(cct),
-    finisher(cct, "commit_finisher", "cfin"),
+    finisher(cct, "commit_finisher", "cfin",
+	     cct->_conf.get_val<uint64_t>("bluestore_finisher_threads")),
     kv_sync_thread(this),
     kv_finalize_thread(this),
 #ifdef HAVE_LIBZBD
@@ -12950,7 +12951,8 @@ void BlueStore::_txc_committed_kv(TransContext *txc)
     if (txc->ch->commit_queue) {
       txc->ch->commit_queue->queue(txc->oncommits);
     } else {
-      finisher.queue(txc->oncommits);
+      finisher.queue(reinterpret_cast<uintptr_t>(txc->ch.get()),
+		     txc->oncommits);
     }
   }
   throttle.log_state_latency(*txc, logger, l_bluestore_state_kv_committing_lat);
@@ -14272,7 +14274,7 @@ int BlueStore::queue_transactions(
     if (c->commit_queue) {
       c->commit_queue->queue(on_applied);
     } else {
-      finisher.queue(on_applied);
+      finisher.queue(reinterpret_cast<uintptr_t>(c), on_applied);
     }
   }
 
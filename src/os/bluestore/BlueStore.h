@@ -2254,7 +2254,7 @@ private:
   deferred_osr_queue_t deferred_queue; ///< osr's with deferred io pending
   std::atomic_int deferred_queue_size = {0};         ///< num txc's queued across all osrs
   std::atomic_int deferred_aggressive = {0}; ///< aggressive wakeup of kv thread
-  Finisher  finisher;
+  ShardedFinisher finisher;  ///< lanes keyed by Collection
   utime_t  deferred_last_submitted = utime_t();
 
   KVSyncThread kv_sync_thread;
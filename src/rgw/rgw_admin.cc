@@ -8301,6 +8301,8 @@ next:
       bool handled = false;
       if (iter->first == RGW_ATTR_MANIFEST) {
         handled = decode_dump<RGWObjManifest>("manifest", bl, formatter.get());
+      } else if (iter->first == RGW_ATTR_DEDUP_MANIFEST) {
+        handled = decode_dump<RGWObjDedupManifest>("dedup_manifest", bl, formatter.get());
       } else if (iter->first == RGW_ATTR_ACL) {
         handled = decode_dump<RGWAccessControlPolicy>("policy", bl, formatter.get());
       } else if (iter->first == RGW_ATTR_ID_TAG) {
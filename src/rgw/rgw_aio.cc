@@ -19,6 +19,8 @@
 
 #include "rgw_aio.h"
 #include "rgw_d3n_cacherequest.h"
+#include "rgw_d3n_datacache.h"
+#include "rgw_perf_counters.h"
 
 namespace rgw {
 
@@ -95,14 +97,19 @@ Aio::OpFunc aio_abstract(Op&& op, boost::asio::io_context& context,
 }
 
 
-Aio::OpFunc d3n_cache_aio_abstract(const DoutPrefixProvider *dpp, optional_yield y, off_t read_ofs, off_t read_len, std::string& location) {
-  return [dpp, y, read_ofs, read_len, location] (Aio* aio, AioResult& r) mutable {
-    // d3n data cache requires yield context (rgw_beast_enable_async=true)
-    ceph_assert(y);
+Aio::OpFunc d3n_cache_aio_abstract(const DoutPrefixProvider *dpp, optional_yield y, off_t read_ofs, off_t read_len, D3nDataCache* cache) {
+  return [dpp, y, read_ofs, read_len, cache] (Aio* aio, AioResult& r) mutable {
     auto& ref = r.obj.get_ref();
     auto c = std::make_unique<D3nL1CacheRequest>();
-    lsubdout(g_ceph_context, rgw_datacache, 20) << "D3nDataCache: d3n_cache_aio_abstract(): libaio Read From Cache, oid=" << ref.obj.oid << dendl;
-    c->file_aio_read_abstract(dpp, y.get_io_context(), y.get_yield_context(), location, read_ofs, read_len, aio, r);
+    const std::string file_path = cache->cache_location + ref.obj.oid;
+    auto handler = D3nL1CacheRequest::d3n_libaio_handler{
+      aio, r, cache, y, read_ofs, read_len, ceph::mono_clock::now()};
+    lsubdout(g_ceph_context, rgw_datacache, 20) << "D3nDataCache: d3n_cache_aio_abstract(): Read From Cache, oid=" << ref.obj.oid << dendl;
+    if (y) {
+      c->file_aio_read_abstract(dpp, y.get_io_context(), y.get_yield_context(), cache->get_io(), file_path, std::move(handler));
+    } else {
+      c->file_aio_read(dpp, cache->get_io(), file_path, std::move(handler));
+    }
   };
 }
 
@@ -131,8 +138,28 @@ Aio::OpFunc Aio::librados_op(librados::ObjectWriteOperation&& op,
 }
 
 Aio::OpFunc Aio::d3n_cache_op(const DoutPrefixProvider *dpp, optional_yield y,
-                              off_t read_ofs, off_t read_len, std::string& location) {
-  return d3n_cache_aio_abstract(dpp, y, read_ofs, read_len, location);
+                              off_t read_ofs, off_t read_len, D3nDataCache* cache) {
+  return d3n_cache_aio_abstract(dpp, y, read_ofs, read_len, cache);
 }
 
 } // namespace rgw
+
+void D3nL1CacheRequest::d3n_libaio_handler::operator()(boost::system::error_code ec, bufferlist bl) const
+{
+  if (ec) {
+    auto& oid = r.obj.get_ref().obj.oid;
+    lsubdout(g_ceph_context, rgw_datacache, 1) << "D3nDataCache: " << __func__ << "(): failed to read oid=" << oid
+        << " from cache, reading from rados instead: " << ec.message() << dendl;
+    cache->invalidate(oid);
+    librados::ObjectReadOperation op;
+    op.read(read_ofs, read_len, nullptr, nullptr);
+    rgw::Aio::librados_op(std::move(op), y)(throttle, r);
+    return;
+  }
+  if (perfcounter) {
+    perfcounter->tinc(l_rgw_d3n_read_lat, ceph::mono_clock::now() - start);
+  }
+  r.result = 0;
+  r.data = std::move(bl);
+  throttle->put(r);
+}
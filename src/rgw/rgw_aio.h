@@ -29,6 +29,8 @@
 
 #include "include/function2.hpp"
 
+struct D3nDataCache;
+
 struct D3nGetObjData;
 
 namespace rgw {
@@ -98,7 +100,7 @@ class Aio {
   static OpFunc librados_op(librados::ObjectWriteOperation&& op,
                             optional_yield y);
   static OpFunc d3n_cache_op(const DoutPrefixProvider *dpp, optional_yield y,
-                             off_t read_ofs, off_t read_len, std::string& location);
+                             off_t read_ofs, off_t read_len, D3nDataCache* cache);
 };
 
 } // namespace rgw
@@ -96,6 +96,10 @@ int ClientIO::init_env(CephContext *cct)
 
 size_t ClientIO::complete_request()
 {
+  // a header still waiting for a body that never came. send it before
+  // the request is logged
+  flush();
+
   perfcounter->inc(l_rgw_qlen, -1);
   perfcounter->inc(l_rgw_qactive, -1);
   return 0;
@@ -103,7 +107,10 @@ size_t ClientIO::complete_request()
 
 void ClientIO::flush()
 {
-  txbuf.pubsync();
+  const auto pending = txbuf.release();
+  if (!pending.empty()) {
+    write_data(pending.data(), pending.size());
+  }
 }
 
 size_t ClientIO::send_status(int status, const char* status_name)
@@ -113,6 +120,9 @@ size_t ClientIO::send_status(int status, const char* status_name)
   char statusbuf[STATUS_BUF_SIZE];
   const auto statuslen = snprintf(statusbuf, sizeof(statusbuf),
                                   "HTTP/1.1 %d %s\r\n", status, status_name);
+  if (status < 200 || status == 204 || status == 304) {
+    has_body = false;
+  }
 
   return txbuf.sputn(statusbuf, statuslen);
 }
@@ -159,10 +169,55 @@ size_t ClientIO::complete_header()
   constexpr char HEADER_END[] = "\r\n";
   sent += txbuf.sputn(HEADER_END, sizeof(HEADER_END) - 1);
 
-  flush();
+  // the header goes out with the first write of the body. responses
+  // without one don't wait for the work that follows them
+  if (!has_body || parser.get().method() == beast::http::verb::head) {
+    flush();
+  }
   return sent;
 }
 
+size_t ClientIO::send_body(const char* buf, size_t len)
+{
+  const auto header = txbuf.release();
+  if (header.empty()) {
+    return write_data(buf, len);
+  }
+  buffers_type buffers;
+  buffers.emplace_back(header.data(), header.size());
+  buffers.emplace_back(buf, len);
+  write_buffers(buffers);
+  return len;
+}
+
+size_t ClientIO::send_body_buffers(const ceph::bufferlist& bl,
+                                   size_t ofs, size_t len)
+{
+  buffers_type buffers;
+  const auto header = txbuf.release();
+  if (!header.empty()) {
+    buffers.emplace_back(header.data(), header.size());
+  }
+  const size_t total = len;
+  for (const auto& bp : bl.buffers()) {
+    if (len == 0) {
+      break;
+    }
+    if (ofs >= bp.length()) {
+      ofs -= bp.length();
+      continue;
+    }
+    const size_t n = std::min<size_t>(bp.length() - ofs, len);
+    buffers.emplace_back(bp.c_str() + ofs, n);
+    ofs = 0;
+    len -= n;
+  }
+  if (!buffers.empty()) {
+    write_buffers(buffers);
+  }
+  return total - len;
+}
+
 size_t ClientIO::send_header(const std::string_view& name,
                              const std::string_view& value)
 {
@@ -186,6 +241,9 @@ size_t ClientIO::send_content_length(uint64_t len)
   char sizebuf[CONLEN_BUF_SIZE];
   const auto sizelen = snprintf(sizebuf, sizeof(sizebuf),
                                 "Content-Length: %" PRIu64 "\r\n", len);
+  if (len == 0) {
+    has_body = false;
+  }
 
   return txbuf.sputn(sizebuf, sizelen);
 }
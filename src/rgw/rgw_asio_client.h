@@ -4,8 +4,10 @@
 #ifndef RGW_ASIO_CLIENT_H
 #define RGW_ASIO_CLIENT_H
 
+#include <boost/asio/buffer.hpp>
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/beast/core.hpp>
+#include <boost/container/small_vector.hpp>
 #include <boost/beast/http.hpp>
 #include "include/ceph_assert.h"
 
@@ -30,6 +32,15 @@ class ClientIO : public io::RestfulClient,
   RGWEnv env;
 
   rgw::io::StaticOutputBufferer<> txbuf;
+  // false once the status or content length show there is no body
+  bool has_body = true;
+
+ protected:
+  using buffers_type = boost::container::small_vector<
+      boost::asio::const_buffer, 16>;
+
+  // send all of the buffers with a single write
+  virtual size_t write_buffers(const buffers_type& buffers) = 0;
 
  public:
   ClientIO(parser_type& parser, bool is_ssl,
@@ -47,9 +58,9 @@ class ClientIO : public io::RestfulClient,
   size_t send_content_length(uint64_t len) override;
   size_t complete_header() override;
 
-  size_t send_body(const char* buf, size_t len) override {
-    return write_data(buf, len);
-  }
+  size_t send_body(const char* buf, size_t len) override;
+  size_t send_body_buffers(const ceph::bufferlist& bl,
+                           size_t ofs, size_t len) override;
 
   RGWEnv& get_env() noexcept override {
     return env;
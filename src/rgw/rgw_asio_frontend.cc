@@ -83,11 +83,11 @@ class StreamIO : public rgw::asio::ClientIO {
         buffer(buffer)
   {}
 
-  size_t write_data(const char* buf, size_t len) override {
+  template <typename ConstBufferSequence>
+  size_t write(const ConstBufferSequence& buffers) {
     boost::system::error_code ec;
     timeout.start();
-    auto bytes = boost::asio::async_write(stream, boost::asio::buffer(buf, len),
-                                          yield[ec]);
+    auto bytes = boost::asio::async_write(stream, buffers, yield[ec]);
     timeout.cancel();
     if (ec) {
       ldout(cct, 4) << "write_data failed: " << ec.message() << dendl;
@@ -100,6 +100,14 @@ class StreamIO : public rgw::asio::ClientIO {
     return bytes;
   }
 
+  size_t write_data(const char* buf, size_t len) override {
+    return write(boost::asio::buffer(buf, len));
+  }
+
+  size_t write_buffers(const buffers_type& buffers) override {
+    return write(buffers);
+  }
+
   size_t recv_body(char* buf, size_t max) override {
     auto& message = parser.get();
     auto& body_remaining = message.body();
@@ -274,6 +282,14 @@ void handle_connection(boost::asio::io_context& context,
                       lua_manager,
                       &http_ret);
 
+      // send a response header that is still buffered, in case the
+      // request wasn't completed
+      try {
+        real_client.flush();
+      } catch (const rgw::io::Exception& e) {
+        ldout(cct, 5) << "failed to write response: " << e.what() << dendl;
+      }
+
       if (cct->_conf->subsys.should_gather(ceph_subsys_rgw_access, 1)) {
         // access log line elements begin per Apache Combined Log Format with additions following
         lsubdout(cct, rgw_access, 1) << "beast: " << std::hex << &req << std::dec << ": "
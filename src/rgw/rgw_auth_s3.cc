@@ -8,7 +8,9 @@
 #include <string_view>
 #include <vector>
 
+#include "auth/Crypto.h"
 #include "common/armor.h"
+#include "common/lru_map.h"
 #include "common/utf8.h"
 #include "rgw_rest_s3.h"
 #include "rgw_auth_s3.h"
@@ -16,6 +18,7 @@
 #include "rgw_client_io.h"
 #include "rgw_rest.h"
 #include "rgw_crypt_sanitize.h"
+#include "rgw_perf_counters.h"
 
 #include <boost/container/small_vector.hpp>
 #include <boost/algorithm/string.hpp>
@@ -895,13 +898,24 @@ transform_secret_key(const std::string_view& secret_access_key)
 }
 
 /*
- * calculate the SigningKey of AWS auth version 4
+ * The signing key only depends on the secret key and the credential scope
+ * (date, region and service), so every request that a client signs on the
+ * same day derives the same one. Keep the recently used ones, like the AWS
+ * SDKs do on the client side; the keys of past days simply age out. Only
+ * the derived keys are held, never the secrets they came from.
  */
+static lru_map<std::string, sha256_digest_t>*
+get_v4_signing_key_cache(CephContext* const cct)
+{
+  static const size_t size = cct->_conf->rgw_s3_auth_signing_key_cache_size;
+  static lru_map<std::string, sha256_digest_t> cache(size);
+  return size > 0 ? &cache : nullptr;
+}
+
 static sha256_digest_t
-get_v4_signing_key(CephContext* const cct,
-                   const std::string_view& credential_scope,
-                   const std::string_view& secret_access_key,
-                   const DoutPrefixProvider *dpp)
+derive_v4_signing_key(const std::string_view& credential_scope,
+                      const std::string_view& secret_access_key,
+                      const DoutPrefixProvider *dpp)
 {
   std::string_view date, region, service;
   std::tie(date, region, service) = parse_cred_scope(credential_scope);
@@ -923,6 +937,45 @@ get_v4_signing_key(CephContext* const cct,
   return signing_key;
 }
 
+/*
+ * calculate the SigningKey of AWS auth version 4
+ */
+static sha256_digest_t
+get_v4_signing_key(CephContext* const cct,
+                   const std::string_view& credential_scope,
+                   const std::string_view& secret_access_key,
+                   const DoutPrefixProvider *dpp)
+{
+  auto cache = get_v4_signing_key_cache(cct);
+  if (!cache) {
+    return derive_v4_signing_key(credential_scope, secret_access_key, dpp);
+  }
+
+  /* Keep no secret keys in the cache: it is indexed by a keyed digest of
+   * the secret, under a key that never leaves this process. */
+  static const auto digest_key = [cct] {
+    std::array<unsigned char, sha256_digest_t::SIZE> k;
+    cct->random()->get_bytes(reinterpret_cast<char*>(k.data()), k.size());
+    return k;
+  }();
+  const auto secret_digest = calc_hmac_sha256(digest_key, secret_access_key);
+  const auto cache_key = string_join_reserve("\n", credential_scope,
+    std::string_view(reinterpret_cast<const char*>(secret_digest.v),
+                     sha256_digest_t::SIZE));
+  sha256_digest_t signing_key;
+  if (cache->find(cache_key, signing_key)) {
+    ldpp_dout(dpp, 20) << "using cached signing key for credential scope "
+                       << credential_scope << dendl;
+    if (perfcounter) {
+      perfcounter->inc(l_rgw_signing_key_cache_hit);
+    }
+    return signing_key;
+  }
+  signing_key = derive_v4_signing_key(credential_scope, secret_access_key, dpp);
+  cache->add(cache_key, signing_key);
+  return signing_key;
+}
+
 /*
  * calculate the AWS signature version 4
  *
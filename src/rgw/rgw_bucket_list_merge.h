@@ -0,0 +1,217 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab ft=cpp
+
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "include/ceph_assert.h"
+#include "cls/rgw/cls_rgw_ops.h"
+
+namespace rgw::bucket_list {
+
+// what an ordered listing read from one bucket index shard
+struct ShardRead {
+  cls_rgw_obj_key start_after; ///< the results follow this key
+  uint32_t batch = 0;          ///< entries asked for
+  rgw_cls_list_ret result;
+};
+
+// manages an iterator through a shard's list results and provides
+// other accessors
+struct ShardTracker {
+  using iterator = decltype(rgw_bucket_dir::m)::iterator;
+
+  const int shard_idx;
+  const std::string oid_name;
+  ShardRead read;
+  // unless *all* of a shard's results are cls_filtered, the shard is
+  // not filtered
+  bool cls_filtered = true;
+  iterator cursor;
+
+  ShardTracker(int _shard_idx, const std::string& _oid_name) :
+    shard_idx(_shard_idx),
+    oid_name(_oid_name),
+    cursor(read.result.dir.m.end())
+  {}
+
+  void reset(const cls_rgw_obj_key& start_after, uint32_t batch,
+	     rgw_cls_list_ret&& result) {
+    read.start_after = start_after;
+    read.batch = batch;
+    read.result = std::move(result);
+    cls_filtered = cls_filtered && read.result.cls_filtered;
+    cursor = read.result.dir.m.begin();
+  }
+
+  // pick up from a previous page's results for this shard; false if
+  // they do not cover what follows marker, and the shard must be read
+  // again
+  bool resume(const ShardRead& saved,
+	      const cls_rgw_obj_key& marker,
+	      bool list_versions) {
+    if (!(saved.start_after == marker) &&
+	!(saved.start_after.name < marker.name)) {
+      return false;
+    }
+    reset(saved.start_after, saved.batch, rgw_cls_list_ret(saved.result));
+    if (saved.start_after == marker) {
+      return true;
+    }
+    // cls orders instances of one name by their index key, so we
+    // cannot tell where marker falls among them; skip them when cls
+    // would have filtered them anyway, otherwise re-read
+    for (; !at_end(); ++cursor) {
+      const auto& name = cursor->second.key.name;
+      if (name > marker.name) {
+	break;
+      }
+      if (name == marker.name && list_versions) {
+	return false;
+      }
+    }
+    return !(at_end() && is_truncated());
+  }
+
+  inline const std::string& entry_name() const {
+    return cursor->first;
+  }
+  rgw_bucket_dir_entry& dir_entry() const {
+    return cursor->second;
+  }
+  inline bool is_truncated() const {
+    return read.result.is_truncated;
+  }
+  inline ShardTracker& advance() {
+    ++cursor;
+    // return a self-reference to allow for chaining of calls, such
+    // as x.advance().at_end()
+    return *this;
+  }
+  inline bool at_end() const {
+    return cursor == read.result.dir.m.end();
+  }
+}; // ShardTracker
+
+/*
+ * k-way merge of the ordered list results of a bucket's index shards,
+ * smallest name first; ties go to the shard added first so the order is
+ * deterministic. The shards are added up front and must not change
+ * afterwards, as the merge holds pointers into their results.
+ */
+class OrderedMerge {
+public:
+  // read the next batch into a shard whose results are consumed, with
+  // about as many entries as are still wanted; sets *stuck if it cannot
+  // read any further
+  using refill_t = std::function<int(ShardTracker& t, uint32_t wanted,
+				     bool* stuck)>;
+
+private:
+  std::vector<ShardTracker> trackers;
+
+  // (name, index into trackers), which may not be the same as the
+  // shard number, i.e. when not all shards are requested
+  using candidate_t = std::pair<const std::string*, size_t>;
+  struct candidate_after {
+    bool operator()(const candidate_t& a, const candidate_t& b) const {
+      const int c = a.first->compare(*b.first);
+      return c > 0 || (c == 0 && a.second > b.second);
+    }
+  };
+  std::priority_queue<candidate_t, std::vector<candidate_t>,
+		      candidate_after> candidates;
+
+public:
+  explicit OrderedMerge(size_t num_shards) {
+    trackers.reserve(num_shards);
+  }
+
+  ShardTracker& add(int shard_idx, const std::string& oid_name) {
+    ceph_assert(trackers.size() < trackers.capacity());
+    return trackers.emplace_back(shard_idx, oid_name);
+  }
+  std::vector<ShardTracker>& shards() {
+    return trackers;
+  }
+  const std::vector<ShardTracker>& shards() const {
+    return trackers;
+  }
+
+  // once every shard has its first results
+  void start() {
+    for (size_t i = 0; i < trackers.size(); ++i) {
+      if (!trackers[i].at_end()) {
+	candidates.emplace(&trackers[i].entry_name(), i);
+      }
+    }
+  }
+
+  bool empty() const {
+    return candidates.empty();
+  }
+  ShardTracker& top() {
+    return trackers.at(candidates.top().second);
+  }
+
+  // advance every shard positioned at name, refilling those that run out
+  // while wanted > 0. sets *need_to_stop if a truncated shard could not
+  // be read further, as one of the next entries may have to come from it
+  int advance(const std::string& name, uint32_t wanted,
+	      const refill_t& refill, bool* need_to_stop) {
+    while (!candidates.empty() && *candidates.top().first == name) {
+      const size_t idx = candidates.top().second;
+      candidates.pop();
+      auto& t = trackers.at(idx);
+      if (t.advance().at_end() && t.is_truncated() && wanted > 0) {
+	int r = refill(t, wanted, need_to_stop);
+	if (r < 0) {
+	  return r;
+	}
+      }
+      if (!t.at_end()) {
+	candidates.emplace(&t.entry_name(), idx);
+      } else if (t.is_truncated()) {
+	*need_to_stop = true;
+      }
+    }
+    return 0;
+  }
+
+  // if all the returned entries are not consumed, or any *one* shard's
+  // result is truncated, the entire result is truncated
+  bool is_truncated() const {
+    for (const auto& t : trackers) {
+      if (!t.at_end() || t.is_truncated()) {
+	return true;
+      }
+    }
+    return false;
+  }
+
+  bool cls_filtered() const {
+    for (const auto& t : trackers) {
+      if (!t.cls_filtered) {
+	return false;
+      }
+    }
+    return true;
+  }
+}; // OrderedMerge
+
+} // namespace rgw::bucket_list
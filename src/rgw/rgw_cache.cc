@@ -4,22 +4,72 @@
 #include "rgw_cache.h"
 #include "rgw_perf_counters.h"
 
+#include <algorithm>
 #include <errno.h>
 
 #define dout_subsys ceph_subsys_rgw
 
 using namespace std;
 
-int ObjectCache::get(const DoutPrefixProvider *dpp, const string& name, ObjectCacheInfo& info, uint32_t mask, rgw_cache_entry_info *cache_info)
+// promotions queued under the shared lock before a lookup applies them
+static constexpr size_t promotion_batch = 32;
+
+void ObjectCache::set_ctx(CephContext *_cct)
+{
+  cct = _cct;
+  const auto num_shards = std::max<uint64_t>(
+      cct->_conf.get_val<uint64_t>("rgw_cache_shards"), 1);
+  shards.clear();
+  for (uint64_t i = 0; i < num_shards; i++) {
+    shards.push_back(std::make_unique<Shard>());
+  }
+  lru_window = cct->_conf->rgw_cache_lru_size / num_shards / 2;
+  expiry = std::chrono::seconds(cct->_conf.get_val<uint64_t>(
+					      "rgw_cache_expiry_interval"));
+  refresh_ahead = std::chrono::seconds(cct->_conf.get_val<uint64_t>(
+					      "rgw_cache_refresh_ahead_interval"));
+}
+
+size_t ObjectCache::shard_index(const string& name) const
+{
+  return std::hash<string>{}(name) % shards.size();
+}
+
+// takes the shard locks in order, so that it can't deadlock with
+// chain_cache_entry()
+std::vector<std::unique_lock<ceph::shared_mutex>> ObjectCache::lock_all()
 {
+  std::vector<std::unique_lock<ceph::shared_mutex>> locks;
+  locks.reserve(shards.size());
+  for (auto& shard : shards) {
+    locks.emplace_back(shard->lock);
+  }
+  return locks;
+}
+
+int ObjectCache::get(const DoutPrefixProvider *dpp, const string& name, ObjectCacheInfo& info, uint32_t mask,
+		     rgw_cache_entry_info *cache_info, bool *refresh)
+{
+  Shard& shard = shard_of(name);
+  bool promote = false;
+  int r = do_get(dpp, shard, name, info, mask, cache_info, refresh, promote);
+  if (promote) {
+    std::unique_lock wl{shard.lock};
+    apply_promotions(dpp, shard);
+  }
+  return r;
+}
 
-  std::shared_lock rl{lock};
-  std::unique_lock wl{lock, std::defer_lock}; // may be promoted to write lock
+int ObjectCache::do_get(const DoutPrefixProvider *dpp, Shard& shard, const string& name,
+			ObjectCacheInfo& info, uint32_t mask, rgw_cache_entry_info *cache_info,
+			bool *refresh, bool& promote)
+{
+  std::shared_lock rl{shard.lock};
   if (!enabled) {
     return -ENOENT;
   }
-  auto iter = cache_map.find(name);
-  if (iter == cache_map.end()) {
+  auto iter = shard.cache_map.find(name);
+  if (iter == shard.cache_map.end()) {
     ldpp_dout(dpp, 10) << "cache get: name=" << name << " : miss" << dendl;
     if (perfcounter) {
       perfcounter->inc(l_rgw_cache_miss);
@@ -27,18 +77,18 @@ int ObjectCache::get(const DoutPrefixProvider *dpp, const string& name, ObjectCa
     return -ENOENT;
   }
 
-  if (expiry.count() &&
-       (ceph::coarse_mono_clock::now() - iter->second.info.time_added) > expiry) {
+  const auto age = ceph::coarse_mono_clock::now() - iter->second.info.time_added;
+  if (expiry.count() && age > expiry) {
     ldpp_dout(dpp, 10) << "cache get: name=" << name << " : expiry miss" << dendl;
     rl.unlock();
-    wl.lock(); // write lock for expiration
+    std::unique_lock wl{shard.lock}; // write lock for expiration
     // check that wasn't already removed by other thread
-    iter = cache_map.find(name);
-    if (iter != cache_map.end()) {
+    iter = shard.cache_map.find(name);
+    if (iter != shard.cache_map.end()) {
       for (auto &kv : iter->second.chained_entries)
         kv.first->invalidate(kv.second);
-      remove_lru(name, iter->second.lru_iter);
-      cache_map.erase(iter);
+      remove_lru(shard, name, iter->second.lru_iter);
+      shard.cache_map.erase(iter);
     }
     if (perfcounter) {
       perfcounter->inc(l_rgw_cache_miss);
@@ -48,24 +98,13 @@ int ObjectCache::get(const DoutPrefixProvider *dpp, const string& name, ObjectCa
 
   ObjectCacheEntry *entry = &iter->second;
 
-  if (lru_counter - entry->lru_promotion_ts > lru_window) {
-    ldpp_dout(dpp, 20) << "cache get: touching lru, lru_counter=" << lru_counter
+  if (shard.lru_counter - entry->lru_promotion_ts > lru_window &&
+      !entry->promoting.exchange(true)) {
+    ldpp_dout(dpp, 20) << "cache get: queueing lru promotion, lru_counter=" << shard.lru_counter
                    << " promotion_ts=" << entry->lru_promotion_ts << dendl;
-    rl.unlock();
-    wl.lock(); // write lock for touch_lru()
-    /* need to redo this because entry might have dropped off the cache */
-    iter = cache_map.find(name);
-    if (iter == cache_map.end()) {
-      ldpp_dout(dpp, 10) << "lost race! cache get: name=" << name << " : miss" << dendl;
-      if(perfcounter) perfcounter->inc(l_rgw_cache_miss);
-      return -ENOENT;
-    }
-
-    entry = &iter->second;
-    /* check again, we might have lost a race here */
-    if (lru_counter - entry->lru_promotion_ts > lru_window) {
-      touch_lru(dpp, name, *entry, iter->second.lru_iter);
-    }
+    std::lock_guard pl{shard.promotion_lock};
+    shard.promotions.push_back(name);
+    promote = shard.promotions.size() >= promotion_batch;
   }
 
   ObjectCacheInfo& src = iter->second.info;
@@ -90,6 +129,11 @@ int ObjectCache::get(const DoutPrefixProvider *dpp, const string& name, ObjectCa
     cache_info->cache_locator = name;
     cache_info->gen = entry->gen;
   }
+  if (refresh && expiry > refresh_ahead && refresh_ahead.count() &&
+      expiry - age < refresh_ahead && !entry->refreshing.exchange(true)) {
+    ldpp_dout(dpp, 10) << "cache get: name=" << name << " : refreshing ahead of expiry" << dendl;
+    *refresh = true;
+  }
   if(perfcounter) perfcounter->inc(l_rgw_cache_hit);
 
   return 0;
@@ -99,7 +143,19 @@ bool ObjectCache::chain_cache_entry(const DoutPrefixProvider *dpp,
                                     std::initializer_list<rgw_cache_entry_info*> cache_info_entries,
 				    RGWChainedCache::Entry *chained_entry)
 {
-  std::unique_lock l{lock};
+  // lock the shards of all the entries, in order
+  std::vector<size_t> indexes;
+  indexes.reserve(cache_info_entries.size());
+  for (auto cache_info : cache_info_entries) {
+    indexes.push_back(shard_index(cache_info->cache_locator));
+  }
+  std::sort(indexes.begin(), indexes.end());
+  indexes.erase(std::unique(indexes.begin(), indexes.end()), indexes.end());
+  std::vector<std::unique_lock<ceph::shared_mutex>> locks;
+  locks.reserve(indexes.size());
+  for (auto i : indexes) {
+    locks.emplace_back(shards[i]->lock);
+  }
 
   if (!enabled) {
     return false;
@@ -111,6 +167,7 @@ bool ObjectCache::chain_cache_entry(const DoutPrefixProvider *dpp,
   for (auto cache_info : cache_info_entries) {
     ldpp_dout(dpp, 10) << "chain_cache_entry: cache_locator="
 		   << cache_info->cache_locator << dendl;
+    auto& cache_map = shard_of(cache_info->cache_locator).cache_map;
     auto iter = cache_map.find(cache_info->cache_locator);
     if (iter == cache_map.end()) {
       ldpp_dout(dpp, 20) << "chain_cache_entry: couldn't find cache locator" << dendl;
@@ -141,20 +198,31 @@ bool ObjectCache::chain_cache_entry(const DoutPrefixProvider *dpp,
 
 void ObjectCache::put(const DoutPrefixProvider *dpp, const string& name, ObjectCacheInfo& info, rgw_cache_entry_info *cache_info)
 {
-  std::unique_lock l{lock};
+  Shard& shard = shard_of(name);
+  std::unique_lock l{shard.lock};
 
   if (!enabled) {
     return;
   }
 
+  do_put(dpp, shard, name, info, cache_info);
+}
+
+void ObjectCache::do_put(const DoutPrefixProvider *dpp, Shard& shard, const string& name,
+			 ObjectCacheInfo& info, rgw_cache_entry_info *cache_info)
+{
   ldpp_dout(dpp, 10) << "cache put: name=" << name << " info.flags=0x"
                  << std::hex << info.flags << std::dec << dendl;
 
-  auto [iter, inserted] = cache_map.emplace(name, ObjectCacheEntry{});
+  // before taking a reference to the entry, as promotions may evict
+  apply_promotions(dpp, shard);
+
+  auto [iter, inserted] = shard.cache_map.try_emplace(name);
   ObjectCacheEntry& entry = iter->second;
   entry.info.time_added = ceph::coarse_mono_clock::now();
+  entry.refreshing = false;
   if (inserted) {
-    entry.lru_iter = lru.end();
+    entry.lru_iter = shard.lru.end();
   }
   ObjectCacheInfo& target = entry.info;
 
@@ -163,7 +231,7 @@ void ObjectCache::put(const DoutPrefixProvider *dpp, const string& name, ObjectC
   entry.chained_entries.clear();
   entry.gen++;
 
-  touch_lru(dpp, name, entry, entry.lru_iter);
+  touch_lru(dpp, shard, name, entry, entry.lru_iter);
 
   target.status = info.status;
 
@@ -214,18 +282,63 @@ void ObjectCache::put(const DoutPrefixProvider *dpp, const string& name, ObjectC
     target.version = info.version;
 }
 
+void ObjectCache::refresh(const DoutPrefixProvider *dpp, const string& name, ObjectCacheInfo& info)
+{
+  Shard& shard = shard_of(name);
+  std::unique_lock l{shard.lock};
+
+  if (!enabled) {
+    return;
+  }
+
+  if (perfcounter) {
+    perfcounter->inc(l_rgw_cache_refresh);
+  }
+  auto iter = shard.cache_map.find(name);
+  if (iter == shard.cache_map.end() || !iter->second.refreshing) {
+    // put or invalidated while we read it, so the read may be stale
+    ldpp_dout(dpp, 10) << "cache refresh: name=" << name << " : superseded" << dendl;
+    return;
+  }
+  ObjectCacheEntry& entry = iter->second;
+  const ObjectCacheInfo& cur = entry.info;
+  if (cur.status == info.status &&
+      (cur.flags & CACHE_FLAGS_REFRESH) == info.flags &&
+      (!(info.flags & CACHE_FLAG_OBJV) || cur.version.compare(&info.version)) &&
+      (!(info.flags & CACHE_FLAG_DATA) || cur.data.contents_equal(info.data)) &&
+      (!(info.flags & CACHE_FLAG_XATTRS) || cur.xattrs == info.xattrs)) {
+    ldpp_dout(dpp, 10) << "cache refresh: name=" << name << " : unchanged" << dendl;
+    entry.info.time_added = ceph::coarse_mono_clock::now();
+    entry.refreshing = false;
+    return;
+  }
+  do_put(dpp, shard, name, info, nullptr);
+}
+
+void ObjectCache::refresh_dropped(const string& name)
+{
+  Shard& shard = shard_of(name);
+  std::shared_lock l{shard.lock};
+
+  auto iter = shard.cache_map.find(name);
+  if (iter != shard.cache_map.end()) {
+    iter->second.refreshing = false;
+  }
+}
+
 // WARNING: This function /must not/ be modified to cache a
 // negative lookup. It must only invalidate.
 bool ObjectCache::invalidate_remove(const DoutPrefixProvider *dpp, const string& name)
 {
-  std::unique_lock l{lock};
+  Shard& shard = shard_of(name);
+  std::unique_lock l{shard.lock};
 
   if (!enabled) {
     return false;
   }
 
-  auto iter = cache_map.find(name);
-  if (iter == cache_map.end())
+  auto iter = shard.cache_map.find(name);
+  if (iter == shard.cache_map.end())
     return false;
 
   ldpp_dout(dpp, 10) << "removing " << name << " from cache" << dendl;
@@ -235,16 +348,33 @@ bool ObjectCache::invalidate_remove(const DoutPrefixProvider *dpp, const string&
     kv.first->invalidate(kv.second);
   }
 
-  remove_lru(name, iter->second.lru_iter);
-  cache_map.erase(iter);
+  remove_lru(shard, name, iter->second.lru_iter);
+  shard.cache_map.erase(iter);
   return true;
 }
 
-void ObjectCache::touch_lru(const DoutPrefixProvider *dpp, const string& name, ObjectCacheEntry& entry,
-			    std::list<string>::iterator& lru_iter)
+void ObjectCache::apply_promotions(const DoutPrefixProvider *dpp, Shard& shard)
 {
-  while (lru_size > (size_t)cct->_conf->rgw_cache_lru_size) {
-    auto iter = lru.begin();
+  std::vector<string> names;
+  {
+    std::lock_guard pl{shard.promotion_lock};
+    names.swap(shard.promotions);
+  }
+  for (const auto& name : names) {
+    auto iter = shard.cache_map.find(name);
+    if (iter != shard.cache_map.end()) {
+      iter->second.promoting = false;
+      touch_lru(dpp, shard, name, iter->second, iter->second.lru_iter);
+    }
+  }
+}
+
+void ObjectCache::touch_lru(const DoutPrefixProvider *dpp, Shard& shard, const string& name,
+			    ObjectCacheEntry& entry, std::list<string>::iterator& lru_iter)
+{
+  const size_t lru_max = std::max<size_t>(cct->_conf->rgw_cache_lru_size / shards.size(), 1);
+  while (shard.lru_size > lru_max) {
+    auto iter = shard.lru.begin();
     if ((*iter).compare(name) == 0) {
       /*
        * if the entry we're touching happens to be at the lru end, don't remove it,
@@ -252,43 +382,43 @@ void ObjectCache::touch_lru(const DoutPrefixProvider *dpp, const string& name, O
        */
       break;
     }
-    auto map_iter = cache_map.find(*iter);
+    auto map_iter = shard.cache_map.find(*iter);
     ldout(cct, 10) << "removing entry: name=" << *iter << " from cache LRU" << dendl;
-    if (map_iter != cache_map.end()) {
+    if (map_iter != shard.cache_map.end()) {
       ObjectCacheEntry& entry = map_iter->second;
       invalidate_lru(entry);
-      cache_map.erase(map_iter);
+      shard.cache_map.erase(map_iter);
     }
-    lru.pop_front();
-    lru_size--;
+    shard.lru.pop_front();
+    shard.lru_size--;
   }
 
-  if (lru_iter == lru.end()) {
-    lru.push_back(name);
-    lru_size++;
+  if (lru_iter == shard.lru.end()) {
+    shard.lru.push_back(name);
+    shard.lru_size++;
     lru_iter--;
     ldpp_dout(dpp, 10) << "adding " << name << " to cache LRU end" << dendl;
   } else {
     ldpp_dout(dpp, 10) << "moving " << name << " to cache LRU end" << dendl;
-    lru.erase(lru_iter);
-    lru.push_back(name);
-    lru_iter = lru.end();
+    shard.lru.erase(lru_iter);
+    shard.lru.push_back(name);
+    lru_iter = shard.lru.end();
     --lru_iter;
   }
 
-  lru_counter++;
-  entry.lru_promotion_ts = lru_counter;
+  shard.lru_counter++;
+  entry.lru_promotion_ts = shard.lru_counter;
 }
 
-void ObjectCache::remove_lru(const string& name,
+void ObjectCache::remove_lru(Shard& shard, const string& name,
 			     std::list<string>::iterator& lru_iter)
 {
-  if (lru_iter == lru.end())
+  if (lru_iter == shard.lru.end())
     return;
 
-  lru.erase(lru_iter);
-  lru_size--;
-  lru_iter = lru.end();
+  shard.lru.erase(lru_iter);
+  shard.lru_size--;
+  lru_iter = shard.lru.end();
 }
 
 void ObjectCache::invalidate_lru(ObjectCacheEntry& entry)
@@ -302,7 +432,7 @@ void ObjectCache::invalidate_lru(ObjectCacheEntry& entry)
 
 void ObjectCache::set_enabled(bool status)
 {
-  std::unique_lock l{lock};
+  auto locks = lock_all();
 
   enabled = status;
 
@@ -313,19 +443,23 @@ void ObjectCache::set_enabled(bool status)
 
 void ObjectCache::invalidate_all()
 {
-  std::unique_lock l{lock};
+  auto locks = lock_all();
 
   do_invalidate_all();
 }
 
 void ObjectCache::do_invalidate_all()
 {
-  cache_map.clear();
-  lru.clear();
+  for (auto& shard : shards) {
+    shard->cache_map.clear();
+    shard->lru.clear();
+
+    shard->lru_size = 0;
+    shard->lru_counter = 0;
 
-  lru_size = 0;
-  lru_counter = 0;
-  lru_window = 0;
+    std::lock_guard pl{shard->promotion_lock};
+    shard->promotions.clear();
+  }
 
   for (auto& cache : chained_cache) {
     cache->invalidate_all();
@@ -333,12 +467,12 @@ void ObjectCache::do_invalidate_all()
 }
 
 void ObjectCache::chain_cache(RGWChainedCache *cache) {
-  std::unique_lock l{lock};
+  auto locks = lock_all();
   chained_cache.push_back(cache);
 }
 
 void ObjectCache::unchain_cache(RGWChainedCache *cache) {
-  std::unique_lock l{lock};
+  auto locks = lock_all();
 
   auto iter = chained_cache.begin();
   for (; iter != chained_cache.end(); ++iter) {
@@ -4,9 +4,13 @@
 #ifndef CEPH_RGWCACHE_H
 #define CEPH_RGWCACHE_H
 
-#include <string>
+#include <atomic>
+#include <list>
 #include <map>
+#include <memory>
+#include <string>
 #include <unordered_map>
+#include <vector>
 #include "include/types.h"
 #include "include/utime.h"
 #include "include/ceph_assert.h"
@@ -26,6 +30,9 @@ enum {
 #define CACHE_FLAG_MODIFY_XATTRS  0x08
 #define CACHE_FLAG_OBJV           0x10
 
+// the parts of an entry that a refresh re-reads
+#define CACHE_FLAGS_REFRESH (CACHE_FLAG_DATA | CACHE_FLAG_XATTRS | CACHE_FLAG_OBJV)
+
 struct ObjectMetaInfo {
   uint64_t size;
   real_time mtime;
@@ -155,35 +162,71 @@ struct ObjectCacheEntry {
   uint64_t lru_promotion_ts;
   uint64_t gen;
   std::vector<std::pair<RGWChainedCache *, std::string> > chained_entries;
+  // set under the shared lock by the lookup that queued an lru promotion
+  // or asked for a refresh, so that the others don't repeat it
+  std::atomic<bool> promoting{false};
+  std::atomic<bool> refreshing{false};
 
   ObjectCacheEntry() : lru_promotion_ts(0), gen(0) {}
 };
 
 class ObjectCache {
-  std::unordered_map<std::string, ObjectCacheEntry> cache_map;
-  std::list<std::string> lru;
-  unsigned long lru_size;
-  unsigned long lru_counter;
+  // entries are spread over shards by name hash, each with its own lock,
+  // map and lru, so that lookups of different entries don't contend
+  struct Shard {
+    std::unordered_map<std::string, ObjectCacheEntry> cache_map;
+    std::list<std::string> lru;
+    unsigned long lru_size = 0;
+    unsigned long lru_counter = 0;
+    ceph::shared_mutex lock = ceph::make_shared_mutex("ObjectCache::Shard");
+
+    // lru promotions of entries found under the shared lock, applied in
+    // batches under the exclusive one
+    ceph::mutex promotion_lock = ceph::make_mutex("ObjectCache::Shard::promotion");
+    std::vector<std::string> promotions;
+  };
+  std::vector<std::unique_ptr<Shard>> shards;
   unsigned long lru_window;
-  ceph::shared_mutex lock = ceph::make_shared_mutex("ObjectCache");
   CephContext *cct;
 
   std::vector<RGWChainedCache *> chained_cache;
 
   bool enabled;
   ceph::timespan expiry;
+  ceph::timespan refresh_ahead;
 
-  void touch_lru(const DoutPrefixProvider *dpp, const std::string& name, ObjectCacheEntry& entry,
-		 std::list<std::string>::iterator& lru_iter);
-  void remove_lru(const std::string& name, std::list<std::string>::iterator& lru_iter);
+  size_t shard_index(const std::string& name) const;
+  Shard& shard_of(const std::string& name) {
+    return *shards[shard_index(name)];
+  }
+  std::vector<std::unique_lock<ceph::shared_mutex>> lock_all();
+
+  int do_get(const DoutPrefixProvider *dpp, Shard& shard, const std::string& name,
+             ObjectCacheInfo& info, uint32_t mask, rgw_cache_entry_info *cache_info,
+             bool *refresh, bool& promote);
+  void do_put(const DoutPrefixProvider *dpp, Shard& shard, const std::string& name,
+              ObjectCacheInfo& info, rgw_cache_entry_info *cache_info);
+
+  void apply_promotions(const DoutPrefixProvider *dpp, Shard& shard);
+  void touch_lru(const DoutPrefixProvider *dpp, Shard& shard, const std::string& name,
+		 ObjectCacheEntry& entry, std::list<std::string>::iterator& lru_iter);
+  void remove_lru(Shard& shard, const std::string& name,
+		  std::list<std::string>::iterator& lru_iter);
   void invalidate_lru(ObjectCacheEntry& entry);
 
   void do_invalidate_all();
 
 public:
-  ObjectCache() : lru_size(0), lru_counter(0), lru_window(0), cct(NULL), enabled(false) { }
+  ObjectCache() : lru_window(0), cct(NULL), enabled(false) {
+    shards.push_back(std::make_unique<Shard>());
+  }
   ~ObjectCache();
-  int get(const DoutPrefixProvider *dpp, const std::string& name, ObjectCacheInfo& bl, uint32_t mask, rgw_cache_entry_info *cache_info);
+  /// if @p refresh is given, it is set for a single lookup of an entry
+  /// that is about to expire, whose caller should re-read the
+  /// CACHE_FLAGS_REFRESH parts of info.flags and pass them to refresh(),
+  /// or call refresh_dropped() if it won't
+  int get(const DoutPrefixProvider *dpp, const std::string& name, ObjectCacheInfo& bl, uint32_t mask,
+	  rgw_cache_entry_info *cache_info, bool *refresh = nullptr);
   std::optional<ObjectCacheInfo> get(const DoutPrefixProvider *dpp, const std::string& name) {
     std::optional<ObjectCacheInfo> info{std::in_place};
     auto r = get(dpp, name, *info, 0, nullptr);
@@ -192,10 +235,13 @@ public:
 
   template<typename F>
   void for_each(const F& f) {
-    std::shared_lock l{lock};
-    if (enabled) {
+    for (auto& shard : shards) {
+      std::shared_lock l{shard->lock};
+      if (!enabled) {
+        return;
+      }
       auto now  = ceph::coarse_mono_clock::now();
-      for (const auto& [name, entry] : cache_map) {
+      for (const auto& [name, entry] : shard->cache_map) {
         if (expiry.count() && (now - entry.info.time_added) < expiry) {
           f(name, entry);
         }
@@ -204,13 +250,14 @@ public:
   }
 
   void put(const DoutPrefixProvider *dpp, const std::string& name, ObjectCacheInfo& bl, rgw_cache_entry_info *cache_info);
+  /// store the re-read of an entry that get() asked to refresh. if it
+  /// didn't change, only its age is reset and chained entries are kept.
+  /// dropped if the entry was put or invalidated since
+  void refresh(const DoutPrefixProvider *dpp, const std::string& name, ObjectCacheInfo& info);
+  /// let a later lookup ask to refresh the entry again
+  void refresh_dropped(const std::string& name);
   bool invalidate_remove(const DoutPrefixProvider *dpp, const std::string& name);
-  void set_ctx(CephContext *_cct) {
-    cct = _cct;
-    lru_window = cct->_conf->rgw_cache_lru_size / 2;
-    expiry = std::chrono::seconds(cct->_conf.get_val<uint64_t>(
-						"rgw_cache_expiry_interval"));
-  }
+  void set_ctx(CephContext *_cct);
   bool chain_cache_entry(const DoutPrefixProvider *dpp,
                          std::initializer_list<rgw_cache_entry_info*> cache_info_entries,
 			 RGWChainedCache::Entry *chained_entry);
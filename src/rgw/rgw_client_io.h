@@ -146,6 +146,30 @@ public:
    * of response's body. On failure throws rgw::io::Exception. */
   virtual size_t send_body(const char* buf, size_t len) = 0;
 
+  /* Generate a part of response's body by taking exactly @len bytes of @bl,
+   * starting at @ofs. Front-ends able to write scattered data override this
+   * to send the buffers of @bl without copying them together first. On
+   * success returns number of generated bytes of response's body. On failure
+   * throws rgw::io::Exception. */
+  virtual size_t send_body_buffers(const ceph::bufferlist& bl,
+                                   size_t ofs, size_t len) {
+    size_t sent = 0;
+    for (const auto& bp : bl.buffers()) {
+      if (len == 0) {
+        break;
+      }
+      if (ofs >= bp.length()) {
+        ofs -= bp.length();
+        continue;
+      }
+      const size_t n = std::min<size_t>(bp.length() - ofs, len);
+      sent += send_body(bp.c_str() + ofs, n);
+      ofs = 0;
+      len -= n;
+    }
+    return sent;
+  }
+
   /* Flushes all already generated data to a direct client of RadosGW.
    * On failure throws rgw::io::Exception containing errno. */
   virtual void flush() = 0;
@@ -240,6 +264,11 @@ public:
     return get_decoratee().send_body(buf, len);
   }
 
+  size_t send_body_buffers(const ceph::bufferlist& bl,
+                           const size_t ofs, const size_t len) override {
+    return get_decoratee().send_body_buffers(bl, ofs, len);
+  }
+
   void flush() override {
     return get_decoratee().flush();
   }
@@ -312,6 +341,16 @@ public:
     constexpr size_t len = sizeof(buffer) - sizeof(std::streambuf::char_type);
     std::streambuf::setp(buffer, buffer + len);
   }
+
+  /* Take the buffered bytes out without sending them, so that the caller
+   * can send them along with something else. The returned view stays valid
+   * until the next write to the buffer. */
+  std::string_view release() {
+    const auto len = static_cast<size_t>(std::streambuf::pptr() -
+                                         std::streambuf::pbase());
+    std::streambuf::pbump(-len);
+    return {std::streambuf::pbase(), len};
+  }
 };
 
 } /* namespace io */
@@ -122,6 +122,18 @@ public:
     return sent;
   }
 
+  size_t send_body_buffers(const ceph::bufferlist& bl,
+                           const size_t ofs, const size_t len) override {
+    const auto sent = DecoratedRestfulClient<T>::send_body_buffers(bl, ofs, len);
+    lsubdout(cct, rgw, 30) << "AccountingFilter::send_body_buffers: e="
+        << (enabled ? "1" : "0") << ", sent=" << sent << ", total="
+        << total_sent << dendl;
+    if (enabled) {
+      total_sent += sent;
+    }
+    return sent;
+  }
+
   size_t complete_request() override {
     const auto sent = DecoratedRestfulClient<T>::complete_request();
     lsubdout(cct, rgw, 30) << "AccountingFilter::complete_request: e="
@@ -173,6 +185,8 @@ public:
   size_t send_chunked_transfer_encoding() override;
   size_t complete_header() override;
   size_t send_body(const char* buf, size_t len) override;
+  size_t send_body_buffers(const ceph::bufferlist& bl,
+                           size_t ofs, size_t len) override;
   size_t complete_request() override;
 };
 
@@ -191,6 +205,25 @@ size_t BufferingFilter<T>::send_body(const char* const buf,
   return DecoratedRestfulClient<T>::send_body(buf, len);
 }
 
+template <typename T>
+size_t BufferingFilter<T>::send_body_buffers(const ceph::bufferlist& bl,
+                                             const size_t ofs,
+                                             const size_t len)
+{
+  if (buffer_data) {
+    /* The buffers of @bl may only be valid until we return. */
+    ceph::bufferptr bp(len);
+    bl.begin(ofs).copy(len, bp.c_str());
+    data.append(std::move(bp));
+
+    lsubdout(cct, rgw, 30) << "BufferingFilter<T>::send_body_buffers: defer count = "
+        << len << dendl;
+    return 0;
+  }
+
+  return DecoratedRestfulClient<T>::send_body_buffers(bl, ofs, len);
+}
+
 template <typename T>
 size_t BufferingFilter<T>::send_content_length(const uint64_t len)
 {
@@ -238,12 +271,10 @@ size_t BufferingFilter<T>::complete_request()
   }
 
   if (buffer_data) {
-    /* We are sending each buffer separately to avoid extra memory shuffling
+    /* We are sending the buffers as they are to avoid extra memory shuffling
      * that would occur on data.c_str() to provide a continuous memory area. */
-    for (const auto& ptr : data.buffers()) {
-      sent += DecoratedRestfulClient<T>::send_body(ptr.c_str(),
-                                                   ptr.length());
-    }
+    sent += DecoratedRestfulClient<T>::send_body_buffers(data, 0,
+                                                         data.length());
     data.clear();
     buffer_data = false;
     lsubdout(cct, rgw, 30) << "BufferingFilter::complete_request: buffer_data: sent="
@@ -267,6 +298,27 @@ class ChunkingFilter : public DecoratedRestfulClient<T> {
 protected:
   bool chunking_enabled;
 
+  /* Frame the chunk and send it with a single write. */
+  size_t send_chunk(const ceph::bufferlist& bl,
+                    const size_t ofs, const size_t len) {
+    static constexpr char HEADER_END[] = "\r\n";
+    /* https://www.w3.org/Protocols/rfc2616/rfc2616-sec3.html#sec3.6.1 */
+    // TODO: we have no support for sending chunked-encoding
+    // extensions/trailing headers.
+    char chunk_size[32];
+    const auto chunk_size_len = snprintf(chunk_size, sizeof(chunk_size),
+                                         "%zx\r\n", len);
+    ceph::bufferlist chunk;
+    chunk.append(chunk_size, chunk_size_len);
+    ceph::bufferlist data;
+    data.substr_of(bl, ofs, len);
+    chunk.claim_append(data);
+    chunk.append(HEADER_END, sizeof(HEADER_END) - 1);
+
+    return DecoratedRestfulClient<T>::send_body_buffers(chunk, 0,
+                                                        chunk.length());
+  }
+
 public:
   template <typename U>
   explicit ChunkingFilter(U&& decoratee)
@@ -285,20 +337,19 @@ public:
     if (! chunking_enabled) {
       return DecoratedRestfulClient<T>::send_body(buf, len);
     } else {
-      static constexpr char HEADER_END[] = "\r\n";
-      /* https://www.w3.org/Protocols/rfc2616/rfc2616-sec3.html#sec3.6.1 */
-      // TODO: we have no support for sending chunked-encoding
-      // extensions/trailing headers.
-      char chunk_size[32];
-      const auto chunk_size_len = snprintf(chunk_size, sizeof(chunk_size),
-                                           "%zx\r\n", len);
-      size_t sent = 0;
-
-      sent += DecoratedRestfulClient<T>::send_body(chunk_size, chunk_size_len);
-      sent += DecoratedRestfulClient<T>::send_body(buf, len);
-      sent += DecoratedRestfulClient<T>::send_body(HEADER_END,
-                                                   sizeof(HEADER_END) - 1);
-      return sent;
+      /* The data is sent before we return, so it doesn't need a copy. */
+      ceph::bufferlist bl;
+      bl.append(ceph::buffer::create_static(len, const_cast<char*>(buf)));
+      return send_chunk(bl, 0, len);
+    }
+  }
+
+  size_t send_body_buffers(const ceph::bufferlist& bl,
+                           const size_t ofs, const size_t len) override {
+    if (! chunking_enabled) {
+      return DecoratedRestfulClient<T>::send_body_buffers(bl, ofs, len);
+    } else {
+      return send_chunk(bl, ofs, len);
     }
   }
 
@@ -2,6 +2,7 @@
 // vim: ts=8 sw=2 smarttab ft=cpp
 
 #include "rgw_compression.h"
+#include "rgw_perf_counters.h"
 
 #define dout_subsys ceph_subsys_rgw
 
@@ -51,7 +52,12 @@ int RGWPutObj_Compress::process(bufferlist&& in, uint64_t logical_offset)
     if ((logical_offset > 0 && compressed) || // if previous part was compressed
         (logical_offset == 0)) {              // or it's the first part
       ldout(cct, 10) << "Compression for rgw is enabled, compress part " << in.length() << dendl;
+      const auto start = ceph::mono_clock::now();
       int cr = compressor->compress(in, out, compressor_message);
+      if (perfcounter) {
+        perfcounter->inc(l_rgw_put_compress_b, in.length());
+        perfcounter->tinc(l_rgw_put_compress_time, ceph::mono_clock::now() - start);
+      }
       if (cr < 0) {
         if (logical_offset > 0) {
           lderr(cct) << "Compression failed with exit code " << cr
@@ -725,7 +725,7 @@ int RGWAsyncFetchRemoteObj::_send_request(const DoutPrefixProvider *dpp)
     
   std::string etag;
 
-  std::optional<uint64_t> bytes_transferred;
+  const auto fetch_start = ceph::mono_clock::now();
   int r = store->getRados()->fetch_remote_obj(obj_ctx,
                        user_id.value_or(rgw_user()),
                        NULL, /* req_info */
@@ -756,6 +756,7 @@ int RGWAsyncFetchRemoteObj::_send_request(const DoutPrefixProvider *dpp)
                        filter.get(),
                        &zones_trace,
                        &bytes_transferred);
+  fetch_latency = ceph::mono_clock::now() - fetch_start;
 
   if (r < 0) {
     ldpp_dout(dpp, 0) << "store->fetch_remote_obj() returned r=" << r << dendl;
@@ -1054,6 +1054,9 @@ class RGWAsyncFetchRemoteObj : public RGWAsyncRadosRequest {
   PerfCounters* counters;
   const DoutPrefixProvider *dpp;
 
+  std::optional<uint64_t> bytes_transferred;
+  ceph::timespan fetch_latency = ceph::timespan::zero();
+
 protected:
   int _send_request(const DoutPrefixProvider *dpp) override;
 public:
@@ -1088,6 +1091,16 @@ public:
       zones_trace = *_zones_trace;
     }
   }
+
+  /// unset if the object was not modified
+  std::optional<uint64_t> get_bytes_transferred() const {
+    return bytes_transferred;
+  }
+  /// the time spent fetching from the source zone, without the time the
+  /// request waited in the async_rados queue
+  ceph::timespan get_fetch_latency() const {
+    return fetch_latency;
+  }
 };
 
 class RGWFetchRemoteObjCR : public RGWSimpleCoroutine {
@@ -1116,6 +1129,8 @@ class RGWFetchRemoteObjCR : public RGWSimpleCoroutine {
   rgw_zone_set *zones_trace;
   PerfCounters* counters;
   const DoutPrefixProvider *dpp;
+  std::optional<uint64_t> *bytes_transferred;
+  ceph::timespan *fetch_latency;
 
 public:
   RGWFetchRemoteObjCR(RGWAsyncRadosProcessor *_async_rados, rgw::sal::RadosStore* _store,
@@ -1130,7 +1145,9 @@ public:
                       bool _if_newer,
                       std::shared_ptr<RGWFetchObjFilter> _filter,
                       rgw_zone_set *_zones_trace,
-                      PerfCounters* counters, const DoutPrefixProvider *dpp)
+                      PerfCounters* counters, const DoutPrefixProvider *dpp,
+                      std::optional<uint64_t> *_bytes_transferred = nullptr,
+                      ceph::timespan *_fetch_latency = nullptr)
     : RGWSimpleCoroutine(_store->ctx()), cct(_store->ctx()),
       async_rados(_async_rados), store(_store),
       source_zone(_source_zone),
@@ -1144,7 +1161,9 @@ public:
       copy_if_newer(_if_newer),
       filter(_filter),
       req(NULL),
-      zones_trace(_zones_trace), counters(counters), dpp(dpp) {}
+      zones_trace(_zones_trace), counters(counters), dpp(dpp),
+      bytes_transferred(_bytes_transferred),
+      fetch_latency(_fetch_latency) {}
 
 
   ~RGWFetchRemoteObjCR() override {
@@ -1168,6 +1187,12 @@ public:
   }
 
   int request_complete() override {
+    if (bytes_transferred) {
+      *bytes_transferred = req->get_bytes_transferred();
+    }
+    if (fetch_latency) {
+      *fetch_latency = req->get_fetch_latency();
+    }
     return req->get_ret_status();
   }
 };
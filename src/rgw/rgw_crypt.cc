@@ -16,6 +16,7 @@
 #include "crypto/crypto_accel.h"
 #include "crypto/crypto_plugin.h"
 #include "rgw/rgw_kms.h"
+#include "rgw/rgw_perf_counters.h"
 #include "rapidjson/document.h"
 #include "rapidjson/writer.h"
 #include "rapidjson/error/error.h"
@@ -804,7 +805,10 @@ RGWPutObj_BlockEncrypt::RGWPutObj_BlockEncrypt(const DoutPrefixProvider *dpp,
     dpp(dpp),
     cct(cct),
     crypt(std::move(crypt)),
-    block_size(this->crypt->get_block_size())
+    block_size(this->crypt->get_block_size()),
+    slice_size(std::max<uint64_t>(
+        cct->_conf.get_val<Option::size_t>("rgw_crypt_slice_size").value & ~(block_size - 1),
+        block_size))
 {
 }
 
@@ -824,10 +828,29 @@ int RGWPutObj_BlockEncrypt::process(bufferlist&& data, uint64_t logical_offset)
     proc_size = cache.length();
   }
   if (proc_size > 0) {
-    bufferlist in, out;
-    cache.splice(0, proc_size, &in);
-    if (!crypt->encrypt(in, 0, proc_size, out, logical_offset)) {
-      return -ERR_INTERNAL_ERROR;
+    // encrypt in slices that stay in the cpu cache between reading the
+    // plaintext and writing the ciphertext. encrypt() reads its input as
+    // one contiguous buffer, so slicing avoids flattening all of the data
+    // at once; a slice within one buffer isn't copied at all. each slice
+    // is written to a new output buffer. slices are whole blocks, so only
+    // the last one of a flush can be partial
+    const auto start = ceph::mono_clock::now();
+    bufferlist out;
+    uint64_t ofs = logical_offset;
+    for (uint64_t remain = proc_size; remain > 0; ) {
+      const uint64_t len = std::min<uint64_t>(remain, slice_size);
+      bufferlist in, slice;
+      cache.splice(0, len, &in);
+      if (!crypt->encrypt(in, 0, len, slice, ofs)) {
+        return -ERR_INTERNAL_ERROR;
+      }
+      out.claim_append(slice);
+      ofs += len;
+      remain -= len;
+    }
+    if (perfcounter) {
+      perfcounter->inc(l_rgw_put_encrypt_b, proc_size);
+      perfcounter->tinc(l_rgw_put_encrypt_time, ceph::mono_clock::now() - start);
     }
     int r = Pipe::process(std::move(out), logical_offset);
     logical_offset += proc_size;
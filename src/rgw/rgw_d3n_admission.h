@@ -0,0 +1,99 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab ft=cpp
+
+#ifndef RGW_D3N_ADMISSION_H
+#define RGW_D3N_ADMISSION_H
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <vector>
+
+/*
+ * TinyLFU admission filter for the d3n data cache.
+ *
+ * A count-min sketch of small saturating counters estimates how often
+ * each object was requested recently. Once the number of samples
+ * reaches ten times the number of objects the cache is expected to
+ * hold, all counters are halved so that the estimates follow changes
+ * in popularity. A full cache only admits an object that was requested
+ * more often than the one it would replace, so a scan over objects
+ * that are read once does not flush the cache.
+ *
+ * Not thread-safe; callers serialize access.
+ */
+class D3nAdmissionFilter {
+  static constexpr unsigned depth = 4;
+  static constexpr uint8_t max_count = 15;
+
+  std::vector<uint8_t> counters; // depth rows of (mask + 1) counters
+  uint64_t mask = 0;
+  uint64_t samples = 0;
+  uint64_t sample_limit = 0;
+
+  static uint64_t mix(uint64_t hash, unsigned row) {
+    // splitmix64 finalizer, seeded per row
+    hash += 0x9e3779b97f4a7c15ull * (row + 1);
+    hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ull;
+    hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebull;
+    return hash ^ (hash >> 31);
+  }
+  size_t index(uint64_t hash, unsigned row) const {
+    return row * (mask + 1) + (mix(hash, row) & mask);
+  }
+
+  void age() {
+    for (auto& c : counters) {
+      c >>= 1;
+    }
+    samples /= 2;
+  }
+
+public:
+  /// size the sketch for a cache of about @p entries objects
+  explicit D3nAdmissionFilter(uint64_t entries = 0) {
+    init(entries);
+  }
+
+  void init(uint64_t entries) {
+    entries = std::max<uint64_t>(entries, 16);
+    const uint64_t width = std::bit_ceil(entries * 2);
+    counters.assign(depth * width, 0);
+    mask = width - 1;
+    samples = 0;
+    sample_limit = entries * 10;
+  }
+
+  /// count a request for the object with @p hash
+  void record(uint64_t hash) {
+    // conservative update: only raise the counters that hold the minimum
+    const uint8_t min = estimate(hash);
+    if (min < max_count) {
+      for (unsigned row = 0; row < depth; row++) {
+        auto& c = counters[index(hash, row)];
+        if (c == min) {
+          c++;
+        }
+      }
+    }
+    if (++samples >= sample_limit) {
+      age();
+    }
+  }
+
+  /// estimated number of recent requests for the object with @p hash
+  uint8_t estimate(uint64_t hash) const {
+    uint8_t min = max_count;
+    for (unsigned row = 0; row < depth; row++) {
+      min = std::min(min, counters[index(hash, row)]);
+    }
+    return min;
+  }
+
+  /// true if @p candidate should replace @p victim in a full cache
+  bool admit(uint64_t candidate, uint64_t victim) const {
+    return estimate(candidate) > estimate(victim);
+  }
+};
+
+#endif
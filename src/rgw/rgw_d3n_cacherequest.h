@@ -6,11 +6,11 @@
 
 #include <fcntl.h>
 #include <stdlib.h>
-#include <aio.h>
 
 #include "include/rados/librados.hpp"
 #include "include/Context.h"
 #include "common/async/completion.h"
+#include "common/ceph_time.h"
 
 #include <errno.h>
 #include "common/error_code.h"
@@ -18,8 +18,11 @@
 
 #include "rgw_aio.h"
 #include "rgw_cache.h"
+#include "rgw_d3n_io.h"
 
 
+struct D3nDataCache;
+
 struct D3nGetObjData {
   std::mutex d3n_lock;
 };
@@ -29,66 +32,39 @@ struct D3nL1CacheRequest {
     lsubdout(g_ceph_context, rgw_datacache, 30) << "D3nDataCache: " << __func__ << "(): Read From Cache, complete" << dendl;
   }
 
-  // unique_ptr with custom deleter for struct aiocb
-  struct libaio_aiocb_deleter {
-    void operator()(struct aiocb* c) {
-      if(c->aio_fildes > 0) {
-        if( ::close(c->aio_fildes) != 0) {
-          lsubdout(g_ceph_context, rgw_datacache, 2) << "D3nDataCache: " << __func__ << "(): Error - can't close file, errno=" << -errno << dendl;
-        }
-      }
-      delete c;
-    }
-  };
-
-  using unique_aio_cb_ptr = std::unique_ptr<struct aiocb, libaio_aiocb_deleter>;
-
   struct AsyncFileReadOp {
     bufferlist result;
-    unique_aio_cb_ptr aio_cb;
+    int fd = -1;
     using Signature = void(boost::system::error_code, bufferlist);
     using Completion = ceph::async::Completion<Signature, AsyncFileReadOp>;
 
-    int init(const DoutPrefixProvider *dpp, const std::string& file_path, off_t read_ofs, off_t read_len, void* arg) {
+    AsyncFileReadOp() = default;
+    AsyncFileReadOp(AsyncFileReadOp&& o)
+      : result(std::move(o.result)), fd(std::exchange(o.fd, -1)) {}
+    ~AsyncFileReadOp() {
+      if (fd >= 0) {
+        if (::close(fd) != 0) {
+          lsubdout(g_ceph_context, rgw_datacache, 2) << "D3nDataCache: " << __func__ << "(): Error - can't close file, errno=" << -errno << dendl;
+        }
+      }
+    }
+
+    int init(const DoutPrefixProvider *dpp, const std::string& file_path, off_t read_ofs, off_t read_len) {
       ldpp_dout(dpp, 20) << "D3nDataCache: " << __func__ << "(): file_path=" << file_path << dendl;
-      aio_cb.reset(new struct aiocb);
-      memset(aio_cb.get(), 0, sizeof(struct aiocb));
-      aio_cb->aio_fildes = TEMP_FAILURE_RETRY(::open(file_path.c_str(), O_RDONLY|O_CLOEXEC|O_BINARY));
-      if(aio_cb->aio_fildes < 0) {
+      fd = TEMP_FAILURE_RETRY(::open(file_path.c_str(), O_RDONLY|O_CLOEXEC|O_BINARY));
+      if (fd < 0) {
         int err = errno;
         ldpp_dout(dpp, 1) << "ERROR: D3nDataCache: " << __func__ << "(): can't open " << file_path << " : " << cpp_strerror(err) << dendl;
         return -err;
       }
       if (g_conf()->rgw_d3n_l1_fadvise != POSIX_FADV_NORMAL)
-        posix_fadvise(aio_cb->aio_fildes, 0, 0, g_conf()->rgw_d3n_l1_fadvise);
+        posix_fadvise(fd, 0, 0, g_conf()->rgw_d3n_l1_fadvise);
 
       bufferptr bp(read_len);
-      aio_cb->aio_buf = bp.c_str();
       result.append(std::move(bp));
-
-      aio_cb->aio_nbytes = read_len;
-      aio_cb->aio_offset = read_ofs;
-      aio_cb->aio_sigevent.sigev_notify = SIGEV_THREAD;
-      aio_cb->aio_sigevent.sigev_notify_function = libaio_cb_aio_dispatch;
-      aio_cb->aio_sigevent.sigev_notify_attributes = nullptr;
-      aio_cb->aio_sigevent.sigev_value.sival_ptr = arg;
-
       return 0;
     }
 
-    static void libaio_cb_aio_dispatch(sigval sigval) {
-      lsubdout(g_ceph_context, rgw_datacache, 20) << "D3nDataCache: " << __func__ << "()" << dendl;
-      auto p = std::unique_ptr<Completion>{static_cast<Completion*>(sigval.sival_ptr)};
-      auto op = std::move(p->user_data);
-      const int ret = -aio_error(op.aio_cb.get());
-      boost::system::error_code ec;
-      if (ret < 0) {
-          ec.assign(-ret, boost::system::system_category());
-      }
-
-      ceph::async::dispatch(std::move(p), ec, std::move(op.result));
-    }
-
     template <typename Executor1, typename CompletionHandler>
     static auto create(const Executor1& ex1, CompletionHandler&& handler) {
       auto p = Completion::create(ex1, std::move(handler));
@@ -96,8 +72,18 @@ struct D3nL1CacheRequest {
     }
   };
 
+  // a short read means the cache file was truncated under us
+  static boost::system::error_code read_result(int r, off_t read_len) {
+    if (r < 0) {
+      return {-r, boost::system::system_category()};
+    } else if (r != read_len) {
+      return {EIO, boost::system::system_category()};
+    }
+    return {};
+  }
+
   template <typename ExecutionContext, typename CompletionToken>
-  auto async_read(const DoutPrefixProvider *dpp, ExecutionContext& ctx, const std::string& file_path,
+  auto async_read(const DoutPrefixProvider *dpp, ExecutionContext& ctx, D3nFileIO& io, const std::string& file_path,
                   off_t read_ofs, off_t read_len, CompletionToken&& token) {
     using Op = AsyncFileReadOp;
     using Signature = typename Op::Signature;
@@ -106,16 +92,17 @@ struct D3nL1CacheRequest {
     auto& op = p->user_data;
 
     ldpp_dout(dpp, 20) << "D3nDataCache: " << __func__ << "(): file_path=" << file_path << dendl;
-    int ret = op.init(dpp, file_path, read_ofs, read_len, p.get());
-    if(0 == ret) {
-      ret = ::aio_read(op.aio_cb.get());
-    }
-    ldpp_dout(dpp, 20) << "D3nDataCache: " << __func__ << "(): ::aio_read(), ret=" << ret << dendl;
-    if(ret < 0) {
+    int ret = op.init(dpp, file_path, read_ofs, read_len);
+    if (ret < 0) {
       auto ec = boost::system::error_code{-ret, boost::system::system_category()};
       ceph::async::post(std::move(p), ec, bufferlist{});
     } else {
-      (void)p.release();
+      const int fd = op.fd;
+      char* buf = op.result.c_str();
+      io.read(fd, buf, read_len, read_ofs, [p = std::move(p), read_len] (int r) mutable {
+        auto op = std::move(p->user_data);
+        ceph::async::dispatch(std::move(p), read_result(r, read_len), std::move(op.result));
+      });
     }
     return init.result.get();
   }
@@ -123,24 +110,44 @@ struct D3nL1CacheRequest {
   struct d3n_libaio_handler {
     rgw::Aio* throttle = nullptr;
     rgw::AioResult& r;
-    // read callback
-    void operator()(boost::system::error_code ec, bufferlist bl) const {
-      r.result = -ec.value();
-      r.data = std::move(bl);
-      throttle->put(r);
-    }
+    D3nDataCache* cache;
+    optional_yield y;
+    off_t read_ofs;
+    off_t read_len;
+    ceph::mono_time start;
+    // read callback. falls back to reading from rados if the cache file
+    // could not be read
+    void operator()(boost::system::error_code ec, bufferlist bl) const;
   };
 
   void file_aio_read_abstract(const DoutPrefixProvider *dpp, boost::asio::io_context& context, yield_context yield,
-                              std::string& file_path, off_t read_ofs, off_t read_len,
-                              rgw::Aio* aio, rgw::AioResult& r) {
+                              D3nFileIO& io, const std::string& file_path, d3n_libaio_handler&& handler) {
     using namespace boost::asio;
     async_completion<yield_context, void()> init(yield);
     auto ex = get_associated_executor(init.completion_handler);
 
-    auto& ref = r.obj.get_ref();
-    ldpp_dout(dpp, 20) << "D3nDataCache: " << __func__ << "(): oid=" << ref.obj.oid << dendl;
-    async_read(dpp, context, file_path+"/"+ref.obj.oid, read_ofs, read_len, bind_executor(ex, d3n_libaio_handler{aio, r}));
+    ldpp_dout(dpp, 20) << "D3nDataCache: " << __func__ << "(): file_path=" << file_path << dendl;
+    async_read(dpp, context, io, file_path, handler.read_ofs, handler.read_len, bind_executor(ex, std::move(handler)));
+  }
+
+  // without a yield context, the handler runs on the thread that reaps
+  // the file read, like the callback of a librados aio
+  void file_aio_read(const DoutPrefixProvider *dpp, D3nFileIO& io, const std::string& file_path,
+                     d3n_libaio_handler&& handler) {
+    auto op = std::make_unique<AsyncFileReadOp>();
+    ldpp_dout(dpp, 20) << "D3nDataCache: " << __func__ << "(): file_path=" << file_path << dendl;
+    int ret = op->init(dpp, file_path, handler.read_ofs, handler.read_len);
+    if (ret < 0) {
+      handler(boost::system::error_code{-ret, boost::system::system_category()}, bufferlist{});
+      return;
+    }
+    const int fd = op->fd;
+    char* buf = op->result.c_str();
+    const off_t read_ofs = handler.read_ofs;
+    const off_t read_len = handler.read_len;
+    io.read(fd, buf, read_len, read_ofs, [op = std::move(op), handler = std::move(handler)] (int r) mutable {
+      handler(read_result(r, handler.read_len), std::move(op->result));
+    });
   }
 
 };
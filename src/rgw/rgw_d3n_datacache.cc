@@ -9,6 +9,7 @@
 #include "rgw_auth_s3.h"
 #include "rgw_op.h"
 #include "rgw_crypt_sanitize.h"
+#include "rgw_perf_counters.h"
 #if defined(__linux__)
 #include <features.h>
 #endif
@@ -25,59 +26,53 @@ namespace efs = std::experimental::filesystem;
 
 using namespace std;
 
-int D3nCacheAioWriteRequest::d3n_prepare_libaio_write_op(bufferlist& bl, unsigned int len, string oid, string cache_location)
+D3nDataCache::D3nDataCache()
+  : cct(nullptr), eviction_policy(_eviction_policy::LRU)
 {
-  std::string location = cache_location + oid;
-  int r = 0;
-
-  lsubdout(g_ceph_context, rgw_datacache, 20) << "D3nDataCache: " << __func__ << "(): Write To Cache, location=" << location << dendl;
-  cb = new struct aiocb;
-  mode_t mode = S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH;
-  memset(cb, 0, sizeof(struct aiocb));
-  r = fd = ::open(location.c_str(), O_WRONLY | O_CREAT | O_TRUNC, mode);
-  if (fd < 0) {
-    ldout(cct, 0) << "ERROR: D3nCacheAioWriteRequest::create_io: open file failed, errno=" << errno << ", location='" << location.c_str() << "'" << dendl;
-    goto done;
-  }
-  if (g_conf()->rgw_d3n_l1_fadvise != POSIX_FADV_NORMAL)
-    posix_fadvise(fd, 0, 0, g_conf()->rgw_d3n_l1_fadvise);
-  cb->aio_fildes = fd;
-
-  data = malloc(len);
-  if (!data) {
-    ldout(cct, 0) << "ERROR: D3nCacheAioWriteRequest::create_io: memory allocation failed" << dendl;
-    goto close_file;
-  }
-  cb->aio_buf = data;
-  memcpy((void*)data, bl.c_str(), len);
-  cb->aio_nbytes = len;
-  goto done;
+  lsubdout(g_ceph_context, rgw_datacache, 5) << "D3nDataCache: " << __func__ << "()" << dendl;
+}
 
-close_file:
-  ::close(fd);
-done:
-  return r;
+D3nDataCache::~D3nDataCache()
+{
+  // wait for outstanding writes; the cached files stay for the next start
+  io.stop();
 }
 
-D3nDataCache::D3nDataCache()
-  : cct(nullptr), io_type(_io_type::ASYNC_IO), free_data_cache_size(0), outstanding_write_size(0)
+uint64_t D3nDataCache::hash_of(const std::string& oid)
 {
-  lsubdout(g_ceph_context, rgw_datacache, 5) << "D3nDataCache: " << __func__ << "()" << dendl;
+  return std::hash<std::string>{}(oid);
 }
 
 void D3nDataCache::init(CephContext *_cct) {
   cct = _cct;
-  free_data_cache_size = cct->_conf->rgw_d3n_l1_datacache_size;
-  head = nullptr;
-  tail = nullptr;
   cache_location = cct->_conf->rgw_d3n_l1_datacache_persistent_path;
   if(cache_location.back() != '/') {
       cache_location += "/";
   }
+  tmp_location = cache_location + ".incomplete/";
+
+  auto conf_eviction_policy = cct->_conf.get_val<std::string>("rgw_d3n_l1_eviction_policy");
+  ceph_assert(conf_eviction_policy == "lru" || conf_eviction_policy == "random");
+  if (conf_eviction_policy == "lru")
+    eviction_policy = _eviction_policy::LRU;
+  if (conf_eviction_policy == "random")
+    eviction_policy = _eviction_policy::RANDOM;
+  admission_enabled = cct->_conf.get_val<std::string>("rgw_d3n_l1_admission_policy") == "tinylfu";
+
+  // split the cache size between the shards, and size their admission
+  // filters for the number of stripes that fit
+  const uint64_t capacity = cct->_conf->rgw_d3n_l1_datacache_size / num_shards;
+  const uint64_t stripe_size = std::max<uint64_t>(cct->_conf->rgw_obj_stripe_size, 1);
+  for (auto& shard : shards) {
+    shard.capacity = capacity;
+    shard.admission.init(capacity / stripe_size);
+  }
+
+  const bool evict = g_conf()->rgw_d3n_l1_evict_cache_on_start;
   try {
     if (efs::exists(cache_location)) {
       // d3n: evict the cache storage directory
-      if (g_conf()->rgw_d3n_l1_evict_cache_on_start) {
+      if (evict) {
         lsubdout(g_ceph_context, rgw, 5) << "D3nDataCache: init: evicting the persistent storage directory on start" << dendl;
         for (auto& p : efs::directory_iterator(cache_location)) {
           efs::remove_all(p.path());
@@ -88,282 +83,284 @@ void D3nDataCache::init(CephContext *_cct) {
       lsubdout(g_ceph_context, rgw, 5) << "D3nDataCache: init: creating the persistent storage directory on start" << dendl;
       efs::create_directories(cache_location);
     }
+    // drop writes that a previous run did not complete
+    efs::remove_all(tmp_location);
+    efs::create_directories(tmp_location);
   } catch (const efs::filesystem_error& e) {
     lderr(g_ceph_context) << "D3nDataCache: init: ERROR initializing the cache storage directory '" << cache_location <<
                               "' : " << e.what() << dendl;
   }
-
-  auto conf_eviction_policy = cct->_conf.get_val<std::string>("rgw_d3n_l1_eviction_policy");
-  ceph_assert(conf_eviction_policy == "lru" || conf_eviction_policy == "random");
-  if (conf_eviction_policy == "lru")
-    eviction_policy = _eviction_policy::LRU;
-  if (conf_eviction_policy == "random")
-    eviction_policy = _eviction_policy::RANDOM;
+  if (!evict) {
+    load_index();
+  }
 
 #if defined(HAVE_LIBAIO) && defined(__GLIBC__)
-  // libaio setup
+  // libaio setup, used if io_uring is disabled or not available
   struct aioinit ainit{0};
   ainit.aio_threads = cct->_conf.get_val<int64_t>("rgw_d3n_libaio_aio_threads");
   ainit.aio_num = cct->_conf.get_val<int64_t>("rgw_d3n_libaio_aio_num");
   ainit.aio_idle_time = 120;
   aio_init(&ainit);
 #endif
+  io.start(cct, cct->_conf.get_val<bool>("rgw_d3n_l1_io_uring"),
+           cct->_conf.get_val<int64_t>("rgw_d3n_libaio_aio_num"));
 }
 
-int D3nDataCache::d3n_io_write(bufferlist& bl, unsigned int len, std::string oid)
+void D3nDataCache::load_index()
 {
-  D3nChunkDataInfo* chunk_info = new D3nChunkDataInfo;
-  std::string location = cache_location + oid;
-
-  lsubdout(g_ceph_context, rgw_datacache, 20) << "D3nDataCache: " << __func__ << "(): location=" << location << dendl;
-  FILE *cache_file = nullptr;
-  int r = 0;
-  size_t nbytes = 0;
-
-  cache_file = fopen(location.c_str(), "w+");
-  if (cache_file == nullptr) {
-    ldout(cct, 0) << "ERROR: D3nDataCache::fopen file has return error, errno=" << errno << dendl;
-    return -errno;
-  }
-
-  nbytes = fwrite(bl.c_str(), 1, len, cache_file);
-  if (nbytes != len) {
-    ldout(cct, 0) << "ERROR: D3nDataCache::io_write: fwrite has returned error: nbytes!=len, nbytes=" << nbytes << ", len=" << len << dendl;
-    return -EIO;
+  struct cached_file {
+    efs::file_time_type mtime;
+    std::string oid;
+    uint64_t size;
+  };
+  std::vector<cached_file> files;
+  try {
+    for (auto& p : efs::directory_iterator(cache_location)) {
+      if (p.is_regular_file()) {
+        files.push_back({p.last_write_time(), p.path().filename().string(), p.file_size()});
+      }
+    }
+  } catch (const efs::filesystem_error& e) {
+    lderr(cct) << "D3nDataCache: " << __func__ << "(): ERROR reading the cache storage directory '" << cache_location <<
+                  "' : " << e.what() << dendl;
+    return;
   }
 
-  r = fclose(cache_file);
-  if (r != 0) {
-    ldout(cct, 0) << "ERROR: D3nDataCache::fclsoe file has return error, errno=" << errno << dendl;
-    return -errno;
+  // the most recently written files are the most recently used, and are
+  // kept if the cache has since been made smaller
+  std::sort(files.begin(), files.end(), [] (const auto& a, const auto& b) {
+    return a.mtime > b.mtime;
+  });
+  uint64_t loaded = 0, removed = 0, total = 0;
+  for (auto& f : files) {
+    const uint64_t hash = hash_of(f.oid);
+    auto& shard = shard_of(hash);
+    if (shard.used + f.size > shard.capacity) {
+      ::remove((cache_location + f.oid).c_str());
+      removed++;
+      continue;
+    }
+    auto& entry = shard.entries[f.oid];
+    entry.oid = f.oid;
+    entry.hash = hash;
+    entry.size = f.size;
+    shard.lru.push_back(entry);
+    shard.used += f.size;
+    total += f.size;
+    loaded++;
   }
-
-  { // update cahce_map entries for new chunk in cache
-    const std::lock_guard l(d3n_cache_lock);
-    chunk_info->oid = oid;
-    chunk_info->set_ctx(cct);
-    chunk_info->size = len;
-    d3n_cache_map.insert(pair<string, D3nChunkDataInfo*>(oid, chunk_info));
+  if (perfcounter) {
+    perfcounter->set(l_rgw_d3n_used, total);
   }
-
-  return r;
+  ldout(cct, 5) << "D3nDataCache: " << __func__ << "(): loaded " << loaded << " cached objects, " << total
+                << " bytes, removed " << removed << " that did not fit" << dendl;
 }
 
-void d3n_libaio_write_cb(sigval sigval)
+void D3nDataCache::write_complete(const std::string& oid, uint64_t len, int fd, int r,
+                                  ceph::mono_time start)
 {
-  lsubdout(g_ceph_context, rgw_datacache, 30) << "D3nDataCache: " << __func__ << "()" << dendl;
-  D3nCacheAioWriteRequest* c = static_cast<D3nCacheAioWriteRequest*>(sigval.sival_ptr);
-  c->priv_data->d3n_libaio_write_completion_cb(c);
-}
+  ::close(fd);
+  const std::string tmp_path = tmp_location + oid;
+  if (r != static_cast<int>(len)) {
+    ldout(cct, 0) << "ERROR: D3nDataCache: " << __func__ << "(): write failed, oid=" << oid << ", r=" << r << dendl;
+    r = -1;
+  }
 
+  const uint64_t hash = hash_of(oid);
+  auto& shard = shard_of(hash);
+  std::unique_lock l(shard.lock);
+  shard.outstanding_writes.erase(oid);
+  shard.reserved -= len;
+  // move the file into place under the shard lock, so that it is ordered
+  // with evict() taking out the file of a shorter prefix of the object
+  if (r >= 0 && ::rename(tmp_path.c_str(), (cache_location + oid).c_str()) < 0) {
+    r = -errno;
+    ldout(cct, 0) << "ERROR: D3nDataCache: " << __func__ << "(): rename failed, oid=" << oid << ": " << cpp_strerror(r) << dendl;
+  }
+  if (r < 0) {
+    l.unlock();
+    ::remove(tmp_path.c_str());
+    return;
+  }
+  if (perfcounter) {
+    perfcounter->tinc(l_rgw_d3n_write_lat, ceph::mono_clock::now() - start);
+  }
+  auto [i, inserted] = shard.entries.try_emplace(oid);
+  auto& entry = i->second;
+  if (inserted) {
+    entry.oid = oid;
+    entry.hash = hash;
+  } else { // replaces a shorter prefix
+    shard.used -= entry.size;
+    shard.lru.erase(shard.lru.iterator_to(entry));
+    if (perfcounter) {
+      perfcounter->dec(l_rgw_d3n_used, entry.size);
+    }
+  }
+  entry.size = len;
+  shard.used += len;
+  shard.lru.push_front(entry);
+  if (perfcounter) {
+    perfcounter->inc(l_rgw_d3n_used, len);
+  }
+}
 
-void D3nDataCache::d3n_libaio_write_completion_cb(D3nCacheAioWriteRequest* c)
+D3nChunkDataInfo* D3nDataCache::pick_victim(Shard& shard)
 {
-  D3nChunkDataInfo* chunk_info{nullptr};
-
-  ldout(cct, 5) << "D3nDataCache: " << __func__ << "(): oid=" << c->oid << dendl;
-
-  { // update cache_map entries for new chunk in cache
-    const std::lock_guard l(d3n_cache_lock);
-    d3n_outstanding_write_list.erase(c->oid);
-    chunk_info = new D3nChunkDataInfo;
-    chunk_info->oid = c->oid;
-    chunk_info->set_ctx(cct);
-    chunk_info->size = c->cb->aio_nbytes;
-    d3n_cache_map.insert(pair<string, D3nChunkDataInfo*>(c->oid, chunk_info));
+  if (shard.entries.empty()) {
+    return nullptr;
   }
-
-  { // update free size
-    const std::lock_guard l(d3n_eviction_lock);
-    free_data_cache_size -= c->cb->aio_nbytes;
-    outstanding_write_size -= c->cb->aio_nbytes;
-    lru_insert_head(chunk_info);
+  if (eviction_policy == _eviction_policy::RANDOM) {
+    auto iter = shard.entries.begin();
+    std::advance(iter, ceph::util::generate_random_number<size_t>(0, shard.entries.size() - 1));
+    return &iter->second;
   }
-  delete c;
-  c = nullptr;
+  return &shard.lru.back();
 }
 
-int D3nDataCache::d3n_libaio_create_write_request(bufferlist& bl, unsigned int len, std::string oid)
+void D3nDataCache::evict(Shard& shard, D3nChunkDataInfo& entry, std::vector<std::string>& files)
 {
-  lsubdout(g_ceph_context, rgw_datacache, 30) << "D3nDataCache: " << __func__ << "(): Write To Cache, oid=" << oid << ", len=" << len << dendl;
-  struct D3nCacheAioWriteRequest* wr = new struct D3nCacheAioWriteRequest(cct);
-  int r=0;
-  if ((r = wr->d3n_prepare_libaio_write_op(bl, len, oid, cache_location)) < 0) {
-    ldout(cct, 0) << "ERROR: D3nDataCache: " << __func__ << "() prepare libaio write op r=" << r << dendl;
-    goto done;
+  ldout(cct, 20) << "D3nDataCache: " << __func__ << "(): oid to remove: " << entry.oid << ", size: " << entry.size << dendl;
+  shard.lru.erase(shard.lru.iterator_to(entry));
+  shard.used -= entry.size;
+  if (perfcounter) {
+    perfcounter->inc(l_rgw_d3n_evict);
+    perfcounter->dec(l_rgw_d3n_used, entry.size);
   }
-  wr->cb->aio_sigevent.sigev_notify = SIGEV_THREAD;
-  wr->cb->aio_sigevent.sigev_notify_function = d3n_libaio_write_cb;
-  wr->cb->aio_sigevent.sigev_notify_attributes = nullptr;
-  wr->cb->aio_sigevent.sigev_value.sival_ptr = (void*)wr;
-  wr->oid = oid;
-  wr->priv_data = this;
-
-  if ((r = ::aio_write(wr->cb)) != 0) {
-    ldout(cct, 0) << "ERROR: D3nDataCache: " << __func__ << "() aio_write r=" << r << dendl;
-    goto error;
+  // take the file out of the cache directory while the shard is locked,
+  // so that its removal can't race with a new file for the same object
+  // being renamed into place. unlinking can take a while, so the caller
+  // does that once it has dropped the lock
+  const std::string path = cache_location + entry.oid;
+  std::string evicted = tmp_location + entry.oid + ".evicted";
+  if (::rename(path.c_str(), evicted.c_str()) == 0) {
+    files.push_back(std::move(evicted));
+  } else if (errno != ENOENT) {
+    ::remove(path.c_str());
   }
-  return 0;
-
-error:
-  delete wr;
-done:
-  return r;
+  shard.entries.erase(shard.entries.find(entry.oid));
 }
 
 void D3nDataCache::put(bufferlist& bl, unsigned int len, std::string& oid)
 {
-  size_t sr = 0;
-  uint64_t freed_size = 0, _free_data_cache_size = 0, _outstanding_write_size = 0;
-
   ldout(cct, 10) << "D3nDataCache::" << __func__ << "(): oid=" << oid << ", len=" << len << dendl;
+  const uint64_t hash = hash_of(oid);
+  auto& shard = shard_of(hash);
+  std::vector<std::string> evicted;
+  bool admit = true;
   {
-    const std::lock_guard l(d3n_cache_lock);
-    std::unordered_map<string, D3nChunkDataInfo*>::iterator iter = d3n_cache_map.find(oid);
-    if (iter != d3n_cache_map.end()) {
+    const std::lock_guard l(shard.lock);
+    if (auto iter = shard.entries.find(oid);
+        iter != shard.entries.end() && iter->second.size >= len) {
       ldout(cct, 10) << "D3nDataCache::" << __func__ << "(): data already cached, no rewrite" << dendl;
       return;
     }
-    auto it = d3n_outstanding_write_list.find(oid);
-    if (it != d3n_outstanding_write_list.end()) {
+    if (shard.outstanding_writes.count(oid)) {
       ldout(cct, 10) << "D3nDataCache: NOTE: data put in cache already issued, no rewrite" << dendl;
       return;
     }
-    d3n_outstanding_write_list.insert(oid);
-  }
-  {
-    const std::lock_guard l(d3n_eviction_lock);
-    _free_data_cache_size = free_data_cache_size;
-    _outstanding_write_size = outstanding_write_size;
-  }
-  ldout(cct, 20) << "D3nDataCache: Before eviction _free_data_cache_size:" << _free_data_cache_size << ", _outstanding_write_size:" << _outstanding_write_size << ", freed_size:" << freed_size << dendl;
-  while (len > (_free_data_cache_size - _outstanding_write_size + freed_size)) {
-    ldout(cct, 20) << "D3nDataCache: enter eviction" << dendl;
-    if (eviction_policy == _eviction_policy::LRU) {
-      sr = lru_eviction();
-    } else if (eviction_policy == _eviction_policy::RANDOM) {
-      sr = random_eviction();
-    } else {
-      ldout(cct, 0) << "D3nDataCache: Warning: unknown cache eviction policy, defaulting to lru eviction" << dendl;
-      sr = lru_eviction();
-    }
-    if (sr == 0) {
-      ldout(cct, 2) << "D3nDataCache: Warning: eviction was not able to free disk space, not writing to cache" << dendl;
-      d3n_outstanding_write_list.erase(oid);
+    if (len > shard.capacity) {
+      ldout(cct, 10) << "D3nDataCache: NOTE: data is larger than the cache shard, not writing to cache" << dendl;
       return;
     }
-    ldout(cct, 20) << "D3nDataCache: completed eviction of " << sr << " bytes" << dendl;
-    freed_size += sr;
+    // a shorter prefix of the object stays cached until the longer one
+    // is written, so it may have to be evicted to make room
+    while (shard.used + shard.reserved + len > shard.capacity) {
+      auto victim = pick_victim(shard);
+      if (!victim) {
+        ldout(cct, 2) << "D3nDataCache: Warning: eviction was not able to free disk space, not writing to cache" << dendl;
+        admit = false;
+        break;
+      }
+      if (admission_enabled && victim->oid != oid &&
+          !shard.admission.admit(hash, victim->hash)) {
+        ldout(cct, 20) << "D3nDataCache: oid=" << oid << " is not requested more often than oid="
+                       << victim->oid << ", not writing to cache" << dendl;
+        if (perfcounter) {
+          perfcounter->inc(l_rgw_d3n_reject);
+        }
+        admit = false;
+        break;
+      }
+      evict(shard, *victim, evicted);
+    }
+    if (admit) {
+      shard.outstanding_writes.insert(oid);
+      shard.reserved += len;
+    }
   }
-  int r = 0;
-  r = d3n_libaio_create_write_request(bl, len, oid);
-  if (r < 0) {
-    const std::lock_guard l(d3n_cache_lock);
-    d3n_outstanding_write_list.erase(oid);
-    ldout(cct, 1) << "D3nDataCache: create_aio_write_request fail, r=" << r << dendl;
+  for (const auto& path : evicted) {
+    ::remove(path.c_str());
+  }
+  if (!admit) {
     return;
   }
 
-  const std::lock_guard l(d3n_eviction_lock);
-  free_data_cache_size += freed_size;
-  outstanding_write_size += len;
+  const std::string tmp_path = tmp_location + oid;
+  lsubdout(g_ceph_context, rgw_datacache, 20) << "D3nDataCache: " << __func__ << "(): Write To Cache, location=" << tmp_path << dendl;
+  mode_t mode = S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH;
+  int fd = TEMP_FAILURE_RETRY(::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, mode));
+  if (fd < 0) {
+    ldout(cct, 0) << "ERROR: D3nDataCache::" << __func__ << "(): open file failed, errno=" << errno << ", location='" << tmp_path << "'" << dendl;
+    const std::lock_guard l(shard.lock);
+    shard.outstanding_writes.erase(oid);
+    shard.reserved -= len;
+    return;
+  }
+  if (g_conf()->rgw_d3n_l1_fadvise != POSIX_FADV_NORMAL)
+    posix_fadvise(fd, 0, 0, g_conf()->rgw_d3n_l1_fadvise);
+
+  // the write holds a reference to the data, which the client may still
+  // be sending from
+  bufferlist data = bl;
+  const char* buf = data.c_str();
+  io.write(fd, buf, len, 0,
+           [this, oid, len, fd, data = std::move(data), start = ceph::mono_clock::now()] (int r) {
+             write_complete(oid, len, fd, r, start);
+           });
 }
 
-bool D3nDataCache::get(const string& oid, const off_t len)
+bool D3nDataCache::get(const string& oid, off_t ofs, off_t len)
 {
-  const std::lock_guard l(d3n_cache_lock);
+  const uint64_t hash = hash_of(oid);
+  auto& shard = shard_of(hash);
   bool exist = false;
-  string location = cache_location + oid;
-
-  lsubdout(g_ceph_context, rgw_datacache, 20) << "D3nDataCache: " << __func__ << "(): location=" << location << dendl;
-  std::unordered_map<string, D3nChunkDataInfo*>::iterator iter = d3n_cache_map.find(oid);
-  if (!(iter == d3n_cache_map.end())) {
-    // check inside cache whether file exists or not!!!! then make exist true;
-    struct D3nChunkDataInfo* chdo = iter->second;
-    struct stat st;
-    int r = stat(location.c_str(), &st);
-    if ( r != -1 && st.st_size == len) { // file exists and containes required data range length
+  {
+    const std::lock_guard l(shard.lock);
+    if (admission_enabled) {
+      shard.admission.record(hash);
+    }
+    auto iter = shard.entries.find(oid);
+    if (iter != shard.entries.end() &&
+        iter->second.size >= static_cast<uint64_t>(ofs + len)) {
       exist = true;
-      /*LRU*/
-      /*get D3nChunkDataInfo*/
-      const std::lock_guard l(d3n_eviction_lock);
-      lru_remove(chdo);
-      lru_insert_head(chdo);
-    } else {
-      d3n_cache_map.erase(oid);
-      const std::lock_guard l(d3n_eviction_lock);
-      lru_remove(chdo);
-      delete chdo;
-      exist = false;
+      auto& entry = iter->second;
+      shard.lru.erase(shard.lru.iterator_to(entry));
+      shard.lru.push_front(entry);
     }
   }
-  return exist;
-}
-
-size_t D3nDataCache::random_eviction()
-{
-  lsubdout(g_ceph_context, rgw_datacache, 20) << "D3nDataCache: " << __func__ << "()" << dendl;
-  int n_entries = 0;
-  int random_index = 0;
-  size_t freed_size = 0;
-  D3nChunkDataInfo* del_entry;
-  string del_oid, location;
-  {
-    const std::lock_guard l(d3n_cache_lock);
-    n_entries = d3n_cache_map.size();
-    if (n_entries <= 0) {
-      return -1;
-    }
-    srand (time(NULL));
-    random_index = ceph::util::generate_random_number<int>(0, n_entries-1);
-    std::unordered_map<string, D3nChunkDataInfo*>::iterator iter = d3n_cache_map.begin();
-    std::advance(iter, random_index);
-    del_oid = iter->first;
-    del_entry =  iter->second;
-    ldout(cct, 20) << "D3nDataCache: random_eviction: index:" << random_index << ", free size: " << del_entry->size << dendl;
-    freed_size = del_entry->size;
-    delete del_entry;
-    del_entry = nullptr;
-    d3n_cache_map.erase(del_oid); // oid
+  lsubdout(g_ceph_context, rgw_datacache, 20) << "D3nDataCache: " << __func__ << "(): oid=" << oid << ", ofs=" << ofs
+                                              << ", len=" << len << ", cached=" << exist << dendl;
+  if (perfcounter) {
+    perfcounter->inc(exist ? l_rgw_d3n_hit : l_rgw_d3n_miss);
   }
-
-  location = cache_location + del_oid;
-  ::remove(location.c_str());
-  return freed_size;
+  return exist;
 }
 
-size_t D3nDataCache::lru_eviction()
+void D3nDataCache::invalidate(const std::string& oid)
 {
-  lsubdout(g_ceph_context, rgw_datacache, 20) << "D3nDataCache: " << __func__ << "()" << dendl;
-  int n_entries = 0;
-  size_t freed_size = 0;
-  D3nChunkDataInfo* del_entry;
-  string del_oid, location;
-
+  const uint64_t hash = hash_of(oid);
+  auto& shard = shard_of(hash);
+  std::vector<std::string> evicted;
   {
-    const std::lock_guard l(d3n_eviction_lock);
-    del_entry = tail;
-    if (del_entry == nullptr) {
-      ldout(cct, 2) << "D3nDataCache: lru_eviction: del_entry=null_ptr" << dendl;
-      return 0;
+    const std::lock_guard l(shard.lock);
+    auto iter = shard.entries.find(oid);
+    if (iter == shard.entries.end()) {
+      return;
     }
-    lru_remove(del_entry);
+    evict(shard, iter->second, evicted);
   }
-
-  {
-    const std::lock_guard l(d3n_cache_lock);
-    n_entries = d3n_cache_map.size();
-    if (n_entries <= 0) {
-      ldout(cct, 2) << "D3nDataCache: lru_eviction: cache_map.size<=0" << dendl;
-      return -1;
-    }
-    del_oid = del_entry->oid;
-    ldout(cct, 20) << "D3nDataCache: lru_eviction: oid to remove: " << del_oid << dendl;
-    d3n_cache_map.erase(del_oid); // oid
+  for (const auto& path : evicted) {
+    ::remove(path.c_str());
   }
-  freed_size = del_entry->size;
-  delete del_entry;
-  location = cache_location + del_oid;
-  ::remove(location.c_str());
-  return freed_size;
 }
@@ -10,137 +10,94 @@
 #include "rgw_common.h"
 
 #include <unistd.h>
-#include <signal.h>
+#include <array>
+#include <boost/intrusive/list.hpp>
 #include "include/Context.h"
-#include "include/lru.h"
+#include "rgw_d3n_admission.h"
 #include "rgw_d3n_cacherequest.h"
+#include "rgw_d3n_io.h"
 
 
-/*D3nDataCache*/
-struct D3nDataCache;
-
-
-struct D3nChunkDataInfo : public LRUObject {
-	CephContext *cct;
-	uint64_t size;
-	time_t access_time;
-	std::string address;
-	std::string oid;
-	bool complete;
-	struct D3nChunkDataInfo* lru_prev;
-	struct D3nChunkDataInfo* lru_next;
-
-	D3nChunkDataInfo(): size(0) {}
-
-	void set_ctx(CephContext *_cct) {
-		cct = _cct;
-	}
-
-	void dump(Formatter *f) const;
-	static void generate_test_instances(std::list<D3nChunkDataInfo*>& o);
-};
-
-struct D3nCacheAioWriteRequest {
-	std::string oid;
-	void *data;
-	int fd;
-	struct aiocb *cb;
-	D3nDataCache *priv_data;
-	CephContext *cct;
-
-	D3nCacheAioWriteRequest(CephContext *_cct) : cct(_cct) {}
-	int d3n_prepare_libaio_write_op(bufferlist& bl, unsigned int len, std::string oid, std::string cache_location);
-
-  ~D3nCacheAioWriteRequest() {
-    ::close(fd);
-		cb->aio_buf = nullptr;
-		free(data);
-		data = nullptr;
-		delete(cb);
-  }
+struct D3nChunkDataInfo {
+  std::string oid;
+  uint64_t hash = 0;
+  uint64_t size = 0; // length of the cached prefix of the rados object
+  boost::intrusive::list_member_hook<> lru_hook;
 };
 
+/*
+ * Local cache of rados object data in files named by oid under
+ * cache_location.
+ *
+ * Objects are spread over shards by the hash of their oid, each with
+ * its own lock, index, lru and share of the cache size. Files are
+ * written under tmp_location and renamed into place once complete, so
+ * the files in cache_location are the persistent index of the cache and
+ * are loaded again on start unless rgw_d3n_l1_evict_cache_on_start is
+ * set. A file holds a prefix of its rados object, and serves any read
+ * that falls within it.
+ */
 struct D3nDataCache {
 
 private:
-  std::unordered_map<std::string, D3nChunkDataInfo*> d3n_cache_map;
-  std::set<std::string> d3n_outstanding_write_list;
-  std::mutex d3n_cache_lock;
-  std::mutex d3n_eviction_lock;
+  using lru_list = boost::intrusive::list<D3nChunkDataInfo,
+        boost::intrusive::member_hook<D3nChunkDataInfo,
+                                      boost::intrusive::list_member_hook<>,
+                                      &D3nChunkDataInfo::lru_hook>>;
+
+  struct Shard {
+    std::mutex lock;
+    std::unordered_map<std::string, D3nChunkDataInfo> entries;
+    lru_list lru; // most recently used first
+    std::set<std::string> outstanding_writes;
+    uint64_t capacity = 0;
+    uint64_t used = 0;
+    uint64_t reserved = 0; // bytes of outstanding writes
+    D3nAdmissionFilter admission;
+  };
+  static constexpr size_t num_shards = 16;
+  std::array<Shard, num_shards> shards;
 
   CephContext *cct;
-  enum class _io_type {
-    SYNC_IO = 1,
-    ASYNC_IO = 2,
-    SEND_FILE = 3
-  } io_type;
   enum class _eviction_policy {
     LRU=0, RANDOM=1
   } eviction_policy;
+  bool admission_enabled = false;
 
-  struct sigaction action;
-  uint64_t free_data_cache_size = 0;
-  uint64_t outstanding_write_size = 0;
-  struct D3nChunkDataInfo* head;
-  struct D3nChunkDataInfo* tail;
+  std::string tmp_location;
+  D3nFileIO io;
 
 private:
-  void add_io();
+  static uint64_t hash_of(const std::string& oid);
+  Shard& shard_of(uint64_t hash) {
+    return shards[hash % num_shards];
+  }
+  // the entry to evict next, or nullptr if the shard is empty
+  D3nChunkDataInfo* pick_victim(Shard& shard);
+  // drop an entry from the shard. its file is added to @p files, to be
+  // removed once the shard is unlocked
+  void evict(Shard& shard, D3nChunkDataInfo& entry, std::vector<std::string>& files);
+  void load_index();
+  void write_complete(const std::string& oid, uint64_t len, int fd, int r,
+                      ceph::mono_time start);
 
 public:
   D3nDataCache();
-  ~D3nDataCache() {
-    while (lru_eviction() > 0);
-  }
+  ~D3nDataCache();
 
   std::string cache_location;
 
-  bool get(const std::string& oid, const off_t len);
-  void put(bufferlist& bl, unsigned int len, std::string& obj_key);
-  int d3n_io_write(bufferlist& bl, unsigned int len, std::string oid);
-  int d3n_libaio_create_write_request(bufferlist& bl, unsigned int len, std::string oid);
-  void d3n_libaio_write_completion_cb(D3nCacheAioWriteRequest* c);
-  size_t random_eviction();
-  size_t lru_eviction();
-
-  void init(CephContext *_cct);
-
-  void lru_insert_head(struct D3nChunkDataInfo* o) {
-    lsubdout(g_ceph_context, rgw_datacache, 30) << "D3nDataCache: " << __func__ << "()" << dendl;
-    o->lru_next = head;
-    o->lru_prev = nullptr;
-    if (head) {
-      head->lru_prev = o;
-    } else {
-      tail = o;
-    }
-    head = o;
+  /// true if bytes [ofs, ofs + len) of the rados object are cached
+  bool get(const std::string& oid, off_t ofs, off_t len);
+  /// cache the first len bytes of a rados object
+  void put(bufferlist& bl, unsigned int len, std::string& oid);
+  /// forget an object whose cache file could not be read
+  void invalidate(const std::string& oid);
+  D3nFileIO& get_io() {
+    return io;
   }
 
-  void lru_insert_tail(struct D3nChunkDataInfo* o) {
-    lsubdout(g_ceph_context, rgw_datacache, 30) << "D3nDataCache: " << __func__ << "()" << dendl;
-    o->lru_next = nullptr;
-    o->lru_prev = tail;
-    if (tail) {
-      tail->lru_next = o;
-    } else {
-      head = o;
-    }
-    tail = o;
-  }
-
-  void lru_remove(struct D3nChunkDataInfo* o) {
-    lsubdout(g_ceph_context, rgw_datacache, 30) << "D3nDataCache: " << __func__ << "()" << dendl;
-    if (o->lru_next)
-      o->lru_next->lru_prev = o->lru_prev;
-    else
-      tail = o->lru_prev;
-    if (o->lru_prev)
-      o->lru_prev->lru_next = o->lru_next;
-    else
-      head = o->lru_next;
-    o->lru_next = o->lru_prev = nullptr;
-  }
+  void init(CephContext *_cct);
 };
 
 
@@ -205,18 +162,15 @@ int D3nRGWDataCache<T>::get_obj_iterate_cb(const DoutPrefixProvider *dpp, const
     ldpp_dout(dpp, 20) << "D3nDataCache::" << __func__ << "(): oid=" << read_obj.oid << " obj-ofs=" << obj_ofs << " read_ofs=" << read_ofs << " len=" << len << dendl;
     op.read(read_ofs, len, nullptr, nullptr);
 
-    const uint64_t cost = len;
     const uint64_t id = obj_ofs; // use logical object offset for sorting replies
 
-    auto completed = d->aio->get(obj, rgw::Aio::librados_op(std::move(op), d->yield), cost, id);
-    return d->flush(std::move(completed));
+    return d->read(obj, rgw::Aio::librados_op(std::move(op), d->yield), len, id);
   } else {
     ldpp_dout(dpp, 20) << "D3nDataCache::" << __func__ << "(): oid=" << read_obj.oid << ", is_head_obj=" << is_head_obj << ", obj-ofs=" << obj_ofs << ", read_ofs=" << read_ofs << ", len=" << len << dendl;
     int r;
 
     op.read(read_ofs, len, nullptr, nullptr);
 
-    const uint64_t cost = len;
     const uint64_t id = obj_ofs; // use logical object offset for sorting replies
     oid = read_obj.oid;
 
@@ -229,19 +183,22 @@ int D3nRGWDataCache<T>::get_obj_iterate_cb(const DoutPrefixProvider *dpp, const
 
     const bool is_compressed = (astate->attrset.find(RGW_ATTR_COMPRESSION) != astate->attrset.end());
     const bool is_encrypted = (astate->attrset.find(RGW_ATTR_CRYPT_MODE) != astate->attrset.end());
-    if (read_ofs != 0 || astate->size != astate->accounted_size || is_compressed || is_encrypted) {
+    if (astate->size != astate->accounted_size || is_compressed || is_encrypted) {
       d->d3n_bypass_cache_write = true;
-      lsubdout(g_ceph_context, rgw, 5) << "D3nDataCache: " << __func__ << "(): Note - bypassing datacache: oid=" << read_obj.oid << ", read_ofs!=0 = " << read_ofs << ", size=" << astate->size << " != accounted_size=" << astate->accounted_size << ", is_compressed=" << is_compressed << ", is_encrypted=" << is_encrypted  << dendl;
-      auto completed = d->aio->get(obj, rgw::Aio::librados_op(std::move(op), d->yield), cost, id);
-      r = d->flush(std::move(completed));
-      return r;
+      lsubdout(g_ceph_context, rgw, 5) << "D3nDataCache: " << __func__ << "(): Note - bypassing datacache: oid=" << read_obj.oid << ", size=" << astate->size << " != accounted_size=" << astate->accounted_size << ", is_compressed=" << is_compressed << ", is_encrypted=" << is_encrypted  << dendl;
+      return d->read(obj, rgw::Aio::librados_op(std::move(op), d->yield), len, id);
+    }
+    if (read_ofs != 0) {
+      // only reads from the start of a rados object are written to the
+      // cache, but a range within a cached prefix can be read from it
+      const std::lock_guard l(d->d3n_get_data.d3n_lock);
+      d->d3n_bypass_ids.insert(id);
     }
 
-    if (d->rgwrados->d3n_data_cache->get(oid, len)) {
+    if (d->rgwrados->d3n_data_cache->get(oid, read_ofs, len)) {
       // Read From Cache
       ldpp_dout(dpp, 20) << "D3nDataCache: " << __func__ << "(): READ FROM CACHE: oid=" << read_obj.oid << ", obj-ofs=" << obj_ofs << ", read_ofs=" << read_ofs << ", len=" << len << dendl;
-      auto completed = d->aio->get(obj, rgw::Aio::d3n_cache_op(dpp, d->yield, read_ofs, len, d->rgwrados->d3n_data_cache->cache_location), cost, id);
-      r = d->flush(std::move(completed));
+      r = d->read(obj, rgw::Aio::d3n_cache_op(dpp, d->yield, read_ofs, len, d->rgwrados->d3n_data_cache), len, id);
       if (r < 0) {
         lsubdout(g_ceph_context, rgw, 0) << "D3nDataCache: " << __func__ << "(): Error: failed to drain/flush, r= " << r << dendl;
       }
@@ -249,8 +206,7 @@ int D3nRGWDataCache<T>::get_obj_iterate_cb(const DoutPrefixProvider *dpp, const
     } else {
       // Write To Cache
       ldpp_dout(dpp, 20) << "D3nDataCache: " << __func__ << "(): WRITE TO CACHE: oid=" << read_obj.oid << ", obj-ofs=" << obj_ofs << ", read_ofs=" << read_ofs << " len=" << len << dendl;
-      auto completed = d->aio->get(obj, rgw::Aio::librados_op(std::move(op), d->yield), cost, id);
-      return d->flush(std::move(completed));
+      return d->read(obj, rgw::Aio::librados_op(std::move(op), d->yield), len, id);
     }
   }
   lsubdout(g_ceph_context, rgw, 1) << "D3nDataCache: " << __func__ << "(): Warning: Check head object cache handling flow, oid=" << read_obj.oid << dendl;
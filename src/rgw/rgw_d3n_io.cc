@@ -0,0 +1,222 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab ft=cpp
+
+#include "rgw_d3n_io.h"
+
+#include <aio.h>
+#include <cstring>
+#include <sys/uio.h>
+
+#include "acconfig.h"
+#include "common/Thread.h"
+#include "common/dout.h"
+#include "common/errno.h"
+
+#if defined(HAVE_LIBURING)
+#include "liburing.h"
+#endif
+
+#define dout_subsys ceph_subsys_rgw_datacache
+
+struct D3nFileIO::Request {
+  D3nFileIO* io = nullptr;
+  Callback cb;
+  bool write = false;
+  int fd = -1;
+  struct iovec iov = {};
+  off_t ofs = 0;
+  struct aiocb aio; // only used for posix aio
+};
+
+struct D3nFileIO::Ring {
+#if defined(HAVE_LIBURING)
+  struct io_uring ring;
+  std::mutex sq_lock;
+#endif
+};
+
+D3nFileIO::D3nFileIO() = default;
+
+D3nFileIO::~D3nFileIO()
+{
+  stop();
+}
+
+void D3nFileIO::start(CephContext* cct, bool use_io_uring, unsigned depth)
+{
+  this->cct = cct;
+#if defined(HAVE_LIBURING)
+  if (use_io_uring) {
+    auto r = std::make_unique<Ring>();
+    int ret = io_uring_queue_init(depth, &r->ring, 0);
+    if (ret == 0) {
+      ring = std::move(r);
+      reaper = make_named_thread("d3n_io", &D3nFileIO::reap, this);
+      ldout(cct, 5) << "D3nDataCache: " << __func__ << "(): using io_uring, depth=" << depth << dendl;
+      return;
+    }
+    ldout(cct, 1) << "D3nDataCache: " << __func__ << "(): can't create io_uring, falling back to posix aio: "
+                  << cpp_strerror(ret) << dendl;
+  }
+#endif
+  ldout(cct, 5) << "D3nDataCache: " << __func__ << "(): using posix aio" << dendl;
+}
+
+void D3nFileIO::stop()
+{
+  {
+    std::unique_lock l{lock};
+    cond.wait(l, [this] { return inflight == 0; });
+  }
+#if defined(HAVE_LIBURING)
+  if (ring) {
+    {
+      // nothing is left in the submission queue, so there is room for a
+      // nop that tells the reaper to exit
+      std::lock_guard l{ring->sq_lock};
+      struct io_uring_sqe* sqe = io_uring_get_sqe(&ring->ring);
+      io_uring_prep_nop(sqe);
+      io_uring_sqe_set_data(sqe, nullptr);
+      io_uring_submit(&ring->ring);
+    }
+    reaper.join();
+    io_uring_queue_exit(&ring->ring);
+    ring.reset();
+  }
+#endif
+}
+
+void D3nFileIO::read(int fd, void* buf, size_t len, off_t ofs, Callback&& cb)
+{
+  auto req = std::make_unique<Request>();
+  req->cb = std::move(cb);
+  req->fd = fd;
+  req->iov = {buf, len};
+  req->ofs = ofs;
+  submit(std::move(req));
+}
+
+void D3nFileIO::write(int fd, const void* buf, size_t len, off_t ofs, Callback&& cb)
+{
+  auto req = std::make_unique<Request>();
+  req->cb = std::move(cb);
+  req->write = true;
+  req->fd = fd;
+  req->iov = {const_cast<void*>(buf), len};
+  req->ofs = ofs;
+  submit(std::move(req));
+}
+
+void D3nFileIO::submit(std::unique_ptr<Request> req)
+{
+  {
+    std::lock_guard l{lock};
+    ++inflight;
+  }
+  req->io = this;
+  if (ring && submit_ring(req)) {
+    return;
+  }
+  submit_aio(std::move(req));
+}
+
+bool D3nFileIO::submit_ring(std::unique_ptr<Request>& req)
+{
+#if defined(HAVE_LIBURING)
+  std::lock_guard l{ring->sq_lock};
+  struct io_uring_sqe* sqe = io_uring_get_sqe(&ring->ring);
+  if (!sqe) {
+    return false;
+  }
+  if (req->write) {
+    io_uring_prep_writev(sqe, req->fd, &req->iov, 1, req->ofs);
+  } else {
+    io_uring_prep_readv(sqe, req->fd, &req->iov, 1, req->ofs);
+  }
+  // the ring owns the request from here on; an entry that failed to
+  // submit stays queued and goes with the next submission
+  io_uring_sqe_set_data(sqe, req.release());
+  int ret;
+  do {
+    ret = io_uring_submit(&ring->ring);
+  } while (ret == -EINTR || ret == -EAGAIN);
+  if (ret < 0) {
+    ldout(cct, 1) << "D3nDataCache: " << __func__ << "(): io_uring_submit failed: "
+                  << cpp_strerror(ret) << dendl;
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+void D3nFileIO::submit_aio(std::unique_ptr<Request> req)
+{
+  auto& cb = req->aio;
+  memset(&cb, 0, sizeof(cb));
+  cb.aio_fildes = req->fd;
+  cb.aio_buf = req->iov.iov_base;
+  cb.aio_nbytes = req->iov.iov_len;
+  cb.aio_offset = req->ofs;
+  cb.aio_sigevent.sigev_notify = SIGEV_THREAD;
+  cb.aio_sigevent.sigev_notify_function = aio_notify;
+  cb.aio_sigevent.sigev_notify_attributes = nullptr;
+  cb.aio_sigevent.sigev_value.sival_ptr = req.get();
+
+  // the notification may run before aio_read/write returns
+  Request* r = req.release();
+  const int ret = r->write ? ::aio_write(&r->aio) : ::aio_read(&r->aio);
+  if (ret < 0) {
+    complete(std::unique_ptr<Request>{r}, -errno);
+  }
+}
+
+void D3nFileIO::aio_notify(union sigval sv)
+{
+  auto req = std::unique_ptr<Request>{static_cast<Request*>(sv.sival_ptr)};
+  int result = ::aio_error(&req->aio);
+  if (result == 0) {
+    result = ::aio_return(&req->aio);
+  } else {
+    result = -result;
+  }
+  auto io = req->io;
+  io->complete(std::move(req), result);
+}
+
+void D3nFileIO::reap()
+{
+#if defined(HAVE_LIBURING)
+  for (;;) {
+    struct io_uring_cqe* cqe = nullptr;
+    int ret = io_uring_wait_cqe(&ring->ring, &cqe);
+    if (ret == -EINTR) {
+      continue;
+    }
+    if (ret < 0) {
+      lderr(cct) << "D3nDataCache: " << __func__ << "(): io_uring_wait_cqe failed: "
+                 << cpp_strerror(ret) << dendl;
+      break;
+    }
+    auto req = static_cast<Request*>(io_uring_cqe_get_data(cqe));
+    const int result = cqe->res;
+    io_uring_cqe_seen(&ring->ring, cqe);
+    if (!req) {
+      break; // stop()
+    }
+    complete(std::unique_ptr<Request>{req}, result);
+  }
+#endif
+}
+
+void D3nFileIO::complete(std::unique_ptr<Request> req, int result)
+{
+  auto cb = std::move(req->cb);
+  req.reset();
+  cb(result);
+
+  std::lock_guard l{lock};
+  if (--inflight == 0) {
+    cond.notify_all();
+  }
+}
@@ -0,0 +1,69 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab ft=cpp
+
+#ifndef RGW_D3N_IO_H
+#define RGW_D3N_IO_H
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <signal.h>
+#include <sys/types.h>
+
+#include "include/function2.hpp"
+
+class CephContext;
+
+/*
+ * Asynchronous reads and writes of d3n cache files.
+ *
+ * Requests go to an io_uring where the kernel and build support it,
+ * with a single thread reaping completions; otherwise they fall back to
+ * posix aio. Callbacks run on the reaping (or aio notification) thread
+ * and should be short. A request that can't be submitted completes
+ * inline with the error.
+ */
+class D3nFileIO {
+public:
+  /// called with the number of bytes transferred, or -errno
+  using Callback = fu2::unique_function<void(int)>;
+
+  D3nFileIO();
+  ~D3nFileIO();
+
+  /// use an io_uring of @p depth entries if @p use_io_uring is set
+  /// and one can be created
+  void start(CephContext* cct, bool use_io_uring, unsigned depth);
+  /// wait for outstanding requests and release the io_uring
+  void stop();
+
+  bool using_io_uring() const {
+    return ring != nullptr;
+  }
+
+  void read(int fd, void* buf, size_t len, off_t ofs, Callback&& cb);
+  void write(int fd, const void* buf, size_t len, off_t ofs, Callback&& cb);
+
+private:
+  struct Request;
+  struct Ring;
+
+  CephContext* cct = nullptr;
+  std::unique_ptr<Ring> ring;
+  std::thread reaper;
+
+  std::mutex lock;
+  std::condition_variable cond;
+  uint64_t inflight = 0;
+
+  void submit(std::unique_ptr<Request> req);
+  bool submit_ring(std::unique_ptr<Request>& req);
+  void submit_aio(std::unique_ptr<Request> req);
+  void complete(std::unique_ptr<Request> req, int result);
+  void reap();
+  static void aio_notify(union sigval sv);
+};
+
+#endif
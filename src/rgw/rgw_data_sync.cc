@@ -2603,6 +2603,9 @@ class RGWObjFetchCR : public RGWCoroutine {
 
   int try_num{0};
   std::shared_ptr<bool> need_retry;
+
+  ceph::timespan fetch_latency = ceph::timespan::zero();
+  std::optional<uint64_t> bytes_transferred;
 public:
   RGWObjFetchCR(RGWDataSyncCtx *_sc,
                 rgw_bucket_sync_pipe& _sync_pipe,
@@ -2740,8 +2743,12 @@ public:
                                        key, dest_key, versioned_epoch,
                                        true,
                                        std::static_pointer_cast<RGWFetchObjFilter>(filter),
-                                       zones_trace, sync_env->counters, dpp));
+                                       zones_trace, sync_env->counters, dpp,
+                                       &bytes_transferred, &fetch_latency));
         }
+        // feed the fetch latency back into the zone's sync window
+        sc->object_window.sample(fetch_latency, retcode,
+                                 bytes_transferred.value_or(0));
         if (retcode < 0) {
           if (*need_retry) {
             continue;
@@ -4275,6 +4282,8 @@ class RGWBucketFullSyncCR : public RGWCoroutine {
     }
   } prefix_handler;
 
+  rgw::sync::AdaptiveWindow::Share window_share;
+
 public:
   RGWBucketFullSyncCR(RGWDataSyncCtx *_sc,
                       rgw_bucket_sync_pipe& _sync_pipe,
@@ -4289,7 +4298,8 @@ public:
       lease_cr(std::move(lease_cr)), status_obj(status_obj), objv(objv_tracker),
       tn(sync_env->sync_tracer->add_node(tn_parent, "full_sync",
                                          SSTR(bucket_shard_str{bs}))),
-      marker_tracker(sc, status_obj, sync_status, tn, objv_tracker)
+      marker_tracker(sc, status_obj, sync_status, tn, objv_tracker),
+      window_share(_sc->object_window)
   {
     zones_trace.insert(sc->source_zone.id, sync_pipe.info.dest_bucket.get_key());
     prefix_handler.set_rules(sync_pipe.get_rules());
@@ -4356,7 +4366,7 @@ int RGWBucketFullSyncCR::operate(const DoutPrefixProvider *dpp)
                                  entry->key, &marker_tracker, zones_trace, tn),
                       false);
         }
-        drain_with_cb(cct->_conf->rgw_bucket_sync_spawn_window,
+        drain_with_cb(sc->object_sync_window(),
                       [&](uint64_t stack_id, int ret) {
                 if (ret < 0) {
                   tn->log(10, "a sync operation returned error");
@@ -4522,6 +4532,8 @@ class RGWBucketShardIncrementalSyncCR : public RGWCoroutine {
   RGWSyncTraceNodeRef tn;
   RGWBucketIncSyncShardMarkerTrack marker_tracker;
 
+  rgw::sync::AdaptiveWindow::Share window_share;
+
 public:
   RGWBucketShardIncrementalSyncCR(RGWDataSyncCtx *_sc,
                                   rgw_bucket_sync_pipe& _sync_pipe,
@@ -4540,7 +4552,8 @@ public:
       tn(sync_env->sync_tracer->add_node(_tn_parent, "inc_sync",
                                          SSTR(bucket_shard_str{bs}))),
       marker_tracker(sc, shard_status_oid, sync_info.inc_marker, tn,
-                     objv_tracker, stable_timestamp)
+                     objv_tracker, stable_timestamp),
+      window_share(_sc->object_window)
   {
     set_description() << "bucket shard incremental sync bucket="
         << bucket_shard_str{bs};
@@ -4750,7 +4763,7 @@ int RGWBucketShardIncrementalSyncCR::operate(const DoutPrefixProvider *dpp)
                   false);
           }
         // }
-        drain_with_cb(cct->_conf->rgw_bucket_sync_spawn_window,
+        drain_with_cb(sc->object_sync_window(),
                       [&](uint64_t stack_id, int ret) {
                 if (ret < 0) {
                   tn->log(10, "a sync operation returned error");
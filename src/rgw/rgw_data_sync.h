@@ -23,6 +23,7 @@
 #include "rgw_sync_module.h"
 #include "rgw_sync_trace.h"
 #include "rgw_sync_policy.h"
+#include "rgw_sync_window.h"
 
 #include "rgw_bucket_sync.h"
 
@@ -354,12 +355,17 @@ struct RGWDataSyncCtx {
   RGWRESTConn *conn{nullptr};
   rgw_zone_id source_zone;
 
+  // object syncs in flight from the source zone, across bucket shards
+  rgw::sync::AdaptiveWindow object_window;
+
   RGWDataSyncCtx() = default;
 
   RGWDataSyncCtx(RGWDataSyncEnv* env,
 		 RGWRESTConn* conn,
 		 const rgw_zone_id& source_zone)
-    : env(env), cct(env->cct), conn(conn), source_zone(source_zone) {}
+    : env(env), cct(env->cct), conn(conn), source_zone(source_zone) {
+    init_object_window();
+  }
 
   void init(RGWDataSyncEnv *_env,
             RGWRESTConn *_conn,
@@ -368,6 +374,21 @@ struct RGWDataSyncCtx {
     env = _env;
     conn = _conn;
     source_zone = _source_zone;
+    init_object_window();
+  }
+
+  /// the number of object syncs that a bucket shard may keep in flight
+  uint64_t object_sync_window() const {
+    if (cct->_conf->rgw_sync_object_window_max == 0) {
+      return std::max<int64_t>(cct->_conf->rgw_bucket_sync_spawn_window, 1);
+    }
+    return object_window.share();
+  }
+
+private:
+  void init_object_window() {
+    object_window.configure(std::max<int64_t>(cct->_conf->rgw_bucket_sync_spawn_window, 1),
+                            cct->_conf->rgw_sync_object_window_max);
   }
 };
 
@@ -18,6 +18,7 @@
 #include "rgw_bucket_layout.h"
 #include "rgw_datalog.h"
 #include "rgw_log_backing.h"
+#include "rgw_perf_counters.h"
 #include "rgw_tools.h"
 
 #define dout_context g_ceph_context
@@ -399,7 +400,8 @@ RGWDataChangesLog::RGWDataChangesLog(CephContext* cct)
   : cct(cct),
     num_shards(cct->_conf->rgw_data_log_num_shards),
     prefix(get_prefix()),
-    changes(cct->_conf->rgw_data_log_changes_size) {}
+    changes(cct->_conf->rgw_data_log_changes_size),
+    queues(num_shards) {}
 
 bs::error_code DataLogBackends::handle_init(entries_t e) noexcept {
   std::unique_lock l(m);
@@ -620,6 +622,63 @@ std::string RGWDataChangesLog::get_oid(uint64_t gen_id, int i) const {
 	  fmt::format("{}.{}", prefix, i));
 }
 
+int RGWDataChangesLog::push_change(const DoutPrefixProvider *dpp, int index,
+				   rgw_data_change&& change)
+{
+  auto& q = queues[index];
+  std::unique_lock l{q.lock};
+  if (!q.next) {
+    q.next = std::make_shared<ChangeBatch>();
+  }
+  auto batch = q.next;
+  if (batch->keys.emplace(change.key, change.gen).second) {
+    batch->changes.push_back(std::move(change));
+  } else if (perfcounter) {
+    // already on its way with this batch
+    perfcounter->inc(l_rgw_datalog_suppressed);
+  }
+
+  q.cond.wait(l, [&] { return batch->done || !q.writing; });
+  if (batch->done) {
+    return batch->r;
+  }
+
+  // write the batch, after giving more changes a chance to join it
+  q.writing = true;
+  const auto window = std::chrono::milliseconds(
+    cct->_conf->rgw_data_log_coalesce_window_msec);
+  if (window.count() > 0) {
+    q.cond.wait_for(l, window, [this] { return going_down(); });
+  }
+  q.next.reset();
+  l.unlock();
+
+  auto now = real_clock::now();
+  auto be = bes->head();
+  RGWDataChangesBE::entries entries;
+  for (auto& c : batch->changes) {
+    ceph::buffer::list bl;
+    encode(c, bl);
+    be->prepare(now, c.key, std::move(bl), entries);
+  }
+  ldpp_dout(dpp, 20) << "RGWDataChangesLog::push_change() writing "
+		     << batch->changes.size() << " entries to shard "
+		     << index << dendl;
+  const int r = be->push(dpp, index, std::move(entries));
+  if (perfcounter) {
+    perfcounter->inc(l_rgw_datalog_batches);
+    perfcounter->inc(l_rgw_datalog_entries, batch->changes.size());
+  }
+
+  l.lock();
+  batch->r = r;
+  batch->done = true;
+  q.writing = false;
+  l.unlock();
+  q.cond.notify_all();
+  return r;
+}
+
 int RGWDataChangesLog::add_entry(const DoutPrefixProvider *dpp,
 				 const RGWBucketInfo& bucket_info,
 				 const rgw::bucket_log_layout_generation& gen,
@@ -657,6 +716,9 @@ int RGWDataChangesLog::add_entry(const DoutPrefixProvider *dpp,
   if (now < status->cur_expiration) {
     /* no need to send, recently completed */
     sl.unlock();
+    if (perfcounter) {
+      perfcounter->inc(l_rgw_datalog_suppressed);
+    }
     register_renew(bs, gen);
     return 0;
   }
@@ -670,6 +732,9 @@ int RGWDataChangesLog::add_entry(const DoutPrefixProvider *dpp,
 
     status->cond->get();
     sl.unlock();
+    if (perfcounter) {
+      perfcounter->inc(l_rgw_datalog_suppressed);
+    }
 
     int ret = cond->wait();
     cond->put();
@@ -694,18 +759,15 @@ int RGWDataChangesLog::add_entry(const DoutPrefixProvider *dpp,
 
     sl.unlock();
 
-    ceph::buffer::list bl;
     rgw_data_change change;
     change.entity_type = ENTITY_TYPE_BUCKET;
     change.key = bs.get_key();
     change.timestamp = now;
     change.gen = gen.gen;
-    encode(change, bl);
 
     ldpp_dout(dpp, 20) << "RGWDataChangesLog::add_entry() sending update with now=" << now << " cur_expiration=" << expiration << dendl;
 
-    auto be = bes->head();
-    ret = be->push(dpp, index, now, change.key, std::move(bl));
+    ret = push_change(dpp, index, std::move(change));
 
     now = real_clock::now();
 
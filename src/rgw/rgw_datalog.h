@@ -270,6 +270,28 @@ class RGWDataChangesLog {
 
   bc::flat_set<BucketGen> cur_cycle;
 
+  // the changes that are written to a data log shard in one operation
+  struct ChangeBatch {
+    std::vector<rgw_data_change> changes;
+    bc::flat_set<std::pair<std::string, uint64_t>> keys;
+    bool done = false;
+    int r = 0;
+  };
+
+  // changes wait here for the write of their data log shard. the first
+  // one to arrive while no write is in flight writes its batch, and any
+  // that arrive meanwhile go into the next one
+  struct ShardQueue {
+    ceph::mutex lock = ceph::make_mutex("RGWDataChangesLog::ShardQueue");
+    ceph::condition_variable cond;
+    std::shared_ptr<ChangeBatch> next;
+    bool writing = false;
+  };
+  std::vector<ShardQueue> queues;
+
+  int push_change(const DoutPrefixProvider *dpp, int index,
+		  rgw_data_change&& change);
+
   ChangeStatusPtr _get_change(const rgw_bucket_shard& bs, uint64_t gen);
   void register_renew(const rgw_bucket_shard& bs,
 		      const rgw::bucket_log_layout_generation& gen);
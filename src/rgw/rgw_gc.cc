@@ -425,6 +425,10 @@ public:
       goto done;
     }
 
+    if (io.type == IO::TailIO && perfcounter) {
+      perfcounter->inc(l_rgw_gc_remove);
+    }
+
     if (! gc->transitioned_objects_cache[io.index]) {
       schedule_tag_removal(io.index, io.tag);
     }
@@ -674,6 +678,10 @@ int RGWGC::process(int index, int max_secs, bool expired_only,
 
 	  const string& oid = obj.key.name; /* just stored raw oid there */
 
+	  if (!pacer.wait(1, [this] { return going_down(); })) {
+	    goto done;
+	  }
+
 	  ldpp_dout(this, 5) << "RGWGC::process removing " << obj.pool <<
 	    ":" << obj.key.name << dendl;
 	  ObjectWriteOperation op;
@@ -725,19 +733,30 @@ done:
 int RGWGC::process(bool expired_only)
 {
   int max_secs = cct->_conf->rgw_gc_processor_max_time;
+  const unsigned num_workers = std::max<uint64_t>(cct->_conf->rgw_gc_processor_threads, 1);
 
   const int start = ceph::util::generate_random_number(0, max_objs - 1);
 
-  RGWGCIOManager io_manager(this, store->ctx(), this);
+  pacer.set_rate(cct->_conf->rgw_gc_max_objs_per_sec);
 
-  for (int i = 0; i < max_objs; i++) {
-    int index = (i + start) % max_objs;
-    int ret = process(index, max_secs, expired_only, io_manager);
-    if (ret < 0)
-      return ret;
+  /* an io manager isn't thread-safe, so every worker gets its own */
+  std::vector<std::unique_ptr<RGWGCIOManager>> io_managers;
+  for (unsigned i = 0; i < num_workers; i++) {
+    io_managers.push_back(std::make_unique<RGWGCIOManager>(this, store->ctx(), this));
   }
+
+  int ret = rgw::for_each_shard("rgw_gc_shard", num_workers, max_objs, start,
+                                [&] (unsigned worker, int index) {
+                                  return process(index, max_secs, expired_only,
+                                                 *io_managers[worker]);
+                                });
+  if (ret < 0)
+    return ret;
+
   if (!going_down()) {
-    io_manager.drain();
+    for (auto& io_manager : io_managers) {
+      io_manager->drain();
+    }
   }
 
   return 0;
@@ -13,6 +13,7 @@
 #include "rgw_common.h"
 #include "rgw_sal.h"
 #include "rgw_rados.h"
+#include "rgw_shard_executor.h"
 #include "cls/rgw/cls_rgw_types.h"
 
 #include <atomic>
@@ -25,6 +26,7 @@ class RGWGC : public DoutPrefixProvider {
   int max_objs;
   std::string *obj_names;
   std::atomic<bool> down_flag = { false };
+  rgw::Pacer pacer; // rgw_gc_max_objs_per_sec
 
   static constexpr uint64_t seed = 8675309;
 
@@ -51,7 +53,9 @@ public:
     stop_processor();
     finalize();
   }
-  std::vector<bool> transitioned_objects_cache;
+  // a byte per shard rather than std::vector<bool>'s bits, so that shards
+  // processed in parallel don't update the same word
+  std::vector<char> transitioned_objects_cache;
   std::tuple<int, std::optional<cls_rgw_obj_chain>> send_split_chain(const cls_rgw_obj_chain& chain, const std::string& tag);
 
   // asynchronously defer garbage collection on an object that's still being read
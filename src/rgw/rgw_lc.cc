@@ -7,6 +7,10 @@
 #include <algorithm>
 #include <tuple>
 #include <functional>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
 
 #include <boost/algorithm/string/split.hpp>
 #include <boost/algorithm/string.hpp>
@@ -374,14 +378,57 @@ class LCObjsLister {
   rgw_bucket_dir_entry pre_obj;
   int64_t delay_ms;
 
+  /* the next page is listed by a task on the workpool, while the workpool
+   * processes the current one. whoever gets to it first lists it: if fetch()
+   * needs the page before the task started, it cancels the task and lists
+   * the page itself */
+  struct Prefetch {
+    std::mutex lock;
+    std::condition_variable cond;
+    bool started = false;
+    bool canceled = false;
+    bool done = false;
+    rgw_obj_key start; // marker the page is listed from
+    rgw::sal::Bucket::ListParams params;
+    rgw::sal::Bucket::ListResults results;
+    int r = 0;
+  };
+  RGWLC::WorkPool* workpool;
+  std::shared_ptr<Prefetch> prefetch;
+
+  void start_prefetch(const DoutPrefixProvider *dpp);
+
+  /* returns false if the prefetch didn't start, and won't. otherwise waits
+   * for it to finish */
+  static bool finish_prefetch(Prefetch& p) {
+    std::unique_lock l{p.lock};
+    if (!p.started) {
+      p.canceled = true;
+      return false;
+    }
+    p.cond.wait(l, [&p] { return p.done; });
+    return true;
+  }
+
 public:
-  LCObjsLister(rgw::sal::Store* _store, rgw::sal::Bucket* _bucket) :
-      store(_store), bucket(_bucket) {
+  LCObjsLister(rgw::sal::Store* _store, rgw::sal::Bucket* _bucket,
+	       RGWLC::WorkPool* _workpool = nullptr) :
+      store(_store), bucket(_bucket), workpool(_workpool) {
     list_params.list_versions = bucket->versioned();
     list_params.allow_unordered = true;
     delay_ms = store->ctx()->_conf.get_val<int64_t>("rgw_lc_thread_delay");
   }
 
+  ~LCObjsLister() {
+    /* the task uses the bucket */
+    if (prefetch) {
+      finish_prefetch(*prefetch);
+    }
+  }
+
+  LCObjsLister(const LCObjsLister&) = delete;
+  LCObjsLister& operator=(const LCObjsLister&) = delete;
+
   void set_prefix(const string& p) {
     prefix = p;
     list_params.prefix = prefix;
@@ -392,12 +439,20 @@ public:
   }
 
   int fetch(const DoutPrefixProvider *dpp) {
-    int ret = bucket->list(dpp, list_params, 1000, list_results, null_yield);
+    int ret;
+    auto p = std::move(prefetch);
+    if (p && finish_prefetch(*p) && p->start == list_params.marker) {
+      ret = p->r;
+      list_results = std::move(p->results);
+    } else {
+      ret = bucket->list(dpp, list_params, 1000, list_results, null_yield);
+    }
     if (ret < 0) {
       return ret;
     }
 
     obj_iter = list_results.objs.begin();
+    start_prefetch(dpp);
 
     return 0;
   }
@@ -568,6 +623,11 @@ static int remove_expired_obj(
 				   const_cast<std::string&>(oc.bucket->get_tenant()),
 				   lc_req_id, null_yield);
 
+  RGWLC* lc = oc.env.worker->get_lc();
+  if (!lc->pacer.wait(1, [lc] { return lc->going_down(); })) {
+    return -ECANCELED;
+  }
+
   ret = notify->publish_reserve(dpp, nullptr);
   if ( ret < 0) {
     ldpp_dout(dpp, 1)
@@ -670,7 +730,8 @@ class WorkQ : public Thread
 public:
   using unique_lock = std::unique_lock<std::mutex>;
   using work_f = std::function<void(RGWLC::LCWorker*, WorkQ*, WorkItem&)>;
-  using dequeue_result = boost::variant<void*, WorkItem>;
+  using task_f = std::function<void()>;
+  using dequeue_result = boost::variant<void*, WorkItem, task_f>;
 
   static constexpr uint32_t FLAG_NONE =        0x0000;
   static constexpr uint32_t FLAG_EWAIT_SYNC =  0x0001;
@@ -686,6 +747,7 @@ private:
   std::condition_variable cv;
   uint32_t flags;
   vector<WorkItem> items;
+  std::deque<task_f> tasks; // run ahead of the items
   work_f f;
 
 public:
@@ -718,6 +780,15 @@ public:
     }
   }
 
+  void run(task_f&& task) {
+    unique_lock uniq(mtx);
+    tasks.push_back(std::move(task));
+    if (flags & FLAG_DWAIT_SYNC) {
+      flags &= ~FLAG_DWAIT_SYNC;
+      cv.notify_one();
+    }
+  }
+
   void drain() {
     unique_lock uniq(mtx);
     flags |= FLAG_EDRAIN_SYNC;
@@ -730,7 +801,7 @@ private:
   dequeue_result dequeue() {
     unique_lock uniq(mtx);
     while ((!wk->get_lc()->going_down()) &&
-	   (items.size() == 0)) {
+	   (items.size() == 0) && tasks.empty()) {
       /* clear drain state, as we are NOT doing work and qlen==0 */
       if (flags & FLAG_EDRAIN_SYNC) {
 	flags &= ~FLAG_EDRAIN_SYNC;
@@ -738,6 +809,11 @@ private:
       flags |= FLAG_DWAIT_SYNC;
       cv.wait_for(uniq, 200ms);
     }
+    if (!tasks.empty()) {
+      auto task = std::move(tasks.front());
+      tasks.pop_front();
+      return {std::move(task)};
+    }
     if (items.size() > 0) {
       auto item = items.back();
       items.pop_back();
@@ -757,6 +833,10 @@ private:
 	/* going down */
 	break;
       }
+      if (item.which() == 2) {
+	boost::get<task_f>(item)();
+	continue;
+      }
       f(wk, this, boost::get<WorkItem>(item));
     }
     return nullptr;
@@ -797,6 +877,12 @@ public:
     (wqs[tix]).enqueue(std::move(item));
   }
 
+  void run(WorkQ::task_f task) {
+    const auto tix = ix;
+    ix = (ix+1) % wqs.size();
+    (wqs[tix]).run(std::move(task));
+  }
+
   void drain() {
     for (auto& wq : wqs) {
       wq.drain();
@@ -804,6 +890,32 @@ public:
   }
 }; /* WorkPool */
 
+void LCObjsLister::start_prefetch(const DoutPrefixProvider *dpp)
+{
+  if (!workpool || !list_results.is_truncated || list_results.objs.empty()) {
+    return;
+  }
+  auto p = std::make_shared<Prefetch>();
+  p->start = list_results.objs.back().key;
+  p->params = list_params;
+  p->params.marker = p->start;
+  workpool->run([p, bucket = bucket, dpp] {
+    {
+      std::lock_guard l{p->lock};
+      if (p->canceled) {
+        return;
+      }
+      p->started = true;
+    }
+    const int r = bucket->list(dpp, p->params, 1000, p->results, null_yield);
+    std::lock_guard l{p->lock};
+    p->r = r;
+    p->done = true;
+    p->cond.notify_all();
+  });
+  prefetch = std::move(p);
+}
+
 RGWLC::LCWorker::LCWorker(const DoutPrefixProvider* dpp, CephContext *cct,
 			  RGWLC *lc, int ix)
   : dpp(dpp), cct(cct), lc(lc), ix(ix)
@@ -1571,6 +1683,8 @@ int RGWLC::bucket_lc_process(string& shard_id, LCWorker* worker,
   /* fetch information for zone checks */
   rgw::sal::Zone* zone = store->get_zone();
 
+  pacer.set_rate(cct->_conf->rgw_lc_max_objs_per_sec);
+
   auto pf = [](RGWLC::LCWorker* wk, WorkQ* wq, WorkItem& wi) {
     auto wt =
       boost::get<std::tuple<LCOpRule, rgw_bucket_dir_entry>>(wi);
@@ -1580,6 +1694,9 @@ int RGWLC::bucket_lc_process(string& shard_id, LCWorker* worker,
       << __func__ << "(): key=" << o.key << wq->thr_name() 
       << dendl;
     int ret = op_rule.process(o, wk->dpp, wq);
+    if (perfcounter) {
+      perfcounter->inc(l_rgw_lc_process);
+    }
     if (ret < 0) {
       ldpp_dout(wk->get_lc(), 20)
 	<< "ERROR: orule.process() returned ret=" << ret
@@ -1620,7 +1737,7 @@ int RGWLC::bucket_lc_process(string& shard_id, LCWorker* worker,
       pre_marker = next_marker;
     }
 
-    LCObjsLister ol(store, bucket.get());
+    LCObjsLister ol(store, bucket.get(), worker->workpool);
     ol.set_prefix(prefix_iter->first);
 
     if (! zone_check(op, zone)) {
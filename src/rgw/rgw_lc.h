@@ -21,6 +21,7 @@
 #include "cls/rgw/cls_rgw_types.h"
 #include "rgw_tag.h"
 #include "rgw_sal.h"
+#include "rgw_shard_executor.h"
 
 #include <atomic>
 #include <tuple>
@@ -568,6 +569,7 @@ public:
   friend class RGWRados;
 
   std::vector<std::unique_ptr<RGWLC::LCWorker>> workers;
+  rgw::Pacer pacer; // rgw_lc_max_objs_per_sec, shared by all workers
 
   RGWLC() : cct(nullptr), store(nullptr) {}
   virtual ~RGWLC() override;
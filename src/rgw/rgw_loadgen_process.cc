@@ -12,8 +12,11 @@
 #include "rgw_loadgen.h"
 #include "rgw_client_io.h"
 #include "rgw_signal.h"
+#include "rgw_perf_counters.h"
 
 #include <atomic>
+#include <cmath>
+#include <random>
 
 #define dout_subsys ceph_subsys_rgw
 
@@ -37,6 +40,15 @@ void RGWLoadGenProcess::run()
   int num_buckets;
   conf->get_val("num_buckets", 1, &num_buckets);
 
+  const uint64_t obj_size = strtoull(conf->get_val("obj_size", "4096").c_str(), nullptr, 10);
+
+  int num_reads;
+  conf->get_val("num_reads", num_objs, &num_reads);
+
+  // with zipf=<exponent>, reads pick objects with a zipf distribution
+  // instead of reading each object in turn
+  const double zipf = strtod(conf->get_val("zipf", "0").c_str(), nullptr);
+
   vector<string> buckets(num_buckets);
 
   std::atomic<bool> failed = { false };
@@ -66,7 +78,7 @@ void RGWLoadGenProcess::run()
   }
 
   for (i = 0; i < num_objs; i++) {
-    gen_request("PUT", objs[i], 4096, &failed);
+    gen_request("PUT", objs[i], obj_size, &failed);
   }
 
   checkpoint();
@@ -76,11 +88,50 @@ void RGWLoadGenProcess::run()
     goto done;
   }
 
-  for (i = 0; i < num_objs; i++) {
-    gen_request("GET", objs[i], 4096, NULL);
-  }
+  {
+    std::vector<double> cdf;
+    if (zipf > 0) {
+      cdf.resize(num_objs);
+      double sum = 0;
+      for (i = 0; i < num_objs; i++) {
+        sum += 1.0 / std::pow(i + 1, zipf);
+        cdf[i] = sum;
+      }
+    }
+    std::mt19937 rng{std::random_device{}()};
+    std::uniform_real_distribution<double> uniform(0, cdf.empty() ? 1 : cdf.back());
+
+    auto read_stats = [] (uint64_t* hit, uint64_t* miss) {
+      *hit = perfcounter ? perfcounter->get(l_rgw_d3n_hit) : 0;
+      *miss = perfcounter ? perfcounter->get(l_rgw_d3n_miss) : 0;
+    };
+    uint64_t hit_before, miss_before;
+    read_stats(&hit_before, &miss_before);
+    const auto start = ceph::mono_clock::now();
+
+    for (i = 0; i < num_reads; i++) {
+      int n = i % num_objs;
+      if (!cdf.empty()) {
+        n = std::lower_bound(cdf.begin(), cdf.end(), uniform(rng)) - cdf.begin();
+        n = std::min(n, num_objs - 1);
+      }
+      gen_request("GET", objs[n], obj_size, NULL);
+    }
 
-  checkpoint();
+    checkpoint();
+
+    const double secs = std::chrono::duration<double>(ceph::mono_clock::now() - start).count();
+    uint64_t hit, miss;
+    read_stats(&hit, &miss);
+    hit -= hit_before;
+    miss -= miss_before;
+    dout(0) << "loadgen: " << num_reads << " reads of " << obj_size << " bytes in "
+            << secs << "s, " << (secs > 0 ? num_reads / secs : 0) << " reads/s, "
+            << (secs > 0 ? (double)num_reads * obj_size / secs / (1024 * 1024) : 0)
+            << " MB/s, d3n cache hits="
+            << hit << " misses=" << miss << " hit rate="
+            << (hit + miss ? 100.0 * hit / (hit + miss) : 0) << "%" << dendl;
+  }
 
   for (i = 0; i < num_objs; i++) {
     gen_request("DELETE", objs[i], 0, NULL);
@@ -104,7 +155,7 @@ done:
 
 void RGWLoadGenProcess::gen_request(const string& method,
 				    const string& resource,
-				    int content_length, std::atomic<bool>* fail_flag)
+				    uint64_t content_length, std::atomic<bool>* fail_flag)
 {
   RGWLoadGenRequest* req =
     new RGWLoadGenRequest(store->get_new_req_id(), method, resource,
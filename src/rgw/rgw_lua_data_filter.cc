@@ -89,6 +89,7 @@ int RGWObjFilter::execute(bufferlist& bl, off_t offset, const char* op_name) con
   open_standard_libs(L);
 
   create_debug_action(L, s->cct);  
+  set_instruction_counter(L);
 
   // create the "Data" table
   create_metatable<BufferlistMetaTable>(L, true, &bl);
@@ -111,7 +112,7 @@ int RGWObjFilter::execute(bufferlist& bl, off_t offset, const char* op_name) con
 
   try {
     // execute the lua script
-    if (luaL_dostring(L, script.c_str()) != LUA_OK) {
+    if (run_script(L, s->cct, script) != LUA_OK) {
       const std::string err(lua_tostring(L, -1));
       ldpp_dout(s, 1) << "Lua ERROR: " << err << dendl;
       return -EINVAL;
@@ -863,6 +863,7 @@ int execute(
       "");
 
   create_debug_action(L, s->cct);  
+  set_instruction_counter(L);
   
   create_metatable<RequestMetaTable>(L, true, s, const_cast<char*>(op_name));
 
@@ -887,7 +888,7 @@ int execute(
   int rc = 0;
   try {
     // execute the lua script
-    if (luaL_dostring(L, script.c_str()) != LUA_OK) {
+    if (run_script(L, s->cct, script) != LUA_OK) {
       const std::string err(lua_tostring(L, -1));
       ldpp_dout(s, 1) << "Lua ERROR: " << err << dendl;
       rc = -1;
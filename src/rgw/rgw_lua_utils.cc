@@ -2,6 +2,7 @@
 #include <lua.hpp>
 #include "common/ceph_context.h"
 #include "common/dout.h"
+#include "common/lru_map.h"
 #include "rgw_lua_utils.h"
 #include "rgw_lua_version.h"
 
@@ -73,5 +74,69 @@ void open_standard_libs(lua_State* L) {
   lua_settable(L, -3);
 }
 
+/*
+ * the same scripts run for every request, and for every chunk of data with
+ * the data filters. keep the bytecode that the most recently used ones were
+ * compiled to, so that they are only parsed once. the script's text is the
+ * key, so an updated script is simply compiled again
+ */
+static lru_map<std::string, std::string>* get_bytecode_cache(CephContext* cct)
+{
+  static const size_t size = cct->_conf->rgw_lua_bytecode_cache_size;
+  static lru_map<std::string, std::string> cache(size);
+  return size > 0 ? &cache : nullptr;
+}
+
+static int bytecode_writer(lua_State* L, const void* p, size_t sz, void* ud)
+{
+  reinterpret_cast<std::string*>(ud)->append(reinterpret_cast<const char*>(p), sz);
+  return 0;
+}
+
+int load_script(lua_State* L, CephContext* cct, const std::string& script)
+{
+  auto cache = get_bytecode_cache(cct);
+  if (!cache) {
+    return luaL_loadstring(L, script.c_str());
+  }
+
+  // name the chunk after the script, the way luaL_loadstring() does, so that
+  // error messages don't depend on whether it was cached
+  std::string bytecode;
+  if (cache->find(script, bytecode)) {
+    return luaL_loadbufferx(L, bytecode.data(), bytecode.size(), script.c_str(), "b");
+  }
+  const int rc = luaL_loadstring(L, script.c_str());
+  if (rc != LUA_OK) {
+    return rc;
+  }
+  // keep the debug info, for line numbers in runtime errors
+  if (lua_dump(L, bytecode_writer, &bytecode, 0) == 0) {
+    cache->add(script, bytecode);
+  }
+  return LUA_OK;
+}
+
+int run_script(lua_State* L, CephContext* cct, const std::string& script)
+{
+  int rc = load_script(L, cct, script);
+  if (rc != LUA_OK) {
+    return rc;
+  }
+  return lua_pcall(L, 0, LUA_MULTRET, 0);
+}
+
+static void count_instructions(lua_State* L, lua_Debug* ar)
+{
+  if (perfcounter) {
+    perfcounter->inc(l_rgw_lua_script_instructions, INSTRUCTION_COUNT_STEP);
+  }
+}
+
+void set_instruction_counter(lua_State* L)
+{
+  lua_sethook(L, count_instructions, LUA_MASKCOUNT, INSTRUCTION_COUNT_STEP);
+}
+
 } // namespace rgw::lua
 
@@ -214,6 +214,21 @@ void set_package_path(lua_State* L, const std::string& install_dir);
 // and the "debug" library
 void open_standard_libs(lua_State* L);
 
+// load the script as a function on top of the stack, like luaL_loadstring().
+// the bytecode that it compiles to is cached, and loaded instead of the
+// script by later calls with the same script
+int load_script(lua_State* L, CephContext* cct, const std::string& script);
+
+// load and call the script, like luaL_dostring()
+int run_script(lua_State* L, CephContext* cct, const std::string& script);
+
+constexpr auto INSTRUCTION_COUNT_STEP = 1000;
+
+// count the instructions that scripts execute in the "lua_script_instructions"
+// perf counter. it is updated every INSTRUCTION_COUNT_STEP instructions, so
+// the last partial step of each script is not counted
+void set_instruction_counter(lua_State* L);
+
 typedef int MetaTableClosure(lua_State* L);
 
 template<typename MapType=std::map<std::string, std::string>>
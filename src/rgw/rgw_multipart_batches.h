@@ -0,0 +1,148 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab ft=cpp
+
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ */
+
+#pragma once
+
+#include <cerrno>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "include/buffer.h"
+
+namespace rgw::multipart {
+
+/*
+ * The parts named by a CompleteMultipartUpload request, split into
+ * batches that can each be read with one omap listing of the upload's
+ * meta object. Each batch lists the keys that follow the last part of
+ * the previous batch, so part numbers don't have to be contiguous.
+ *
+ * The reads may complete in any order; parts are handed to the callback
+ * in part order as soon as their batch and all earlier ones are done.
+ */
+template <typename Part>
+class PartBatches {
+public:
+  // decodes a part, returning its number or a negative error code
+  using decode_t = std::function<int(ceph::buffer::list&, Part&)>;
+  using part_cb_t = std::function<int(Part&)>;
+
+  struct Batch {
+    std::map<int, std::string>::const_iterator first;
+    int count = 0;
+    std::string after; ///< list the keys after this one
+    std::map<std::string, ceph::buffer::list> vals;
+    bool more = false;
+    int rval = 0;
+    bool done = false;
+
+    // keys to read: the batch, and the one after it
+    unsigned max() const {
+      return count + 1;
+    }
+  };
+
+private:
+  std::vector<Batch> batches;
+  decode_t decode;
+  part_cb_t cb;
+  size_t next = 0; // next batch to hand to cb
+
+  // -EAGAIN if the stored parts don't match the batch
+  int handle(size_t index) {
+    auto& b = batches[index];
+    if (b.rval < 0) {
+      return b.rval;
+    }
+    auto num = b.first;
+    auto v = b.vals.begin();
+    for (int n = 0; n < b.count; ++n, ++num, ++v) {
+      if (v == b.vals.end()) {
+	return -EAGAIN;
+      }
+      Part part;
+      int r = decode(v->second, part);
+      if (r < 0) {
+	return r;
+      }
+      if (r != num->first) {
+	return -EAGAIN;
+      }
+      r = cb(part);
+      if (r < 0) {
+	return r;
+      }
+    }
+    // the key after the batch must be the first part of the next batch
+    if (v != b.vals.end()) {
+      Part part;
+      if (index + 1 == batches.size() ||
+	  decode(v->second, part) != batches[index + 1].first->first) {
+	return -EAGAIN;
+      }
+    }
+    return 0;
+  }
+
+public:
+  PartBatches(const std::map<int, std::string>& part_etags, int batch_size,
+	      decode_t decode, part_cb_t cb)
+    : decode(std::move(decode)), cb(std::move(cb)) {
+    batches.reserve((part_etags.size() + batch_size - 1) / batch_size);
+    int prev = 0;
+    for (auto i = part_etags.begin(); i != part_etags.end(); ) {
+      auto& b = batches.emplace_back();
+      char buf[32];
+      snprintf(buf, sizeof(buf), "part.%08d", prev);
+      b.after = buf;
+      b.first = i;
+      for (; i != part_etags.end() && b.count < batch_size; ++i, ++b.count) {
+	prev = i->first;
+      }
+    }
+  }
+
+  size_t size() const {
+    return batches.size();
+  }
+  Batch& operator[](size_t index) {
+    return batches[index];
+  }
+  // every part was handed to cb
+  bool finished() const {
+    return next == batches.size();
+  }
+
+  // the read of a batch finished with result
+  void done(size_t index, int result) {
+    auto& b = batches[index];
+    b.done = true;
+    if (result < 0 && b.rval >= 0) {
+      b.rval = result;
+    }
+  }
+
+  // hand the parts of the batches that are done, up to the first that
+  // isn't, to cb
+  int handle_done() {
+    int r = 0;
+    for (; r == 0 && next < batches.size() && batches[next].done; ++next) {
+      r = handle(next);
+    }
+    return r;
+  }
+}; // PartBatches
+
+} // namespace rgw::multipart
@@ -4,7 +4,9 @@
 #include "rgw_notify.h"
 #include "cls/2pc_queue/cls_2pc_queue_client.h"
 #include "cls/lock/cls_lock_client.h"
+#include <map>
 #include <memory>
+#include <tuple>
 #include <boost/algorithm/hex.hpp>
 #include <boost/context/protected_fixedsize_stack.hpp>
 #include <spawn/spawn.hpp>
@@ -159,9 +161,30 @@ class Manager : public DoutPrefixProvider {
     }   
   };
 
+  // push endpoints used by the entries of a single batch, by endpoint, args and topic
+  // entries of the same topic share an endpoint (and its broker connection) instead
+  // of creating one per entry
+  using endpoint_key_t = std::tuple<std::string, std::string, std::string>;
+  using endpoints_t = std::map<endpoint_key_t, RGWPubSubEndpoint::Ptr>;
+
+  // get the endpoint of an entry from the batch's endpoints, or create it
+  // may throw a configuration_error if creation fails
+  RGWPubSubEndpoint& get_endpoint(const event_entry_t& event_entry, endpoints_t& endpoints) {
+    endpoint_key_t key{event_entry.push_endpoint, event_entry.push_endpoint_args, event_entry.arn_topic};
+    auto i = endpoints.find(key);
+    if (i == endpoints.end()) {
+      auto push_endpoint = RGWPubSubEndpoint::create(event_entry.push_endpoint, event_entry.arn_topic,
+          RGWHTTPArgs(event_entry.push_endpoint_args, this), 
+          cct);
+      ldpp_dout(this, 20) << "INFO: push endpoint created: " << event_entry.push_endpoint << dendl;
+      i = endpoints.emplace(std::move(key), std::move(push_endpoint)).first;
+    }
+    return *i->second;
+  }
+
   // processing of a specific entry
   // return whether processing was successfull (true) or not (false)
-  bool process_entry(const cls_queue_entry& entry, yield_context yield) {
+  bool process_entry(const cls_queue_entry& entry, endpoints_t& endpoints, yield_context yield) {
     event_entry_t event_entry;
     auto iter = entry.data.cbegin();
     try {
@@ -171,13 +194,8 @@ class Manager : public DoutPrefixProvider {
       return false;
     }
     try {
-      // TODO move endpoint creation to queue level
-      const auto push_endpoint = RGWPubSubEndpoint::create(event_entry.push_endpoint, event_entry.arn_topic,
-          RGWHTTPArgs(event_entry.push_endpoint_args, this), 
-          cct);
-      ldpp_dout(this, 20) << "INFO: push endpoint created: " << event_entry.push_endpoint <<
-        " for entry: " << entry.marker << dendl;
-      const auto ret = push_endpoint->send_to_completion_async(cct, event_entry.event, optional_yield(io_context, yield));
+      auto& push_endpoint = get_endpoint(event_entry, endpoints);
+      const auto ret = push_endpoint.send_to_completion_async(cct, event_entry.event, optional_yield(io_context, yield));
       if (ret < 0) {
         ldpp_dout(this, 5) << "WARNING: push entry: " << entry.marker << " to endpoint: " << event_entry.push_endpoint 
           << " failed. error: " << ret << " (will retry)" << dendl;
@@ -304,16 +322,18 @@ class Manager : public DoutPrefixProvider {
       auto has_error = false;
       auto remove_entries = false;
       auto entry_idx = 1U;
+      // the entries and endpoints outlive the coroutines, which are all waited for below.
+      // the coroutines run on the strand of this one, so they share them without locking
+      endpoints_t endpoints;
       tokens_waiter waiter(io_context);
-      for (auto& entry : entries) {
+      for (const auto& entry : entries) {
         if (has_error) {
           // bail out on first error
           break;
         }
-        // TODO pass entry pointer instead of by-value
-        spawn::spawn(yield, [this, &queue_name, entry_idx, total_entries, &end_marker, &remove_entries, &has_error, &waiter, entry](yield_context yield) {
+        spawn::spawn(yield, [this, &queue_name, entry_idx, total_entries, &end_marker, &remove_entries, &has_error, &waiter, &endpoints, &entry](yield_context yield) {
             const auto token = waiter.make_token();
-            if (process_entry(entry, yield)) {
+            if (process_entry(entry, endpoints, yield)) {
               ldpp_dout(this, 20) << "INFO: processing of entry: " << 
                 entry.marker << " (" << entry_idx << "/" << total_entries << ") from: " << queue_name << " ok" << dendl;
               remove_entries = true;
@@ -968,7 +988,8 @@ reservation_t::reservation_t(const DoutPrefixProvider* _dpp,
 			     const req_state* _s,
 			     rgw::sal::Object* _object,
 			     rgw::sal::Object* _src_object,
-			     const std::string* _object_name) :
+			     const std::string* _object_name,
+			     optional_yield y) :
   dpp(_s), store(_store), s(_s), size(0) /* XXX */,
   object(_object), src_object(_src_object), bucket(_s->bucket.get()),
   object_name(_object_name),
@@ -977,7 +998,7 @@ reservation_t::reservation_t(const DoutPrefixProvider* _dpp,
   user_id(_s->user->get_id().id),
   user_tenant(_s->user->get_id().tenant),
   req_id(_s->req_id),
-  yield(_s->yield)
+  yield(y)
 {}
 
 reservation_t::reservation_t(const DoutPrefixProvider* _dpp,
@@ -3,6 +3,7 @@
 
 #include "rgw_obj_manifest.h"
 
+#include "common/hobject.h"
 #include "services/svc_zone.h"
 #include "services/svc_tier_rados.h"
 #include "rgw_rados.h" // RGW_OBJ_NS_SHADOW and RGW_OBJ_NS_MULTIPART
@@ -607,3 +608,56 @@ void RGWObjTier::dump(Formatter *f) const
   encode_json("tier_placement", tier_placement, f);
   encode_json("is_multipart_upload", is_multipart_upload, f);
 }
+
+void RGWObjDedupChunk::dump(Formatter *f) const
+{
+  encode_json("fingerprint", fingerprint.to_str(), f);
+  encode_json("ofs", ofs, f);
+  encode_json("len", len, f);
+}
+
+void RGWObjDedupManifest::append(const sha256_digest_t& fingerprint, uint64_t len)
+{
+  auto& c = chunks.emplace_back();
+  c.fingerprint = fingerprint;
+  c.ofs = obj_size;
+  c.len = len;
+  obj_size += len;
+}
+
+std::vector<RGWObjDedupChunk>::const_iterator
+RGWObjDedupManifest::find(uint64_t ofs) const
+{
+  return std::upper_bound(chunks.begin(), chunks.end(), ofs,
+                          [] (uint64_t o, const RGWObjDedupChunk& c) {
+                            return o < c.ofs + c.len;
+                          });
+}
+
+hobject_t RGWObjDedupManifest::get_ref_source() const
+{
+  hobject_t source;
+  source.oid.name = ref_tag;
+  return source;
+}
+
+void RGWObjDedupManifest::dump(Formatter *f) const
+{
+  encode_json("pool", pool, f);
+  encode_json("ref_tag", ref_tag, f);
+  encode_json("obj_size", obj_size, f);
+  encode_json("chunks", chunks, f);
+}
+
+void RGWObjDedupManifest::generate_test_instances(std::list<RGWObjDedupManifest*>& o)
+{
+  o.push_back(new RGWObjDedupManifest);
+
+  auto m = new RGWObjDedupManifest;
+  m->pool = rgw_pool(".chunks");
+  m->ref_tag = "tag";
+  unsigned char v[sha256_digest_t::SIZE] = {1, 2, 3};
+  m->append(sha256_digest_t(v), 64 * 1024);
+  m->append(sha256_digest_t(v), 80 * 1024);
+  o.push_back(m);
+}
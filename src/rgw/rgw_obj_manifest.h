@@ -174,6 +174,75 @@ struct RGWObjTier {
 };
 WRITE_CLASS_ENCODER(RGWObjTier)
 
+/*
+ The dedup manifest replaces RGWObjManifest for objects whose data was cut
+ into content-defined chunks. The head holds no data. Each chunk is stored
+ once in the chunk pool, named by the SHA-256 of its contents, and carries
+ one cls_cas reference (named by ref_tag) for every time the object uses it.
+*/
+struct RGWObjDedupChunk {
+  sha256_digest_t fingerprint;
+  uint64_t len{0};
+  uint64_t ofs{0}; /* not encoded, derived from the lengths of the chunks before it */
+
+  std::string get_oid() const { return fingerprint.to_str(); }
+
+  void encode(bufferlist& bl) const {
+    ENCODE_START(1, 1, bl);
+    encode(fingerprint, bl);
+    encode(len, bl);
+    ENCODE_FINISH(bl);
+  }
+
+  void decode(bufferlist::const_iterator& bl) {
+    DECODE_START(1, bl);
+    decode(fingerprint, bl);
+    decode(len, bl);
+    DECODE_FINISH(bl);
+  }
+  void dump(Formatter *f) const;
+};
+WRITE_CLASS_ENCODER(RGWObjDedupChunk)
+
+struct RGWObjDedupManifest {
+  rgw_pool pool;       /* the chunk pool */
+  std::string ref_tag; /* names this object's references on its chunks */
+  uint64_t obj_size{0};
+  std::vector<RGWObjDedupChunk> chunks;
+
+  void append(const sha256_digest_t& fingerprint, uint64_t len);
+
+  /* the chunk that contains ofs, or chunks.end() */
+  std::vector<RGWObjDedupChunk>::const_iterator find(uint64_t ofs) const;
+
+  /* the source that cls_cas records for each of our references */
+  hobject_t get_ref_source() const;
+
+  void encode(bufferlist& bl) const {
+    ENCODE_START(1, 1, bl);
+    encode(pool, bl);
+    encode(ref_tag, bl);
+    encode(chunks, bl);
+    ENCODE_FINISH(bl);
+  }
+
+  void decode(bufferlist::const_iterator& bl) {
+    DECODE_START(1, bl);
+    decode(pool, bl);
+    decode(ref_tag, bl);
+    decode(chunks, bl);
+    DECODE_FINISH(bl);
+    obj_size = 0;
+    for (auto& c : chunks) {
+      c.ofs = obj_size;
+      obj_size += c.len;
+    }
+  }
+  void dump(Formatter *f) const;
+  static void generate_test_instances(std::list<RGWObjDedupManifest*>& o);
+};
+WRITE_CLASS_ENCODER(RGWObjDedupManifest)
+
 class RGWObjManifest {
 protected:
   bool explicit_objs{false}; /* really old manifest? */
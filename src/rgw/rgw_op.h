@@ -26,6 +26,7 @@
 #include <boost/utility/in_place_factory.hpp>
 #include <boost/function.hpp>
 #include <boost/container/flat_map.hpp>
+#include <boost/asio/deadline_timer.hpp>
 
 #include "common/armor.h"
 #include "common/mime.h"
@@ -2039,6 +2040,14 @@ protected:
   bool bypass_perm;
   bool bypass_governance_mode;
 
+  // deletes a single key and sends its result. with a flush timer, it
+  // is one of several concurrent deletes and leaves the flush to the
+  // coroutine that owns the response
+  void handle_individual_object(const rgw_obj_key& o, optional_yield y,
+                                boost::asio::deadline_timer *formatter_flush_cond);
+  // flush results to the client as they come in, until @p predicate holds
+  void wait_flush(optional_yield y, boost::asio::deadline_timer *formatter_flush_cond,
+                  std::function<bool()> predicate);
 
 public:
   RGWDeleteMultiObj() {
@@ -2054,8 +2063,9 @@ public:
   virtual int get_params(optional_yield y) = 0;
   virtual void send_status() = 0;
   virtual void begin_response() = 0;
-  virtual void send_partial_response(rgw_obj_key& key, bool delete_marker,
-                                     const std::string& marker_version_id, int ret) = 0;
+  virtual void send_partial_response(const rgw_obj_key& key, bool delete_marker,
+                                     const std::string& marker_version_id, int ret,
+                                     boost::asio::deadline_timer *formatter_flush_cond) = 0;
   virtual void end_response() = 0;
   const char* name() const override { return "multi_object_delete"; }
   RGWOpType get_type() override { return RGW_OP_DELETE_MULTI_OBJ; }
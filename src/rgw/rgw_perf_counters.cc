@@ -35,6 +35,7 @@ int rgw_perf_start(CephContext *cct)
   plb.add_u64_counter(l_rgw_keystone_token_cache_miss, "keystone_token_cache_miss", "Keystone token cache miss");
 
   plb.add_u64_counter(l_rgw_gc_retire, "gc_retire_object", "GC object retires");
+  plb.add_u64_counter(l_rgw_gc_remove, "gc_remove_object", "Tail objects removed by GC");
 
   plb.add_u64_counter(l_rgw_lc_expire_current, "lc_expire_current",
 		      "Lifecycle current expiration");
@@ -49,6 +50,8 @@ int rgw_perf_start(CephContext *cct)
 		      "Lifecycle non-current transition");
   plb.add_u64_counter(l_rgw_lc_abort_mpu, "lc_abort_mpu",
 		      "Lifecycle abort multipart upload");
+  plb.add_u64_counter(l_rgw_lc_process, "lc_process_object",
+		      "Objects evaluated by lifecycle");
 
   plb.add_u64_counter(l_rgw_pubsub_event_triggered, "pubsub_event_triggered", "Pubsub events with at least one topic");
   plb.add_u64_counter(l_rgw_pubsub_event_lost, "pubsub_event_lost", "Pubsub events lost");
@@ -63,6 +66,46 @@ int rgw_perf_start(CephContext *cct)
   plb.add_u64_counter(l_rgw_lua_script_ok, "lua_script_ok", "Successfull executions of lua scripts");
   plb.add_u64_counter(l_rgw_lua_script_fail, "lua_script_fail", "Failed executions of lua scripts");
   plb.add_u64(l_rgw_lua_current_vms, "lua_current_vms", "Number of Lua VMs currently being executed");
+
+  plb.add_u64(l_rgw_reshard_active, "reshard_active", "Bucket reshards in progress");
+  plb.add_u64_counter(l_rgw_reshard_entries, "reshard_entries", "Index entries copied by reshard");
+  plb.add_u64_counter(l_rgw_reshard_replayed, "reshard_replayed", "Objects copied again because they were modified during reshard");
+  plb.add_time_avg(l_rgw_reshard_copy_lat, "reshard_copy_lat", "Time to copy a bucket index to its new layout");
+  plb.add_time_avg(l_rgw_reshard_block_lat, "reshard_block_lat", "Time writes to a bucket were blocked by reshard");
+
+  plb.add_u64_counter(l_rgw_d3n_hit, "d3n_cache_hit", "Reads served from the d3n data cache");
+  plb.add_u64_counter(l_rgw_d3n_miss, "d3n_cache_miss", "Reads not found in the d3n data cache");
+  plb.add_u64_counter(l_rgw_d3n_reject, "d3n_cache_reject", "Objects not written to the d3n data cache by its admission policy");
+  plb.add_u64_counter(l_rgw_d3n_evict, "d3n_cache_evict", "Objects evicted from the d3n data cache");
+  plb.add_u64(l_rgw_d3n_used, "d3n_cache_used", "Bytes in the d3n data cache");
+  plb.add_time_avg(l_rgw_d3n_read_lat, "d3n_cache_read_lat", "d3n data cache read latency");
+  plb.add_time_avg(l_rgw_d3n_write_lat, "d3n_cache_write_lat", "d3n data cache write latency");
+
+  plb.add_time_avg(l_rgw_multipart_complete_lat, "multipart_complete_lat", "Time to assemble the manifest of a completed multipart upload");
+  plb.add_time_avg(l_rgw_get_read_lat, "get_read_lat", "Latency of the reads issued by object GETs");
+
+  plb.add_u64_counter(l_rgw_s3select_range_read, "s3select_range_read", "Ranged reads of Parquet objects by S3 Select");
+  plb.add_u64_counter(l_rgw_s3select_range_bytes, "s3select_range_bytes", "Bytes read from Parquet objects by S3 Select");
+  plb.add_u64_counter(l_rgw_s3select_range_cached, "s3select_range_cached", "S3 Select Parquet reads served from the prefetched tail");
+
+  plb.add_u64_avg(l_rgw_bi_complete_batch, "bi_complete_batch", "Bucket index complete ops sent together to an index shard");
+
+  plb.add_u64_counter(l_rgw_cache_refresh, "cache_refresh", "Cache entries re-read ahead of expiry");
+
+  plb.add_u64_counter(l_rgw_put_hash_b, "put_hash_b", "Bytes of PUT data hashed for the ETag");
+  plb.add_time(l_rgw_put_hash_time, "put_hash_time", "Time spent hashing PUT data for the ETag");
+  plb.add_u64_counter(l_rgw_put_compress_b, "put_compress_b", "Bytes of PUT data compressed");
+  plb.add_time(l_rgw_put_compress_time, "put_compress_time", "Time spent compressing PUT data");
+  plb.add_u64_counter(l_rgw_put_encrypt_b, "put_encrypt_b", "Bytes of PUT data encrypted");
+  plb.add_time(l_rgw_put_encrypt_time, "put_encrypt_time", "Time spent encrypting PUT data");
+
+  plb.add_u64_counter(l_rgw_datalog_entries, "datalog_entries", "Data changes log entries written");
+  plb.add_u64_counter(l_rgw_datalog_batches, "datalog_batches", "Data changes log writes");
+  plb.add_u64_counter(l_rgw_datalog_suppressed, "datalog_suppressed", "Bucket shard changes that didn't need a new data changes log entry");
+
+  plb.add_u64_counter(l_rgw_lua_script_instructions, "lua_script_instructions", "Instructions executed by lua request and data scripts");
+
+  plb.add_u64_counter(l_rgw_signing_key_cache_hit, "signing_key_cache_hit", "SigV4 signing keys found in the cache");
   
   perfcounter = plb.create_perf_counters();
   cct->get_perfcounters_collection()->add(perfcounter);
@@ -32,6 +32,7 @@ enum {
   l_rgw_keystone_token_cache_miss,
 
   l_rgw_gc_retire,
+  l_rgw_gc_remove,
 
   l_rgw_lc_expire_current,
   l_rgw_lc_expire_noncurrent,
@@ -39,6 +40,7 @@ enum {
   l_rgw_lc_transition_current,
   l_rgw_lc_transition_noncurrent,
   l_rgw_lc_abort_mpu,
+  l_rgw_lc_process,
 
   l_rgw_pubsub_event_triggered,
   l_rgw_pubsub_event_lost,
@@ -54,6 +56,46 @@ enum {
   l_rgw_lua_script_ok,
   l_rgw_lua_script_fail,
 
+  l_rgw_reshard_active,
+  l_rgw_reshard_entries,
+  l_rgw_reshard_replayed,
+  l_rgw_reshard_copy_lat,
+  l_rgw_reshard_block_lat,
+
+  l_rgw_d3n_hit,
+  l_rgw_d3n_miss,
+  l_rgw_d3n_reject,
+  l_rgw_d3n_evict,
+  l_rgw_d3n_used,
+  l_rgw_d3n_read_lat,
+  l_rgw_d3n_write_lat,
+
+  l_rgw_multipart_complete_lat,
+  l_rgw_get_read_lat,
+
+  l_rgw_s3select_range_read,
+  l_rgw_s3select_range_bytes,
+  l_rgw_s3select_range_cached,
+
+  l_rgw_bi_complete_batch,
+
+  l_rgw_cache_refresh,
+
+  l_rgw_put_hash_b,
+  l_rgw_put_hash_time,
+  l_rgw_put_compress_b,
+  l_rgw_put_compress_time,
+  l_rgw_put_encrypt_b,
+  l_rgw_put_encrypt_time,
+
+  l_rgw_datalog_entries,
+  l_rgw_datalog_batches,
+  l_rgw_datalog_suppressed,
+
+  l_rgw_lua_script_instructions,
+
+  l_rgw_signing_key_cache_hit,
+
   l_rgw_last,
 };
 
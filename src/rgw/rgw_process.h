@@ -163,7 +163,7 @@ public:
   void checkpoint();
   void handle_request(const DoutPrefixProvider *dpp, RGWRequest* req) override;
   void gen_request(const std::string& method, const std::string& resource,
-		  int content_length, std::atomic<bool>* fail_flag);
+		  uint64_t content_length, std::atomic<bool>* fail_flag);
 
   void set_access_key(RGWAccessKey& key) { access_key = key; }
 };
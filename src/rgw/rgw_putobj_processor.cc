@@ -15,6 +15,8 @@
 
 #include "rgw_aio.h"
 #include "rgw_putobj_processor.h"
+#include "cls/cas/cls_cas_client.h"
+#include "common/hobject.h"
 #include "rgw_multi.h"
 #include "rgw_compression.h"
 #include "services/svc_sys_obj.h"
@@ -349,6 +351,197 @@ int AtomicObjectProcessor::complete(size_t accounted_size,
 }
 
 
+DedupObjectProcessor::~DedupObjectProcessor()
+{
+  // wait on outstanding references without sending any more chunk data
+  process_completed(aio->drain(), false);
+
+  if (completed || referenced.empty()) {
+    return;
+  }
+  // drop the references we took. chunks go away with their last reference
+  RGWObjDedupManifest refs;
+  refs.pool = manifest.pool;
+  refs.ref_tag = manifest.ref_tag;
+  for (auto index : referenced) {
+    const auto& c = manifest.chunks[index];
+    refs.append(c.fingerprint, c.len);
+  }
+  store->getRados()->put_dedup_chunk_refs(dpp, refs, y);
+}
+
+AioResultList DedupObjectProcessor::submit(uint64_t index,
+                                           librados::ObjectWriteOperation&& op,
+                                           uint64_t cost)
+{
+  auto obj = store->svc()->rados->obj(chunk_pool,
+                                      manifest.chunks[index].get_oid());
+  // the chunk index doubles as the aio id
+  return aio->get(obj, Aio::librados_op(std::move(op), y), cost, index);
+}
+
+int DedupObjectProcessor::process_completed(AioResultList&& results,
+                                            bool resubmit)
+{
+  std::optional<int> error;
+  while (!results.empty()) {
+    auto& e = results.front();
+    const uint64_t index = e.id;
+    const int result = e.result;
+    results.pop_front_and_dispose(std::default_delete<AioResultEntry>{});
+
+    auto c = checking.find(index);
+    if (c != checking.end()) {
+      bufferlist data = std::move(c->second);
+      checking.erase(c);
+      if (result == -ENOENT && resubmit) {
+        // new chunk, create it with our reference
+        librados::ObjectWriteOperation op;
+        cls_cas_chunk_create_or_get_ref(op, manifest.get_ref_source(), data);
+        const uint64_t cost = data.length();
+        auto more = submit(index, std::move(op), cost);
+        results.splice(results.end(), more);
+        continue;
+      }
+    }
+    if (result >= 0) {
+      referenced.push_back(index);
+    } else if (!error) { // record first error code
+      error = result;
+    }
+  }
+  return error.value_or(0);
+}
+
+int DedupObjectProcessor::add_chunk(bufferlist&& data)
+{
+  const uint64_t index = manifest.chunks.size();
+  const uint64_t cost = data.length();
+  manifest.append(ceph::crypto::digest<ceph::crypto::SHA256>(data), cost);
+
+  // take a reference on the chunk if it exists, and hold on to the data in
+  // case it doesn't
+  librados::ObjectWriteOperation op;
+  cls_cas_chunk_get_ref(op, manifest.get_ref_source());
+  checking.emplace(index, std::move(data));
+  return process_completed(submit(index, std::move(op), cost));
+}
+
+int DedupObjectProcessor::prepare(optional_yield y)
+{
+  CephContext *cct = store->ctx();
+  const auto bits = cct->_conf.get_val<uint64_t>("rgw_dedup_chunk_bits");
+  // FastCDC cuts between 1/4 and 4 times the target size
+  constexpr int window_bits = 2;
+  cdc = CDC::create("fastcdc", bits, window_bits);
+  max_chunk_size = 1ull << (bits + window_bits);
+
+  rgw_raw_obj raw_head;
+  dynamic_cast<rgw::sal::RadosObject*>(head_obj.get())->get_raw_obj(&raw_head);
+
+  manifest.pool = rgw_pool(cct->_conf.get_val<std::string>("rgw_dedup_chunk_pool"));
+  manifest.ref_tag = raw_head.oid + "." + gen_rand_alphanumeric(cct, 16);
+
+  chunk_pool = store->svc()->rados->pool(manifest.pool);
+  int r = chunk_pool.open(dpp);
+  if (r < 0) {
+    ldpp_dout(dpp, 0) << "ERROR: failed to open dedup chunk pool "
+        << manifest.pool << " r=" << r << dendl;
+    return r;
+  }
+  return 0;
+}
+
+int DedupObjectProcessor::process(bufferlist&& data, uint64_t offset)
+{
+  const bool flush = (data.length() == 0);
+  pending.claim_append(data);
+
+  // the last cut may just be where our data ends. wait until there is room
+  // for at least one whole chunk before it
+  if (!flush && pending.length() < 2 * max_chunk_size) {
+    return 0;
+  }
+
+  std::vector<std::pair<uint64_t, uint64_t>> cuts;
+  cdc->calc_chunks(pending, &cuts);
+  if (!flush && !cuts.empty()) {
+    cuts.pop_back(); // cut it again once we have more data
+  }
+  for (const auto& cut : cuts) {
+    bufferlist chunk;
+    pending.splice(0, cut.second, &chunk);
+    int r = add_chunk(std::move(chunk));
+    if (r < 0) {
+      return r;
+    }
+  }
+  return 0;
+}
+
+int DedupObjectProcessor::complete(size_t accounted_size,
+                                   const std::string& etag,
+                                   ceph::real_time *mtime,
+                                   ceph::real_time set_mtime,
+                                   rgw::sal::Attrs& attrs,
+                                   ceph::real_time delete_at,
+                                   const char *if_match,
+                                   const char *if_nomatch,
+                                   const std::string *user_data,
+                                   rgw_zone_set *zones_trace,
+                                   bool *pcanceled, optional_yield y)
+{
+  // new chunks are only created once their reference attempt completes, so
+  // keep draining until nothing is left in flight
+  for (auto c = aio->drain(); !c.empty(); c = aio->drain()) {
+    int r = process_completed(std::move(c));
+    if (r < 0) {
+      return r;
+    }
+  }
+
+  bufferlist manifest_bl;
+  encode(manifest, manifest_bl);
+  attrs[RGW_ATTR_DEDUP_MANIFEST] = std::move(manifest_bl);
+
+  head_obj->set_atomic();
+
+  RGWRados::Object op_target(store->getRados(),
+		  head_obj->get_bucket(),
+		  obj_ctx, head_obj.get());
+  RGWRados::Object::Write obj_op(&op_target);
+
+  op_target.set_versioning_disabled(!head_obj->get_bucket()->versioning_enabled());
+  obj_op.meta.ptag = &unique_tag; /* use req_id as operation tag */
+  obj_op.meta.if_match = if_match;
+  obj_op.meta.if_nomatch = if_nomatch;
+  obj_op.meta.mtime = mtime;
+  obj_op.meta.set_mtime = set_mtime;
+  obj_op.meta.owner = owner;
+  obj_op.meta.flags = PUT_OBJ_CREATE;
+  obj_op.meta.olh_epoch = olh_epoch;
+  obj_op.meta.delete_at = delete_at;
+  obj_op.meta.user_data = user_data;
+  obj_op.meta.zones_trace = zones_trace;
+
+  int r = obj_op.write_meta(dpp, manifest.obj_size, accounted_size, attrs, y);
+  if (r < 0) {
+    if (r == -ETIMEDOUT) {
+      // the head object write may eventually succeed, keep our references.
+      // if it doesn't, they leak as if we'd crashed before that write
+      completed = true;
+    }
+    return r;
+  }
+  // on success, keep the references for the new head
+  completed = !obj_op.meta.canceled;
+  if (pcanceled) {
+    *pcanceled = obj_op.meta.canceled;
+  }
+  return 0;
+}
+
+
 int MultipartObjectProcessor::process_first_chunk(bufferlist&& data,
                                                   DataProcessor **processor)
 {
@@ -17,6 +17,8 @@
 
 #include <optional>
 
+#include "common/CDC.h"
+#include "rgw_aio.h"
 #include "rgw_putobj.h"
 #include "services/svc_rados.h"
 #include "services/svc_tier_rados.h"
@@ -197,6 +199,68 @@ class AtomicObjectProcessor : public ManifestObjectProcessor {
 };
 
 
+// a processor that cuts the object data into content-defined chunks and stores
+// each chunk once in the dedup chunk pool. a chunk that already exists only
+// gets another cls_cas reference, its data is sent only when that fails with
+// ENOENT. completes with an atomic write of the head object, which holds no
+// data and lists the chunks in its dedup manifest
+class DedupObjectProcessor : public rgw::sal::ObjectProcessor {
+  Aio *const aio;
+  rgw::sal::RadosStore* const store;
+  const rgw_user owner;
+  RGWObjectCtx& obj_ctx;
+  std::unique_ptr<rgw::sal::Object> head_obj;
+  const std::optional<uint64_t> olh_epoch;
+  const std::string unique_tag;
+  const DoutPrefixProvider *dpp;
+  optional_yield y;
+
+  std::unique_ptr<CDC> cdc;
+  uint64_t max_chunk_size = 0;
+  RGWSI_RADOS::Pool chunk_pool;
+  RGWObjDedupManifest manifest;
+  bufferlist pending; // data that isn't cut into chunks yet
+  // chunk data held until the reference on an existing chunk is confirmed,
+  // by chunk index
+  std::map<uint64_t, bufferlist> checking;
+  // indices of the chunks we hold a reference on, dropped unless we complete
+  std::vector<uint64_t> referenced;
+  bool completed = false;
+
+  int add_chunk(bufferlist&& data);
+  AioResultList submit(uint64_t index, librados::ObjectWriteOperation&& op,
+                       uint64_t cost);
+  // record the references we took and send the data of new chunks
+  int process_completed(AioResultList&& results, bool resubmit = true);
+ public:
+  DedupObjectProcessor(Aio *aio, rgw::sal::RadosStore* store,
+                       const rgw_user& owner, RGWObjectCtx& obj_ctx,
+                       std::unique_ptr<rgw::sal::Object> _head_obj,
+                       std::optional<uint64_t> olh_epoch,
+                       const std::string& unique_tag,
+                       const DoutPrefixProvider *dpp, optional_yield y)
+    : aio(aio), store(store), owner(owner), obj_ctx(obj_ctx),
+      head_obj(std::move(_head_obj)), olh_epoch(olh_epoch),
+      unique_tag(unique_tag), dpp(dpp), y(y)
+  {}
+  ~DedupObjectProcessor();
+
+  // set up the chunker and open the chunk pool
+  int prepare(optional_yield y) override;
+  // buffer the data and store every chunk whose end is known
+  int process(bufferlist&& data, uint64_t offset) override;
+  // write the head object atomically in a bucket index transaction
+  int complete(size_t accounted_size, const std::string& etag,
+               ceph::real_time *mtime, ceph::real_time set_mtime,
+               std::map<std::string, bufferlist>& attrs,
+               ceph::real_time delete_at,
+               const char *if_match, const char *if_nomatch,
+               const std::string *user_data,
+               rgw_zone_set *zones_trace, bool *canceled,
+               optional_yield y) override;
+};
+
+
 // a processor for multipart parts, which don't require atomic completion. the
 // part's head is written with an exclusive create to detect racing uploads of
 // the same part/upload id, which are restarted with a random oid prefix
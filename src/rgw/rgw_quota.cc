@@ -83,7 +83,7 @@ public:
   }
 
   int get_stats(const rgw_user& user, const rgw_bucket& bucket, RGWStorageStats& stats, optional_yield y,
-                const DoutPrefixProvider* dpp);
+                const DoutPrefixProvider* dpp, bool *stale = nullptr);
   void adjust_stats(const rgw_user& user, rgw_bucket& bucket, int objs_delta, uint64_t added_bytes, uint64_t removed_bytes);
 
   void set_stats(const rgw_user& user, const rgw_bucket& bucket, RGWQuotaCacheStats& qs, RGWStorageStats& stats);
@@ -166,9 +166,12 @@ void RGWQuotaCache<T>::set_stats(const rgw_user& user, const rgw_bucket& bucket,
 }
 
 template<class T>
-int RGWQuotaCache<T>::get_stats(const rgw_user& user, const rgw_bucket& bucket, RGWStorageStats& stats, optional_yield y, const DoutPrefixProvider* dpp) {
+int RGWQuotaCache<T>::get_stats(const rgw_user& user, const rgw_bucket& bucket, RGWStorageStats& stats, optional_yield y, const DoutPrefixProvider* dpp, bool *stale) {
   RGWQuotaCacheStats qs;
   utime_t now = ceph_clock_now();
+  if (stale) {
+    *stale = false;
+  }
   if (map_find(user, bucket, qs)) {
     if (qs.async_refresh_time.sec() > 0 && now >= qs.async_refresh_time) {
       int r = async_refresh(user, bucket, qs);
@@ -183,6 +186,25 @@ int RGWQuotaCache<T>::get_stats(const rgw_user& user, const rgw_bucket& bucket,
       stats = qs.stats;
       return 0;
     }
+
+    /*
+     * the caller can take expired stats, for up to another ttl, instead of
+     * waiting for them to be read. local changes were applied to them
+     * all along, so they only miss what other gateways wrote since
+     */
+    utime_t stale_expiration = qs.expiration;
+    stale_expiration += store->ctx()->_conf->rgw_bucket_quota_ttl;
+    if (stale && stale_expiration > ceph_clock_now()) {
+      if (qs.async_refresh_time.sec() > 0) {
+        int r = async_refresh(user, bucket, qs);
+        if (r < 0) {
+          ldpp_dout(dpp, 0) << "ERROR: quota async refresh returned ret=" << r << dendl;
+        }
+      }
+      *stale = true;
+      stats = qs.stats;
+      return 0;
+    }
   }
 
   int ret = fetch_stats_from_storage(user, bucket, stats, y, dpp);
@@ -907,6 +929,60 @@ class RGWQuotaHandlerImpl : public RGWQuotaHandler {
                             << " stats.size=" << stats.size << dendl;
     return 0;
   }
+
+  /*
+   * whether adding num_objs objects of the given size still leaves the
+   * given fraction of each limit unused. stale stats are only trusted
+   * that far from the limits
+   */
+  static bool has_headroom(const RGWQuotaInfo& quota,
+                           const RGWStorageStats& stats,
+                           const uint64_t num_objs,
+                           const uint64_t size,
+                           const double ratio) {
+    if (quota.max_objects >= 0 &&
+        stats.num_objects + num_objs + ratio * quota.max_objects > quota.max_objects) {
+      return false;
+    }
+    if (quota.max_size >= 0) {
+      const uint64_t cur_size = quota.check_on_raw ? stats.size : stats.size_rounded;
+      const uint64_t new_size = quota.check_on_raw ? size : rgw_rounded_objsize(size);
+      if (cur_size + new_size + ratio * quota.max_size > quota.max_size) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /*
+   * get the stats to check the quota against. with rgw_quota_stale_headroom
+   * set, expired stats are used while they are refreshed in the background,
+   * as long as the request leaves that much of the quota unused. closer to
+   * the limit, the stats are read before the quota is checked
+   */
+  template<class T>
+  int get_quota_stats(RGWQuotaCache<T>& cache,
+                      const rgw_user& user,
+                      const rgw_bucket& bucket,
+                      const RGWQuotaInfo& quota,
+                      const uint64_t num_objs,
+                      const uint64_t size,
+                      RGWStorageStats& stats,
+                      optional_yield y,
+                      const DoutPrefixProvider *dpp) {
+    const double ratio = store->ctx()->_conf->rgw_quota_stale_headroom;
+    bool stale = false;
+    int ret = cache.get_stats(user, bucket, stats, y, dpp, ratio > 0 ? &stale : nullptr);
+    if (ret < 0 || !stale) {
+      return ret;
+    }
+    if (has_headroom(quota, stats, num_objs, size, ratio)) {
+      ldpp_dout(dpp, 20) << "using expired quota stats: stats.num_objects=" << stats.num_objects
+                         << " stats.size=" << stats.size << dendl;
+      return 0;
+    }
+    return cache.get_stats(user, bucket, stats, y, dpp);
+  }
 public:
   RGWQuotaHandlerImpl(const DoutPrefixProvider *dpp, rgw::sal::Store* _store, bool quota_threads) : store(_store),
                                     bucket_stats_cache(_store),
@@ -933,7 +1009,8 @@ public:
     const DoutPrefix dp(store->ctx(), dout_subsys, "rgw quota handler: ");
     if (quota.bucket_quota.enabled) {
       RGWStorageStats bucket_stats;
-      int ret = bucket_stats_cache.get_stats(user, bucket, bucket_stats, y, &dp);
+      int ret = get_quota_stats(bucket_stats_cache, user, bucket, quota.bucket_quota,
+                                num_objs, size, bucket_stats, y, &dp);
       if (ret < 0) {
         return ret;
       }
@@ -945,7 +1022,8 @@ public:
 
     if (quota.user_quota.enabled) {
       RGWStorageStats user_stats;
-      int ret = user_stats_cache.get_stats(user, bucket, user_stats, y, &dp);
+      int ret = get_quota_stats(user_stats_cache, user, bucket, quota.user_quota,
+                                num_objs, size, user_stats, y, &dp);
       if (ret < 0) {
         return ret;
       }
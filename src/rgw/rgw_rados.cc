@@ -21,6 +21,7 @@
 #include "common/Formatter.h"
 #include "common/Throttle.h"
 #include "common/BackTrace.h"
+#include "common/lru_map.h"
 
 #include "rgw_sal.h"
 #include "rgw_zone.h"
@@ -39,6 +40,7 @@
 #include "cls/rgw/cls_rgw_client.h"
 #include "cls/rgw/cls_rgw_const.h"
 #include "cls/refcount/cls_refcount_client.h"
+#include "cls/cas/cls_cas_client.h"
 #include "cls/version/cls_version_client.h"
 #include "osd/osd_types.h"
 
@@ -49,6 +51,7 @@
 #include "rgw_worker.h"
 #include "rgw_notify.h"
 #include "rgw_http_errors.h"
+#include "rgw_perf_counters.h"
 
 #undef fork // fails to compile RGWPeriod::fork() below
 
@@ -62,6 +65,7 @@
 #include <map>
 #include "include/random.h"
 
+#include "rgw_bucket_list_merge.h"
 #include "rgw_gc.h"
 #include "rgw_lc.h"
 
@@ -801,6 +805,65 @@ struct complete_op_data {
   }
 };
 
+// complete ops sent together to one bucket index shard object
+struct complete_batch_state;
+struct complete_batch_data {
+  std::shared_ptr<complete_batch_state> state;
+  RGWSI_RADOS::Obj obj;
+  std::vector<std::unique_ptr<complete_op_data>> entries;
+};
+
+// complete ops waiting for an earlier batch to the same index shard
+// object to finish
+struct complete_batch_queue {
+  RGWSI_RADOS::Obj obj;
+  std::vector<std::unique_ptr<complete_op_data>> queued;
+  std::set<std::string> names; // of the queued entries
+  uint32_t inflight = 0;
+};
+
+// shared with the callbacks of the batches in flight, which can run
+// after the manager is gone
+struct complete_batch_state {
+  ceph::mutex lock = ceph::make_mutex("complete_batch_state");
+  ceph::condition_variable cond; // signaled when draining empties shards
+  RGWIndexCompletionManager* manager = nullptr;
+  bool draining = false; // no new batches, shutdown waits for shards
+  bool stopped = false;
+  std::map<rgw_raw_obj, complete_batch_queue> shards; // with one in flight
+};
+
+static void prepare_complete_batch(librados::ObjectWriteOperation& o,
+                                   complete_batch_data& b)
+{
+  cls_rgw_guard_bucket_resharding(o, -ERR_BUSY_RESHARDING);
+  if (b.entries.size() == 1) {
+    // understood by any osd
+    auto& c = b.entries.front();
+    cls_rgw_bucket_complete_op(o, c->op, c->tag, c->ver, c->key, c->dir_meta, &c->remove_objs,
+                               c->log_op, c->bilog_op, &c->zones_trace);
+  } else {
+    std::vector<rgw_cls_obj_complete_op> ops;
+    ops.reserve(b.entries.size());
+    for (auto& c : b.entries) {
+      auto& call = ops.emplace_back();
+      call.op = c->op;
+      call.tag = c->tag;
+      call.key = c->key;
+      call.ver = c->ver;
+      call.meta = c->dir_meta;
+      call.log_op = c->log_op;
+      call.bilog_flags = c->bilog_op;
+      call.remove_objs = c->remove_objs;
+      call.zones_trace = c->zones_trace;
+    }
+    cls_rgw_bucket_complete_ops(o, std::move(ops));
+  }
+  if (perfcounter) {
+    perfcounter->inc(l_rgw_bi_complete_batch, b.entries.size());
+  }
+}
+
 class RGWIndexCompletionManager {
   RGWRados* const store;
   const uint32_t num_shards;
@@ -818,13 +881,46 @@ class RGWIndexCompletionManager {
   // around back to 0 without issue
   std::atomic<uint32_t> cur_shard {0};
 
+  // complete ops to the same index shard object are coalesced: while
+  // one is in flight, the ones that follow are queued and sent together
+  // as soon as it finishes
+  const uint32_t max_batch;
+  std::atomic<bool> batch_supported{true};
+  std::shared_ptr<complete_batch_state> batch_state;
+
   void process();
   
   void add_completion(complete_op_data *completion);
-  
+
+  complete_op_data* new_entry(const rgw_obj& obj,
+                              RGWModifyOp op, string& tag,
+                              rgw_bucket_entry_ver& ver,
+                              const cls_rgw_obj_key& key,
+                              rgw_bucket_dir_entry_meta& dir_meta,
+                              list<cls_rgw_obj_key> *remove_objs, bool log_op,
+                              uint16_t bilog_op,
+                              rgw_zone_set *zones_trace);
+
+  std::unique_ptr<complete_batch_data> take_batch(complete_batch_queue& q);
+  // hands the ops of a batch that wasn't applied to the retry thread
+  void handle_batch_result(complete_batch_data& b, int r);
+
   void stop() {
+    // the batches in flight finish, and send what is queued behind them
+    // in order as they do; their failures go to the retry thread, which
+    // is only stopped once they all have, and drains them before it exits
+    {
+      std::unique_lock l{batch_state->lock};
+      batch_state->draining = true;
+      batch_state->cond.wait(l, [this] { return batch_state->shards.empty(); });
+      batch_state->stopped = true;
+    }
+
     if (retry_thread.joinable()) {
-      _stop = true;
+      {
+        std::lock_guard l{retry_completions_lock};
+        _stop = true;
+      }
       cond.notify_all();
       retry_thread.join();
     }
@@ -853,8 +949,12 @@ public:
 				std::to_string(i));
       })},
     completions(num_shards),
-    retry_thread(&RGWIndexCompletionManager::process, this)
-    {}
+    retry_thread(&RGWIndexCompletionManager::process, this),
+    max_batch(store->ctx()->_conf->rgw_bucket_index_complete_batch_size),
+    batch_state(std::make_shared<complete_batch_state>())
+    {
+      batch_state->manager = this;
+    }
 
   ~RGWIndexCompletionManager() {
     stop();
@@ -872,6 +972,22 @@ public:
 
   bool handle_completion(completion_t cb, complete_op_data *arg);
 
+  /// queue a complete op to be sent with others to the index shard
+  /// object @p shard. returns false if it has to be sent on its own
+  bool batch_completion(RGWSI_RADOS::Obj& shard, const rgw_obj& obj,
+                        RGWModifyOp op, string& tag,
+                        rgw_bucket_entry_ver& ver,
+                        const cls_rgw_obj_key& key,
+                        rgw_bucket_dir_entry_meta& dir_meta,
+                        list<cls_rgw_obj_key> *remove_objs, bool log_op,
+                        uint16_t bilog_op,
+                        rgw_zone_set *zones_trace);
+
+  /// called with batch_state->lock held. returns the batch to send next
+  /// to the same shard, if any were queued
+  std::unique_ptr<complete_batch_data> handle_batch_completion(
+      std::unique_ptr<complete_batch_data> b, int r);
+
   CephContext* ctx() {
     return store->ctx();
   }
@@ -893,17 +1009,58 @@ static void obj_complete_cb(completion_t cb, void *arg)
   }
 }
 
+static void send_complete_batch(std::unique_ptr<complete_batch_data> b);
+
+static std::unique_ptr<complete_batch_data> finish_complete_batch(
+    std::unique_ptr<complete_batch_data> b, int r)
+{
+  auto state = b->state;
+  std::lock_guard l{state->lock};
+  if (state->stopped) {
+    return nullptr;
+  }
+  return state->manager->handle_batch_completion(std::move(b), r);
+}
+
+static void complete_batch_cb(completion_t cb, void *arg)
+{
+  auto b = std::unique_ptr<complete_batch_data>{
+    reinterpret_cast<complete_batch_data*>(arg)};
+  const int r = rados_aio_get_return_value(cb);
+  auto next = finish_complete_batch(std::move(b), r);
+  if (next) {
+    send_complete_batch(std::move(next));
+  }
+}
+
+static void send_complete_batch(std::unique_ptr<complete_batch_data> b)
+{
+  while (b) {
+    librados::ObjectWriteOperation o;
+    prepare_complete_batch(o, *b);
+
+    auto completion = librados::Rados::aio_create_completion(b.get(), complete_batch_cb);
+    const int r = b->obj.aio_operate(completion, &o);
+    completion->release();
+    if (r >= 0) {
+      b.release(); // owned by the callback
+      return;
+    }
+    b = finish_complete_batch(std::move(b), r);
+  }
+}
+
 void RGWIndexCompletionManager::process()
 {
   DoutPrefix dpp(store->ctx(), dout_subsys, "rgw index completion thread: ");
-  while(!_stop) {
+  for (;;) {
     std::vector<complete_op_data*> comps;
 
     {
       std::unique_lock l{retry_completions_lock};
       cond.wait(l, [this](){return _stop || !retry_completions.empty();});
-      if (_stop) {
-        return;
+      if (retry_completions.empty()) {
+        return; // stopped, and nothing left to retry
       }
       retry_completions.swap(comps);
     }
@@ -953,21 +1110,17 @@ void RGWIndexCompletionManager::process()
   }
 }
 
-void RGWIndexCompletionManager::create_completion(const rgw_obj& obj,
-                                                  RGWModifyOp op, string& tag,
-                                                  rgw_bucket_entry_ver& ver,
-                                                  const cls_rgw_obj_key& key,
-                                                  rgw_bucket_dir_entry_meta& dir_meta,
-                                                  list<cls_rgw_obj_key> *remove_objs, bool log_op,
-                                                  uint16_t bilog_op,
-                                                  rgw_zone_set *zones_trace,
-                                                  complete_op_data **result)
+complete_op_data* RGWIndexCompletionManager::new_entry(const rgw_obj& obj,
+                                                      RGWModifyOp op, string& tag,
+                                                      rgw_bucket_entry_ver& ver,
+                                                      const cls_rgw_obj_key& key,
+                                                      rgw_bucket_dir_entry_meta& dir_meta,
+                                                      list<cls_rgw_obj_key> *remove_objs, bool log_op,
+                                                      uint16_t bilog_op,
+                                                      rgw_zone_set *zones_trace)
 {
   complete_op_data *entry = new complete_op_data;
 
-  int shard_id = next_shard();
-
-  entry->manager_shard_id = shard_id;
   entry->manager = this;
   entry->obj = obj;
   entry->op = op;
@@ -989,6 +1142,25 @@ void RGWIndexCompletionManager::create_completion(const rgw_obj& obj,
   } else {
     entry->zones_trace.insert(store->svc.zone->get_zone().id, obj.bucket.get_key());
   }
+  return entry;
+}
+
+void RGWIndexCompletionManager::create_completion(const rgw_obj& obj,
+                                                  RGWModifyOp op, string& tag,
+                                                  rgw_bucket_entry_ver& ver,
+                                                  const cls_rgw_obj_key& key,
+                                                  rgw_bucket_dir_entry_meta& dir_meta,
+                                                  list<cls_rgw_obj_key> *remove_objs, bool log_op,
+                                                  uint16_t bilog_op,
+                                                  rgw_zone_set *zones_trace,
+                                                  complete_op_data **result)
+{
+  complete_op_data *entry = new_entry(obj, op, tag, ver, key, dir_meta, remove_objs,
+                                      log_op, bilog_op, zones_trace);
+
+  int shard_id = next_shard();
+
+  entry->manager_shard_id = shard_id;
 
   *result = entry;
 
@@ -999,6 +1171,106 @@ void RGWIndexCompletionManager::create_completion(const rgw_obj& obj,
   ceph_assert(ok);
 }
 
+std::unique_ptr<complete_batch_data> RGWIndexCompletionManager::take_batch(complete_batch_queue& q)
+{
+  auto b = std::make_unique<complete_batch_data>();
+  b->state = batch_state;
+  b->obj = q.obj;
+  b->entries.swap(q.queued);
+  q.names.clear();
+  ++q.inflight;
+  return b;
+}
+
+bool RGWIndexCompletionManager::batch_completion(RGWSI_RADOS::Obj& shard, const rgw_obj& obj,
+                                                 RGWModifyOp op, string& tag,
+                                                 rgw_bucket_entry_ver& ver,
+                                                 const cls_rgw_obj_key& key,
+                                                 rgw_bucket_dir_entry_meta& dir_meta,
+                                                 list<cls_rgw_obj_key> *remove_objs, bool log_op,
+                                                 uint16_t bilog_op,
+                                                 rgw_zone_set *zones_trace)
+{
+  // removals of multipart parts touch other entries of the shard, leave
+  // them on their own
+  if (max_batch < 2 || !batch_supported ||
+      (remove_objs && !remove_objs->empty())) {
+    return false;
+  }
+  auto entry = std::unique_ptr<complete_op_data>{
+    new_entry(obj, op, tag, ver, key, dir_meta, remove_objs, log_op, bilog_op, zones_trace)};
+
+  std::unique_ptr<complete_batch_data> send;
+  {
+    std::lock_guard l{batch_state->lock};
+    if (batch_state->draining) {
+      return false;
+    }
+    auto& q = batch_state->shards[shard.get_raw_obj()];
+    if (q.inflight == 0) {
+      // nothing to wait for
+      q.obj = shard;
+      q.queued.push_back(std::move(entry));
+      send = take_batch(q);
+    } else {
+      // a batch can't change the same entry twice. ops to one object are
+      // applied in the order they're sent, so sending the queue first
+      // keeps them in order
+      if (q.names.count(key.name) || q.queued.size() >= max_batch) {
+        send = take_batch(q);
+      }
+      q.names.insert(key.name);
+      q.queued.push_back(std::move(entry));
+    }
+  }
+  if (send) {
+    send_complete_batch(std::move(send));
+  }
+  return true;
+}
+
+std::unique_ptr<complete_batch_data> RGWIndexCompletionManager::handle_batch_completion(
+    std::unique_ptr<complete_batch_data> b, int r)
+{
+  std::unique_ptr<complete_batch_data> next;
+  auto q = batch_state->shards.find(b->obj.get_raw_obj());
+  if (q != batch_state->shards.end()) {
+    --q->second.inflight;
+    if (!q->second.queued.empty()) {
+      next = take_batch(q->second);
+    } else if (q->second.inflight == 0) {
+      batch_state->shards.erase(q);
+    }
+  }
+  // before shutdown can go on to stop the retry thread
+  handle_batch_result(*b, r);
+  if (batch_state->draining && batch_state->shards.empty()) {
+    batch_state->cond.notify_all();
+  }
+  return next;
+}
+
+void RGWIndexCompletionManager::handle_batch_result(complete_batch_data& b, int r)
+{
+  const size_t count = b.entries.size();
+  if (r == -EOPNOTSUPP && count > 1 && batch_supported.exchange(false)) {
+    ldout(ctx(), 0) << "WARNING: " << __func__ << "(): bucket index osds don't support "
+        "batched completions, sending them one at a time" << dendl;
+  }
+  if (r == -ERR_BUSY_RESHARDING || (r < 0 && count > 1)) {
+    // nothing in the batch was applied. retry the ops one at a time,
+    // once the reshard is done if there is one
+    for (auto& c : b.entries) {
+      add_completion(c.release());
+    }
+    ldout(ctx(), 20) << __func__ << "(): batch of " << count
+        << " completions failed with " << r << ", retrying them" << dendl;
+  } else {
+    ldout(ctx(), 20) << __func__ << "(): batch of " << count << " completions "
+        << (r == 0 ? "ok" : "failed with " + to_string(r)) << dendl;
+  }
+}
+
 void RGWIndexCompletionManager::add_completion(complete_op_data *completion) {
   {
     std::lock_guard l{retry_completions_lock};
@@ -1098,6 +1370,7 @@ void RGWRados::finalize()
 
   delete binfo_cache;
   delete obj_tombstone_cache;
+  delete bucket_list_cursors;
   if (d3n_data_cache)
     delete d3n_data_cache;
 
@@ -1349,6 +1622,11 @@ int RGWRados::init_complete(const DoutPrefixProvider *dpp)
     obj_tombstone_cache = new tombstone_cache_t(cct->_conf->rgw_obj_tombstone_cache_size);
   }
 
+  if (const auto n = cct->_conf.get_val<uint64_t>("rgw_bucket_list_cursor_cache_size");
+      n > 0) {
+    bucket_list_cursors = new bucket_list_cursor_cache_t(n);
+  }
+
   reshard_wait = std::make_shared<RGWReshardWait>();
 
   reshard = new RGWReshard(this->store);
@@ -3255,7 +3533,7 @@ int RGWRados::Object::Write::_do_write_meta(const DoutPrefixProvider *dpp,
   epoch = ioctx.get_last_version();
   poolid = ioctx.get_id();
 
-  r = target->complete_atomic_modification(dpp);
+  r = target->complete_atomic_modification(dpp, y);
   if (r < 0) {
     ldpp_dout(dpp, 0) << "ERROR: complete_atomic_modification returned r=" << r << dendl;
   }
@@ -3457,6 +3735,8 @@ public:
         manifest_bl = std::move(iter->second);
         src_attrs.erase(iter);
       }
+      // we write our own layout of the data
+      src_attrs.erase(RGW_ATTR_DEDUP_MANIFEST);
 
       // filter out olh attributes
       iter = src_attrs.lower_bound(RGW_ATTR_OLH_PREFIX);
@@ -4674,6 +4954,8 @@ int RGWRados::copy_obj_data(RGWObjectCtx& obj_ctx,
     accounted_size = compressed ? cs_info.orig_size : ofs;
   }
 
+  attrs.erase(RGW_ATTR_DEDUP_MANIFEST); // the copy is striped, not chunked
+
   return processor.complete(accounted_size, etag, mtime, set_mtime, attrs, delete_at,
                             nullptr, nullptr, nullptr, nullptr, nullptr, y);
 }
@@ -4923,9 +5205,41 @@ int RGWRados::bucket_suspended(const DoutPrefixProvider *dpp, rgw_bucket& bucket
   return 0;
 }
 
-int RGWRados::Object::complete_atomic_modification(const DoutPrefixProvider *dpp)
+// decode the dedup manifest of a chunked object, leaves it empty otherwise
+static int decode_dedup_manifest(const DoutPrefixProvider *dpp,
+                                 const RGWObjState& s,
+                                 std::optional<RGWObjDedupManifest>& manifest)
 {
-  if ((!manifest)|| state->keep_tail)
+  auto iter = s.attrset.find(RGW_ATTR_DEDUP_MANIFEST);
+  if (iter == s.attrset.end()) {
+    return 0;
+  }
+  try {
+    auto p = iter->second.cbegin();
+    decode(manifest.emplace(), p);
+  } catch (const buffer::error&) {
+    ldpp_dout(dpp, 0) << "ERROR: couldn't decode dedup manifest for " << s.obj << dendl;
+    return -EIO;
+  }
+  return 0;
+}
+
+int RGWRados::Object::complete_atomic_modification(const DoutPrefixProvider *dpp, optional_yield y)
+{
+  if (!manifest) {
+    std::optional<RGWObjDedupManifest> dedup;
+    int r = decode_dedup_manifest(dpp, *state, dedup);
+    if (r < 0) {
+      return r;
+    }
+    if (dedup && !state->keep_tail) {
+      // chunks are shared with other objects by content, there is no tail
+      // of our own to send to gc
+      store->put_dedup_chunk_refs(dpp, *dedup, y);
+    }
+    return 0;
+  }
+  if (state->keep_tail)
     return 0;
 
   cls_rgw_obj_chain chain;
@@ -5004,6 +5318,42 @@ void RGWRados::delete_objs_inline(const DoutPrefixProvider *dpp, cls_rgw_obj_cha
   }
 }
 
+void RGWRados::put_dedup_chunk_refs(const DoutPrefixProvider *dpp,
+                                    const RGWObjDedupManifest& manifest,
+                                    optional_yield y)
+{
+  auto pool = svc.rados->pool(manifest.pool);
+  int ret = pool.open(dpp, RGWSI_RADOS::OpenParams().set_create(false));
+  if (ret < 0) {
+    ldpp_dout(dpp, 0) << "ERROR: failed to open dedup chunk pool " << manifest.pool
+        << ", " << manifest.chunks.size() << " chunk references leaked" << dendl;
+    return;
+  }
+
+  const hobject_t source = manifest.get_ref_source();
+  auto aio = rgw::make_throttle(cct->_conf->rgw_max_copy_obj_concurrent_io, y);
+  rgw::AioResultList completed;
+  for (const auto& c : manifest.chunks) {
+    ObjectWriteOperation op;
+    cls_cas_chunk_put_ref(op, source);
+
+    static constexpr uint64_t cost = 1; // 1 throttle unit per request
+    static constexpr uint64_t id = 0; // ids unused
+    auto obj = svc.rados->obj(pool, c.get_oid());
+    rgw::AioResultList r = aio->get(obj, rgw::Aio::librados_op(std::move(op), y), cost, id);
+    completed.splice(completed.end(), r);
+  }
+  rgw::AioResultList r = aio->drain();
+  completed.splice(completed.end(), r);
+
+  for (const auto& e : completed) {
+    if (e.result < 0) {
+      ldpp_dout(dpp, 0) << "WARNING: failed to drop reference " << manifest.ref_tag
+          << " on dedup chunk " << e.obj.get_ref().obj << ", ret=" << e.result << dendl;
+    }
+  }
+}
+
 static void accumulate_raw_stats(const rgw_bucket_dir_header& header,
                                  map<RGWObjCategory, RGWStorageStats>& stats)
 {
@@ -5321,7 +5671,7 @@ int RGWRados::Object::Delete::delete_obj(optional_yield y, const DoutPrefixProvi
     }
     r = index_op.complete_del(dpp, poolid, ioctx.get_last_version(), state->mtime, params.remove_objs);
     
-    int ret = target->complete_atomic_modification(dpp);
+    int ret = target->complete_atomic_modification(dpp, y);
     if (ret < 0) {
       ldpp_dout(dpp, 0) << "ERROR: complete_atomic_modification returned ret=" << ret << dendl;
     }
@@ -5624,6 +5974,16 @@ int RGWRados::get_obj_state_impl(const DoutPrefixProvider *dpp, RGWObjectCtx *rc
       s->fake_tag = true;
     }
   }
+  std::optional<RGWObjDedupManifest> dedup;
+  r = decode_dedup_manifest(dpp, *s, dedup);
+  if (r < 0) {
+    return r;
+  }
+  if (dedup) {
+    s->size = dedup->obj_size;
+    if (!compressed)
+      s->accounted_size = s->size;
+  }
   map<string, bufferlist>::iterator aiter = s->attrset.find(RGW_ATTR_PG_VER);
   if (aiter != s->attrset.end()) {
     bufferlist& pg_ver_bl = aiter->second;
@@ -6420,7 +6780,22 @@ int RGWRados::Object::Read::read(int64_t ofs, int64_t end,
   else
     len = end - ofs + 1;
 
-  if (manifest && manifest->has_tail()) {
+  std::optional<RGWObjDedupManifest> dedup;
+  r = decode_dedup_manifest(dpp, *astate, dedup);
+  if (r < 0)
+    return r;
+
+  if (dedup) {
+    /* read from the chunk that holds ofs */
+    auto chunk = dedup->find(ofs);
+    if (chunk == dedup->chunks.end()) {
+      return 0;
+    }
+    read_obj = rgw_raw_obj(dedup->pool, chunk->get_oid());
+    len = std::min(len, chunk->len - (ofs - chunk->ofs));
+    read_ofs = ofs - chunk->ofs;
+    reading_from_head = false;
+  } else if (manifest && manifest->has_tail()) {
     /* now get the relevant object part */
     RGWObjManifest::obj_iterator iter = manifest->obj_find(dpp, ofs);
 
@@ -6507,6 +6882,20 @@ int RGWRados::Object::Read::read(int64_t ofs, int64_t end,
 }
 
 int get_obj_data::flush(rgw::AioResultList&& results) {
+  const auto now = ceph::mono_clock::now();
+  for (auto& e : results) {
+    auto i = inflight.find(e.id);
+    if (i != inflight.end()) {
+      const auto elapsed = now - i->second.issued;
+      window.read_complete(elapsed);
+      if (perfcounter) {
+        perfcounter->tinc(l_rgw_get_read_lat, elapsed);
+      }
+      pending -= i->second.len;
+      inflight.erase(i);
+    }
+  }
+
   int r = rgw::check_for_errors(results);
   if (r < 0) {
     return r;
@@ -6522,19 +6911,23 @@ int get_obj_data::flush(rgw::AioResultList&& results) {
 
     bl_list.push_back(bl);
     offset += bl.length();
+    const auto start = ceph::mono_clock::now();
     int r = client_cb->handle_data(bl, 0, bl.length());
     if (r < 0) {
       return r;
     }
+    window.client_drained(bl.length(), ceph::mono_clock::now() - start);
 
     if (rgwrados->get_use_datacache()) {
       const std::lock_guard l(d3n_get_data.d3n_lock);
       auto oid = completed.front().obj.get_ref().obj.oid;
-      if (bl.length() <= g_conf()->rgw_get_obj_max_req_size && !d3n_bypass_cache_write) {
+      const bool bypass = d3n_bypass_ids.erase(completed.front().id) > 0 ||
+                          d3n_bypass_cache_write;
+      if (bl.length() <= g_conf()->rgw_get_obj_max_req_size && !bypass) {
         lsubdout(g_ceph_context, rgw_datacache, 10) << "D3nDataCache: " << __func__ << "(): bl.length <= rgw_get_obj_max_req_size (default 4MB) - write to datacache, bl.length=" << bl.length() << dendl;
         rgwrados->d3n_data_cache->put(bl, bl.length(), oid);
       } else {
-        lsubdout(g_ceph_context, rgw_datacache, 10) << "D3nDataCache: " << __func__ << "(): not writing to datacache - bl.length > rgw_get_obj_max_req_size (default 4MB), bl.length=" << bl.length() << " or d3n_bypass_cache_write=" << d3n_bypass_cache_write << dendl;
+        lsubdout(g_ceph_context, rgw_datacache, 10) << "D3nDataCache: " << __func__ << "(): not writing to datacache - bl.length > rgw_get_obj_max_req_size (default 4MB), bl.length=" << bl.length() << " or bypass=" << bypass << dendl;
       }
     }
     completed.pop_front_and_dispose(std::default_delete<rgw::AioResultEntry>{});
@@ -6542,6 +6935,26 @@ int get_obj_data::flush(rgw::AioResultList&& results) {
   return 0;
 }
 
+int get_obj_data::read(const RGWSI_RADOS::Obj& obj, rgw::Aio::OpFunc&& op,
+                       uint64_t len, uint64_t id)
+{
+  // the reads in flight keep going while earlier data is written to the
+  // client, so waiting here is what bounds the read-ahead
+  while (pending > 0 && pending + len > window.size()) {
+    auto c = aio->wait();
+    if (c.empty()) {
+      break;
+    }
+    int r = flush(std::move(c));
+    if (r < 0) {
+      return r;
+    }
+  }
+  inflight[id] = Inflight{len, ceph::mono_clock::now()};
+  pending += len;
+  return flush(aio->get(obj, std::move(op), len, id));
+}
+
 static int _get_obj_iterate_cb(const DoutPrefixProvider *dpp,
                                const rgw_raw_obj& read_obj, off_t obj_ofs,
                                off_t read_ofs, off_t len, bool is_head_obj,
@@ -6594,12 +7007,9 @@ int RGWRados::get_obj_iterate_cb(const DoutPrefixProvider *dpp,
   ldpp_dout(dpp, 20) << "rados->get_obj_iterate_cb oid=" << read_obj.oid << " obj-ofs=" << obj_ofs << " read_ofs=" << read_ofs << " len=" << len << dendl;
   op.read(read_ofs, len, nullptr, nullptr);
 
-  const uint64_t cost = len;
   const uint64_t id = obj_ofs; // use logical object offset for sorting replies
 
-  auto completed = d->aio->get(obj, rgw::Aio::librados_op(std::move(op), d->yield), cost, id);
-
-  return d->flush(std::move(completed));
+  return d->read(obj, rgw::Aio::librados_op(std::move(op), d->yield), len, id);
 }
 
 int RGWRados::Object::Read::iterate(const DoutPrefixProvider *dpp, int64_t ofs, int64_t end, RGWGetDataCB *cb,
@@ -6609,9 +7019,14 @@ int RGWRados::Object::Read::iterate(const DoutPrefixProvider *dpp, int64_t ofs,
   CephContext *cct = store->ctx();
   const uint64_t chunk_size = cct->_conf->rgw_get_obj_max_req_size;
   const uint64_t window_size = cct->_conf->rgw_get_obj_window_size;
+  const uint64_t max_window_size = std::max<uint64_t>(window_size,
+      cct->_conf->rgw_get_obj_window_max_size);
 
-  auto aio = rgw::make_throttle(window_size, y);
-  get_obj_data data(store, cb, &*aio, ofs, y);
+  // get_obj_data keeps the reads within its adaptive window, which is
+  // never larger than the throttle's
+  auto aio = rgw::make_throttle(max_window_size, y);
+  get_obj_data data(store, cb, &*aio, ofs, y,
+                    rgw::ReadWindow{window_size, max_window_size, chunk_size});
 
   int r = store->iterate_obj(dpp, source->get_ctx(), source->get_bucket_info(),
 			     source->get_target(),
@@ -6650,7 +7065,38 @@ int RGWRados::iterate_obj(const DoutPrefixProvider *dpp, RGWObjectCtx& obj_ctx,
   else
     len = end - ofs + 1;
 
-  if (manifest) {
+  std::optional<RGWObjDedupManifest> dedup;
+  r = decode_dedup_manifest(dpp, *astate, dedup);
+  if (r < 0) {
+    return r;
+  }
+
+  if (dedup) {
+    /* read each chunk that overlaps the range from the chunk pool */
+    auto chunk = dedup->find(ofs);
+
+    for (; chunk != dedup->chunks.end() && ofs <= end; ++chunk) {
+      read_obj = rgw_raw_obj(dedup->pool, chunk->get_oid());
+      off_t next_chunk_ofs = chunk->ofs + chunk->len;
+
+      while (ofs < next_chunk_ofs && ofs <= end) {
+        uint64_t read_len = std::min<uint64_t>(len, next_chunk_ofs - ofs);
+        read_ofs = ofs - chunk->ofs;
+
+        if (read_len > max_chunk_size) {
+          read_len = max_chunk_size;
+        }
+
+        r = cb(dpp, read_obj, ofs, read_ofs, read_len, false, astate, arg);
+        if (r < 0) {
+          return r;
+        }
+
+        len -= read_len;
+        ofs += read_len;
+      }
+    }
+  } else if (manifest) {
     /* now get the relevant object stripe */
     RGWObjManifest::obj_iterator iter = manifest->obj_find(dpp, ofs);
 
@@ -6916,7 +7362,10 @@ int RGWRados::block_while_resharding(RGWRados::BucketShard *bs,
       return ret;
     }
 
-    if (!entry.resharding_in_progress()) {
+    // the guard also blocks a logrecord phase whose reshard stopped
+    // extending it, so that it gets cleared here
+    if (!entry.resharding_in_progress() &&
+        !entry.resharding_in_logrecord()) {
       return fetch_new_bucket_info("get_bucket_resharding_succeeded");
     }
 
@@ -6944,6 +7393,15 @@ int RGWRados::block_while_resharding(RGWRados::BucketShard *bs,
 	ldpp_dout(dpp, 20) << __func__ <<
 	  " ERROR: failed to take reshard lock for bucket " <<
 	  bucket_id << "; expected if resharding underway" << dendl;
+	if (entry.resharding_in_logrecord()) {
+	  // the reshard still holds its lock, and extends the logrecord
+	  // phase along with it; give it a chance to, then retry the op
+	  ret = reshard_wait->wait(y);
+	  if (ret < 0) {
+	    return ret;
+	  }
+	  return -ERR_BUSY_RESHARDING;
+	}
       } else {
 	ldpp_dout(dpp, 10) << __func__ <<
 	  " INFO: was able to take reshard lock for bucket " <<
@@ -8466,6 +8924,12 @@ int RGWRados::cls_obj_complete_op(BucketShard& bs, const rgw_obj& obj, RGWModify
   ver.pool = pool;
   ver.epoch = epoch;
   cls_rgw_obj_key key(ent.key.name, ent.key.instance);
+  if (index_completion_manager->batch_completion(bs.bucket_obj, obj, op, tag, ver, key, dir_meta,
+                                                 remove_objs, svc.zone->get_zone().log_data,
+                                                 bilog_flags, &zones_trace)) {
+    ldout_bitx_c(bitx, cct, 10) << "EXITING " << __func__ << ": batched" << dendl_bitx;
+    return 0;
+  }
   cls_rgw_guard_bucket_resharding(o, -ERR_BUSY_RESHARDING);
   cls_rgw_bucket_complete_op(o, op, tag, ver, key, dir_meta, remove_objs,
                              svc.zone->get_zone().log_data, bilog_flags, &zones_trace);
@@ -8527,6 +8991,12 @@ int RGWRados::cls_obj_set_bucket_tag_timeout(const DoutPrefixProvider *dpp, RGWB
   return CLSRGWIssueSetTagTimeout(index_pool.ioctx(), bucket_objs, cct->_conf->rgw_bucket_index_max_aio, timeout)();
 }
 
+// what an ordered listing read from each shard, kept so that a listing
+// that continues where it stopped can resume without reading it again
+struct bucket_list_cursor {
+  ceph::coarse_mono_time stamp;
+  std::map<int, rgw::bucket_list::ShardRead> shards;
+};
 
 uint32_t RGWRados::calc_ordered_bucket_list_per_shard(uint32_t num_entries,
 						      uint32_t num_shards)
@@ -8626,119 +9096,119 @@ int RGWRados::cls_bucket_list_ordered(const DoutPrefixProvider *dpp,
     num_entries_per_shard = num_entries;
   }
 
+  auto& ioctx = index_pool.ioctx();
+  const uint32_t max_aio = cct->_conf->rgw_bucket_index_max_aio;
+  constexpr uint32_t min_refill = 8;
+
+  // listings that continue where an earlier one stopped can reuse the
+  // per-shard results it read but did not consume
+  const bool use_cursor_cache = bucket_list_cursors != nullptr;
+  std::string cursor_key;
+  std::shared_ptr<bucket_list_cursor> saved;
+  if (use_cursor_cache) {
+    cursor_key = bucket_info.bucket.get_key();
+    cursor_key.append(1, '\0').append(std::to_string(idx_layout.gen));
+    cursor_key.append(1, '\0').append(std::to_string(shard_id));
+    cursor_key.append(1, '\0').append(prefix);
+    cursor_key.append(1, '\0').append(delimiter);
+    cursor_key.append(1, '\0').append(list_versions ? "v" : "");
+    if (bucket_list_cursors->find(cursor_key, saved)) {
+      bucket_list_cursors->erase(cursor_key);
+      const auto ttl = ceph::make_timespan(
+	cct->_conf.get_val<double>("rgw_bucket_list_cursor_cache_ttl"));
+      if (ceph::coarse_mono_clock::now() - saved->stamp > ttl) {
+	saved.reset();
+      }
+    }
+  }
+
+  // one tracker per shard requested (may not be all shards)
+  rgw::bucket_list::OrderedMerge merge(shard_oids.size());
+  std::map<int, std::string> read_oids;
+  uint32_t reused = 0;
+  for (auto& [shard, oid] : shard_oids) {
+    auto& t = merge.add(shard, oid);
+    if (saved) {
+      auto s = saved->shards.find(shard);
+      if (s != saved->shards.end() &&
+	  t.resume(s->second, start_after, list_versions)) {
+	++reused;
+	continue;
+      }
+    }
+    read_oids[shard] = oid;
+  }
+  saved.reset();
+
   ldpp_dout(dpp, 10) << __func__ <<
-    ": request from each of " << shard_count <<
+    ": request from each of " << read_oids.size() << " of " << shard_count <<
     " shard(s) for " << num_entries_per_shard << " entries to get " <<
-    num_entries << " total entries" << dendl;
+    num_entries << " total entries; " << reused <<
+    " shard(s) resumed from a previous listing" << dendl;
 
-  auto& ioctx = index_pool.ioctx();
-  std::map<int, rgw_cls_list_ret> shard_list_results;
   cls_rgw_obj_key start_after_key(start_after.name, start_after.instance);
-  r = CLSRGWIssueBucketList(ioctx, start_after_key, prefix, delimiter,
-			    num_entries_per_shard,
-			    list_versions, shard_oids, shard_list_results,
-			    cct->_conf->rgw_bucket_index_max_aio)();
-  if (r < 0) {
-    ldpp_dout(dpp, 0) << __func__ <<
-      ": CLSRGWIssueBucketList for " << bucket_info.bucket <<
-      " failed" << dendl;
-    return r;
+  if (!read_oids.empty()) {
+    std::map<int, rgw_cls_list_ret> shard_list_results;
+    r = CLSRGWIssueBucketList(ioctx, start_after_key, prefix, delimiter,
+			      num_entries_per_shard,
+			      list_versions, read_oids, shard_list_results,
+			      max_aio)();
+    if (r < 0) {
+      ldpp_dout(dpp, 0) << __func__ <<
+	": CLSRGWIssueBucketList for " << bucket_info.bucket <<
+	" failed" << dendl;
+      return r;
+    }
+    for (auto& t : merge.shards()) {
+      auto i = shard_list_results.find(t.shard_idx);
+      if (i != shard_list_results.end()) {
+	t.reset(start_after, num_entries_per_shard, std::move(i->second));
+      }
+    }
   }
 
-  // to manage the iterators through each shard's list results
-  struct ShardTracker {
-    const size_t shard_idx;
-    rgw_cls_list_ret& result;
-    const std::string& oid_name;
-    RGWRados::ent_map_t::iterator cursor;
-    RGWRados::ent_map_t::iterator end;
-
-    // manages an iterator through a shard and provides other
-    // accessors
-    ShardTracker(size_t _shard_idx,
-		 rgw_cls_list_ret& _result,
-		 const std::string& _oid_name):
-      shard_idx(_shard_idx),
-      result(_result),
-      oid_name(_oid_name),
-      cursor(_result.dir.m.begin()),
-      end(_result.dir.m.end())
-    {}
-
-    inline const std::string& entry_name() const {
-      return cursor->first;
-    }
-    rgw_bucket_dir_entry& dir_entry() const {
-      return cursor->second;
-    }
-    inline bool is_truncated() const {
-      return result.is_truncated;
-    }
-    inline ShardTracker& advance() {
-      ++cursor;
-      // return a self-reference to allow for chaining of calls, such
-      // as x.advance().at_end()
-      return *this;
-    }
-    inline bool at_end() const {
-      return cursor == end;
-    }
-  }; // ShardTracker
-
-  // add the next unique candidate, or return false if we reach the end
-  auto next_candidate = [] (CephContext *cct, ShardTracker& t,
-                            std::multimap<std::string, size_t>& candidates,
-                            size_t tracker_idx) {
-    if (!t.at_end()) {
-      candidates.emplace(t.entry_name(), tracker_idx);
+  // read the next batch from a shard whose results we have consumed;
+  // each refill of a shard asks for twice as much as the last, so a
+  // listing dominated by a few shards only goes back to those
+  auto refill = [&](rgw::bucket_list::ShardTracker& t, uint32_t wanted,
+		    bool* stuck) -> int {
+    cls_rgw_obj_key after = t.read.result.marker;
+    if (after.empty() && !t.read.result.dir.m.empty()) {
+      after = t.read.result.dir.m.rbegin()->second.key;
     }
-    return;
+    if (after.empty() || after == t.read.start_after) {
+      *stuck = true; // an old osd that does not return a marker
+      return 0;
+    }
+    const uint32_t batch =
+      std::clamp(t.read.batch * 2, min_refill, std::max(wanted, min_refill));
+    std::map<int, std::string> oids{{t.shard_idx, t.oid_name}};
+    std::map<int, rgw_cls_list_ret> results;
+    int r = CLSRGWIssueBucketList(ioctx, after, prefix, delimiter, batch,
+				  list_versions, oids, results, 1)();
+    if (r < 0) {
+      ldpp_dout(dpp, 0) << __func__ <<
+	": CLSRGWIssueBucketList refill of shard " << t.shard_idx <<
+	" for " << bucket_info.bucket << " failed" << dendl;
+      return r;
+    }
+    ldpp_dout(dpp, 20) << __func__ << ": refilled shard " << t.shard_idx <<
+      " after " << after << " with " << results[t.shard_idx].dir.m.size() <<
+      " of " << batch << " entries" << dendl;
+    t.reset(after, batch, std::move(results[t.shard_idx]));
+    return 0;
   };
 
-  // one tracker per shard requested (may not be all shards)
-  std::vector<ShardTracker> results_trackers;
-  results_trackers.reserve(shard_list_results.size());
-  for (auto& r : shard_list_results) {
-    results_trackers.emplace_back(r.first, r.second, shard_oids[r.first]);
-
-    // if any *one* shard's result is trucated, the entire result is
-    // truncated
-    *is_truncated = *is_truncated || r.second.is_truncated;
-
-    // unless *all* are shards are cls_filtered, the entire result is
-    // not filtered
-    *cls_filtered = *cls_filtered && r.second.cls_filtered;
-  }
-
-  // create a map to track the next candidate entry from ShardTracker
-  // (key=candidate, value=index into results_trackers); as we consume
-  // entries from shards, we replace them with the next entries in the
-  // shards until we run out
-  std::multimap<std::string, size_t> candidates;
-  size_t tracker_idx = 0;
-  std::vector<size_t> vidx;
-  vidx.reserve(shard_list_results.size());
-  for (auto& t : results_trackers) {
-    // it's important that the values in the map refer to the index
-    // into the results_trackers vector, which may not be the same
-    // as the shard number (i.e., when not all shards are requested)
-    next_candidate(cct, t, candidates, tracker_idx);
-    ++tracker_idx;
-  }
-
-  rgw_bucket_dir_entry*
-    last_entry_visited = nullptr; // to set last_entry (marker)
+  merge.start();
+
+  std::optional<rgw_obj_index_key> last_entry_visited; // to set last_entry (marker)
   std::map<std::string, bufferlist> updates;
   uint32_t count = 0;
-  while (count < num_entries && !candidates.empty()) {
+  while (count < num_entries && !merge.empty()) {
     r = 0;
-    // select the next entry in lexical order (first key in map);
-    // again tracker_idx is not necessarily shard number, but is index
-    // into results_trackers vector
-    tracker_idx = candidates.begin()->second;
-    auto& tracker = results_trackers.at(tracker_idx);
+    auto& tracker = merge.top();
 
-    const std::string& name = tracker.entry_name();
+    const std::string name = tracker.entry_name();
     rgw_bucket_dir_entry& dirent = tracker.dir_entry();
 
     ldpp_dout(dpp, 20) << __func__ << ": currently processing " <<
@@ -8777,8 +9247,9 @@ int RGWRados::cls_bucket_list_ordered(const DoutPrefixProvider *dpp,
       ldpp_dout(dpp, 10) << __func__ << ": got " <<
 	dirent.key << dendl;
 
-      auto [it, inserted] = m.insert_or_assign(name, std::move(dirent));
-      last_entry_visited = &it->second;
+      // copy rather than move, so the shard results stay whole for the
+      // cursor cache
+      auto [it, inserted] = m.insert_or_assign(name, dirent);
       if (inserted) {
 	++count;
       } else {
@@ -8789,34 +9260,24 @@ int RGWRados::cls_bucket_list_ordered(const DoutPrefixProvider *dpp,
     } else {
       ldpp_dout(dpp, 10) << __func__ << ": skipping " <<
 	dirent.key.name << "[" << dirent.key.instance << "]" << dendl;
-      last_entry_visited = &tracker.dir_entry();
     }
+    last_entry_visited = dirent.key;
 
-    // refresh the candidates map
-    vidx.clear();
+    // advance every shard positioned at this name, reading more from
+    // those that run out while more is needed
     bool need_to_stop = false;
-    auto range = candidates.equal_range(name);
-    for (auto i = range.first; i != range.second; ++i) {
-      vidx.push_back(i->second);
-    } 
-    candidates.erase(range.first, range.second);
-    for (auto idx : vidx) {
-      auto& tracker_match = results_trackers.at(idx);
-      tracker_match.advance();
-      next_candidate(cct, tracker_match, candidates, idx);
-      if (tracker_match.at_end() && tracker_match.is_truncated()) {
-        need_to_stop = true;
-        break;
-      }
+    r = merge.advance(name, num_entries - count, refill, &need_to_stop);
+    if (r < 0) {
+      return r;
     }
-    if (need_to_stop) {
-      // once we exhaust one shard that is truncated, we need to stop,
-      // as we cannot be certain that one of the next entries needs to
-      // come from that shard; S3 and swift protocols allow returning
-      // fewer than what was requested
+    if (need_to_stop && count < num_entries) {
+      // we cannot be certain that one of the next entries does not
+      // need to come from a truncated shard we could not read further;
+      // S3 and swift protocols allow returning fewer than what was
+      // requested
       ldpp_dout(dpp, 10) << __func__ <<
 	": stopped accumulating results at count=" << count <<
-	", dirent=\"" << dirent.key <<
+	", dirent=\"" << name <<
 	"\", because its shard is truncated and exhausted" << dendl;
       break;
     }
@@ -8840,13 +9301,9 @@ int RGWRados::cls_bucket_list_ordered(const DoutPrefixProvider *dpp,
 
   // determine truncation by checking if all the returned entries are
   // consumed or not
-  *is_truncated = false;
-  for (const auto& t : results_trackers) {
-    if (!t.at_end() || t.is_truncated()) {
-      *is_truncated = true;
-      break;
-    }
-  }
+  *is_truncated = merge.is_truncated();
+  // including the shards that were refilled
+  *cls_filtered = *cls_filtered && merge.cls_filtered();
 
   ldpp_dout(dpp, 20) << __func__ <<
     ": returning, count=" << count << ", is_truncated=" << *is_truncated <<
@@ -8858,8 +9315,8 @@ int RGWRados::cls_bucket_list_ordered(const DoutPrefixProvider *dpp,
       count << ", which is truncated" << dendl;
   }
 
-  if (last_entry_visited != nullptr && last_entry) {
-    *last_entry = last_entry_visited->key;
+  if (last_entry_visited && last_entry) {
+    *last_entry = *last_entry_visited;
     ldpp_dout(dpp, 20) << __func__ <<
       ": returning, last_entry=" << *last_entry << dendl;
   } else {
@@ -8867,6 +9324,24 @@ int RGWRados::cls_bucket_list_ordered(const DoutPrefixProvider *dpp,
       ": returning, last_entry NOT SET" << dendl;
   }
 
+  // keep what we read for a listing that continues from here; skip
+  // very wide reads rather than pin a lot of memory
+  if (use_cursor_cache && *is_truncated) {
+    constexpr size_t max_cached_entries = 8192;
+    size_t entries = 0;
+    for (const auto& t : merge.shards()) {
+      entries += t.read.result.dir.m.size();
+    }
+    if (entries <= max_cached_entries) {
+      auto c = std::make_shared<bucket_list_cursor>();
+      c->stamp = ceph::coarse_mono_clock::now();
+      for (auto& t : merge.shards()) {
+	c->shards.emplace(t.shard_idx, std::move(t.read));
+      }
+      bucket_list_cursors->add(cursor_key, c);
+    }
+  }
+
   ldout_bitx(bitx, dpp, 10) << "EXITING " << __func__ << dendl_bitx;
   return 0;
 } // RGWRados::cls_bucket_list_ordered
@@ -31,6 +31,7 @@
 #include "rgw_service.h"
 #include "rgw_sal.h"
 #include "rgw_aio.h"
+#include "rgw_read_window.h"
 #include "rgw_d3n_cacherequest.h"
 
 #include "services/svc_rados.h"
@@ -325,6 +326,10 @@ template <class K, class V>
 class lru_map;
 using tombstone_cache_t = lru_map<rgw_obj, tombstone_entry>;
 
+struct bucket_list_cursor;
+using bucket_list_cursor_cache_t =
+  lru_map<std::string, std::shared_ptr<bucket_list_cursor>>;
+
 class RGWIndexCompletionManager;
 
 class RGWRados
@@ -425,6 +430,10 @@ protected:
 
   tombstone_cache_t *obj_tombstone_cache;
 
+  // per-shard results left over from ordered listings, so the next page
+  // does not have to read them again
+  bucket_list_cursor_cache_t *bucket_list_cursors = nullptr;
+
   librados::IoCtx gc_pool_ctx;        // .rgw.gc
   librados::IoCtx lc_pool_ctx;        // .rgw.lc
   librados::IoCtx objexp_pool_ctx;
@@ -681,7 +690,7 @@ public:
 
     int prepare_atomic_modification(const DoutPrefixProvider *dpp, librados::ObjectWriteOperation& op, bool reset_obj, const std::string *ptag,
                                     const char *ifmatch, const char *ifnomatch, bool removal_op, bool modify_tail, optional_yield y);
-    int complete_atomic_modification(const DoutPrefixProvider *dpp);
+    int complete_atomic_modification(const DoutPrefixProvider *dpp, optional_yield y);
 
   public:
     Object(RGWRados *_store, rgw::sal::Bucket* _bucket, RGWObjectCtx& _ctx, rgw::sal::Object* _obj) : store(_store), bucket(_bucket),
@@ -1470,6 +1479,8 @@ public:
   void update_gc_chain(const DoutPrefixProvider *dpp, rgw_obj head_obj, RGWObjManifest& manifest, cls_rgw_obj_chain *chain);
   std::tuple<int, std::optional<cls_rgw_obj_chain>> send_chain_to_gc(cls_rgw_obj_chain& chain, const std::string& tag);
   void delete_objs_inline(const DoutPrefixProvider *dpp, cls_rgw_obj_chain& chain, const std::string& tag);
+  // drop the object's cls_cas reference on each of its dedup chunks
+  void put_dedup_chunk_refs(const DoutPrefixProvider *dpp, const RGWObjDedupManifest& manifest, optional_yield y);
   int gc_operate(const DoutPrefixProvider *dpp, std::string& oid, librados::ObjectWriteOperation *op);
   int gc_aio_operate(const std::string& oid, librados::AioCompletion *c,
                      librados::ObjectWriteOperation *op);
@@ -1598,9 +1609,19 @@ struct get_obj_data {
   rgw::AioResultList completed; // completed read results, sorted by offset
   optional_yield yield;
 
+  rgw::ReadWindow window;
+  uint64_t pending = 0; // bytes of reads in flight
+  struct Inflight {
+    uint64_t len;
+    ceph::mono_time issued;
+  };
+  std::map<uint64_t, Inflight> inflight; // by result id
+
   get_obj_data(RGWRados* rgwrados, RGWGetDataCB* cb, rgw::Aio* aio,
-               uint64_t offset, optional_yield yield)
-               : rgwrados(rgwrados), client_cb(cb), aio(aio), offset(offset), yield(yield) {}
+               uint64_t offset, optional_yield yield,
+               const rgw::ReadWindow& window)
+               : rgwrados(rgwrados), client_cb(cb), aio(aio), offset(offset), yield(yield),
+                 window(window) {}
   ~get_obj_data() {
     if (rgwrados->get_use_datacache()) {
       const std::lock_guard l(d3n_get_data.d3n_lock);
@@ -1609,9 +1630,16 @@ struct get_obj_data {
 
   D3nGetObjData d3n_get_data;
   std::atomic_bool d3n_bypass_cache_write{false};
+  // ids of the reads that must not be written to the datacache
+  std::set<uint64_t> d3n_bypass_ids;
 
   int flush(rgw::AioResultList&& results);
 
+  // submit a read of @p len bytes once it fits in the read window, and
+  // flush whatever completed in the meantime
+  int read(const RGWSI_RADOS::Obj& obj, rgw::Aio::OpFunc&& op,
+           uint64_t len, uint64_t id);
+
   void cancel() {
     // wait for all completions to drain and ignore the results
     aio->drain();
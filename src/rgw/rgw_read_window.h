@@ -0,0 +1,82 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab ft=cpp
+
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+
+#include "common/ceph_time.h"
+
+namespace rgw {
+
+/*
+ * Sizes the read-ahead window of a GET, in bytes of RADOS reads kept in
+ * flight.
+ *
+ * To keep the client busy, the window has to hold what the client takes
+ * during one RADOS read: the client drain rate times the read latency.
+ * Both are tracked as moving averages, and the window is twice their
+ * product plus one read, bounded by [min, max]. A client that takes data
+ * faster than RADOS returns it opens the window up to max; a slow client
+ * closes it back to min, so that its GET doesn't hold on to memory.
+ */
+class ReadWindow {
+  static constexpr double weight = 0.125; // of each new sample
+
+  uint64_t min;
+  uint64_t max;
+  uint64_t chunk;
+  uint64_t window;
+  double latency = 0; // seconds
+  double rate = 0; // bytes per second
+
+  static double average(double avg, double sample) {
+    return avg == 0 ? sample : avg + weight * (sample - avg);
+  }
+  static double seconds(ceph::timespan t) {
+    // treat anything below a microsecond as one, so that an instant
+    // sample doesn't divide by zero
+    using namespace std::chrono_literals;
+    return std::chrono::duration<double>(std::max<ceph::timespan>(t, 1us)).count();
+  }
+
+  void update() {
+    if (latency == 0 || rate == 0) {
+      return;
+    }
+    const double target = 2 * rate * latency + chunk;
+    window = target >= max ? max : std::max<uint64_t>(target, min);
+  }
+
+public:
+  /// @p chunk is the size of a single read
+  ReadWindow(uint64_t min, uint64_t max, uint64_t chunk)
+    : min(min), max(std::max(min, max)), chunk(chunk), window(min) {}
+
+  uint64_t size() const { return window; }
+
+  /// a RADOS read completed after @p elapsed
+  void read_complete(ceph::timespan elapsed) {
+    latency = average(latency, seconds(elapsed));
+    update();
+  }
+
+  /// the client took @p bytes in @p elapsed
+  void client_drained(uint64_t bytes, ceph::timespan elapsed) {
+    rate = average(rate, bytes / seconds(elapsed));
+    update();
+  }
+};
+
+} // namespace rgw
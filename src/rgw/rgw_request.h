@@ -31,10 +31,10 @@ struct RGWRequest
 struct RGWLoadGenRequest : public RGWRequest {
 	std::string method;
 	std::string resource;
-	int content_length;
+	uint64_t content_length;
 	std::atomic<bool>* fail_flag = nullptr;
 
-RGWLoadGenRequest(uint64_t req_id, const std::string& _m, const std::string& _r, int _cl,
+RGWLoadGenRequest(uint64_t req_id, const std::string& _m, const std::string& _r, uint64_t _cl,
 		std::atomic<bool> *ff)
 	: RGWRequest(req_id), method(_m), resource(_r), content_length(_cl),
 		fail_flag(ff) {}
@@ -9,6 +9,7 @@
 #include "rgw_reshard.h"
 #include "rgw_sal.h"
 #include "rgw_sal_rados.h"
+#include "rgw_perf_counters.h"
 #include "cls/rgw/cls_rgw_client.h"
 #include "cls/lock/cls_lock_client.h"
 #include "common/errno.h"
@@ -30,6 +31,37 @@ const string reshard_oid_prefix = "reshard.";
 const string reshard_lock_name = "reshard_process";
 const string bucket_instance_lock_name = "bucket_instance_lock";
 
+// the progress of one reshard, registered while it runs so that
+// concurrent reshards don't overwrite each other's
+namespace reshard_counters {
+
+enum {
+  l_first = 806000,
+
+  l_source_shards,
+  l_source_shards_done,
+  l_entries,
+  l_replayed,
+
+  l_last,
+};
+
+static PerfCountersRef build(CephContext *cct, const std::string& name)
+{
+  PerfCountersBuilder b(cct, name, l_first, l_last);
+
+  b.add_u64(l_source_shards, "source_shards", "Index shards of the bucket being resharded");
+  b.add_u64(l_source_shards_done, "source_shards_done", "Index shards copied so far");
+  b.add_u64_counter(l_entries, "entries", "Index entries copied");
+  b.add_u64_counter(l_replayed, "replayed", "Objects copied again because they were modified");
+
+  auto logger = PerfCountersRef{ b.create_perf_counters(), cct };
+  cct->get_perfcounters_collection()->add(logger.get());
+  return logger;
+}
+
+} // namespace reshard_counters
+
 /* All primes up to 2000 used to attempt to make dynamic sharding use
  * a prime numbers of shards. Note: this list also includes 1 for when
  * 1 shard is the most appropriate, even though 1 is not prime.
@@ -179,6 +211,30 @@ public:
     }
     return ret;
   }
+
+  RGWRados::BucketShard& get_bucket_shard() {
+    return bs;
+  }
+
+  // write the current entries of an object copied earlier, removing any
+  // of its old entries that no longer exist; stats are adjusted by cls
+  int replace_entries(std::vector<rgw_cls_bi_entry>&& put,
+                      std::vector<std::string>&& remove) {
+    librados::ObjectWriteOperation op;
+    cls_rgw_bi_put_entries(op, std::move(put), std::move(remove), true);
+
+    librados::AioCompletion *c;
+    int ret = get_completion(&c);
+    if (ret < 0) {
+      return ret;
+    }
+    ret = bs.bucket_obj.aio_operate(c, &op);
+    if (ret < 0) {
+      derr << "ERROR: failed to replace entries in target bucket shard (bs=" << bs.bucket << "/" << bs.shard_id << ") error=" << cpp_strerror(-ret) << dendl;
+      return ret;
+    }
+    return 0;
+  }
 }; // class BucketReshardShard
 
 
@@ -225,6 +281,21 @@ public:
     return 0;
   }
 
+  BucketReshardShard& get_shard(int shard_index) {
+    return target_shards[shard_index];
+  }
+
+  int wait_all_aio() {
+    int ret = 0;
+    for (auto& shard : target_shards) {
+      int r = shard.wait_all_aio();
+      if (r < 0) {
+        ret = r;
+      }
+    }
+    return ret;
+  }
+
   int finish() {
     int ret = 0;
     for (auto& shard : target_shards) {
@@ -263,6 +334,12 @@ static int set_resharding_status(const DoutPrefixProvider *dpp,
 {
   cls_rgw_bucket_instance_entry instance_entry;
   instance_entry.set_status(status);
+  if (status == cls_rgw_reshard_status::IN_LOGRECORD) {
+    // expires with the reshard lock unless the reshard extends both
+    const auto duration = std::chrono::seconds(
+        store->ctx()->_conf.get_val<uint64_t>("rgw_reshard_bucket_lock_duration"));
+    instance_entry.logrecord_expire = ceph::real_clock::now() + duration;
+  }
 
   int ret = store->getRados()->bucket_set_reshard(dpp, bucket_info, instance_entry);
   if (ret < 0) {
@@ -497,11 +574,14 @@ static int revert_target_layout(rgw::sal::RadosStore* store,
   return 0;
 } // remove_target_layout
 
+// status is IN_PROGRESS to block writes for the whole reshard, or
+// IN_LOGRECORD to let them continue while the index is copied
 static int init_reshard(rgw::sal::RadosStore* store,
                         RGWBucketInfo& bucket_info,
 			std::map<std::string, bufferlist>& bucket_attrs,
                         ReshardFaultInjector& fault,
                         uint32_t new_num_shards,
+                        cls_rgw_reshard_status status,
                         const DoutPrefixProvider *dpp)
 {
   int ret = init_target_layout(store, bucket_info, bucket_attrs, fault, new_num_shards, dpp);
@@ -510,14 +590,13 @@ static int init_reshard(rgw::sal::RadosStore* store,
   }
 
   if (ret = fault.check("block_writes");
-      ret == 0) { // no fault injected, block writes to the current index shards
-    ret = set_resharding_status(dpp, store, bucket_info,
-                                cls_rgw_reshard_status::IN_PROGRESS);
+      ret == 0) { // no fault injected, block or record writes to the current index shards
+    ret = set_resharding_status(dpp, store, bucket_info, status);
   }
 
   if (ret < 0) {
-    ldpp_dout(dpp, 0) << "ERROR: " << __func__ << " failed to pause "
-        "writes to the current index: " << cpp_strerror(ret) << dendl;
+    ldpp_dout(dpp, 0) << "ERROR: " << __func__ << " failed to set "
+        "reshard status on the current index: " << cpp_strerror(ret) << dendl;
     // clean up the target layout (ignore errors)
     revert_target_layout(store, bucket_info, bucket_attrs, fault, dpp);
     return ret;
@@ -785,6 +864,212 @@ int RGWBucketReshardLock::renew(const Clock::time_point& now) {
 }
 
 
+// the shard of the target index that holds the entries of an object
+static int get_target_shard_index(rgw::sal::RadosStore* store,
+                                  const RGWBucketInfo& bucket_info,
+                                  const rgw::bucket_index_layout_generation& target,
+                                  const cls_rgw_obj_key& cls_key,
+                                  int* shard_index)
+{
+  rgw_obj_key key(cls_key);
+  rgw_obj obj(bucket_info.bucket, key);
+  RGWMPObj mp;
+  if (key.ns == RGW_OBJ_NS_MULTIPART && mp.from_meta(key.name)) {
+    // place the multipart .meta object on the same shard as its head object
+    obj.index_hash_source = mp.get_key();
+  }
+  int target_shard_id;
+  int ret = store->getRados()->get_target_shard_id(target.layout.normal,
+                                                   obj.get_hash_object(),
+                                                   &target_shard_id);
+  if (ret < 0) {
+    return ret;
+  }
+  *shard_index = (target_shard_id > 0 ? target_shard_id : 0);
+  return 0;
+}
+
+// list every entry of one object (plain, instance and olh) in a shard
+static int list_object_entries(rgw::sal::RadosStore* store,
+                               RGWRados::BucketShard& bs,
+                               const std::string& name, int max_entries,
+                               std::list<rgw_cls_bi_entry>* entries)
+{
+  std::string marker;
+  bool is_truncated = true;
+  while (is_truncated) {
+    std::list<rgw_cls_bi_entry> page;
+    int ret = store->getRados()->bi_list(bs, name, marker, max_entries,
+                                         &page, &is_truncated);
+    if (ret == -ENOENT) {
+      break;
+    } else if (ret < 0) {
+      return ret;
+    }
+    if (page.empty()) {
+      break;
+    }
+    marker = page.back().idx;
+    entries->splice(entries->end(), page);
+  }
+  return 0;
+}
+
+// copy the current entries of an object from a source shard to the
+// target index, replacing whatever an earlier copy left there
+static int replay_object(rgw::sal::RadosStore* store,
+                         const RGWBucketInfo& bucket_info,
+                         const rgw::bucket_index_layout_generation& target,
+                         RGWRados::BucketShard& source,
+                         BucketReshardManager& target_shards,
+                         const std::string& name, int max_entries,
+                         const DoutPrefixProvider* dpp)
+{
+  int shard_index;
+  int ret = get_target_shard_index(store, bucket_info, target,
+                                   cls_rgw_obj_key(name), &shard_index);
+  if (ret < 0) {
+    ldpp_dout(dpp, -1) << "ERROR: get_target_shard_id() returned ret=" << ret << dendl;
+    return ret;
+  }
+  auto& target_shard = target_shards.get_shard(shard_index);
+
+  std::list<rgw_cls_bi_entry> current;
+  ret = list_object_entries(store, source, name, max_entries, &current);
+  if (ret < 0) {
+    ldpp_dout(dpp, -1) << "ERROR: failed to list source entries for "
+        << name << ": " << cpp_strerror(-ret) << dendl;
+    return ret;
+  }
+  std::list<rgw_cls_bi_entry> copied;
+  ret = list_object_entries(store, target_shard.get_bucket_shard(), name,
+                            max_entries, &copied);
+  if (ret < 0) {
+    ldpp_dout(dpp, -1) << "ERROR: failed to list target entries for "
+        << name << ": " << cpp_strerror(-ret) << dendl;
+    return ret;
+  }
+
+  std::set<std::string> keep;
+  std::vector<rgw_cls_bi_entry> put;
+  put.reserve(current.size());
+  for (auto& entry : current) {
+    keep.insert(entry.idx);
+    put.push_back(std::move(entry));
+  }
+  std::vector<std::string> remove;
+  for (auto& entry : copied) {
+    if (!keep.count(entry.idx)) {
+      remove.push_back(std::move(entry.idx));
+    }
+  }
+  if (put.empty() && remove.empty()) {
+    return 0;
+  }
+  return target_shard.replace_entries(std::move(put), std::move(remove));
+}
+
+int RGWBucketReshard::renew_locks(const DoutPrefixProvider *dpp)
+{
+  Clock::time_point now = Clock::now();
+  if (!reshard_lock.should_renew(now)) {
+    return 0;
+  }
+  // assume outer locks have timespans at least the size of ours, so
+  // can call inside conditional
+  if (outer_reshard_lock) {
+    int ret = outer_reshard_lock->renew(now);
+    if (ret < 0) {
+      return ret;
+    }
+  }
+  int ret = reshard_lock.renew(now);
+  if (ret < 0) {
+    ldpp_dout(dpp, -1) << "Error renewing bucket lock: " << ret << dendl;
+    return ret;
+  }
+  if (in_logrecord) {
+    ret = set_resharding_status(dpp, store, bucket_info,
+                                cls_rgw_reshard_status::IN_LOGRECORD);
+    if (ret < 0) {
+      return ret;
+    }
+  }
+  return 0;
+}
+
+int RGWBucketReshard::replay_reshard_log(const rgw::bucket_index_layout_generation& current,
+                                         const rgw::bucket_index_layout_generation& target,
+                                         int max_entries,
+                                         uint64_t* count,
+                                         const DoutPrefixProvider *dpp)
+{
+  BucketReshardManager target_shards_mgr(dpp, store, bucket_info, target);
+
+  const int num_source_shards = current.layout.normal.num_shards;
+  for (int i = 0; i < num_source_shards; ++i) {
+    RGWRados::BucketShard bs(store->getRados());
+    int ret = bs.init(dpp, bucket_info, current, i);
+    if (ret < 0) {
+      ldpp_dout(dpp, -1) << "ERROR: bs.init() returned ret=" << ret << dendl;
+      return ret;
+    }
+    auto& ref = bs.bucket_obj.get_ref();
+
+    std::string marker;
+    bool is_truncated = true;
+    while (is_truncated) {
+      std::map<std::string, uint64_t> names;
+      ret = cls_rgw_reshard_log_list(ref.pool.ioctx(), ref.obj.oid, marker,
+                                     max_entries, &names, &is_truncated);
+      if (ret < 0) {
+        ldpp_dout(dpp, -1) << "ERROR: failed to list reshard log of shard "
+            << i << ": " << cpp_strerror(-ret) << dendl;
+        return ret;
+      }
+      if (names.empty()) {
+        break;
+      }
+      for (const auto& name : names) {
+        ret = replay_object(store, bucket_info, target, bs, target_shards_mgr,
+                            name.first, max_entries, dpp);
+        if (ret < 0) {
+          return ret;
+        }
+        ret = renew_locks(dpp);
+        if (ret < 0) {
+          return ret;
+        }
+      }
+      marker = names.rbegin()->first;
+      *count += names.size();
+      if (perfcounter) {
+        perfcounter->inc(l_rgw_reshard_replayed, names.size());
+      }
+      if (counters) {
+        counters->inc(reshard_counters::l_replayed, names.size());
+      }
+
+      // the copies must be durable before their records are dropped. a
+      // record is only dropped if its object was not modified again
+      ret = target_shards_mgr.wait_all_aio();
+      if (ret < 0) {
+        return ret;
+      }
+      librados::ObjectWriteOperation op;
+      cls_rgw_reshard_log_trim(op, std::move(names));
+      ret = bs.bucket_obj.operate(dpp, &op, null_yield);
+      if (ret < 0) {
+        ldpp_dout(dpp, -1) << "ERROR: failed to trim reshard log of shard "
+            << i << ": " << cpp_strerror(-ret) << dendl;
+        return ret;
+      }
+    }
+  }
+
+  return target_shards_mgr.finish();
+} // RGWBucketReshard::replay_reshard_log
+
 int RGWBucketReshard::do_reshard(const rgw::bucket_index_layout_generation& current,
                                  const rgw::bucket_index_layout_generation& target,
                                  int max_entries,
@@ -822,6 +1107,9 @@ int RGWBucketReshard::do_reshard(const rgw::bucket_index_layout_generation& curr
   }
 
   const int num_source_shards = current.layout.normal.num_shards;
+  if (counters) {
+    counters->set(reshard_counters::l_source_shards, num_source_shards);
+  }
   string marker;
   for (int i = 0; i < num_source_shards; ++i) {
     bool is_truncated = true;
@@ -848,7 +1136,6 @@ int RGWBucketReshard::do_reshard(const rgw::bucket_index_layout_generation& curr
 
 	marker = entry.idx;
 
-	int target_shard_id;
 	cls_rgw_obj_key cls_key;
 	RGWObjCategory category;
 	rgw_bucket_category_stats stats;
@@ -861,42 +1148,23 @@ int RGWBucketReshard::do_reshard(const rgw::bucket_index_layout_generation& curr
 	  ldpp_dout(dpp, 10) << "Dropping entry with empty name, idx=" << marker << dendl;
 	  continue;
 	}
-	rgw_obj obj(bucket_info.bucket, key);
-	RGWMPObj mp;
-	if (key.ns == RGW_OBJ_NS_MULTIPART && mp.from_meta(key.name)) {
-	  // place the multipart .meta object on the same shard as its head object
-	  obj.index_hash_source = mp.get_key();
-	}
-	ret = store->getRados()->get_target_shard_id(bucket_info.layout.target_index->layout.normal,
-						     obj.get_hash_object(), &target_shard_id);
+	int shard_index;
+	ret = get_target_shard_index(store, bucket_info, target, cls_key,
+				     &shard_index);
 	if (ret < 0) {
 	  ldpp_dout(dpp, -1) << "ERROR: get_target_shard_id() returned ret=" << ret << dendl;
 	  return ret;
 	}
 
-	int shard_index = (target_shard_id > 0 ? target_shard_id : 0);
-
 	ret = target_shards_mgr.add_entry(shard_index, entry, account,
 					  category, stats);
 	if (ret < 0) {
 	  return ret;
 	}
 
-	Clock::time_point now = Clock::now();
-	if (reshard_lock.should_renew(now)) {
-	  // assume outer locks have timespans at least the size of ours, so
-	  // can call inside conditional
-	  if (outer_reshard_lock) {
-	    ret = outer_reshard_lock->renew(now);
-	    if (ret < 0) {
-	      return ret;
-	    }
-	  }
-	  ret = reshard_lock.renew(now);
-	  if (ret < 0) {
-	    ldpp_dout(dpp, -1) << "Error renewing bucket lock: " << ret << dendl;
-	    return ret;
-	  }
+	ret = renew_locks(dpp);
+	if (ret < 0) {
+	  return ret;
 	}
 	if (verbose_json_out) {
 	  formatter->close_section();
@@ -905,6 +1173,15 @@ int RGWBucketReshard::do_reshard(const rgw::bucket_index_layout_generation& curr
 	  (*out) << " " << total_entries;
 	}
       } // entries loop
+      if (perfcounter) {
+	perfcounter->inc(l_rgw_reshard_entries, entries.size());
+      }
+      if (counters) {
+	counters->inc(reshard_counters::l_entries, entries.size());
+      }
+    }
+    if (counters) {
+      counters->set(reshard_counters::l_source_shards_done, i + 1);
     }
   }
 
@@ -951,17 +1228,77 @@ int RGWBucketReshard::execute(int num_shards,
     }
   }
 
+  // with rgw_reshard_online, writes continue during the copy and are
+  // only blocked while the objects they modified are copied again
+  auto& conf = store->ctx()->_conf;
+  const bool online = conf.get_val<bool>("rgw_reshard_online");
+
   // prepare the target index and add its layout the bucket info
-  ret = init_reshard(store, bucket_info, bucket_attrs, fault, num_shards, dpp);
+  ret = init_reshard(store, bucket_info, bucket_attrs, fault, num_shards,
+                     online ? cls_rgw_reshard_status::IN_LOGRECORD :
+                              cls_rgw_reshard_status::IN_PROGRESS, dpp);
   if (ret < 0) {
     return ret;
   }
 
+  in_logrecord = online;
+  if (perfcounter) {
+    perfcounter->inc(l_rgw_reshard_active);
+  }
+  counters = reshard_counters::build(store->ctx(),
+                                     "reshard-" + bucket_info.bucket.get_key());
+  auto active = make_scope_guard([this] {
+    in_logrecord = false;
+    counters.reset();
+    if (perfcounter) {
+      perfcounter->dec(l_rgw_reshard_active);
+    }
+  });
+
+  const auto& current = bucket_info.layout.current_index;
+  const auto& target = *bucket_info.layout.target_index;
+  auto copy_start = ceph::mono_clock::now();
+  auto block_start = copy_start;
+
   if (ret = fault.check("do_reshard");
       ret == 0) { // no fault injected, do the reshard
-    ret = do_reshard(bucket_info.layout.current_index,
-                     *bucket_info.layout.target_index,
-                     max_op_entries, verbose, out, formatter, dpp);
+    ret = do_reshard(current, target, max_op_entries, verbose, out,
+                     formatter, dpp);
+  }
+
+  if (ret == 0 && online) {
+    // catch up with the writes made during the copy while they
+    // continue, until few enough are left to copy with writes blocked
+    const uint64_t passes = conf.get_val<uint64_t>("rgw_reshard_replay_passes");
+    const uint64_t batch = conf.get_val<uint64_t>("rgw_reshard_batch_size");
+    for (uint64_t pass = 0; pass < passes; ++pass) {
+      uint64_t count = 0;
+      ret = replay_reshard_log(current, target, max_op_entries, &count, dpp);
+      ldpp_dout(dpp, 10) << __func__ << " replay pass " << pass
+          << " copied " << count << " modified objects" << dendl;
+      if (ret < 0 || count < batch) {
+        break;
+      }
+    }
+    if (ret == 0) {
+      if (ret = fault.check("block_writes_after_copy");
+          ret == 0) { // no fault injected, block writes to the current index
+        ret = set_resharding_status(dpp, store, bucket_info,
+                                    cls_rgw_reshard_status::IN_PROGRESS);
+      }
+      in_logrecord = false;
+      block_start = ceph::mono_clock::now();
+    }
+    if (ret == 0) {
+      uint64_t count = 0;
+      ret = replay_reshard_log(current, target, max_op_entries, &count, dpp);
+      ldpp_dout(dpp, 10) << __func__ << " copied " << count << " modified "
+          "objects with writes blocked" << dendl;
+    }
+  }
+  if (perfcounter) {
+    perfcounter->tinc(l_rgw_reshard_copy_lat,
+                      ceph::mono_clock::now() - copy_start);
   }
 
   if (ret < 0) {
@@ -976,6 +1313,10 @@ int RGWBucketReshard::execute(int num_shards,
   if (ret < 0) {
     return ret;
   }
+  if (perfcounter) {
+    perfcounter->tinc(l_rgw_reshard_block_lat,
+                      ceph::mono_clock::now() - block_start);
+  }
 
   ldpp_dout(dpp, 1) << __func__ << " INFO: reshard of bucket \""
       << bucket_info.bucket.name << "\" completed successfully" << dendl;
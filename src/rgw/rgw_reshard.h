@@ -17,6 +17,7 @@
 #include "include/rados/librados.hpp"
 #include "common/ceph_time.h"
 #include "common/async/yield_context.h"
+#include "common/perf_counters_collection.h"
 #include "cls/rgw/cls_rgw_types.h"
 #include "cls/lock/cls_lock_client.h"
 
@@ -79,6 +80,12 @@ class RGWBucketReshard {
   RGWBucketReshardLock reshard_lock;
   RGWBucketReshardLock* outer_reshard_lock;
 
+  // true while writes are recorded; the logrecord state of the index
+  // shards is extended along with the reshard lock
+  bool in_logrecord = false;
+  // the progress of this reshard, as "reshard-<bucket>"
+  PerfCountersRef counters;
+
   // using an initializer_list as an array in contiguous memory
   // allocated in at once
   static const std::initializer_list<uint16_t> reshard_primes;
@@ -90,6 +97,14 @@ class RGWBucketReshard {
                  std::ostream *os,
 		 Formatter *formatter,
                  const DoutPrefixProvider *dpp);
+  // copy the objects recorded in the reshard logs of the current index
+  // again, adding the number of objects to count
+  int replay_reshard_log(const rgw::bucket_index_layout_generation& current,
+                         const rgw::bucket_index_layout_generation& target,
+                         int max_entries,
+                         uint64_t* count,
+                         const DoutPrefixProvider *dpp);
+  int renew_locks(const DoutPrefixProvider *dpp);
 public:
 
   // pass nullptr for the final parameter if no outer reshard lock to
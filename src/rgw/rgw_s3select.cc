@@ -2,6 +2,7 @@
 // vim: ts=8 sw=2 smarttab ft=cpp
 
 #include "rgw_s3select_private.h"
+#include "rgw_perf_counters.h"
 
 #define dout_subsys ceph_subsys_rgw
 
@@ -261,6 +262,8 @@ void aws_response_handler::send_stats_response()
 RGWSelectObj_ObjStore_S3::RGWSelectObj_ObjStore_S3():
   m_buff_header(std::make_unique<char[]>(1000)),
   m_parquet_type(false),
+  m_request_range(0),
+  m_parquet_tail_ofs(0),
   chunk_number(0)
 {
   set_get_data(true);
@@ -535,27 +538,67 @@ size_t RGWSelectObj_ObjStore_S3::get_obj_size()
   return s->obj_size;
 }
 
-int RGWSelectObj_ObjStore_S3::range_request(int64_t ofs, int64_t len, void* buff, optional_yield y)
+int RGWSelectObj_ObjStore_S3::read_range(const std::string& range, optional_yield y)
 {
-  //purpose: implementation for arrow::ReadAt, this may take several async calls.
-  //send_response_date(call_back) accumulate buffer, upon completion control is back to ReadAt.
-  range_req_str = "bytes=" + std::to_string(ofs) + "-" + std::to_string(ofs+len-1);
+  //send_response_data(call_back) collects the data into m_range_bl, upon completion control is back here.
+  range_req_str = range;
   range_str = range_req_str.c_str();
   range_parsed = false;
   RGWGetObj::parse_range();
-  requested_buffer.clear();
-  m_request_range = len;
-  ldout(s->cct, 10) << "S3select: calling execute(async):" << " request-offset :" << ofs << " request-length :" << len << " buffer size : " << requested_buffer.size() << dendl;
+  m_range_bl.clear();
+  ldout(s->cct, 10) << "S3select: calling execute(async):" << " request-range :" << range_req_str << dendl;
   RGWGetObj::execute(y);
-  memcpy(buff, requested_buffer.data(), len);
-  ldout(s->cct, 10) << "S3select: done waiting, buffer is complete buffer-size:" << requested_buffer.size() << dendl;
+  if (perfcounter) {
+    perfcounter->inc(l_rgw_s3select_range_read);
+    perfcounter->inc(l_rgw_s3select_range_bytes, m_range_bl.length());
+  }
+  ldout(s->cct, 10) << "S3select: done waiting, buffer is complete buffer-size:" << m_range_bl.length() << dendl;
+  return op_ret;
+}
+
+int RGWSelectObj_ObjStore_S3::read_parquet_tail(optional_yield y)
+{
+  //a parquet object ends with its footer, followed by the footer length and the magic.
+  //the reader starts by reading these, so one read of the tail serves all of it.
+  const uint64_t tail_size = std::max<uint64_t>(s->cct->_conf->rgw_s3select_parquet_tail_size, 4);
+  m_request_range = tail_size;
+  int ret = read_range("bytes=-" + std::to_string(tail_size), y);
+  if (ret < 0) {
+    return ret;
+  }
+  m_parquet_tail = std::move(m_range_bl);
+  m_parquet_tail_ofs = s->obj_size - m_parquet_tail.length();
+  return 0;
+}
+
+int RGWSelectObj_ObjStore_S3::range_request(int64_t ofs, int64_t len, void* buff, optional_yield y)
+{
+  //purpose: implementation for arrow::ReadAt, this may take several async calls.
+  if (ofs >= m_parquet_tail_ofs &&
+      ofs + len <= m_parquet_tail_ofs + static_cast<int64_t>(m_parquet_tail.length())) {
+    m_parquet_tail.begin(ofs - m_parquet_tail_ofs).copy(len, static_cast<char*>(buff));
+    if (perfcounter) {
+      perfcounter->inc(l_rgw_s3select_range_cached);
+    }
+    ldout(s->cct, 10) << "S3select: range-request served from the object tail" << dendl;
+    return len;
+  }
+  m_request_range = len;
+  int ret = read_range("bytes=" + std::to_string(ofs) + "-" + std::to_string(ofs+len-1), y);
+  if (ret < 0) {
+    return ret;
+  }
+  if (m_range_bl.length() < static_cast<uint64_t>(len)) {
+    ldout(s->cct, 10) << "S3select: short range-request, got " << m_range_bl.length() << " of " << len << dendl;
+    len = m_range_bl.length();
+  }
+  m_range_bl.begin().copy(len, static_cast<char*>(buff));
   return len;
 }
 
 void RGWSelectObj_ObjStore_S3::execute(optional_yield y)
 {
   int status = 0;
-  char parquet_magic[4];
   static constexpr uint8_t parquet_magic1[4] = {'P', 'A', 'R', '1'};
   static constexpr uint8_t parquet_magicE[4] = {'P', 'A', 'R', 'E'};
   get_params(y);
@@ -564,7 +607,16 @@ void RGWSelectObj_ObjStore_S3::execute(optional_yield y)
 #endif
   if (m_parquet_type) {
     //parquet processing
-    range_request(0, 4, parquet_magic, y);
+    if (read_parquet_tail(y) < 0) {
+      ldout(s->cct, 10) << "S3select: failed to read the tail of " << s->object->get_name() << dendl;
+      return;
+    }
+    char parquet_magic[4];
+    if (m_parquet_tail.length() < sizeof(parquet_magic)) {
+      op_ret = -ERR_INVALID_REQUEST;
+      return;
+    }
+    m_parquet_tail.begin(m_parquet_tail.length() - sizeof(parquet_magic)).copy(sizeof(parquet_magic), parquet_magic);
     if(memcmp(parquet_magic, parquet_magic1, 4) && memcmp(parquet_magic, parquet_magicE, 4)) {
       ldout(s->cct, 10) << s->object->get_name() << " does not contain parquet magic" << dendl;
       op_ret = -ERR_INVALID_REQUEST;
@@ -598,23 +650,16 @@ int RGWSelectObj_ObjStore_S3::parquet_processing(bufferlist& bl, off_t ofs, off_
       end_header(s, this, "application/xml", CHUNKED_TRANSFER_ENCODING);
     }
     chunk_number++;
-    size_t append_in_callback = 0;
-    int part_no = 1;
-    //concat the requested buffer
-    for (auto& it : bl.buffers()) {
-      if(it.length() == 0) {
-        ldout(s->cct, 10) << "S3select: get zero-buffer while appending request-buffer " << dendl;
-      }
-      append_in_callback += it.length();
-      ldout(s->cct, 10) << "S3select: part " << part_no++ << " it.length() = " << it.length() << dendl;
-      requested_buffer.append(&(it)[0]+ofs, len);
-    }
-    ldout(s->cct, 10) << "S3select:append_in_callback = " << append_in_callback << dendl;
-    if (requested_buffer.size() < m_request_range) {
-      ldout(s->cct, 10) << "S3select: need another round buffe-size: " << requested_buffer.size() << " request range length:" << m_request_range << dendl;
+    //share the buffers instead of copying them, range_request() copies once into the reader's buffer
+    bufferlist chunk;
+    chunk.substr_of(bl, ofs, len);
+    m_range_bl.claim_append(chunk);
+    ldout(s->cct, 10) << "S3select: append_in_callback = " << len << dendl;
+    if (m_range_bl.length() < m_request_range) {
+      ldout(s->cct, 10) << "S3select: need another round buffe-size: " << m_range_bl.length() << " request range length:" << m_request_range << dendl;
       return 0;
     } else {//buffer is complete
-      ldout(s->cct, 10) << "S3select: buffer is complete " << requested_buffer.size() << " request range length:" << m_request_range << dendl;
+      ldout(s->cct, 10) << "S3select: buffer is complete " << m_range_bl.length() << " request range length:" << m_request_range << dendl;
       m_request_range = 0;
     }
     return 0;
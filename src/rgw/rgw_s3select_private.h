@@ -193,8 +193,12 @@ private:
 #endif
   //a request for range may statisfy by several calls to send_response_date;
   size_t m_request_range;
-  std::string requested_buffer;
+  //the data of a range request, shared with the buffers that RADOS returned
+  bufferlist m_range_bl;
   std::string range_req_str;
+  //the tail of the parquet object (footer and magic), read up front
+  bufferlist m_parquet_tail;
+  int64_t m_parquet_tail_ofs;
   std::function<int(std::string&)> fp_result_header_format;
   std::function<int(std::string&)> fp_s3select_result_format;
   int m_header_size;
@@ -229,6 +233,10 @@ private:
 
   int range_request(int64_t start, int64_t len, void*, optional_yield);
 
+  int read_range(const std::string& range, optional_yield y);
+
+  int read_parquet_tail(optional_yield y);
+
   size_t get_obj_size();
   std::function<int(int64_t, int64_t, void*, optional_yield*)> fp_range_req;
   std::function<size_t(void)> fp_get_obj_size;
@@ -2359,7 +2359,8 @@ std::unique_ptr<Completions> DaosStore::get_completions(void) {
 
 std::unique_ptr<Notification> DaosStore::get_notification(
     rgw::sal::Object* obj, rgw::sal::Object* src_obj, struct req_state* s,
-    rgw::notify::EventType event_type, const std::string* object_name) {
+    rgw::notify::EventType event_type, optional_yield y,
+    const std::string* object_name) {
   return std::make_unique<DaosNotification>(obj, src_obj, event_type);
 }
 
@@ -29,10 +29,12 @@
 #include "rgw_sal_rados.h"
 #include "rgw_bucket.h"
 #include "rgw_multi.h"
+#include "rgw_multipart_batches.h"
 #include "rgw_acl_s3.h"
 #include "rgw_aio.h"
 #include "rgw_aio_throttle.h"
 #include "rgw_tracer.h"
+#include "rgw_perf_counters.h"
 
 #include "rgw_zone.h"
 #include "rgw_rest_conn.h"
@@ -1273,9 +1275,9 @@ std::unique_ptr<Completions> RadosStore::get_completions(void)
 }
 
 std::unique_ptr<Notification> RadosStore::get_notification(
-  rgw::sal::Object* obj, rgw::sal::Object* src_obj, req_state* s, rgw::notify::EventType event_type, const std::string* object_name)
+  rgw::sal::Object* obj, rgw::sal::Object* src_obj, req_state* s, rgw::notify::EventType event_type, optional_yield y, const std::string* object_name)
 {
-  return std::make_unique<RadosNotification>(s, this, obj, src_obj, s, event_type, object_name);
+  return std::make_unique<RadosNotification>(s, this, obj, src_obj, s, event_type, y, object_name);
 }
 
 std::unique_ptr<Notification> RadosStore::get_notification(const DoutPrefixProvider* dpp, rgw::sal::Object* obj, rgw::sal::Object* src_obj, rgw::notify::EventType event_type, rgw::sal::Bucket* _bucket, std::string& _user_id, std::string& _user_tenant, std::string& _req_id, optional_yield y)
@@ -1603,6 +1605,15 @@ std::unique_ptr<Writer> RadosStore::get_atomic_writer(const DoutPrefixProvider *
 				  const std::string& unique_tag)
 {
   auto aio = rgw::make_throttle(ctx()->_conf->rgw_put_obj_min_window_size, y);
+  // other storage classes keep their data in their own pools
+  if (!ctx()->_conf.get_val<std::string>("rgw_dedup_chunk_pool").empty() &&
+      (!ptail_placement_rule ||
+       ptail_placement_rule->get_storage_class() == RGW_STORAGE_CLASS_STANDARD)) {
+    return std::make_unique<RadosDedupWriter>(dpp, y,
+				   std::move(_head_obj),
+				   this, std::move(aio), owner,
+				   olh_epoch, unique_tag);
+  }
   return std::make_unique<RadosAtomicWriter>(dpp, y,
 				 std::move(_head_obj),
 				 this, std::move(aio), owner,
@@ -2485,10 +2496,132 @@ int RadosMultipartUpload::complete(const DoutPrefixProvider *dpp,
   int max_parts = 1000;
   int marker = 0;
   uint64_t min_part_size = cct->_conf->rgw_multipart_min_part_size;
+  const auto start = ceph::mono_clock::now();
   auto etags_iter = part_etags.begin();
   rgw::sal::Attrs attrs = target_obj->get_attrs();
 
-  do {
+  auto add_part = [&] (RadosMultipartPart* part) -> int {
+    uint64_t part_size = part->get_size();
+    if (handled_parts < (int)part_etags.size() - 1 &&
+        part_size < min_part_size) {
+      return -ERR_TOO_SMALL;
+    }
+
+    char petag[CEPH_CRYPTO_MD5_DIGESTSIZE];
+    if (etags_iter->first != (int)part->info.num) {
+      ldpp_dout(dpp, 0) << "NOTICE: parts num mismatch: next requested: "
+			 << etags_iter->first << " next uploaded: "
+			 << part->info.num << dendl;
+      return -ERR_INVALID_PART;
+    }
+    string part_etag = rgw_string_unquote(etags_iter->second);
+    if (part_etag.compare(part->get_etag()) != 0) {
+      ldpp_dout(dpp, 0) << "NOTICE: etag mismatch: part: " << etags_iter->first
+			 << " etag: " << etags_iter->second << dendl;
+      return -ERR_INVALID_PART;
+    }
+
+    hex_to_buf(part->get_etag().c_str(), petag,
+		CEPH_CRYPTO_MD5_DIGESTSIZE);
+    hash.Update((const unsigned char *)petag, sizeof(petag));
+
+    RGWUploadPartInfo& obj_part = part->info;
+
+    /* update manifest for part */
+    string oid = mp_obj.get_part(part->info.num);
+    rgw_obj src_obj;
+    src_obj.init_ns(bucket->get_key(), oid, mp_ns);
+
+    if (obj_part.manifest.empty()) {
+      ldpp_dout(dpp, 0) << "ERROR: empty manifest for object part: obj="
+			 << src_obj << dendl;
+      return -ERR_INVALID_PART;
+    } else {
+      manifest.append(dpp, obj_part.manifest, store->svc()->zone->get_zonegroup(), store->svc()->zone->get_zone_params());
+    }
+
+    bool part_compressed = (obj_part.cs_info.compression_type != "none");
+    if ((handled_parts > 0) &&
+        ((part_compressed != compressed) ||
+          (cs_info.compression_type != obj_part.cs_info.compression_type))) {
+        ldpp_dout(dpp, 0) << "ERROR: compression type was changed during multipart upload ("
+                         << cs_info.compression_type << ">>" << obj_part.cs_info.compression_type << ")" << dendl;
+        return -ERR_INVALID_PART;
+    }
+    
+    if (part_compressed) {
+      int64_t new_ofs; // offset in compression data for new part
+      if (cs_info.blocks.size() > 0)
+        new_ofs = cs_info.blocks.back().new_ofs + cs_info.blocks.back().len;
+      else
+        new_ofs = 0;
+      for (const auto& block : obj_part.cs_info.blocks) {
+        compression_block cb;
+        cb.old_ofs = block.old_ofs + cs_info.orig_size;
+        cb.new_ofs = new_ofs;
+        cb.len = block.len;
+        cs_info.blocks.push_back(cb);
+        new_ofs = cb.new_ofs + cb.len;
+      } 
+      if (!compressed)
+        cs_info.compression_type = obj_part.cs_info.compression_type;
+      cs_info.orig_size += obj_part.cs_info.orig_size;
+      compressed = true;
+    }
+
+    rgw_obj_index_key remove_key;
+    src_obj.key.get_index_key(&remove_key);
+
+    remove_objs.push_back(remove_key);
+
+    ofs += obj_part.size;
+    accounted_size += obj_part.accounted_size;
+    return 0;
+  };
+
+  const unsigned window = cct->_conf->rgw_multipart_complete_window;
+  bool pipelined = false;
+  if (window > 1 && !part_etags.empty() && is_v2_upload_id(get_upload_id())) {
+    // if the uploaded parts turn out not to match the request, start over
+    // with list_parts() so that the mismatch is reported as it always was
+    const auto saved_manifest = manifest;
+    const auto saved_remove_objs = remove_objs;
+    const auto saved_cs_info = cs_info;
+    const bool saved_compressed = compressed;
+    const uint64_t saved_accounted_size = accounted_size;
+    const off_t saved_ofs = ofs;
+
+    ret = read_parts_pipelined(dpp, y, part_etags, max_parts, window,
+                               [&] (RadosMultipartPart& part) {
+                                 int r = add_part(&part);
+                                 ++etags_iter;
+                                 ++handled_parts;
+                                 return r;
+                               });
+    if (ret == -ENOENT) {
+      return -ERR_NO_SUCH_UPLOAD;
+    }
+    if (ret == -EAGAIN) {
+      ldpp_dout(dpp, 10) << "parts of upload " << get_upload_id()
+                         << " don't match the request, listing them in order" << dendl;
+      manifest = saved_manifest;
+      remove_objs = saved_remove_objs;
+      cs_info = saved_cs_info;
+      compressed = saved_compressed;
+      accounted_size = saved_accounted_size;
+      ofs = saved_ofs;
+      hash.Restart();
+      hash.SetFlags(EVP_MD_CTX_FLAG_NON_FIPS_ALLOW);
+      etags_iter = part_etags.begin();
+      handled_parts = 0;
+    } else if (ret < 0) {
+      return ret;
+    } else {
+      pipelined = true;
+    }
+  }
+
+  while (!pipelined) {
     ret = list_parts(dpp, cct, max_parts, marker, &marker, &truncated);
     if (ret == -ENOENT) {
       ret = -ERR_NO_SUCH_UPLOAD;
@@ -2506,88 +2639,18 @@ int RadosMultipartUpload::complete(const DoutPrefixProvider *dpp,
 
     for (auto obj_iter = parts.begin(); etags_iter != part_etags.end() && obj_iter != parts.end(); ++etags_iter, ++obj_iter, ++handled_parts) {
       RadosMultipartPart* part = dynamic_cast<rgw::sal::RadosMultipartPart*>(obj_iter->second.get());
-      uint64_t part_size = part->get_size();
-      if (handled_parts < (int)part_etags.size() - 1 &&
-          part_size < min_part_size) {
-        ret = -ERR_TOO_SMALL;
-        return ret;
-      }
-
-      char petag[CEPH_CRYPTO_MD5_DIGESTSIZE];
-      if (etags_iter->first != (int)obj_iter->first) {
-        ldpp_dout(dpp, 0) << "NOTICE: parts num mismatch: next requested: "
-			 << etags_iter->first << " next uploaded: "
-			 << obj_iter->first << dendl;
-        ret = -ERR_INVALID_PART;
-        return ret;
-      }
-      string part_etag = rgw_string_unquote(etags_iter->second);
-      if (part_etag.compare(part->get_etag()) != 0) {
-        ldpp_dout(dpp, 0) << "NOTICE: etag mismatch: part: " << etags_iter->first
-			 << " etag: " << etags_iter->second << dendl;
-        ret = -ERR_INVALID_PART;
-        return ret;
-      }
-
-      hex_to_buf(part->get_etag().c_str(), petag,
-		CEPH_CRYPTO_MD5_DIGESTSIZE);
-      hash.Update((const unsigned char *)petag, sizeof(petag));
-
-      RGWUploadPartInfo& obj_part = part->info;
-
-      /* update manifest for part */
-      string oid = mp_obj.get_part(part->info.num);
-      rgw_obj src_obj;
-      src_obj.init_ns(bucket->get_key(), oid, mp_ns);
-
-      if (obj_part.manifest.empty()) {
-        ldpp_dout(dpp, 0) << "ERROR: empty manifest for object part: obj="
-			 << src_obj << dendl;
-        ret = -ERR_INVALID_PART;
+      ret = add_part(part);
+      if (ret < 0) {
         return ret;
-      } else {
-        manifest.append(dpp, obj_part.manifest, store->svc()->zone->get_zonegroup(), store->svc()->zone->get_zone_params());
-      }
-
-      bool part_compressed = (obj_part.cs_info.compression_type != "none");
-      if ((handled_parts > 0) &&
-          ((part_compressed != compressed) ||
-            (cs_info.compression_type != obj_part.cs_info.compression_type))) {
-          ldpp_dout(dpp, 0) << "ERROR: compression type was changed during multipart upload ("
-                           << cs_info.compression_type << ">>" << obj_part.cs_info.compression_type << ")" << dendl;
-          ret = -ERR_INVALID_PART;
-          return ret; 
-      }
-      
-      if (part_compressed) {
-        int64_t new_ofs; // offset in compression data for new part
-        if (cs_info.blocks.size() > 0)
-          new_ofs = cs_info.blocks.back().new_ofs + cs_info.blocks.back().len;
-        else
-          new_ofs = 0;
-        for (const auto& block : obj_part.cs_info.blocks) {
-          compression_block cb;
-          cb.old_ofs = block.old_ofs + cs_info.orig_size;
-          cb.new_ofs = new_ofs;
-          cb.len = block.len;
-          cs_info.blocks.push_back(cb);
-          new_ofs = cb.new_ofs + cb.len;
-        } 
-        if (!compressed)
-          cs_info.compression_type = obj_part.cs_info.compression_type;
-        cs_info.orig_size += obj_part.cs_info.orig_size;
-        compressed = true;
       }
-
-      rgw_obj_index_key remove_key;
-      src_obj.key.get_index_key(&remove_key);
-
-      remove_objs.push_back(remove_key);
-
-      ofs += obj_part.size;
-      accounted_size += obj_part.accounted_size;
     }
-  } while (truncated);
+    if (!truncated) {
+      break;
+    }
+  }
+  if (perfcounter) {
+    perfcounter->tinc(l_rgw_multipart_complete_lat, ceph::mono_clock::now() - start);
+  }
   hash.Final((unsigned char *)final_etag);
 
   buf_to_hex((unsigned char *)final_etag, sizeof(final_etag), final_etag_str);
@@ -2633,6 +2696,65 @@ int RadosMultipartUpload::complete(const DoutPrefixProvider *dpp,
   return ret;
 }
 
+/*
+ * Read the parts named in part_etags from the omap of the upload's meta
+ * object, with up to 'window' omap reads of 'batch_size' parts in flight
+ * at a time, and hand them to cb in part order as their batch arrives.
+ * Returns -EAGAIN if the parts that were uploaded differ from the ones
+ * requested, after cb may already have seen some of them.
+ */
+int RadosMultipartUpload::read_parts_pipelined(const DoutPrefixProvider *dpp, optional_yield y,
+                                               const map<int, string>& part_etags,
+                                               int batch_size, unsigned window,
+                                               const std::function<int(RadosMultipartPart&)>& cb)
+{
+  std::unique_ptr<rgw::sal::Object> meta_obj = bucket->get_object(
+		      rgw_obj_key(get_meta(), std::string(), RGW_OBJ_NS_MULTIPART));
+  meta_obj->set_in_extra_data(true);
+
+  rgw_raw_obj raw_obj;
+  static_cast<RadosObject*>(meta_obj.get())->get_raw_obj(&raw_obj);
+  auto obj = store->svc()->rados->obj(raw_obj);
+  int ret = obj.open(dpp);
+  if (ret < 0) {
+    return ret;
+  }
+
+  auto decode_part = [dpp] (bufferlist& bl, RadosMultipartPart& part) {
+    auto bli = bl.cbegin();
+    try {
+      decode(part.info, bli);
+    } catch (buffer::error& err) {
+      ldpp_dout(dpp, 0) << "ERROR: could not part info, caught buffer::error" << dendl;
+      return -EIO;
+    }
+    return static_cast<int>(part.info.num);
+  };
+  rgw::multipart::PartBatches<RadosMultipartPart> batches(
+    part_etags, batch_size, decode_part, cb);
+
+  auto collect = [&batches] (rgw::AioResultList&& completed) {
+    for (auto& e : completed) {
+      batches.done(e.id, e.result);
+    }
+    return batches.handle_done();
+  };
+
+  auto aio = rgw::make_throttle(window, y);
+  for (size_t i = 0; ret == 0 && i < batches.size(); ++i) {
+    auto& b = batches[i];
+    librados::ObjectReadOperation op;
+    op.omap_get_vals2(b.after, b.max(), &b.vals, &b.more, &b.rval);
+    ret = collect(aio->get(obj, rgw::Aio::librados_op(std::move(op), y), 1, i));
+  }
+  while (ret == 0 && !batches.finished()) {
+    ret = collect(aio->wait());
+  }
+  // the outstanding reads still point into batches
+  aio->drain();
+  return ret;
+}
+
 int RadosMultipartUpload::get_info(const DoutPrefixProvider *dpp, optional_yield y, rgw_placement_rule** rule, rgw::sal::Attrs* attrs)
 {
   if (!rule && !attrs) {
@@ -2908,6 +3030,29 @@ int RadosAtomicWriter::complete(size_t accounted_size, const std::string& etag,
 			    if_match, if_nomatch, user_data, zones_trace, canceled, y);
 }
 
+int RadosDedupWriter::prepare(optional_yield y)
+{
+  return processor.prepare(y);
+}
+
+int RadosDedupWriter::process(bufferlist&& data, uint64_t offset)
+{
+  return processor.process(std::move(data), offset);
+}
+
+int RadosDedupWriter::complete(size_t accounted_size, const std::string& etag,
+                       ceph::real_time *mtime, ceph::real_time set_mtime,
+                       std::map<std::string, bufferlist>& attrs,
+                       ceph::real_time delete_at,
+                       const char *if_match, const char *if_nomatch,
+                       const std::string *user_data,
+                       rgw_zone_set *zones_trace, bool *canceled,
+                       optional_yield y)
+{
+  return processor.complete(accounted_size, etag, mtime, set_mtime, attrs, delete_at,
+			    if_match, if_nomatch, user_data, zones_trace, canceled, y);
+}
+
 int RadosAppendWriter::prepare(optional_yield y)
 {
   return processor.prepare(y);
@@ -164,7 +164,7 @@ class RadosStore : public StoreStore {
     virtual int cluster_stat(RGWClusterStat& stats) override;
     virtual std::unique_ptr<Lifecycle> get_lifecycle(void) override;
     virtual std::unique_ptr<Completions> get_completions(void) override;
-    virtual std::unique_ptr<Notification> get_notification(rgw::sal::Object* obj, rgw::sal::Object* src_obj, req_state* s, rgw::notify::EventType event_type, const std::string* object_name=nullptr) override;
+    virtual std::unique_ptr<Notification> get_notification(rgw::sal::Object* obj, rgw::sal::Object* src_obj, req_state* s, rgw::notify::EventType event_type, optional_yield y, const std::string* object_name=nullptr) override;
     virtual std::unique_ptr<Notification> get_notification(
     const DoutPrefixProvider* dpp, rgw::sal::Object* obj, rgw::sal::Object* src_obj, 
     rgw::notify::EventType event_type, rgw::sal::Bucket* _bucket, std::string& _user_id, std::string& _user_tenant,
@@ -649,6 +649,11 @@ class RadosMultipartUpload : public StoreMultipartUpload {
   rgw_placement_rule placement;
   RGWObjManifest manifest;
 
+  int read_parts_pipelined(const DoutPrefixProvider* dpp, optional_yield y,
+                           const std::map<int, std::string>& part_etags,
+                           int batch_size, unsigned window,
+                           const std::function<int(RadosMultipartPart&)>& cb);
+
 public:
   RadosMultipartUpload(RadosStore* _store, Bucket* _bucket, const std::string& oid,
                        std::optional<std::string> upload_id, ACLOwner owner,
@@ -746,8 +751,8 @@ class RadosNotification : public StoreNotification {
   rgw::notify::reservation_t res;
 
   public:
-    RadosNotification(const DoutPrefixProvider* _dpp, RadosStore* _store, Object* _obj, Object* _src_obj, req_state* _s, rgw::notify::EventType _type, const std::string* object_name=nullptr) :
-      StoreNotification(_obj, _src_obj, _type), store(_store), res(_dpp, _store, _s, _obj, _src_obj, object_name) { }
+    RadosNotification(const DoutPrefixProvider* _dpp, RadosStore* _store, Object* _obj, Object* _src_obj, req_state* _s, rgw::notify::EventType _type, optional_yield y, const std::string* object_name=nullptr) :
+      StoreNotification(_obj, _src_obj, _type), store(_store), res(_dpp, _store, _s, _obj, _src_obj, object_name, y) { }
 
     RadosNotification(const DoutPrefixProvider* _dpp, RadosStore* _store, Object* _obj, Object* _src_obj, rgw::notify::EventType _type, rgw::sal::Bucket* _bucket, std::string& _user_id, std::string& _user_tenant, std::string& _req_id, optional_yield y) :
       StoreNotification(_obj, _src_obj, _type), store(_store), res(_dpp, _store, _obj, _src_obj, _bucket, _user_id, _user_tenant, _req_id, y) {}
@@ -808,6 +813,49 @@ public:
                        optional_yield y) override;
 };
 
+class RadosDedupWriter : public StoreWriter {
+protected:
+  rgw::sal::RadosStore* store;
+  std::unique_ptr<Aio> aio;
+  RGWObjectCtx* obj_ctx;
+  rgw::putobj::DedupObjectProcessor processor;
+
+public:
+  RadosDedupWriter(const DoutPrefixProvider *dpp,
+		    optional_yield y,
+		    std::unique_ptr<rgw::sal::Object> _head_obj,
+		    RadosStore* _store, std::unique_ptr<Aio> _aio,
+		    const rgw_user& owner,
+		    uint64_t olh_epoch,
+		    const std::string& unique_tag) :
+			StoreWriter(dpp, y),
+			store(_store),
+			aio(std::move(_aio)),
+			obj_ctx(&dynamic_cast<RadosObject*>(_head_obj.get())->get_ctx()),
+			processor(&*aio, store, owner,
+				  *obj_ctx,
+				  std::move(_head_obj), olh_epoch, unique_tag,
+				  dpp, y)
+  {}
+  ~RadosDedupWriter() = default;
+
+  // prepare to start processing object data
+  virtual int prepare(optional_yield y) override;
+
+  // Process a bufferlist
+  virtual int process(bufferlist&& data, uint64_t offset) override;
+
+  // complete the operation and make its result visible to clients
+  virtual int complete(size_t accounted_size, const std::string& etag,
+                       ceph::real_time *mtime, ceph::real_time set_mtime,
+                       std::map<std::string, bufferlist>& attrs,
+                       ceph::real_time delete_at,
+                       const char *if_match, const char *if_nomatch,
+                       const std::string *user_data,
+                       rgw_zone_set *zones_trace, bool *canceled,
+                       optional_yield y) override;
+};
+
 class RadosAppendWriter : public StoreWriter {
 protected:
   rgw::sal::RadosStore* store;
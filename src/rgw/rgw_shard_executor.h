@@ -0,0 +1,122 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab ft=cpp
+
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/Thread.h"
+#include "common/ceph_time.h"
+
+namespace rgw {
+
+/*
+ * Runs fn(worker, shard) for every shard in [0, num_shards), starting at
+ * shard 'start' and wrapping around, from a pool of num_workers threads.
+ * Each worker claims the next shard that nobody has claimed yet, so a
+ * slow shard only holds up its own worker. Once fn returns an error, no
+ * more shards are claimed and the first error is returned.
+ *
+ * With a single worker, fn runs on the calling thread.
+ */
+inline int for_each_shard(const std::string& name, unsigned num_workers,
+                          int num_shards, int start,
+                          const std::function<int(unsigned, int)>& fn)
+{
+  std::atomic<int> next{0};
+  std::atomic<int> error{0};
+
+  auto work = [&] (unsigned worker) {
+    while (error == 0) {
+      const int i = next++;
+      if (i >= num_shards) {
+        break;
+      }
+      const int r = fn(worker, (start + i) % num_shards);
+      if (r < 0) {
+        int expected = 0;
+        error.compare_exchange_strong(expected, r);
+      }
+    }
+  };
+
+  num_workers = std::clamp<unsigned>(num_workers, 1, std::max(num_shards, 1));
+  if (num_workers == 1) {
+    work(0);
+    return error;
+  }
+
+  std::vector<std::thread> threads;
+  threads.reserve(num_workers);
+  for (unsigned w = 0; w < num_workers; w++) {
+    threads.push_back(make_named_thread(name, work, w));
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  return error;
+}
+
+/*
+ * Spaces out the start of work items so that all the threads sharing a
+ * Pacer together start at most 'rate' items per second. A rate of 0
+ * means no limit.
+ */
+class Pacer {
+  std::mutex mutex;
+  uint64_t rate;
+  ceph::mono_time next = ceph::mono_clock::zero();
+
+public:
+  explicit Pacer(uint64_t rate = 0) : rate(rate) {}
+
+  void set_rate(uint64_t r) {
+    std::lock_guard l{mutex};
+    rate = r;
+  }
+
+  /// wait for the turn of the next @p count items. gives up early and
+  /// returns false if @p stop returns true
+  template <typename Stop>
+  bool wait(uint64_t count, Stop&& stop) {
+    using namespace std::chrono_literals;
+    ceph::mono_time slot;
+    {
+      std::lock_guard l{mutex};
+      if (rate == 0) {
+        return true;
+      }
+      const auto now = ceph::mono_clock::now();
+      slot = std::max(now, next);
+      next = slot + std::chrono::duration_cast<ceph::timespan>(
+          std::chrono::duration<double>(double(count) / rate));
+    }
+    // sleep in short steps so that shutdown isn't held up
+    for (auto now = ceph::mono_clock::now(); now < slot;
+         now = ceph::mono_clock::now()) {
+      if (stop()) {
+        return false;
+      }
+      std::this_thread::sleep_for(std::min<ceph::timespan>(slot - now, 100ms));
+    }
+    return true;
+  }
+};
+
+} // namespace rgw
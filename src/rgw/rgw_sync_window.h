@@ -0,0 +1,154 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab ft=cpp
+
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+
+#include "common/ceph_time.h"
+
+namespace rgw::sync {
+
+/*
+ * Sizes the number of object syncs kept in flight against a source zone,
+ * across all of the bucket shards that sync from it.
+ *
+ * Each object fetch is timed, and compared with the lowest latency seen
+ * recently for fetches of about the same size, as a large object takes
+ * longer to copy without any queueing. While fetches take about that
+ * long, the source zone isn't queueing them: the window doubles every
+ * round trip until the first sign of congestion, and opens by one per
+ * round trip after that. Once fetches take more than twice as long, or
+ * fail with an error that suggests overload, the window closes by a
+ * quarter, at most once per round trip.
+ *
+ * The bucket shards that are syncing split the window between them
+ * evenly, so that one busy bucket can use all of it, but can't starve the
+ * others. Each of them may always keep min fetches in flight, as it would
+ * without the window, so the window stays within [min * shards, max]. It
+ * is only used from the thread that runs the zone's sync coroutines.
+ */
+class AdaptiveWindow {
+  static constexpr uint64_t base_period = 256; // samples per baseline
+
+  // fetches are only compared with others of the same size class:
+  // below 128K, 1M, 8M, and larger
+  static constexpr size_t num_size_classes = 4;
+  static size_t size_class(uint64_t bytes) {
+    constexpr uint64_t bounds[num_size_classes - 1] = {
+      128 << 10, 1 << 20, 8 << 20
+    };
+    return std::upper_bound(std::begin(bounds), std::end(bounds), bytes) -
+	std::begin(bounds);
+  }
+
+  uint64_t min = 1; // per bucket shard
+  uint64_t max = 1;
+  double window = 1;
+  bool slow_start = true;
+
+  struct Baseline {
+    double base = 0; // lowest latency of the last period, in seconds
+    double period_base = 0; // lowest latency of this period so far
+    uint64_t samples = 0;
+  };
+  std::array<Baseline, num_size_classes> baselines;
+  uint64_t since_decrease = 0;
+
+  unsigned active = 0; // bucket shards sharing the window
+
+  double min_size() const {
+    return double(min) * std::max(active, 1u);
+  }
+
+  static double seconds(ceph::timespan t) {
+    using namespace std::chrono_literals;
+    return std::chrono::duration<double>(std::max<ceph::timespan>(t, 1us)).count();
+  }
+  static bool overloaded(int r) {
+    return r == -EBUSY || r == -ETIMEDOUT || r == -EAGAIN;
+  }
+
+  void decrease() {
+    if (since_decrease < window) {
+      return; // already backed off for this round trip
+    }
+    window = std::max(min_size(), window * 3 / 4);
+    slow_start = false;
+    since_decrease = 0;
+  }
+
+public:
+  AdaptiveWindow() = default;
+  AdaptiveWindow(uint64_t min, uint64_t max) {
+    configure(min, max);
+  }
+
+  void configure(uint64_t _min, uint64_t _max) {
+    min = std::max<uint64_t>(_min, 1);
+    max = std::max(min, _max);
+    window = min_size();
+    slow_start = true;
+  }
+
+  uint64_t size() const { return window; }
+
+  /// the number of object syncs that each of the active bucket shards
+  /// may keep in flight
+  uint64_t share() const {
+    return std::max<uint64_t>(size() / std::max(active, 1u), min);
+  }
+
+  /// an object fetch of @p bytes completed with @p r after @p elapsed
+  void sample(ceph::timespan elapsed, int r, uint64_t bytes) {
+    const double latency = seconds(elapsed);
+    auto& b = baselines[size_class(bytes)];
+    if (r >= 0) {
+      b.period_base = b.period_base == 0 ? latency : std::min(b.period_base, latency);
+      b.base = b.base == 0 ? latency : std::min(b.base, latency);
+    }
+    if (++b.samples % base_period == 0) {
+      // forget old minimums, in case the path to the zone got slower
+      b.base = b.period_base;
+      b.period_base = 0;
+    }
+    ++since_decrease;
+
+    if (overloaded(r) || (r >= 0 && latency > 2 * b.base)) {
+      decrease();
+    } else if (r >= 0) {
+      // a window's worth of fetches completes per round trip
+      window = std::min(std::max<double>(max, min_size()),
+			window + (slow_start ? 1 : 1 / window));
+    }
+  }
+
+  /// registers a bucket shard that syncs through the window while it
+  /// lives
+  class Share {
+    AdaptiveWindow& w;
+  public:
+    explicit Share(AdaptiveWindow& w) : w(w) {
+      ++w.active;
+      w.window = std::max(w.window, w.min_size());
+    }
+    ~Share() { --w.active; }
+    Share(const Share&) = delete;
+    Share& operator=(const Share&) = delete;
+  };
+};
+
+} // namespace rgw::sync
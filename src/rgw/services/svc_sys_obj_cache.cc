@@ -2,6 +2,7 @@
 // -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
 // vim: ts=8 sw=2 smarttab ft=cpp
 
+#include "common/Thread.h"
 #include "common/admin_socket.h"
 
 #include "svc_sys_obj_cache.h"
@@ -56,15 +57,107 @@ int RGWSI_SysObj_Cache::do_start(optional_yield y, const DoutPrefixProvider *dpp
 
   notify_svc->register_watch_cb(cb.get());
 
+  if (cct->_conf.get_val<uint64_t>("rgw_cache_refresh_ahead_interval") > 0) {
+    refresh_thread = make_named_thread("rgw_cache_rfsh",
+                                       &RGWSI_SysObj_Cache::refresh_entries, this);
+  }
+
   return 0;
 }
 
 void RGWSI_SysObj_Cache::shutdown()
 {
+  if (refresh_thread.joinable()) {
+    {
+      std::lock_guard l{refresh_lock};
+      refresh_stopping = true;
+    }
+    refresh_cond.notify_all();
+    refresh_thread.join();
+  }
   asocket.shutdown();
   RGWSI_SysObj_Core::shutdown();
 }
 
+// bounds the backlog of refreshes; an entry whose refresh is dropped
+// just expires as it would have without refresh-ahead
+static constexpr size_t max_queued_refreshes = 1024;
+
+void RGWSI_SysObj_Cache::queue_refresh(const rgw_raw_obj& obj, const string& name, uint32_t flags)
+{
+  {
+    std::lock_guard l{refresh_lock};
+    if (!refresh_stopping && refresh_thread.joinable() &&
+        refresh_queue.size() < max_queued_refreshes) {
+      refresh_queue.push_back({obj, name, flags});
+      refresh_cond.notify_one();
+      return;
+    }
+  }
+  cache.refresh_dropped(name);
+}
+
+void RGWSI_SysObj_Cache::refresh_entries()
+{
+  NoDoutPrefix dpp(cct, dout_subsys);
+  std::unique_lock l{refresh_lock};
+  for (;;) {
+    refresh_cond.wait(l, [this] { return refresh_stopping || !refresh_queue.empty(); });
+    if (refresh_stopping) {
+      break;
+    }
+    auto req = std::move(refresh_queue.front());
+    refresh_queue.pop_front();
+    l.unlock();
+    refresh_entry(&dpp, req);
+    l.lock();
+  }
+}
+
+void RGWSI_SysObj_Cache::refresh_entry(const DoutPrefixProvider *dpp, const RefreshRequest& req)
+{
+  ldpp_dout(dpp, 10) << "refreshing cache entry " << req.name << dendl;
+
+  RGWSI_SysObj_Core_GetObjState read_state;
+  RGWObjVersionTracker objv_tracker;
+  bufferlist bl;
+  map<string, bufferlist> attrs;
+  const bool want_data = req.flags & CACHE_FLAG_DATA;
+  const off_t end = want_data ? -1 : 0;
+
+  ObjectCacheInfo info;
+  int r = RGWSI_SysObj_Core::read(dpp, read_state,
+                                  (req.flags & CACHE_FLAG_OBJV ? &objv_tracker : nullptr),
+                                  req.obj, &bl, 0, end,
+                                  (req.flags & CACHE_FLAG_XATTRS ? &attrs : nullptr),
+                                  true, nullptr, boost::none, null_yield);
+  if (r == -ENOENT) {
+    info.status = r;
+    cache.refresh(dpp, req.name, info);
+    return;
+  }
+  if (r < 0) {
+    // leave the entry to expire
+    ldpp_dout(dpp, 5) << "WARNING: failed to refresh cache entry " << req.name
+                      << ": r=" << r << dendl;
+    cache.refresh_dropped(req.name);
+    return;
+  }
+
+  info.status = 0;
+  info.flags = req.flags;
+  if (want_data) {
+    info.data = std::move(bl);
+  }
+  if (req.flags & CACHE_FLAG_OBJV) {
+    info.version = objv_tracker.read_version;
+  }
+  if (req.flags & CACHE_FLAG_XATTRS) {
+    info.xattrs = std::move(attrs);
+  }
+  cache.refresh(dpp, req.name, info);
+}
+
 static string normal_name(rgw_pool& pool, const std::string& oid) {
   std::string buf;
   buf.reserve(pool.name.size() + pool.ns.size() + oid.size() + 2);
@@ -136,7 +229,12 @@ int RGWSI_SysObj_Cache::read(const DoutPrefixProvider *dpp,
   if (attrs)
     flags |= CACHE_FLAG_XATTRS;
   
-  int r = cache.get(dpp, name, info, flags, cache_info);
+  bool refresh = false;
+  int r = cache.get(dpp, name, info, flags, cache_info, &refresh);
+  if (refresh) {
+    // re-read all that the entry holds, not just what this lookup wanted
+    queue_refresh(obj, name, info.flags & CACHE_FLAGS_REFRESH);
+  }
   if (r == 0 &&
       (!refresh_version || !info.version.compare(&(*refresh_version)))) {
     if (info.status < 0)
@@ -3,7 +3,11 @@
 
 #pragma once
 
+#include <deque>
+#include <thread>
+
 #include "common/RWLock.h"
+#include "common/ceph_mutex.h"
 #include "rgw/rgw_service.h"
 #include "rgw/rgw_cache.h"
 
@@ -25,6 +29,24 @@ class RGWSI_SysObj_Cache : public RGWSI_SysObj_Core
 
   std::shared_ptr<RGWSI_SysObj_Cache_CB> cb;
 
+  // entries that the cache asked to refresh ahead of their expiry are
+  // re-read in the background, so that hot entries don't expire under
+  // load and send all their readers to rados at once
+  struct RefreshRequest {
+    rgw_raw_obj obj;
+    std::string name;
+    uint32_t flags;
+  };
+  ceph::mutex refresh_lock = ceph::make_mutex("RGWSI_SysObj_Cache::refresh_lock");
+  ceph::condition_variable refresh_cond;
+  std::deque<RefreshRequest> refresh_queue;
+  bool refresh_stopping{false};
+  std::thread refresh_thread;
+
+  void queue_refresh(const rgw_raw_obj& obj, const std::string& name, uint32_t flags);
+  void refresh_entries();
+  void refresh_entry(const DoutPrefixProvider *dpp, const RefreshRequest& req);
+
   void normalize_pool_and_obj(const rgw_pool& src_pool, const std::string& src_obj, rgw_pool& dst_pool, std::string& dst_obj);
 protected:
   void init(RGWSI_RADOS *_rados_svc,
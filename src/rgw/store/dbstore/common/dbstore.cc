@@ -258,6 +258,27 @@ int DB::ProcessOp(const DoutPrefixProvider *dpp, std::string_view Op, DBOpParams
   return ret;
 }
 
+int DB::PutObjectDataBatch(const DoutPrefixProvider *dpp, std::vector<DBOpParams>& chunks) {
+  int ret = -1;
+
+  auto db_op = std::dynamic_pointer_cast<PutObjectDataOp>(
+      getDBOp(dpp, "PutObjectData", &chunks.front()));
+  if (!db_op) {
+    ldpp_dout(dpp, 0)<<"No db_op found for Op(PutObjectData)" << dendl;
+    return ret;
+  }
+  ret = db_op->ExecuteBatch(dpp, chunks);
+
+  if (ret) {
+    ldpp_dout(dpp, 0)<<"In Process op ExecuteBatch failed for fop(PutObjectData)" << dendl;
+  } else {
+    ldpp_dout(dpp, 20)<<"Successfully processed " << chunks.size()
+      << " chunks of fop(PutObjectData)" << dendl;
+  }
+
+  return ret;
+}
+
 int DB::get_user(const DoutPrefixProvider *dpp,
     const std::string& query_str, const std::string& query_str_val,
     RGWUserInfo& uinfo, map<string, bufferlist> *pattrs,
@@ -1202,21 +1223,30 @@ int DB::raw_obj::read(const DoutPrefixProvider *dpp, int64_t ofs,
   return bl.length();
 }
 
+uint64_t DB::raw_obj::InitializeParamsforWrite(const DoutPrefixProvider *dpp, int64_t ofs,
+                                               int64_t write_ofs, uint64_t len,
+                                               bufferlist& bl, DBOpParams* params)
+{
+  db->InitializeParams(dpp, params);
+  InitializeParamsfromRawObj(dpp, params);
+
+  /* XXX: Check for chunk_size ?? */
+  params->op.obj_data.offset = ofs;
+  unsigned write_len = std::min((uint64_t)bl.length() - write_ofs, len);
+  bl.begin(write_ofs).copy(write_len, params->op.obj_data.data);
+  params->op.obj_data.size = params->op.obj_data.data.length();
+  params->op.obj.state.mtime = real_clock::now();
+
+  return write_len;
+}
+
 int DB::raw_obj::write(const DoutPrefixProvider *dpp, int64_t ofs, int64_t write_ofs,
                        uint64_t len, bufferlist& bl)
 {
   int ret = 0;
   DBOpParams params = {};
 
-  db->InitializeParams(dpp, &params);
-  InitializeParamsfromRawObj(dpp, &params);
-
-  /* XXX: Check for chunk_size ?? */
-  params.op.obj_data.offset = ofs;
-  unsigned write_len = std::min((uint64_t)bl.length() - write_ofs, len);
-  bl.begin(write_ofs).copy(write_len, params.op.obj_data.data);
-  params.op.obj_data.size = params.op.obj_data.data.length();
-  params.op.obj.state.mtime = real_clock::now();
+  unsigned write_len = InitializeParamsforWrite(dpp, ofs, write_ofs, len, bl, &params);
 
   ret = db->ProcessOp(dpp, "PutObjectData", &params);
 
@@ -1648,6 +1678,7 @@ int DB::Object::Write::write_data(const DoutPrefixProvider* dpp,
   /* as we are writing max_chunk_size at a time in sal_dbstore DBAtomicWriter::process(),
    * maybe this while loop is not needed
    */
+  std::vector<DBOpParams> chunks;
   while (write_ofs < end) {
     part_num = (ofs / max_chunk_size);
     uint64_t len = std::min(end, max_chunk_size);
@@ -1659,17 +1690,24 @@ int DB::Object::Write::write_data(const DoutPrefixProvider* dpp,
 
     ldpp_dout(dpp, 20) << "dbstore->write obj-ofs=" << ofs << " write_len=" << len << dendl;
 
-    // write into non head object
-    int r = write_obj.write(dpp, ofs, write_ofs, len, data); 
-    if (r < 0) {
-      return r;
-    }
+    // write into non head object, with the other chunks below
+    uint64_t r = write_obj.InitializeParamsforWrite(dpp, ofs, write_ofs, len, data,
+                                                    &chunks.emplace_back());
     /* r refers to chunk_len (no. of bytes) handled in raw_obj::write */
     len -= r;
     ofs += r;
     write_ofs += r;
   }
 
+  if (chunks.empty()) {
+    return 0;
+  }
+  int ret = store->PutObjectDataBatch(dpp, chunks);
+  if (ret) {
+    ldpp_dout(dpp, 0)<<"In PutObjectData failed err:(" <<ret<<")" << dendl;
+    return ret;
+  }
+
   return 0;
 }
 
@@ -1254,6 +1254,18 @@ class PutObjectDataOp: virtual public DBOp {
   public:
     virtual ~PutObjectDataOp() {}
 
+    /* Writes the chunks of one object's data. Backends that can write
+     * them in a single transaction override this. */
+    virtual int ExecuteBatch(const DoutPrefixProvider *dpp,
+                             std::vector<DBOpParams>& chunks) {
+      for (auto& chunk : chunks) {
+        int ret = Execute(dpp, &chunk);
+        if (ret)
+          return ret;
+      }
+      return 0;
+    }
+
     static std::string Schema(DBOpPrepareParams &params) {
       return fmt::format(Query,
           params.objectdata_table,
@@ -1569,6 +1581,8 @@ class DB {
 
     int InitializeParams(const DoutPrefixProvider *dpp, DBOpParams *params);
     int ProcessOp(const DoutPrefixProvider *dpp, std::string_view Op, DBOpParams *params);
+    /* Writes chunks of data of the same object together */
+    int PutObjectDataBatch(const DoutPrefixProvider *dpp, std::vector<DBOpParams>& chunks);
     std::shared_ptr<class DBOp> getDBOp(const DoutPrefixProvider *dpp, std::string_view Op, const DBOpParams *params);
     int objectmapInsert(const DoutPrefixProvider *dpp, std::string bucket, class ObjectOp* ptr);
     int objectmapDelete(const DoutPrefixProvider *dpp, std::string bucket);
@@ -1714,6 +1728,9 @@ class DB {
 
       int read(const DoutPrefixProvider *dpp, int64_t ofs, uint64_t end, bufferlist& bl);
       int write(const DoutPrefixProvider *dpp, int64_t ofs, int64_t write_ofs, uint64_t len, bufferlist& bl);
+      /* Fills params to write the data at write_ofs in bl; returns its length */
+      uint64_t InitializeParamsforWrite(const DoutPrefixProvider *dpp, int64_t ofs, int64_t write_ofs,
+                                        uint64_t len, bufferlist& bl, DBOpParams* params);
     };
 
     class GC : public Thread {
@@ -15,7 +15,9 @@
 
 #pragma once
 
+#include <map>
 #include <memory>
+#include <string>
 #include <sqlite3.h>
 
 #undef FMT_HEADER_ONLY
@@ -42,7 +44,7 @@ db_ptr open_database(const char* filename, int flags);
 struct Connection {
   db_ptr db;
   // map of statements, prepared on first use
-  std::map<std::string_view, stmt_ptr> statements;
+  std::map<std::string, stmt_ptr, std::less<>> statements;
 
   explicit Connection(db_ptr db) : db(std::move(db)) {}
 };
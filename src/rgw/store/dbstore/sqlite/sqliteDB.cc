@@ -2,6 +2,7 @@
 // vim: ts=8 sw=2 smarttab
 
 #include "sqliteDB.h"
+#include "rgw/store/dbstore/sqlite/error.h"
 
 using namespace std;
 
@@ -612,6 +613,69 @@ int SQLiteDB::InitializeDBOps(const DoutPrefixProvider *dpp)
   return 0;
 }
 
+/* Per connection settings, for the shared handle and the data connections */
+static void tune_connection(const DoutPrefixProvider *dpp, CephContext *cct,
+                            sqlite3 *db)
+{
+  auto exec = [dpp, db] (const std::string& pragma) {
+    char *errmsg = NULL;
+    if (sqlite3_exec(db, pragma.c_str(), NULL, 0, &errmsg) != SQLITE_OK) {
+      ldpp_dout(dpp, 0) <<"sqlite exec failed for schema("<<pragma \
+        <<"); Errmsg - "<<errmsg <<  dendl;
+      sqlite3_free(errmsg);
+    }
+  };
+
+  exec("PRAGMA foreign_keys=ON");
+
+  if (cct->_conf.get_val<bool>("dbstore_sqlite_wal")) {
+    /* readers don't block the writer, and a commit appends to the log
+     * instead of rewriting pages of the database file */
+    exec("PRAGMA journal_mode=WAL");
+    if (cct->_conf.get_val<bool>("dbstore_sqlite_synchronous_normal")) {
+      /* don't sync the log on commit, only when it is checkpointed. a
+       * crash may lose the latest commits, but not corrupt the database */
+      exec("PRAGMA synchronous=NORMAL");
+    }
+  }
+  {
+    const uint64_t mmap_size = cct->_conf.get_val<Option::size_t>("dbstore_sqlite_mmap_size");
+    exec(fmt::format("PRAGMA mmap_size={}", mmap_size));
+  }
+  /* wait for other processes (e.g. radosgw-admin) that hold the lock,
+   * instead of failing with SQLITE_BUSY */
+  sqlite3_busy_timeout(db,
+      cct->_conf.get_val<std::chrono::milliseconds>("dbstore_sqlite_busy_timeout").count());
+}
+
+auto SQLiteConnectionFactory::operator()(const DoutPrefixProvider* dpp)
+  -> std::unique_ptr<rgw::dbstore::sqlite::Connection>
+{
+  /* a connection is only used by one thread at a time */
+  auto db = rgw::dbstore::sqlite::open_database(dbfile.c_str(),
+      SQLITE_OPEN_READWRITE | SQLITE_OPEN_NOMUTEX);
+  tune_connection(dpp, cct, db.get());
+  return std::make_unique<rgw::dbstore::sqlite::Connection>(std::move(db));
+}
+
+/* The data connections of each database file, shared by the ops of all
+ * its buckets */
+static std::mutex data_pools_lock;
+static std::map<std::string, std::shared_ptr<SQLiteConnectionPool>> data_pools;
+
+std::shared_ptr<SQLiteConnectionPool> SQLiteDB::get_data_pool()
+{
+  const std::string dbfile = getDBfile();
+  std::lock_guard l{data_pools_lock};
+  auto& pool = data_pools[dbfile];
+  if (!pool) {
+    pool = std::make_shared<SQLiteConnectionPool>(
+        SQLiteConnectionFactory{dbfile, cct},
+        cct->_conf.get_val<uint64_t>("dbstore_sqlite_data_connections"));
+  }
+  return pool;
+}
+
 void *SQLiteDB::openDB(const DoutPrefixProvider *dpp)
 {
   string dbname;
@@ -636,7 +700,9 @@ void *SQLiteDB::openDB(const DoutPrefixProvider *dpp)
     ldpp_dout(dpp, 0) <<"Opened database("<<dbname<<") successfully" <<  dendl;
   }
 
-  exec(dpp, "PRAGMA foreign_keys=ON", NULL);
+  if (db) {
+    tune_connection(dpp, cct, (sqlite3*)db);
+  }
 
 out:
   return db;
@@ -644,6 +710,11 @@ out:
 
 int SQLiteDB::closeDB(const DoutPrefixProvider *dpp)
 {
+  {
+    /* closed once the ops that still use them are gone */
+    std::lock_guard l{data_pools_lock};
+    data_pools.erase(getDBfile());
+  }
   if (db)
     sqlite3_close((sqlite3 *)db);
 
@@ -679,7 +750,7 @@ again:
 
   if ((ret != SQLITE_DONE) && (ret != SQLITE_ROW)) {
     ldpp_dout(dpp, 0)<<"sqlite step failed for stmt("<<stmt \
-      <<"); Errmsg - "<<sqlite3_errmsg((sqlite3*)db) << dendl;
+      <<"); Errmsg - "<<sqlite3_errmsg(sqlite3_db_handle(stmt)) << dendl;
     return -1;
   } else if (ret == SQLITE_ROW) {
     if (cbk) {
@@ -2392,29 +2463,31 @@ out:
   return ret;
 }
 
-int SQLPutObjectData::Prepare(const DoutPrefixProvider *dpp, struct DBOpParams *params)
+sqlite3_stmt *SQLPutObjectData::PrepareStmt(const DoutPrefixProvider *dpp, struct DBOpParams *params,
+                                            rgw::dbstore::sqlite::Connection& conn)
 {
-  int ret = -1;
   struct DBOpPrepareParams p_params = PrepareParams;
 
-  if (!*sdb) {
-    ldpp_dout(dpp, 0)<<"In SQLPutObjectData - no db" << dendl;
-    goto out;
-  }
-
   InitPrepareParams(dpp, p_params, params);
 
-  SQL_PREPARE(dpp, p_params, sdb, stmt, ret, "PreparePutObjectData");
-
-out:
-  return ret;
+  /* the op is per bucket, the connection is not */
+  auto& stmt = conn.statements["PutObjectData:" + p_params.objectdata_table];
+  if (!stmt) {
+    stmt = rgw::dbstore::sqlite::prepare_statement(dpp, conn.db.get(), Schema(p_params));
+    ldpp_dout(dpp, 20)<<"Successfully Prepared stmt for Op(PreparePutObjectData) stmt("
+      <<stmt.get()<<")"<< dendl;
+  }
+  return stmt.get();
 }
 
-int SQLPutObjectData::Bind(const DoutPrefixProvider *dpp, struct DBOpParams *params)
+int SQLPutObjectData::BindStmt(const DoutPrefixProvider *dpp, struct DBOpParams *params,
+                               sqlite3_stmt *stmt)
 {
   int index = -1;
   int rc = 0;
   struct DBOpPrepareParams p_params = PrepareParams;
+  sqlite3 *conn_db = sqlite3_db_handle(stmt);
+  sqlite3 **sdb = &conn_db;
 
   if (params->op.obj.state.obj.key.instance.empty()) {
     params->op.obj.state.obj.key.instance = "null";
@@ -2465,13 +2538,53 @@ out:
   return rc;
 }
 
+int SQLPutObjectData::Write(const DoutPrefixProvider *dpp, struct DBOpParams *chunks,
+                            size_t count)
+{
+  const bool batch = count > 1;
+
+  try {
+    auto conn = pool->get(dpp);
+    sqlite3_stmt *stmt = PrepareStmt(dpp, &chunks[0], *conn);
+
+    /* nothing is synced or visible to the readers until all of it is in */
+    if (batch) {
+      rgw::dbstore::sqlite::execute(dpp, conn->db.get(), "BEGIN", nullptr, nullptr);
+    }
+    try {
+      for (size_t i = 0; i < count; ++i) {
+        auto binding = rgw::dbstore::sqlite::stmt_binding{stmt};
+        if (BindStmt(dpp, &chunks[i], stmt)) {
+          throw rgw::dbstore::sqlite::error(conn->db.get());
+        }
+        auto reset = rgw::dbstore::sqlite::stmt_execution{stmt};
+        rgw::dbstore::sqlite::eval0(dpp, reset);
+      }
+      if (batch) {
+        rgw::dbstore::sqlite::execute(dpp, conn->db.get(), "COMMIT", nullptr, nullptr);
+      }
+    } catch (const std::exception&) {
+      if (batch) {
+        sqlite3_exec(conn->db.get(), "ROLLBACK", NULL, 0, NULL);
+      }
+      throw;
+    }
+  } catch (const std::exception& e) {
+    ldpp_dout(dpp, 0)<<"In SQLPutObjectData - writing "<<count
+      <<" chunks failed: "<<e.what()<< dendl;
+    return -1;
+  }
+  return 0;
+}
+
 int SQLPutObjectData::Execute(const DoutPrefixProvider *dpp, struct DBOpParams *params)
 {
-  int ret = -1;
+  return Write(dpp, params, 1);
+}
 
-  SQL_EXECUTE(dpp, params, stmt, NULL);
-out:
-  return ret;
+int SQLPutObjectData::ExecuteBatch(const DoutPrefixProvider *dpp, std::vector<DBOpParams>& chunks)
+{
+  return Write(dpp, chunks.data(), chunks.size());
 }
 
 int SQLUpdateObjectData::Prepare(const DoutPrefixProvider *dpp, struct DBOpParams *params)
@@ -2529,28 +2642,30 @@ out:
   return ret;
 }
 
-int SQLGetObjectData::Prepare(const DoutPrefixProvider *dpp, struct DBOpParams *params)
+sqlite3_stmt *SQLGetObjectData::PrepareStmt(const DoutPrefixProvider *dpp, struct DBOpParams *params,
+                                            rgw::dbstore::sqlite::Connection& conn)
 {
-  int ret = -1;
   struct DBOpPrepareParams p_params = PrepareParams;
 
-  if (!*sdb) {
-    ldpp_dout(dpp, 0)<<"In SQLGetObjectData - no db" << dendl;
-    goto out;
-  }
-
   InitPrepareParams(dpp, p_params, params);
-  SQL_PREPARE(dpp, p_params, sdb, stmt, ret, "PrepareGetObjectData");
 
-out:
-  return ret;
+  auto& stmt = conn.statements["GetObjectData:" + p_params.objectdata_table];
+  if (!stmt) {
+    stmt = rgw::dbstore::sqlite::prepare_statement(dpp, conn.db.get(), Schema(p_params));
+    ldpp_dout(dpp, 20)<<"Successfully Prepared stmt for Op(PrepareGetObjectData) stmt("
+      <<stmt.get()<<")"<< dendl;
+  }
+  return stmt.get();
 }
 
-int SQLGetObjectData::Bind(const DoutPrefixProvider *dpp, struct DBOpParams *params)
+int SQLGetObjectData::BindStmt(const DoutPrefixProvider *dpp, struct DBOpParams *params,
+                               sqlite3_stmt *stmt)
 {
   int index = -1;
   int rc = 0;
   struct DBOpPrepareParams p_params = PrepareParams;
+  sqlite3 *conn_db = sqlite3_db_handle(stmt);
+  sqlite3 **sdb = &conn_db;
 
   if (params->op.obj.state.obj.key.instance.empty()) {
     params->op.obj.state.obj.key.instance = "null";
@@ -2576,8 +2691,25 @@ int SQLGetObjectData::Execute(const DoutPrefixProvider *dpp, struct DBOpParams *
 {
   int ret = -1;
 
-  SQL_EXECUTE(dpp, params, stmt, get_objectdata);
-out:
+  try {
+    auto conn = pool->get(dpp);
+    sqlite3_stmt *stmt = PrepareStmt(dpp, params, *conn);
+
+    ret = BindStmt(dpp, params, stmt);
+    if (ret) {
+      ldpp_dout(dpp, 0) <<"Bind parameters failed for stmt(" <<stmt<<") "<< dendl;
+      Reset(dpp, stmt);
+      return ret;
+    }
+    ret = Step(dpp, params->op, stmt, get_objectdata);
+    Reset(dpp, stmt);
+    if (ret) {
+      ldpp_dout(dpp, 0) <<"Execution failed for stmt(" <<stmt<<")"<< dendl;
+    }
+  } catch (const std::exception& e) {
+    ldpp_dout(dpp, 0)<<"In SQLGetObjectData - "<<e.what()<< dendl;
+    return -1;
+  }
   return ret;
 }
 
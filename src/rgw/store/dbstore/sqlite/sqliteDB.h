@@ -9,9 +9,26 @@
 #include <string>
 #include <sqlite3.h>
 #include "rgw/store/dbstore/common/dbstore.h"
+#include "rgw/store/dbstore/common/connection_pool.h"
+#include "rgw/store/dbstore/sqlite/connection.h"
 
 using namespace rgw::store;
 
+/* Opens connections to a database file, set up like the one of SQLiteDB */
+class SQLiteConnectionFactory {
+  std::string dbfile;
+  CephContext *cct;
+ public:
+  SQLiteConnectionFactory(std::string dbfile, CephContext *cct)
+    : dbfile(std::move(dbfile)), cct(cct) {}
+
+  auto operator()(const DoutPrefixProvider* dpp)
+    -> std::unique_ptr<rgw::dbstore::sqlite::Connection>;
+};
+
+using SQLiteConnectionPool = rgw::dbstore::ConnectionPool<
+    rgw::dbstore::sqlite::Connection, SQLiteConnectionFactory>;
+
 class SQLiteDB : public DB, virtual public DBOp {
   private:
     sqlite3_mutex *mutex = NULL;
@@ -31,6 +48,10 @@ class SQLiteDB : public DB, virtual public DBOp {
     ~SQLiteDB() {}
 
     uint64_t get_blob_limit() override { return SQLITE_LIMIT_LENGTH; }
+    /* Connections of the calling threads for the object data ops, so they
+     * don't all wait on the one handle and the mutex of their op. Each keeps
+     * its own prepared statements. */
+    std::shared_ptr<SQLiteConnectionPool> get_data_pool();
     void *openDB(const DoutPrefixProvider *dpp) override;
     int closeDB(const DoutPrefixProvider *dpp) override;
     int InitializeDBOps(const DoutPrefixProvider *dpp) override;
@@ -349,19 +370,20 @@ class SQLListVersionedObjects : public SQLiteDB, public ListVersionedObjectsOp {
 class SQLPutObjectData : public SQLiteDB, public PutObjectDataOp {
   private:
     sqlite3 **sdb = NULL;
-    sqlite3_stmt *stmt = NULL; // Prepared statement
+    std::shared_ptr<SQLiteConnectionPool> pool;
+
+    int Write(const DoutPrefixProvider *dpp, DBOpParams *chunks, size_t count);
 
   public:
-    SQLPutObjectData(void **db, std::string db_name, CephContext *cct) : SQLiteDB((sqlite3 *)(*db), db_name, cct), sdb((sqlite3 **)db) {}
-    SQLPutObjectData(sqlite3 **sdbi, std::string db_name, CephContext *cct) : SQLiteDB(*sdbi, db_name, cct), sdb(sdbi) {}
+    SQLPutObjectData(void **db, std::string db_name, CephContext *cct) : SQLiteDB((sqlite3 *)(*db), db_name, cct), sdb((sqlite3 **)db), pool(get_data_pool()) {}
+    SQLPutObjectData(sqlite3 **sdbi, std::string db_name, CephContext *cct) : SQLiteDB(*sdbi, db_name, cct), sdb(sdbi), pool(get_data_pool()) {}
 
-    ~SQLPutObjectData() {
-      if (stmt)
-        sqlite3_finalize(stmt);
-    }
-    int Prepare(const DoutPrefixProvider *dpp, DBOpParams *params);
+    ~SQLPutObjectData() {}
+    sqlite3_stmt *PrepareStmt(const DoutPrefixProvider *dpp, DBOpParams *params,
+                              rgw::dbstore::sqlite::Connection& conn);
     int Execute(const DoutPrefixProvider *dpp, DBOpParams *params);
-    int Bind(const DoutPrefixProvider *dpp, DBOpParams *params);
+    int ExecuteBatch(const DoutPrefixProvider *dpp, std::vector<DBOpParams>& chunks) override;
+    int BindStmt(const DoutPrefixProvider *dpp, DBOpParams *params, sqlite3_stmt *stmt);
 };
 
 class SQLUpdateObjectData : public SQLiteDB, public UpdateObjectDataOp {
@@ -385,19 +407,17 @@ class SQLUpdateObjectData : public SQLiteDB, public UpdateObjectDataOp {
 class SQLGetObjectData : public SQLiteDB, public GetObjectDataOp {
   private:
     sqlite3 **sdb = NULL;
-    sqlite3_stmt *stmt = NULL; // Prepared statement
+    std::shared_ptr<SQLiteConnectionPool> pool;
 
   public:
-    SQLGetObjectData(void **db, std::string db_name, CephContext *cct) : SQLiteDB((sqlite3 *)(*db), db_name, cct), sdb((sqlite3 **)db) {}
-    SQLGetObjectData(sqlite3 **sdbi, std::string db_name, CephContext *cct) : SQLiteDB(*sdbi, db_name, cct), sdb(sdbi) {}
+    SQLGetObjectData(void **db, std::string db_name, CephContext *cct) : SQLiteDB((sqlite3 *)(*db), db_name, cct), sdb((sqlite3 **)db), pool(get_data_pool()) {}
+    SQLGetObjectData(sqlite3 **sdbi, std::string db_name, CephContext *cct) : SQLiteDB(*sdbi, db_name, cct), sdb(sdbi), pool(get_data_pool()) {}
 
-    ~SQLGetObjectData() {
-      if (stmt)
-        sqlite3_finalize(stmt);
-    }
-    int Prepare(const DoutPrefixProvider *dpp, DBOpParams *params);
+    ~SQLGetObjectData() {}
+    sqlite3_stmt *PrepareStmt(const DoutPrefixProvider *dpp, DBOpParams *params,
+                              rgw::dbstore::sqlite::Connection& conn);
     int Execute(const DoutPrefixProvider *dpp, DBOpParams *params);
-    int Bind(const DoutPrefixProvider *dpp, DBOpParams *params);
+    int BindStmt(const DoutPrefixProvider *dpp, DBOpParams *params, sqlite3_stmt *stmt);
 };
 
 class SQLDeleteObjectData : public SQLiteDB, public DeleteObjectDataOp {
@@ -4,6 +4,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <atomic>
+#include <thread>
 #include <dbstore.h>
 #include <sqliteDB.h>
 #include "rgw_common.h"
@@ -1242,6 +1244,89 @@ TEST_F(DBStoreTest, GetObjectData) {
   ASSERT_EQ(data, "HELLO WORLD");
 }
 
+TEST_F(DBStoreTest, PutObjectDataBatch) {
+  std::vector<DBOpParams> chunks;
+  int ret = -1;
+
+  for (int i = 0; i < 3; i++) {
+    struct DBOpParams& params = chunks.emplace_back(GlobalParams);
+    params.op.obj.state.obj.key.name = "object_batch";
+    params.op.obj_data.part_num = i;
+    params.op.obj_data.offset = i * 10;
+    params.op.obj_data.multipart_part_str = "0.0";
+    bufferlist b1;
+    encode("CHUNK" + to_string(i), b1);
+    params.op.obj_data.data = b1;
+    params.op.obj_data.size = b1.length();
+    params.op.obj.state.mtime = real_clock::now();
+  }
+  ret = db->PutObjectDataBatch(dpp, chunks);
+  ASSERT_EQ(ret, 0);
+
+  /* rows come in part order, the last one is what's returned */
+  struct DBOpParams params = GlobalParams;
+  params.op.obj.state.obj.key.name = "object_batch";
+  ret = db->ProcessOp(dpp, "GetObjectData", &params);
+  ASSERT_EQ(ret, 0);
+  ASSERT_EQ(params.op.obj_data.part_num, 2);
+  ASSERT_EQ(params.op.obj_data.offset, 20);
+  string data;
+  decode(data, params.op.obj_data.data);
+  ASSERT_EQ(data, "CHUNK2");
+}
+
+TEST_F(DBStoreTest, PutObjectDataConcurrent) {
+  std::atomic<int> failed = 0;
+  std::vector<std::thread> threads;
+
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([&, t] {
+      for (int i = 0; i < 20; i++) {
+        struct DBOpParams params = GlobalParams;
+        params.op.obj.state.obj.key.name = "object_thread" + to_string(t);
+        params.op.obj_data.part_num = i;
+        params.op.obj_data.multipart_part_str = "0.0";
+        bufferlist b1;
+        encode("HELLO WORLD", b1);
+        params.op.obj_data.data = b1;
+        params.op.obj_data.size = b1.length();
+        params.op.obj.state.mtime = real_clock::now();
+        if (db->ProcessOp(dpp, "PutObjectData", &params)) {
+          ++failed;
+        }
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  ASSERT_EQ(failed, 0);
+
+  for (int t = 0; t < 4; t++) {
+    struct DBOpParams params = GlobalParams;
+    params.op.obj.state.obj.key.name = "object_thread" + to_string(t);
+    ret = db->ProcessOp(dpp, "GetObjectData", &params);
+    ASSERT_EQ(ret, 0);
+    ASSERT_EQ(params.op.obj_data.part_num, 19);
+  }
+}
+
+TEST_F(DBStoreTest, JournalMode) {
+  sqlite3 *sdb = nullptr;
+  sqlite3_stmt *stmt = nullptr;
+
+  /* WAL mode is kept in the database file */
+  ASSERT_EQ(sqlite3_open_v2(db->getDBfile().c_str(), &sdb,
+                            SQLITE_OPEN_READONLY, nullptr), SQLITE_OK);
+  ASSERT_EQ(sqlite3_prepare_v2(sdb, "PRAGMA journal_mode", -1, &stmt, nullptr),
+            SQLITE_OK);
+  ASSERT_EQ(sqlite3_step(stmt), SQLITE_ROW);
+  string mode = (const char*)sqlite3_column_text(stmt, 0);
+  sqlite3_finalize(stmt);
+  sqlite3_close(sdb);
+  ASSERT_EQ(mode, "wal");
+}
+
 TEST_F(DBStoreTest, DeleteObjectData) {
   struct DBOpParams params = GlobalParams;
   int ret = -1;
@@ -22,6 +22,7 @@
 #include <limits.h>
 #include <errno.h>
 #include <sys/uio.h>
+#include <thread>
 
 #include "include/buffer.h"
 #include "include/buffer_raw.h"
@@ -126,6 +127,9 @@ TEST(Buffer, constructors) {
 
 void bench_buffer_alloc(int size, int num)
 {
+  buffer::track_slab_cache(true);
+  const auto hits = buffer::get_slab_cache_hits();
+  const auto misses = buffer::get_slab_cache_misses();
   utime_t start = ceph_clock_now();
   for (int i=0; i<num; ++i) {
     bufferptr p = buffer::create(size);
@@ -133,7 +137,10 @@ void bench_buffer_alloc(int size, int num)
   }
   utime_t end = ceph_clock_now();
   cout << num << " alloc of size " << size
-       << " in " << (end - start) << std::endl;
+       << " in " << (end - start)
+       << " (" << buffer::get_slab_cache_misses() - misses << " heap, "
+       << buffer::get_slab_cache_hits() - hits << " slab)" << std::endl;
+  buffer::track_slab_cache(false);
 }
 
 TEST(Buffer, BenchAlloc) {
@@ -1312,6 +1319,9 @@ TEST(BufferList, append_after_move) {
 
 void bench_bufferlist_alloc(int size, int num, int per)
 {
+  buffer::track_slab_cache(true);
+  const auto hits = buffer::get_slab_cache_hits();
+  const auto misses = buffer::get_slab_cache_misses();
   utime_t start = ceph_clock_now();
   for (int i=0; i<num; ++i) {
     bufferlist bl;
@@ -1320,7 +1330,57 @@ void bench_bufferlist_alloc(int size, int num, int per)
   }
   utime_t end = ceph_clock_now();
   cout << num << " alloc of size " << size
-       << " in " << (end - start) << std::endl;
+       << " in " << (end - start)
+       << " (" << buffer::get_slab_cache_misses() - misses << " heap, "
+       << buffer::get_slab_cache_hits() - hits << " slab)" << std::endl;
+  buffer::track_slab_cache(false);
+}
+
+TEST(BufferList, SlabCacheCrossThread) {
+  // allocate on one thread, release on another, then allocate again:
+  // the second round should be served from the blocks the releasing
+  // thread handed back.  the caches and depot hold all of them: 512
+  // 4K buffers, 512 2K ones, and 1024 ptr_nodes.
+  constexpr int count = 512;
+  // a ptr_node and a raw_combined for each append
+  constexpr uint64_t allocs = 4 * count;
+  // what the releasing thread frees instead of handing back when it
+  // exits: less than a batch of each of the three sizes
+  constexpr uint64_t max_lost = 64 + 16 + 8;
+  std::vector<bufferlist> bls(count);
+  buffer::track_slab_cache(true);
+  for (int round = 0; round < 2; ++round) {
+    const uint64_t hits = buffer::get_slab_cache_hits();
+    const uint64_t misses = buffer::get_slab_cache_misses();
+    std::thread producer([&bls] {
+      for (auto& bl : bls) {
+	bl.append("0123456789", 10);
+	bl.append(buffer::create(1000));
+      }
+    });
+    producer.join();
+    const uint64_t round_hits = buffer::get_slab_cache_hits() - hits;
+    const uint64_t round_misses = buffer::get_slab_cache_misses() - misses;
+    EXPECT_EQ(allocs, round_hits + round_misses);
+    if (round > 0) {
+      EXPECT_GE(round_hits, allocs - max_lost);
+      EXPECT_LE(round_misses, max_lost);
+    }
+    for (auto& bl : bls) {
+      EXPECT_EQ(1010u, bl.length());
+      EXPECT_EQ(0, memcmp("0123456789", bl.front().c_str(), 10));
+    }
+    std::thread consumer([&bls] {
+      for (auto& bl : bls) {
+	bl.clear();
+      }
+    });
+    consumer.join();
+    // what the consumer handed back is accounted
+    EXPECT_LE((count - 8) * 4096u,
+	      mempool::buffer_slab::allocated_bytes());
+  }
+  buffer::track_slab_cache(false);
 }
 
 TEST(BufferList, BenchAlloc) {
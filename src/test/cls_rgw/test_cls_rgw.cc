@@ -170,6 +170,82 @@ TEST_F(cls_rgw, index_multiple_obj_writers)
   }
 }
 
+static rgw_cls_obj_complete_op complete_add(librados::IoCtx& ioctx,
+                                            const cls_rgw_obj_key& key,
+                                            const string& tag, uint64_t size)
+{
+  rgw_cls_obj_complete_op call;
+  call.op = CLS_RGW_OP_ADD;
+  call.key = key;
+  call.tag = tag;
+  call.ver.pool = ioctx.get_id();
+  call.ver.epoch = 1;
+  call.meta.category = RGWObjCategory::None;
+  call.meta.size = size;
+  call.meta.accounted_size = size;
+  call.log_op = true;
+  return call;
+}
+
+static int bilog_list(librados::IoCtx& ioctx, const std::string& oid,
+                      cls_rgw_bi_log_list_ret *result);
+
+TEST_F(cls_rgw, index_complete_batch)
+{
+  string bucket_oid = str_int("batch", 0);
+
+  ObjectWriteOperation op;
+  cls_rgw_bucket_init_index(op);
+  ASSERT_EQ(0, ioctx.operate(bucket_oid, &op));
+
+  uint64_t obj_size = 1024;
+
+  std::vector<rgw_cls_obj_complete_op> ops;
+  for (int i = 0; i < NUM_OBJS; i++) {
+    cls_rgw_obj_key obj = str_int("obj", i);
+    string tag = str_int("tag", i);
+    string loc = str_int("loc", i);
+    index_prepare(ioctx, bucket_oid, CLS_RGW_OP_ADD, tag, obj, loc);
+    ops.push_back(complete_add(ioctx, obj, tag, obj_size));
+  }
+
+  {
+    // a batch can't touch the same entry twice; none of it is applied
+    auto dup = ops;
+    dup.push_back(dup.front());
+    ObjectWriteOperation op;
+    cls_rgw_bucket_complete_ops(op, std::move(dup));
+    ASSERT_EQ(-EINVAL, ioctx.operate(bucket_oid, &op));
+    test_stats(ioctx, bucket_oid, RGWObjCategory::None, 0, 0);
+  }
+  {
+    // nor is it if any op fails
+    auto bad = ops;
+    bad.back().tag = "unknown";
+    ObjectWriteOperation op;
+    cls_rgw_bucket_complete_ops(op, std::move(bad));
+    ASSERT_EQ(-EINVAL, ioctx.operate(bucket_oid, &op));
+    test_stats(ioctx, bucket_oid, RGWObjCategory::None, 0, 0);
+  }
+
+  ObjectWriteOperation complete;
+  cls_rgw_bucket_complete_ops(complete, ops);
+  ASSERT_EQ(0, ioctx.operate(bucket_oid, &complete));
+  test_stats(ioctx, bucket_oid, RGWObjCategory::None, NUM_OBJS,
+	     obj_size * NUM_OBJS);
+
+  // every op is logged, under its own index version
+  cls_rgw_bi_log_list_ret bilog;
+  ASSERT_EQ(0, bilog_list(ioctx, bucket_oid, &bilog));
+  ASSERT_EQ(static_cast<size_t>(NUM_OBJS), bilog.entries.size());
+  std::set<std::string> ids;
+  for (const auto& entry : bilog.entries) {
+    EXPECT_EQ(CLS_RGW_STATE_COMPLETE, entry.state);
+    ids.insert(entry.id);
+  }
+  EXPECT_EQ(bilog.entries.size(), ids.size());
+}
+
 TEST_F(cls_rgw, index_remove_object)
 {
   string bucket_oid = str_int("bucket", 2);
@@ -1252,3 +1328,327 @@ TEST_F(cls_rgw, bi_log_trim)
     EXPECT_FALSE(truncated);
   }
 }
+
+static void add_obj(librados::IoCtx& ioctx, string& oid,
+                    const cls_rgw_obj_key& key, uint64_t size, int epoch)
+{
+  string tag = "tag-" + key.name + key.instance + "-" + std::to_string(epoch);
+  string loc = "loc-" + key.name;
+  index_prepare(ioctx, oid, CLS_RGW_OP_ADD, tag, key, loc);
+  rgw_bucket_dir_entry_meta meta;
+  meta.category = RGWObjCategory::None;
+  meta.size = size;
+  index_complete(ioctx, oid, CLS_RGW_OP_ADD, tag, epoch, key, meta);
+}
+
+static void remove_obj(librados::IoCtx& ioctx, string& oid,
+                       const cls_rgw_obj_key& key, int epoch)
+{
+  string tag = "tag-rm-" + key.name + "-" + std::to_string(epoch);
+  string loc = "loc-" + key.name;
+  index_prepare(ioctx, oid, CLS_RGW_OP_DEL, tag, key, loc);
+  rgw_bucket_dir_entry_meta meta;
+  index_complete(ioctx, oid, CLS_RGW_OP_DEL, tag, epoch, key, meta);
+}
+
+static void set_reshard_status(librados::IoCtx& ioctx, const string& oid,
+                               cls_rgw_reshard_status status,
+                               ceph::real_time logrecord_expire = {})
+{
+  cls_rgw_bucket_instance_entry entry;
+  entry.set_status(status);
+  entry.logrecord_expire = logrecord_expire;
+  ASSERT_EQ(0, cls_rgw_set_bucket_resharding(ioctx, oid, entry));
+}
+
+// the whole reshard log, read a few entries at a time
+static map<string, uint64_t> reshard_log(librados::IoCtx& ioctx,
+                                         const string& oid)
+{
+  map<string, uint64_t> log;
+  string marker;
+  bool truncated = true;
+  while (truncated) {
+    map<string, uint64_t> page;
+    EXPECT_EQ(0, cls_rgw_reshard_log_list(ioctx, oid, marker, 2,
+                                          &page, &truncated));
+    if (page.empty()) {
+      break;
+    }
+    marker = page.rbegin()->first;
+    log.insert(page.begin(), page.end());
+  }
+  return log;
+}
+
+static list<rgw_cls_bi_entry> bi_entries(librados::IoCtx& ioctx,
+                                         const string& oid,
+                                         const string& name = "")
+{
+  list<rgw_cls_bi_entry> entries;
+  bool truncated = false;
+  EXPECT_EQ(0, cls_rgw_bi_list(ioctx, oid, name, "", 1000,
+                               &entries, &truncated));
+  EXPECT_FALSE(truncated);
+  return entries;
+}
+
+TEST_F(cls_rgw, bi_put_entries)
+{
+  string src_oid = "put-entries-src";
+  string dst_oid = "put-entries-dst";
+  for (auto& oid : {src_oid, dst_oid}) {
+    ObjectWriteOperation op;
+    cls_rgw_bucket_init_index(op);
+    ASSERT_EQ(0, ioctx.operate(oid, &op));
+  }
+  for (int i = 0; i < 3; i++) {
+    add_obj(ioctx, src_oid, str_int("obj", i), 1024, 1);
+  }
+
+  // copy everything
+  {
+    auto entries = bi_entries(ioctx, src_oid);
+    ASSERT_EQ(3u, entries.size());
+    ObjectWriteOperation op;
+    cls_rgw_bi_put_entries(op, {entries.begin(), entries.end()}, {}, false);
+    ASSERT_EQ(0, ioctx.operate(dst_oid, &op));
+    test_stats(ioctx, dst_oid, RGWObjCategory::None, 3, 3 * 1024);
+  }
+  // replacing an entry that was copied before only accounts for it once
+  add_obj(ioctx, src_oid, str_int("obj", 0), 4096, 2);
+  {
+    auto entries = bi_entries(ioctx, src_oid, str_int("obj", 0));
+    ASSERT_EQ(1u, entries.size());
+    ObjectWriteOperation op;
+    cls_rgw_bi_put_entries(op, {entries.begin(), entries.end()}, {}, true);
+    ASSERT_EQ(0, ioctx.operate(dst_oid, &op));
+    test_stats(ioctx, dst_oid, RGWObjCategory::None, 3, 4096 + 2 * 1024);
+  }
+  // removals take the entry out of the stats, missing ones are ignored
+  {
+    ObjectWriteOperation op;
+    cls_rgw_bi_put_entries(op, {}, {str_int("obj", 1), "missing"}, false);
+    ASSERT_EQ(0, ioctx.operate(dst_oid, &op));
+    test_stats(ioctx, dst_oid, RGWObjCategory::None, 2, 4096 + 1024);
+    EXPECT_EQ(2u, bi_entries(ioctx, dst_oid).size());
+  }
+}
+
+TEST_F(cls_rgw, reshard_log_list_trim)
+{
+  string bucket_oid = "reshard-log-trim";
+  ObjectWriteOperation op;
+  cls_rgw_bucket_init_index(op);
+  ASSERT_EQ(0, ioctx.operate(bucket_oid, &op));
+
+  set_reshard_status(ioctx, bucket_oid, cls_rgw_reshard_status::IN_LOGRECORD);
+  for (int i = 0; i < 5; i++) {
+    add_obj(ioctx, bucket_oid, str_int("obj", i), 1024, 1);
+  }
+  auto listed = reshard_log(ioctx, bucket_oid);
+  ASSERT_EQ(5u, listed.size());
+  for (int i = 0; i < 5; i++) {
+    EXPECT_EQ(1u, listed.count(str_int("obj", i)));
+  }
+
+  // an object modified again after it was listed stays in the log
+  add_obj(ioctx, bucket_oid, str_int("obj", 0), 2048, 2);
+  {
+    ObjectWriteOperation op;
+    cls_rgw_reshard_log_trim(op, listed);
+    ASSERT_EQ(0, ioctx.operate(bucket_oid, &op));
+  }
+  auto left = reshard_log(ioctx, bucket_oid);
+  ASSERT_EQ(1u, left.size());
+  EXPECT_EQ(str_int("obj", 0), left.begin()->first);
+  EXPECT_NE(listed[str_int("obj", 0)], left.begin()->second);
+
+  // the log doesn't show up as index entries
+  EXPECT_EQ(5u, bi_entries(ioctx, bucket_oid).size());
+
+  // and is dropped when the reshard ends
+  ASSERT_EQ(0, cls_rgw_clear_bucket_resharding(ioctx, bucket_oid));
+  EXPECT_TRUE(reshard_log(ioctx, bucket_oid).empty());
+}
+
+TEST_F(cls_rgw, reshard_log_logrecord_only)
+{
+  string bucket_oid = "reshard-log-logrecord";
+  ObjectWriteOperation op;
+  cls_rgw_bucket_init_index(op);
+  ASSERT_EQ(0, ioctx.operate(bucket_oid, &op));
+
+  const cls_rgw_obj_key plain{"plain"};
+  const cls_rgw_obj_key versioned{"versioned", "inst"};
+  rgw_zone_set zones_trace;
+
+  // nothing is recorded outside of IN_LOGRECORD
+  add_obj(ioctx, bucket_oid, plain, 1024, 1);
+  add_obj(ioctx, bucket_oid, versioned, 1024, 1);
+  EXPECT_TRUE(reshard_log(ioctx, bucket_oid).empty());
+
+  // versioned ops that don't otherwise read the header are recorded too
+  set_reshard_status(ioctx, bucket_oid, cls_rgw_reshard_status::IN_LOGRECORD);
+  const string olh_tag = "tag-" + versioned.name + versioned.instance + "-1";
+  ASSERT_EQ(0, cls_rgw_bucket_unlink_instance(ioctx, bucket_oid, versioned,
+                                              "unlink-tag", olh_tag, 2,
+                                              true, zones_trace));
+  {
+    auto log = reshard_log(ioctx, bucket_oid);
+    ASSERT_EQ(1u, log.size());
+    EXPECT_EQ(versioned.name, log.begin()->first);
+  }
+  {
+    auto entries = bi_entries(ioctx, bucket_oid, plain.name);
+    ASSERT_EQ(1u, entries.size());
+    ASSERT_EQ(0, cls_rgw_bi_put(ioctx, bucket_oid, entries.front()));
+    EXPECT_EQ(2u, reshard_log(ioctx, bucket_oid).size());
+  }
+
+  // nor once the shard leaves it
+  set_reshard_status(ioctx, bucket_oid, cls_rgw_reshard_status::NOT_RESHARDING);
+  EXPECT_TRUE(reshard_log(ioctx, bucket_oid).empty());
+  add_obj(ioctx, bucket_oid, versioned, 1024, 3);
+  add_obj(ioctx, bucket_oid, plain, 2048, 2);
+  EXPECT_TRUE(reshard_log(ioctx, bucket_oid).empty());
+}
+
+// copies the current entries of a logged object from src to dst as
+// rgw's reshard does when replaying the log
+static void replay_object(librados::IoCtx& ioctx, const string& src_oid,
+                          const string& dst_oid, const string& name)
+{
+  set<string> keep;
+  vector<rgw_cls_bi_entry> put;
+  for (auto& entry : bi_entries(ioctx, src_oid, name)) {
+    keep.insert(entry.idx);
+    put.push_back(std::move(entry));
+  }
+  vector<string> remove;
+  for (auto& entry : bi_entries(ioctx, dst_oid, name)) {
+    if (!keep.count(entry.idx)) {
+      remove.push_back(std::move(entry.idx));
+    }
+  }
+  ObjectWriteOperation op;
+  cls_rgw_bi_put_entries(op, std::move(put), std::move(remove), true);
+  ASSERT_EQ(0, ioctx.operate(dst_oid, &op));
+}
+
+TEST_F(cls_rgw, reshard_log_replay)
+{
+  string src_oid = "reshard-replay-src";
+  string dst_oid = "reshard-replay-dst";
+  for (auto& oid : {src_oid, dst_oid}) {
+    ObjectWriteOperation op;
+    cls_rgw_bucket_init_index(op);
+    ASSERT_EQ(0, ioctx.operate(oid, &op));
+  }
+  for (int i = 0; i < 4; i++) {
+    add_obj(ioctx, src_oid, str_int("obj", i), 1024, 1);
+  }
+  add_obj(ioctx, src_oid, {"versioned", "v1"}, 1024, 1);
+
+  // the copy reads the source while it still takes writes
+  set_reshard_status(ioctx, src_oid, cls_rgw_reshard_status::IN_LOGRECORD);
+  auto copy = bi_entries(ioctx, src_oid);
+
+  add_obj(ioctx, src_oid, str_int("obj", 0), 4096, 2);
+  remove_obj(ioctx, src_oid, str_int("obj", 1), 2);
+  add_obj(ioctx, src_oid, {"new"}, 512, 1);
+  add_obj(ioctx, src_oid, {"versioned", "v2"}, 2048, 2);
+
+  {
+    ObjectWriteOperation op;
+    cls_rgw_bi_put_entries(op, {copy.begin(), copy.end()}, {}, false);
+    ASSERT_EQ(0, ioctx.operate(dst_oid, &op));
+  }
+
+  // writes are blocked, replay what changed during the copy
+  set_reshard_status(ioctx, src_oid, cls_rgw_reshard_status::IN_PROGRESS);
+  auto log = reshard_log(ioctx, src_oid);
+  set<string> logged;
+  for (auto& [name, ver] : log) {
+    logged.insert(name);
+    replay_object(ioctx, src_oid, dst_oid, name);
+  }
+  EXPECT_EQ((set<string>{str_int("obj", 0), str_int("obj", 1), "new",
+                         "versioned"}), logged);
+  {
+    ObjectWriteOperation op;
+    cls_rgw_reshard_log_trim(op, log);
+    ASSERT_EQ(0, ioctx.operate(src_oid, &op));
+  }
+  EXPECT_TRUE(reshard_log(ioctx, src_oid).empty());
+
+  // the target matches the source
+  auto src_entries = bi_entries(ioctx, src_oid);
+  auto dst_entries = bi_entries(ioctx, dst_oid);
+  ASSERT_EQ(src_entries.size(), dst_entries.size());
+  for (auto s = src_entries.begin(), d = dst_entries.begin();
+       s != src_entries.end(); ++s, ++d) {
+    EXPECT_EQ(s->idx, d->idx);
+    EXPECT_TRUE(s->data.contents_equal(d->data));
+  }
+  // 4 plain objects and 2 versions
+  const uint64_t total_size = 4096 + 2 * 1024 + 512 + 1024 + 2048;
+  test_stats(ioctx, src_oid, RGWObjCategory::None, 6, total_size);
+  test_stats(ioctx, dst_oid, RGWObjCategory::None, 6, total_size);
+}
+
+TEST_F(cls_rgw, reshard_logrecord_expired)
+{
+  string bucket_oid = "reshard-logrecord-expired";
+  ObjectWriteOperation op;
+  cls_rgw_bucket_init_index(op);
+  ASSERT_EQ(0, ioctx.operate(bucket_oid, &op));
+
+  // a prepare guarded the way rgw sends it
+  auto guarded_prepare = [&] (const cls_rgw_obj_key& key) {
+    ObjectWriteOperation op;
+    cls_rgw_guard_bucket_resharding(op, -EBUSY);
+    rgw_zone_set zones_trace;
+    cls_rgw_bucket_prepare_op(op, CLS_RGW_OP_ADD, "tag-" + key.name, key,
+                              "loc-" + key.name, true, 0, zones_trace);
+    return ioctx.operate(bucket_oid, &op);
+  };
+
+  // writes continue while the reshard keeps extending the phase
+  const auto now = ceph::real_clock::now();
+  set_reshard_status(ioctx, bucket_oid, cls_rgw_reshard_status::IN_LOGRECORD,
+                     now + std::chrono::hours(1));
+  ASSERT_EQ(0, guarded_prepare({"obj1"}));
+  EXPECT_EQ(1u, reshard_log(ioctx, bucket_oid).size());
+
+  // once it stops, they are blocked like for a reshard in progress
+  set_reshard_status(ioctx, bucket_oid, cls_rgw_reshard_status::IN_LOGRECORD,
+                     now - std::chrono::seconds(1));
+  ASSERT_EQ(-EBUSY, guarded_prepare({"obj2"}));
+  {
+    cls_rgw_bucket_instance_entry entry;
+    ASSERT_EQ(0, cls_rgw_get_bucket_resharding(ioctx, bucket_oid, &entry));
+    EXPECT_TRUE(entry.resharding_in_logrecord());
+    EXPECT_TRUE(entry.logrecord_expired(ceph::real_clock::now()));
+  }
+
+  // an entry without an expiry, as set by an older rgw, never expires
+  set_reshard_status(ioctx, bucket_oid, cls_rgw_reshard_status::IN_LOGRECORD);
+  ASSERT_EQ(0, guarded_prepare({"obj2"}));
+
+  // the rgw that takes over the reshard lock clears the reshard, which
+  // drops the log and stops the recording
+  set_reshard_status(ioctx, bucket_oid, cls_rgw_reshard_status::IN_LOGRECORD,
+                     now - std::chrono::seconds(1));
+  ASSERT_EQ(-EBUSY, guarded_prepare({"obj3"}));
+  ASSERT_EQ(0, cls_rgw_clear_bucket_resharding(ioctx, bucket_oid));
+  {
+    cls_rgw_bucket_instance_entry entry;
+    ASSERT_EQ(0, cls_rgw_get_bucket_resharding(ioctx, bucket_oid, &entry));
+    EXPECT_FALSE(entry.resharding_in_logrecord());
+    EXPECT_TRUE(ceph::real_clock::is_zero(entry.logrecord_expire));
+  }
+  EXPECT_TRUE(reshard_log(ioctx, bucket_oid).empty());
+  ASSERT_EQ(0, guarded_prepare({"obj3"}));
+  EXPECT_TRUE(reshard_log(ioctx, bucket_oid).empty());
+}
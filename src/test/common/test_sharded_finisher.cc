@@ -0,0 +1,112 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "common/Finisher.h"
+#include "global/global_context.h"
+
+namespace {
+struct Record : public Context {
+  std::mutex& lock;
+  std::vector<std::vector<int>>& seen;
+  unsigned lane;
+  int seq;
+  Record(std::mutex& l, std::vector<std::vector<int>>& s,
+	 unsigned lane, int seq)
+    : lock(l), seen(s), lane(lane), seq(seq) {}
+  void finish(int r) override {
+    std::lock_guard l(lock);
+    seen[lane].push_back(seq);
+  }
+};
+}
+
+TEST(ShardedFinisher, LanesStayOrdered)
+{
+  constexpr unsigned lanes = 16;
+  constexpr int per_lane = 1000;
+  ShardedFinisher fin(g_ceph_context, "test_lanes", "tfin", 4);
+  ASSERT_EQ(4u, fin.get_num_threads());
+  fin.start();
+
+  std::mutex lock;
+  std::vector<std::vector<int>> seen(lanes);
+  for (int i = 0; i < per_lane; i += 2) {
+    for (unsigned l = 0; l < lanes; ++l) {
+      fin.queue(l, new Record(lock, seen, l, i));
+      std::list<Context*> ls{new Record(lock, seen, l, i + 1)};
+      fin.queue(l, ls);
+      ASSERT_TRUE(ls.empty());
+    }
+  }
+  fin.wait_for_empty();
+  fin.stop();
+
+  for (unsigned l = 0; l < lanes; ++l) {
+    ASSERT_EQ(per_lane, (int)seen[l].size());
+    for (int i = 0; i < per_lane; ++i) {
+      ASSERT_EQ(i, seen[l][i]);
+    }
+  }
+}
+
+TEST(ShardedFinisher, Unkeyed)
+{
+  ShardedFinisher fin(g_ceph_context, "test_unkeyed", "tfin", 3);
+  fin.start();
+  std::atomic<int> done = 0;
+  for (int i = 0; i < 300; ++i) {
+    fin.queue(new LambdaContext([&done](int r) {
+      ASSERT_EQ(-1, r);
+      ++done;
+    }), -1);
+  }
+  fin.wait_for_empty();
+  ASSERT_EQ(300, done);
+  fin.stop();
+}
+
+TEST(ShardedFinisher, WaitCoversRequeue)
+{
+  // each step completes on one lane and queues the next onto another, so
+  // the chain keeps crossing back onto shards already seen idle
+  constexpr unsigned shards = 4;
+  constexpr int steps = 64;
+  ShardedFinisher fin(g_ceph_context, "test_requeue", "tfin", shards);
+  fin.start();
+
+  std::atomic<int> done = 0;
+  std::function<void(int)> step = [&](int i) {
+    fin.queue(i, new LambdaContext([&, i](int r) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      ++done;
+      if (i + 1 < steps) {
+	step(i + 1);
+      }
+    }));
+  };
+  for (int round = 0; round < 10; ++round) {
+    done = 0;
+    step(0);
+    fin.wait_for_empty();
+    ASSERT_EQ(steps, done);
+  }
+  fin.stop();
+}
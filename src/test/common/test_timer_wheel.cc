@@ -0,0 +1,180 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "common/timer_wheel.h"
+
+using namespace std::literals;
+
+namespace {
+// manually driven clock so the tests are deterministic
+struct test_clock {
+  using duration = std::chrono::nanoseconds;
+  using rep = duration::rep;
+  using period = duration::period;
+  using time_point = std::chrono::time_point<test_clock>;
+  static constexpr bool is_steady = true;
+  static time_point now() {
+    return time_point(duration(0));
+  }
+};
+
+using wheel_t = ceph::timer_wheel<test_clock>;
+using tp = test_clock::time_point;
+
+struct event : wheel_t::node {
+  int id = 0;
+};
+
+std::vector<int> drain(wheel_t& w)
+{
+  std::vector<int> out;
+  while (auto n = w.pop_due()) {
+    out.push_back(static_cast<event*>(n)->id);
+  }
+  return out;
+}
+}
+
+TEST(TimerWheel, Basic)
+{
+  wheel_t w(1ms, tp(0ns));
+  ASSERT_TRUE(w.empty());
+  ASSERT_EQ(tp::max(), w.next_expiry());
+
+  event a, b, c;
+  a.id = 1;
+  b.id = 2;
+  c.id = 3;
+  w.add(b, tp(10ms));
+  w.add(a, tp(5ms + 1ns));   // rounded up to 6ms
+  w.add(c, tp(1h));
+  ASSERT_EQ(3u, w.size());
+  ASSERT_EQ(tp(6ms), w.next_expiry());
+
+  w.advance(tp(5ms + 999us));
+  ASSERT_TRUE(drain(w).empty());
+  w.advance(tp(6ms));
+  ASSERT_EQ(std::vector<int>{1}, drain(w));
+
+  w.remove(b);
+  ASSERT_EQ(1u, w.size());
+  w.advance(tp(59min));
+  ASSERT_TRUE(drain(w).empty());
+  ASSERT_LE(w.next_expiry(), tp(1h));
+  w.advance(tp(2h));
+  ASSERT_EQ(std::vector<int>{3}, drain(w));
+  ASSERT_TRUE(w.empty());
+}
+
+TEST(TimerWheel, SameTickOrder)
+{
+  wheel_t w(1ms, tp(0ns));
+  event e[4];
+  // deadlines within one tick; insertion order breaks the tie
+  w.add(e[0], tp(1ms + 500us));
+  w.add(e[1], tp(1ms + 100us));
+  w.add(e[2], tp(1ms + 500us));
+  w.add(e[3], tp(1ms + 100us));
+  for (int i = 0; i < 4; ++i) {
+    e[i].id = i;
+  }
+  w.advance(tp(2ms));
+  ASSERT_EQ((std::vector<int>{1, 3, 0, 2}), drain(w));
+}
+
+TEST(TimerWheel, RemoveDue)
+{
+  wheel_t w(1ms, tp(0ns));
+  event a, b;
+  a.id = 1;
+  b.id = 2;
+  w.add(a, tp(1ms));
+  w.add(b, tp(1ms));
+  w.advance(tp(1ms));
+  ASSERT_LE(w.next_expiry(), tp(1ms));
+  w.remove(a);
+  ASSERT_FALSE(a.is_linked());
+  ASSERT_EQ(std::vector<int>{2}, drain(w));
+}
+
+TEST(TimerWheel, Random)
+{
+  // compare against an ordered multimap across several levels of the
+  // wheel, including the overflow list
+  std::mt19937_64 rng(42);
+  std::vector<std::unique_ptr<event>> events;
+  wheel_t w(1ms, tp(0ns));
+  std::multimap<std::pair<tp, int>, event*> expect;
+  tp now(0ns);
+  int next_id = 0;
+
+  for (int round = 0; round < 2000; ++round) {
+    for (int i = rng() % 20; i > 0; --i) {
+      std::chrono::nanoseconds delay;
+      switch (rng() % 4) {
+      case 0: delay = std::chrono::nanoseconds(rng() % 100'000'000); break;
+      case 1: delay = std::chrono::nanoseconds(rng() % 100'000'000'000); break;
+      case 2: delay = std::chrono::hours(rng() % 200'000); break;
+      default: delay = -std::chrono::nanoseconds(rng() % 1'000'000); break;
+      }
+      auto e = std::make_unique<event>();
+      e->id = next_id++;
+      w.add(*e, now + delay);
+      expect.emplace(std::make_pair(now + delay, e->id), e.get());
+      events.push_back(std::move(e));
+    }
+    // cancel a few
+    for (int i = rng() % 5; i > 0 && !expect.empty(); --i) {
+      auto p = expect.begin();
+      std::advance(p, rng() % expect.size());
+      w.remove(*p->second);
+      expect.erase(p);
+    }
+    ASSERT_EQ(expect.size(), w.size());
+
+    // jump either to the next expiry or by a random amount
+    auto next = w.next_expiry();
+    if (!expect.empty()) {
+      ASSERT_LE(next, std::max(now, expect.begin()->first.first) + 1ms);
+    }
+    if (rng() % 2 && next != tp::max()) {
+      now = std::max(now, next);
+    } else {
+      now += std::chrono::nanoseconds(rng() % 10'000'000'000'000);
+    }
+    w.advance(now);
+
+    auto got = drain(w);
+    tp last = tp::min();
+    for (auto id : got) {
+      auto p = std::find_if(expect.begin(), expect.end(),
+			    [id](auto& i) { return i.first.second == id; });
+      ASSERT_NE(p, expect.end());
+      ASSERT_LE(p->first.first, now);
+      ASSERT_GE(p->first.first, last);
+      last = p->first.first;
+      expect.erase(p);
+    }
+    // whatever is left may only be late by less than a tick
+    if (!expect.empty()) {
+      ASSERT_GT(expect.begin()->first.first, now - 1ms);
+    }
+  }
+}
@@ -424,6 +424,53 @@ TEST(small_encoding, varint) {
   }
 }
 
+TEST(small_encoding, varint_word) {
+  // decode runs of varints of every length, so that both the 8-byte
+  // word path and the bytewise tail (near the end of the buffer, or for
+  // varints longer than 8 bytes) are exercised
+  std::vector<uint64_t> values;
+  for (unsigned bits = 0; bits <= 64; ++bits) {
+    uint64_t v = bits ? (~0ull >> (64 - bits)) : 0;
+    values.push_back(v);
+    values.push_back(v >> 1);
+    values.push_back(v & 0x5555555555555555ull);
+  }
+  bufferlist bl;
+  {
+    auto app = bl.get_contiguous_appender(values.size() * 10, true);
+    for (auto v : values) {
+      denc_varint(v, app);
+    }
+  }
+  bl.rebuild();
+  auto p = bl.front().cbegin();
+  for (auto v : values) {
+    uint64_t u;
+    denc_varint(u, p);
+    ASSERT_EQ(v, u);
+  }
+  ASSERT_TRUE(p.end());
+
+  for (auto v : values) {
+    // lowz encodings lose the top bits of full-width values
+    v >>= 2;
+    bufferlist lbl;
+    {
+      auto app = lbl.get_contiguous_appender(32, true);
+      denc_varint_lowz(v, app);
+      denc_signed_varint_lowz(-(int64_t)(v >> 8), app);
+    }
+    lbl.rebuild();
+    auto lp = lbl.front().cbegin();
+    uint64_t u;
+    denc_varint_lowz(u, lp);
+    ASSERT_EQ(v, u);
+    int64_t s;
+    denc_signed_varint_lowz(s, lp);
+    ASSERT_EQ(-(int64_t)(v >> 8), s);
+  }
+}
+
 TEST(small_encoding, varint_lowz) {
   uint32_t v[][4] = {
     /* value, bytes encoded */
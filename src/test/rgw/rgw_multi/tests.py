@@ -1220,6 +1220,59 @@ def test_bucket_sync_disable_enable():
 
     zonegroup_data_checkpoint(zonegroup_conns)
 
+def bucket_sync_catch_up_rate(zonegroup, zonegroup_conns, num_objects):
+    """ returns the objects/sec at which the other zones catch up on objects
+    that were written while bucket sync was disabled """
+    buckets, zone_bucket = create_bucket_per_zone(zonegroup_conns)
+    zonegroup_meta_checkpoint(zonegroup)
+
+    for bucket_name in buckets:
+        disable_bucket_sync(realm.meta_master_zone(), bucket_name)
+    zonegroup_meta_checkpoint(zonegroup)
+
+    for zone, bucket in zone_bucket:
+        for i in range(num_objects):
+            k = new_key(zone, bucket.name, 'obj%d' % i)
+            k.set_contents_from_string('asdasd')
+
+    start = time.time()
+    for bucket_name in buckets:
+        enable_bucket_sync(realm.meta_master_zone(), bucket_name)
+    for bucket_name in buckets:
+        zonegroup_bucket_checkpoint(zonegroup_conns, bucket_name)
+    elapsed = time.time() - start
+
+    rate = num_objects * len(buckets) / elapsed
+    log.info('caught up on %d objects in %.1fs, %.1f objects/sec',
+             num_objects * len(buckets), elapsed, rate)
+    return rate
+
+def test_bucket_sync_catch_up_rate():
+    """ the adaptive object sync window never lets a bucket shard fetch
+    fewer objects at a time than the fixed one, so catching up with it is
+    at least as fast """
+    zonegroup = realm.master_zonegroup()
+    zonegroup_conns = ZonegroupConns(zonegroup)
+    num_objects = 500
+
+    # rgw_bucket_sync_spawn_window objects at a time per bucket shard
+    for z in zonegroup.zones:
+        z.stop()
+    try:
+        for z in zonegroup.zones:
+            z.start(['--rgw-sync-object-window-max=0'])
+        fixed = bucket_sync_catch_up_rate(zonegroup, zonegroup_conns, num_objects)
+    finally:
+        for z in zonegroup.zones:
+            z.stop()
+        for z in zonegroup.zones:
+            z.start()
+
+    adaptive = bucket_sync_catch_up_rate(zonegroup, zonegroup_conns, num_objects)
+    log.info('catch up rate: %.1f objects/sec adaptive, %.1f fixed',
+             adaptive, fixed)
+    assert adaptive >= fixed
+
 def test_multipart_object_sync():
     zonegroup = realm.master_zonegroup()
     zonegroup_conns = ZonegroupConns(zonegroup)
@@ -0,0 +1,77 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab ft=cpp
+
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ */
+
+#include "rgw/rgw_auth_s3.h"
+#include "rgw/rgw_perf_counters.h"
+
+#include "common/dout.h"
+#include "global/global_context.h"
+
+#include <gtest/gtest.h>
+
+using rgw::auth::s3::get_v4_signature;
+
+// the example from the AWS documentation:
+// https://docs.aws.amazon.com/general/latest/gr/sigv4-calculate-signature.html
+static const std::string example_secret = "wJalrXUtnFEMI/K7MDENG+bPxRfiCYEXAMPLEKEY";
+static const std::string example_scope = "20150830/us-east-1/iam/aws4_request";
+static const std::string example_string_to_sign =
+  "AWS4-HMAC-SHA256\n"
+  "20150830T123600Z\n"
+  "20150830/us-east-1/iam/aws4_request\n"
+  "f536975d06c0309214f805bb90ccff089219ecd68b2577efef23edd43b7e1a59";
+
+class SigV4 : public ::testing::Test {
+protected:
+  NoDoutPrefix dpp{g_ceph_context, ceph_subsys_rgw};
+
+  static void SetUpTestSuite() {
+    rgw_perf_start(g_ceph_context);
+  }
+  static void TearDownTestSuite() {
+    rgw_perf_stop(g_ceph_context);
+  }
+
+  uint64_t cache_hits() {
+    return perfcounter->get(l_rgw_signing_key_cache_hit);
+  }
+
+  std::string sign(const std::string& scope, const std::string& secret) {
+    return get_v4_signature(scope, g_ceph_context, secret,
+                            example_string_to_sign, &dpp);
+  }
+};
+
+TEST_F(SigV4, Example)
+{
+  EXPECT_EQ("5d672d79c15b13162d9279b0855cfba6789a8edb4c82c400e06b5924a6f2b5d7",
+            sign(example_scope, example_secret));
+  // again, with the signing key from the cache
+  const auto hits = cache_hits();
+  EXPECT_EQ("5d672d79c15b13162d9279b0855cfba6789a8edb4c82c400e06b5924a6f2b5d7",
+            sign(example_scope, example_secret));
+  EXPECT_EQ(hits + 1, cache_hits());
+}
+
+TEST_F(SigV4, CachedPerSecretAndScope)
+{
+  ASSERT_EQ("5d672d79c15b13162d9279b0855cfba6789a8edb4c82c400e06b5924a6f2b5d7",
+            sign(example_scope, example_secret));
+  const auto hits = cache_hits();
+  // another secret key doesn't get the cached signing key
+  EXPECT_EQ("4ffc23037029b53b8f3d4bfd4a7cf44b0eb5cc00c870a2b96a3e66aff8ef0efa",
+            sign(example_scope, "AnotherSecretKey"));
+  // neither does another day
+  EXPECT_EQ("d9a0b58c17e7b1169085a8705d460aebe0158f0adb73b66eb96359a6edd070b8",
+            sign("20150831/us-east-1/iam/aws4_request", example_secret));
+  EXPECT_EQ(hits, cache_hits());
+}
@@ -0,0 +1,223 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab ft=cpp
+
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ */
+
+#include "rgw/rgw_bucket_list_merge.h"
+
+#include <algorithm>
+#include <map>
+
+#include <gtest/gtest.h>
+
+using namespace rgw::bucket_list;
+
+// the entries of one shard of a fake bucket index, and how cls would
+// list them
+struct FakeShard {
+  std::vector<std::string> names; // in order
+
+  rgw_cls_list_ret list(const cls_rgw_obj_key& after, uint32_t max) const {
+    rgw_cls_list_ret ret;
+    auto i = std::upper_bound(names.begin(), names.end(), after.name);
+    for (; i != names.end() && ret.dir.m.size() < max; ++i) {
+      auto& e = ret.dir.m[*i];
+      e.key.name = *i;
+      e.exists = true;
+      ret.marker = e.key;
+    }
+    ret.is_truncated = i != names.end();
+    return ret;
+  }
+};
+
+class OrderedMergeTest : public ::testing::Test {
+protected:
+  std::map<int, FakeShard> index;
+  std::map<int, int> refills; // per shard
+
+  OrderedMerge::refill_t refill = [this] (ShardTracker& t, uint32_t wanted,
+					  bool* stuck) {
+    ++refills[t.shard_idx];
+    const cls_rgw_obj_key after = t.read.result.marker;
+    t.reset(after, wanted, index[t.shard_idx].list(after, wanted));
+    return 0;
+  };
+
+  // start a listing after marker, reading batch entries from each shard
+  void start(OrderedMerge& merge, const cls_rgw_obj_key& marker,
+	     uint32_t batch) {
+    for (auto& [shard, fake] : index) {
+      auto& t = merge.add(shard, "oid" + std::to_string(shard));
+      t.reset(marker, batch, fake.list(marker, batch));
+    }
+    merge.start();
+  }
+
+  // take up to max entries, as cls_bucket_list_ordered does
+  std::vector<std::string> take(OrderedMerge& merge, uint32_t max,
+				bool* stopped = nullptr) {
+    std::vector<std::string> out;
+    while (out.size() < max && !merge.empty()) {
+      const std::string name = merge.top().entry_name();
+      out.push_back(name);
+      bool need_to_stop = false;
+      EXPECT_EQ(0, merge.advance(name, max - out.size(), refill,
+				 &need_to_stop));
+      if (need_to_stop && out.size() < max) {
+	if (stopped) {
+	  *stopped = true;
+	}
+	break;
+      }
+    }
+    return out;
+  }
+};
+
+TEST_F(OrderedMergeTest, OrderAcrossShards)
+{
+  index[0].names = {"a", "d", "g"};
+  index[1].names = {"b", "e", "h"};
+  index[2].names = {"c", "f", "i"};
+
+  OrderedMerge merge(index.size());
+  start(merge, {}, 10);
+  EXPECT_EQ((std::vector<std::string>{"a", "b", "c", "d", "e", "f", "g", "h", "i"}),
+	    take(merge, 100));
+  EXPECT_FALSE(merge.is_truncated());
+  EXPECT_TRUE(refills.empty());
+}
+
+TEST_F(OrderedMergeTest, TiesTakenOnce)
+{
+  // e.g. common prefixes, which every shard can report
+  index[0].names = {"a/", "b"};
+  index[1].names = {"a/", "c"};
+
+  OrderedMerge merge(index.size());
+  start(merge, {}, 10);
+  EXPECT_EQ((std::vector<std::string>{"a/", "b", "c"}), take(merge, 100));
+  // the tie went to the first shard
+  EXPECT_TRUE(merge.empty());
+}
+
+TEST_F(OrderedMergeTest, RefillOnlyConsumedShard)
+{
+  // all of the first page comes from shard 0
+  for (char c = 'a'; c <= 'p'; ++c) {
+    index[0].names.push_back(std::string(1, c));
+  }
+  index[1].names = {"x", "y", "z"};
+
+  OrderedMerge merge(index.size());
+  start(merge, {}, 4);
+  const auto page = take(merge, 10);
+  ASSERT_EQ(10u, page.size());
+  EXPECT_EQ("a", page.front());
+  EXPECT_EQ("j", page.back());
+  EXPECT_TRUE(std::is_sorted(page.begin(), page.end()));
+  EXPECT_EQ(0, refills.count(1));
+  EXPECT_LT(0, refills[0]);
+  EXPECT_TRUE(merge.is_truncated());
+}
+
+TEST_F(OrderedMergeTest, StopWhenStuck)
+{
+  index[0].names = {"a", "b", "c", "d"};
+  index[1].names = {"e"};
+
+  OrderedMerge merge(index.size());
+  start(merge, {}, 2);
+  OrderedMerge::refill_t stuck = [] (ShardTracker&, uint32_t, bool* s) {
+    *s = true;
+    return 0;
+  };
+  refill = stuck;
+  bool stopped = false;
+  // "e" must not be returned before what shard 0 may hold after "b"
+  EXPECT_EQ((std::vector<std::string>{"a", "b"}), take(merge, 10, &stopped));
+  EXPECT_TRUE(stopped);
+  EXPECT_TRUE(merge.is_truncated());
+}
+
+TEST_F(OrderedMergeTest, ClsFilteredCoversRefills)
+{
+  index[0].names = {"a", "b", "c", "d"};
+
+  OrderedMerge merge(index.size());
+  start(merge, {}, 2);
+  EXPECT_TRUE(merge.cls_filtered());
+  // an older osd answers the refill
+  refill = [this] (ShardTracker& t, uint32_t wanted, bool*) {
+    const cls_rgw_obj_key after = t.read.result.marker;
+    auto ret = index[t.shard_idx].list(after, wanted);
+    ret.cls_filtered = false;
+    t.reset(after, wanted, std::move(ret));
+    return 0;
+  };
+  EXPECT_EQ(4u, take(merge, 10).size());
+  EXPECT_FALSE(merge.cls_filtered());
+}
+
+TEST_F(OrderedMergeTest, ResumeAfterMarker)
+{
+  index[0].names = {"a", "c", "e", "g"};
+  index[1].names = {"b", "d", "f", "h"};
+
+  // the first page reads everything but returns only some of it
+  std::map<int, ShardRead> saved;
+  cls_rgw_obj_key marker;
+  {
+    OrderedMerge merge(index.size());
+    start(merge, {}, 4);
+    const auto page = take(merge, 3);
+    EXPECT_EQ((std::vector<std::string>{"a", "b", "c"}), page);
+    marker.name = page.back();
+    for (auto& t : merge.shards()) {
+      saved.emplace(t.shard_idx, std::move(t.read));
+    }
+  }
+
+  // the next page continues from the saved reads without reading again
+  OrderedMerge merge(index.size());
+  for (auto& [shard, fake] : index) {
+    auto& t = merge.add(shard, "oid");
+    ASSERT_TRUE(t.resume(saved[shard], marker, false));
+  }
+  merge.start();
+  EXPECT_EQ((std::vector<std::string>{"d", "e", "f", "g", "h"}),
+	    take(merge, 100));
+  EXPECT_TRUE(refills.empty());
+}
+
+TEST_F(OrderedMergeTest, ResumeNotCovered)
+{
+  index[0].names = {"a", "b", "c", "d", "e"};
+  ShardRead saved;
+  saved.start_after.name = "b";
+  saved.batch = 2;
+  saved.result = index[0].list(saved.start_after, 2);
+
+  ShardTracker t(0, "oid");
+  // a marker before the saved read isn't covered
+  cls_rgw_obj_key marker;
+  marker.name = "a";
+  EXPECT_FALSE(t.resume(saved, marker, false));
+  // nor is one past its end while the shard has more
+  ShardTracker t2(0, "oid");
+  marker.name = "d";
+  EXPECT_FALSE(t2.resume(saved, marker, false));
+  // nor one among instances whose order cls decides
+  ShardTracker t3(0, "oid");
+  marker.name = "c";
+  marker.instance = "v1";
+  EXPECT_FALSE(t3.resume(saved, marker, true));
+}
@@ -0,0 +1,190 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab ft=cpp
+
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ */
+
+#include "rgw/rgw_client_io.h"
+#include "rgw/rgw_asio_client.h"
+
+#include "global/global_context.h"
+
+#include <gtest/gtest.h>
+
+// records the writes that reach the front-end
+class RecordingClient : public rgw::io::RestfulClient {
+  RGWEnv env;
+
+public:
+  int init_env(CephContext*) override { return 0; }
+  std::string header;
+  std::vector<std::string> writes;
+
+  size_t send_status(int status, const char*) override {
+    header += "status " + std::to_string(status) + "\n";
+    return 0;
+  }
+  size_t send_100_continue() override { return 0; }
+  size_t send_header(const std::string_view& name,
+                     const std::string_view& value) override {
+    header += std::string(name) + ": " + std::string(value) + "\n";
+    return 0;
+  }
+  size_t send_content_length(uint64_t len) override {
+    return send_header("Content-Length", std::to_string(len));
+  }
+  size_t complete_header() override { return 0; }
+  size_t recv_body(char*, size_t) override { return 0; }
+  size_t send_body(const char* buf, size_t len) override {
+    writes.emplace_back(buf, len);
+    return len;
+  }
+  size_t send_body_buffers(const ceph::bufferlist& bl,
+                           size_t ofs, size_t len) override {
+    std::string s;
+    bl.begin(ofs).copy(len, s);
+    writes.push_back(std::move(s));
+    return len;
+  }
+  void flush() override {}
+  RGWEnv& get_env() noexcept override { return env; }
+  size_t complete_request() override { return 0; }
+};
+
+// a bufferlist made of one buffer per string
+static ceph::bufferlist fragmented(std::initializer_list<std::string_view> parts)
+{
+  ceph::bufferlist bl;
+  for (auto p : parts) {
+    bl.append(ceph::bufferptr(p.data(), p.size()));
+  }
+  return bl;
+}
+
+TEST(ClientIO, SendBodyBuffersDefault)
+{
+  // a front-end without a scattered write gets one send_body() per buffer
+  RecordingClient client;
+  auto bl = fragmented({"abc", "defg", "hi"});
+  EXPECT_EQ(5u, client.RestfulClient::send_body_buffers(bl, 2, 5));
+  EXPECT_EQ((std::vector<std::string>{"c", "defg"}), client.writes);
+}
+
+TEST(ClientIO, ChunkingInOneWrite)
+{
+  RecordingClient client;
+  auto chunking = rgw::io::add_chunking(&client);
+  chunking.send_chunked_transfer_encoding();
+  auto bl = fragmented({"hel", "lo, ", "world"});
+  chunking.send_body_buffers(bl, 0, 5);
+  chunking.send_body("!", 1);
+  chunking.complete_request();
+  EXPECT_EQ((std::vector<std::string>{"5\r\nhello\r\n", "1\r\n!\r\n",
+                                      "0\r\n\r\n"}),
+            client.writes);
+}
+
+TEST(ClientIO, BufferingWithoutContentLength)
+{
+  RecordingClient client;
+  auto buffering = rgw::io::add_buffering(g_ceph_context, &client);
+  buffering.complete_header();
+  auto bl = fragmented({"hel", "lo"});
+  EXPECT_EQ(0u, buffering.send_body_buffers(bl, 0, bl.length()));
+  EXPECT_EQ(0u, buffering.send_body(", world", 7));
+  EXPECT_TRUE(client.writes.empty());
+
+  buffering.complete_request();
+  EXPECT_EQ("Content-Length: 12\n", client.header);
+  // everything buffered goes out together
+  EXPECT_EQ((std::vector<std::string>{"hello, world"}), client.writes);
+}
+
+// the beast client, writing to a string per write instead of a socket
+class RecordingAsioClient : public rgw::asio::ClientIO {
+public:
+  std::vector<std::string> writes;
+
+  explicit RecordingAsioClient(rgw::asio::parser_type& parser)
+    : ClientIO(parser, false, {}, {}) {}
+
+  size_t write_data(const char* buf, size_t len) override {
+    writes.emplace_back(buf, len);
+    return len;
+  }
+  size_t write_buffers(const buffers_type& buffers) override {
+    std::string s;
+    for (const auto& b : buffers) {
+      s.append(static_cast<const char*>(b.data()), b.size());
+    }
+    const size_t len = s.size();
+    writes.push_back(std::move(s));
+    return len;
+  }
+  size_t recv_body(char*, size_t) override { return 0; }
+};
+
+static void parse_request(rgw::asio::parser_type& parser,
+                          std::string_view request)
+{
+  boost::system::error_code ec;
+  parser.put(boost::asio::buffer(request.data(), request.size()), ec);
+  ASSERT_FALSE(ec);
+  ASSERT_TRUE(parser.is_header_done());
+}
+
+TEST(AsioClientIO, HeaderWithFirstBodyWrite)
+{
+  rgw::asio::parser_type parser;
+  parse_request(parser, "GET /bucket/obj HTTP/1.1\r\nHost: x\r\n\r\n");
+  RecordingAsioClient client(parser);
+  client.send_status(200, "OK");
+  client.send_content_length(5);
+  client.complete_header();
+  EXPECT_TRUE(client.writes.empty());
+
+  client.send_body("hello", 5);
+  ASSERT_EQ(1u, client.writes.size());
+  EXPECT_TRUE(client.writes[0].starts_with("HTTP/1.1 200 OK\r\n"));
+  EXPECT_TRUE(client.writes[0].ends_with("\r\n\r\nhello"));
+}
+
+TEST(AsioClientIO, HeaderWithoutBodyNotDeferred)
+{
+  // HEAD, an empty body and statuses without a body send the header at
+  // once, before the request's post-processing
+  {
+    rgw::asio::parser_type parser;
+    parse_request(parser, "HEAD /bucket/obj HTTP/1.1\r\nHost: x\r\n\r\n");
+    RecordingAsioClient client(parser);
+    client.send_status(200, "OK");
+    client.send_content_length(1024);
+    client.complete_header();
+    ASSERT_EQ(1u, client.writes.size());
+    EXPECT_TRUE(client.writes[0].ends_with("\r\n\r\n"));
+  }
+  {
+    rgw::asio::parser_type parser;
+    parse_request(parser, "PUT /bucket/obj HTTP/1.1\r\nHost: x\r\n"
+                  "Content-Length: 0\r\n\r\n");
+    RecordingAsioClient client(parser);
+    client.send_status(200, "OK");
+    client.send_content_length(0);
+    client.complete_header();
+    EXPECT_EQ(1u, client.writes.size());
+  }
+  {
+    rgw::asio::parser_type parser;
+    parse_request(parser, "DELETE /bucket/obj HTTP/1.1\r\nHost: x\r\n\r\n");
+    RecordingAsioClient client(parser);
+    client.send_status(204, "No Content");
+    client.complete_header();
+    EXPECT_EQ(1u, client.writes.size());
+  }
+}
@@ -758,6 +758,55 @@ TEST(TestRGWCrypto, verify_RGWPutObj_BlockEncrypt_chunks)
 }
 
 
+TEST(TestRGWCrypto, verify_RGWPutObj_BlockEncrypt_slices)
+{
+  const NoDoutPrefix no_dpp(g_ceph_context, dout_subsys);
+  const size_t test_size = 256*1024 + 1234;
+  bufferptr buf(test_size);
+  char* p = buf.c_str();
+  for (size_t i = 0; i < buf.length(); i++)
+    p[i] = i + i*i + (i >> 3);
+
+  uint8_t key[32];
+  for (size_t i = 0; i < sizeof(key); i++)
+    key[i] = i * 7;
+
+  // encrypted at once
+  auto cbc = AES_256_CBC_create(&no_dpp, g_ceph_context, &key[0], 32);
+  ASSERT_NE(cbc.get(), nullptr);
+  bufferlist input;
+  input.append(buf);
+  bufferlist expected;
+  ASSERT_TRUE(cbc->encrypt(input, 0, test_size, expected, 0));
+
+  auto& conf = g_ceph_context->_conf;
+  const auto orig_slice_size = conf.get_val<Option::size_t>("rgw_crypt_slice_size");
+  for (auto slice_size : {"4096", "5000", "65536", "1048576"}) {
+    conf.set_val_or_die("rgw_crypt_slice_size", slice_size);
+
+    ut_put_sink put_sink;
+    RGWPutObj_BlockEncrypt encrypt(&no_dpp, g_ceph_context, &put_sink,
+                                   AES_256_CBC_create(&no_dpp, g_ceph_context, &key[0], 32));
+    // feed the data in pieces that don't line up with the blocks
+    off_t pos = 0;
+    while (pos < (off_t)test_size) {
+      bufferlist bl;
+      for (size_t piece : {777, 10000, 3}) {
+        piece = std::min<size_t>(piece, test_size - pos);
+        bl.append(buffer::copy(p + pos, piece));
+        pos += piece;
+      }
+      const auto len = bl.length();
+      ASSERT_EQ(0, encrypt.process(std::move(bl), pos - len));
+    }
+    ASSERT_EQ(0, encrypt.process({}, pos));
+
+    ASSERT_EQ(put_sink.get_sink(),
+              std::string(expected.c_str(), expected.length()));
+  }
+  conf.set_val_or_die("rgw_crypt_slice_size", std::to_string(orig_slice_size.value));
+}
+
 TEST(TestRGWCrypto, verify_Encrypt_Decrypt)
 {
   const NoDoutPrefix no_dpp(g_ceph_context, dout_subsys);
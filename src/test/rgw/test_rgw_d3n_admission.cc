@@ -0,0 +1,78 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab ft=cpp
+
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ */
+
+#include "rgw/rgw_d3n_admission.h"
+#include <gtest/gtest.h>
+
+TEST(D3nAdmission, Unknown)
+{
+  D3nAdmissionFilter filter(64);
+  EXPECT_EQ(0, filter.estimate(1));
+  EXPECT_FALSE(filter.admit(1, 2));
+}
+
+TEST(D3nAdmission, FrequentBeatsRare)
+{
+  D3nAdmissionFilter filter(64);
+  for (int i = 0; i < 5; i++) {
+    filter.record(1);
+  }
+  filter.record(2);
+  EXPECT_EQ(5, filter.estimate(1));
+  EXPECT_EQ(1, filter.estimate(2));
+  EXPECT_TRUE(filter.admit(1, 2));
+  EXPECT_FALSE(filter.admit(2, 1));
+}
+
+TEST(D3nAdmission, Saturate)
+{
+  D3nAdmissionFilter filter(64);
+  for (int i = 0; i < 100; i++) {
+    filter.record(1);
+  }
+  EXPECT_EQ(15, filter.estimate(1));
+}
+
+TEST(D3nAdmission, ScanDoesNotDisplaceHotSet)
+{
+  // 16 hot objects that keep being requested while a scan requests 500
+  // other objects once each
+  D3nAdmissionFilter filter(16);
+  for (int round = 0; round < 4; round++) {
+    for (uint64_t hot = 0; hot < 16; hot++) {
+      filter.record(hot);
+    }
+  }
+  int admitted = 0;
+  for (uint64_t cold = 1000; cold < 1500; cold++) {
+    filter.record(cold);
+    filter.record(cold % 16);
+    if (filter.admit(cold, (cold + 1) % 16)) {
+      admitted++;
+    }
+  }
+  // a few get in through hash collisions; an lru would admit all of them
+  EXPECT_LT(admitted, 50);
+}
+
+TEST(D3nAdmission, Aging)
+{
+  D3nAdmissionFilter filter(16); // halves after 160 samples
+  for (int i = 0; i < 8; i++) {
+    filter.record(1);
+  }
+  ASSERT_EQ(8, filter.estimate(1));
+  for (uint64_t other = 100; filter.estimate(1) == 8; other++) {
+    filter.record(other);
+  }
+  EXPECT_EQ(4, filter.estimate(1));
+}
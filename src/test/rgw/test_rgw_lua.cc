@@ -5,6 +5,7 @@
 #include "rgw/rgw_process.h"
 #include "rgw/rgw_sal_rados.h"
 #include "rgw/rgw_lua_request.h"
+#include "rgw/rgw_lua_utils.h"
 #include "rgw/rgw_lua_background.h"
 #include "rgw/rgw_lua_data_filter.h"
 
@@ -274,6 +275,60 @@ TEST(TestRGWLua, SetResponse)
   ASSERT_EQ(rc, 0);
 }
 
+TEST(TestRGWLua, CachedScript)
+{
+  const std::string script = R"(
+    assert(Request.Response.Message == "this is a bad request")
+    Request.Response.Message = "this is a good request"
+    x = (x or 0) + 1
+    assert(x == 1)
+  )";
+
+  // the second run loads the script from the bytecode cache, into a new VM
+  for (int i = 0; i < 2; i++) {
+    DEFINE_REQ_STATE;
+    s.err.message = "this is a bad request";
+
+    const auto rc = lua::request::execute(nullptr, nullptr, nullptr, &s, nullptr, script);
+    ASSERT_EQ(rc, 0);
+    ASSERT_EQ(s.err.message, "this is a good request");
+  }
+}
+
+TEST(TestRGWLua, CachedScriptError)
+{
+  const std::string script = R"(
+    local t = nil
+    return t.cached_script_error
+  )";
+
+  // the error names the script and the line, whether or not the script
+  // was loaded from the bytecode cache
+  std::string first_error;
+  for (int i = 0; i < 2; i++) {
+    lua_State* L = luaL_newstate();
+    ASSERT_NE(L, nullptr);
+    lua::lua_state_guard lguard(L);
+    lua::open_standard_libs(L);
+
+    ASSERT_NE(lua::run_script(L, g_cct, script), LUA_OK);
+    const std::string error = lua_tostring(L, -1);
+    ASSERT_NE(error.find(":3: attempt to index"), std::string::npos) << error;
+    if (i == 0) {
+      first_error = error;
+    } else {
+      ASSERT_EQ(error, first_error);
+    }
+  }
+
+  for (int i = 0; i < 2; i++) {
+    DEFINE_REQ_STATE;
+
+    const auto rc = lua::request::execute(nullptr, nullptr, nullptr, &s, nullptr, script);
+    ASSERT_EQ(rc, -1);
+  }
+}
+
 TEST(TestRGWLua, RGWIdNotWriteable)
 {
   const std::string script = R"(
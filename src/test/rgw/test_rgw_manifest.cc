@@ -385,6 +385,43 @@ TEST(TestRGWManifest, old_obj_manifest) {
 }
 
 
+TEST(TestRGWDedupManifest, find_and_decode) {
+  RGWObjDedupManifest manifest;
+  manifest.pool = rgw_pool(".rgw.chunks");
+  manifest.ref_tag = "obj.tag";
+
+  unsigned char v[sha256_digest_t::SIZE] = {0};
+  const uint64_t lens[] = {100, 50, 200};
+  for (auto len : lens) {
+    ++v[0];
+    manifest.append(sha256_digest_t(v), len);
+  }
+  ASSERT_EQ(350u, manifest.obj_size);
+
+  ASSERT_EQ(0u, manifest.find(0)->ofs);
+  ASSERT_EQ(0u, manifest.find(99)->ofs);
+  ASSERT_EQ(100u, manifest.find(100)->ofs);
+  ASSERT_EQ(150u, manifest.find(349)->ofs);
+  ASSERT_TRUE(manifest.find(350) == manifest.chunks.end());
+
+  bufferlist bl;
+  encode(manifest, bl);
+  RGWObjDedupManifest decoded;
+  auto p = bl.cbegin();
+  decode(decoded, p);
+
+  ASSERT_EQ(manifest.pool, decoded.pool);
+  ASSERT_EQ(manifest.ref_tag, decoded.ref_tag);
+  ASSERT_EQ(manifest.obj_size, decoded.obj_size);
+  ASSERT_EQ(manifest.chunks.size(), decoded.chunks.size());
+  for (size_t i = 0; i < manifest.chunks.size(); i++) {
+    ASSERT_EQ(manifest.chunks[i].get_oid(), decoded.chunks[i].get_oid());
+    ASSERT_EQ(manifest.chunks[i].ofs, decoded.chunks[i].ofs);
+    ASSERT_EQ(manifest.chunks[i].len, decoded.chunks[i].len);
+  }
+}
+
+
 int main(int argc, char **argv) {
   auto args = argv_to_vec(argc, argv);
   auto cct = global_init(NULL, args, CEPH_ENTITY_TYPE_CLIENT,
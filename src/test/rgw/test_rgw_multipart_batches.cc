@@ -0,0 +1,240 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab ft=cpp
+
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ */
+
+#include "rgw/rgw_multipart_batches.h"
+
+#include <numeric>
+
+#include "include/encoding.h"
+
+#include <gtest/gtest.h>
+
+using namespace rgw::multipart;
+
+struct FakePart {
+  uint32_t num = 0;
+};
+
+// the part entries in the omap of an upload's meta object
+struct FakeUpload {
+  std::map<std::string, ceph::buffer::list> omap;
+
+  void add(uint32_t num) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "part.%08d", num);
+    encode(num, omap[buf]);
+  }
+
+  // omap_get_vals2()
+  std::map<std::string, ceph::buffer::list>
+  list(const std::string& after, unsigned max) const {
+    std::map<std::string, ceph::buffer::list> vals;
+    for (auto i = omap.upper_bound(after);
+	 i != omap.end() && vals.size() < max; ++i) {
+      vals.insert(*i);
+    }
+    return vals;
+  }
+};
+
+static int decode_part(ceph::buffer::list& bl, FakePart& part)
+{
+  auto p = bl.cbegin();
+  decode(part.num, p);
+  return part.num;
+}
+
+static std::map<int, std::string> request(std::initializer_list<int> nums)
+{
+  std::map<int, std::string> parts;
+  for (int n : nums) {
+    parts[n] = "etag" + std::to_string(n);
+  }
+  return parts;
+}
+
+static std::map<int, std::string> request_range(int first, int last)
+{
+  std::map<int, std::string> parts;
+  for (int n = first; n <= last; ++n) {
+    parts[n] = "etag" + std::to_string(n);
+  }
+  return parts;
+}
+
+class PartBatchesTest : public ::testing::Test {
+protected:
+  FakeUpload upload;
+  std::vector<uint32_t> seen; // parts handed to the callback
+
+  PartBatches<FakePart>::part_cb_t cb = [this] (FakePart& part) {
+    seen.push_back(part.num);
+    return 0;
+  };
+
+  // read every batch, completing them in the given order
+  int read(PartBatches<FakePart>& batches, std::vector<size_t> order) {
+    for (size_t i : order) {
+      auto& b = batches[i];
+      b.vals = upload.list(b.after, b.max());
+      batches.done(i, 0);
+      int r = batches.handle_done();
+      if (r < 0) {
+	return r;
+      }
+    }
+    return 0;
+  }
+};
+
+TEST_F(PartBatchesTest, InOrderAcrossBatches)
+{
+  for (int n = 1; n <= 25; ++n) {
+    upload.add(n);
+  }
+  const auto parts = request_range(1, 25);
+  PartBatches<FakePart> batches(parts, 10, decode_part, cb);
+  ASSERT_EQ(3u, batches.size());
+  EXPECT_EQ("part.00000000", batches[0].after);
+  EXPECT_EQ("part.00000010", batches[1].after);
+  EXPECT_EQ("part.00000020", batches[2].after);
+
+  // the last batch arrives first, but nothing is handed out before the
+  // first one is done
+  EXPECT_EQ(0, read(batches, {2}));
+  EXPECT_TRUE(seen.empty());
+  EXPECT_EQ(0, read(batches, {0, 1}));
+  EXPECT_TRUE(batches.finished());
+  std::vector<uint32_t> expected(25);
+  std::iota(expected.begin(), expected.end(), 1);
+  EXPECT_EQ(expected, seen);
+}
+
+TEST_F(PartBatchesTest, SparsePartNumbers)
+{
+  const auto parts = request({2, 3, 5, 8, 13, 21, 34});
+  for (auto& [n, etag] : parts) {
+    upload.add(n);
+  }
+  PartBatches<FakePart> batches(parts, 3, decode_part, cb);
+  ASSERT_EQ(3u, batches.size());
+  EXPECT_EQ(0, read(batches, {1, 2, 0}));
+  EXPECT_TRUE(batches.finished());
+  EXPECT_EQ((std::vector<uint32_t>{2, 3, 5, 8, 13, 21, 34}), seen);
+}
+
+TEST_F(PartBatchesTest, MissingPart)
+{
+  for (int n = 1; n <= 25; ++n) {
+    if (n != 15) {
+      upload.add(n);
+    }
+  }
+  const auto parts = request_range(1, 25);
+  PartBatches<FakePart> batches(parts, 10, decode_part, cb);
+  EXPECT_EQ(-EAGAIN, read(batches, {0, 1, 2}));
+  // the first batch was already handed out
+  EXPECT_LE(10u, seen.size());
+  EXPECT_FALSE(batches.finished());
+}
+
+TEST_F(PartBatchesTest, ExtraPartBetweenBatches)
+{
+  // part 11 was uploaded but isn't in the request; it falls between
+  // the batches, where only the key after the first batch shows it
+  for (int n = 1; n <= 21; ++n) {
+    upload.add(n);
+  }
+  auto parts = request_range(1, 21);
+  parts.erase(11);
+  PartBatches<FakePart> batches(parts, 10, decode_part, cb);
+  ASSERT_EQ(2u, batches.size());
+  EXPECT_EQ(-EAGAIN, read(batches, {1, 0}));
+}
+
+TEST_F(PartBatchesTest, ExtraPartAfterLast)
+{
+  for (int n = 1; n <= 11; ++n) {
+    upload.add(n);
+  }
+  const auto parts = request_range(1, 10);
+  PartBatches<FakePart> batches(parts, 10, decode_part, cb);
+  EXPECT_EQ(-EAGAIN, read(batches, {0}));
+}
+
+TEST_F(PartBatchesTest, ReadError)
+{
+  for (int n = 1; n <= 20; ++n) {
+    upload.add(n);
+  }
+  const auto parts = request_range(1, 20);
+  PartBatches<FakePart> batches(parts, 10, decode_part, cb);
+  batches.done(1, -EIO);
+  EXPECT_EQ(0, batches.handle_done());
+  auto& b = batches[0];
+  b.vals = upload.list(b.after, b.max());
+  batches.done(0, 0);
+  EXPECT_EQ(-EIO, batches.handle_done());
+  EXPECT_EQ(10u, seen.size());
+}
+
+// complete() assembles the parts as the batches hand them out, and on
+// -EAGAIN starts over, listing the parts in pages as it always did, so
+// that the mismatch is reported the same way
+TEST_F(PartBatchesTest, FallbackToListing)
+{
+  constexpr int max_parts = 10;
+  for (int n = 1; n <= 35; ++n) {
+    if (n != 27) {
+      upload.add(n);
+    }
+  }
+  const auto parts = request_range(1, 35);
+
+  std::vector<uint32_t> manifest;
+  auto add_part = [&manifest] (FakePart& part) {
+    manifest.push_back(part.num);
+    return 0;
+  };
+  PartBatches<FakePart> batches(parts, max_parts, decode_part, add_part);
+  ASSERT_EQ(4u, batches.size());
+  ASSERT_EQ(-EAGAIN, read(batches, {0, 1, 3, 2}));
+  // two batches and the start of the third made it into the manifest
+  // before the mismatch
+  EXPECT_EQ(26u, manifest.size());
+
+  // start over, as list_parts() pages would
+  manifest.clear();
+  auto etags_iter = parts.begin();
+  std::string marker = "part.00000000";
+  int r = 0;
+  for (bool truncated = true; truncated && r == 0; ) {
+    auto page = upload.list(marker, max_parts);
+    truncated = page.size() == max_parts;
+    for (auto& [key, bl] : page) {
+      FakePart part;
+      decode_part(bl, part);
+      if ((int)part.num != etags_iter->first) {
+	r = -EINVAL; // ERR_INVALID_PART
+	break;
+      }
+      manifest.push_back(part.num);
+      ++etags_iter;
+      marker = key;
+    }
+  }
+  EXPECT_EQ(-EINVAL, r);
+  // no part was added twice
+  std::vector<uint32_t> expected(26);
+  std::iota(expected.begin(), expected.end(), 1);
+  EXPECT_EQ(expected, manifest);
+}
@@ -0,0 +1,236 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab ft=cpp
+
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ */
+
+#include "rgw/rgw_cache.h"
+
+#include <thread>
+
+#include "common/ceph_context.h"
+#include "common/dout.h"
+#include "global/global_context.h"
+
+#include <gtest/gtest.h>
+
+using namespace std::chrono_literals;
+
+class ObjectCacheTest : public ::testing::Test {
+protected:
+  NoDoutPrefix dpp{g_ceph_context, ceph_subsys_rgw};
+  ObjectCache cache;
+
+  void configure(const std::string& shards, const std::string& lru_size,
+                 const std::string& expiry, const std::string& refresh_ahead) {
+    auto& conf = g_ceph_context->_conf;
+    conf.set_val_or_die("rgw_cache_shards", shards);
+    conf.set_val_or_die("rgw_cache_lru_size", lru_size);
+    conf.set_val_or_die("rgw_cache_expiry_interval", expiry);
+    conf.set_val_or_die("rgw_cache_refresh_ahead_interval", refresh_ahead);
+    conf.apply_changes(nullptr);
+    cache.set_ctx(g_ceph_context);
+    cache.set_enabled(true);
+  }
+
+  void put(const std::string& name, const std::string& data) {
+    ObjectCacheInfo info;
+    info.status = 0;
+    info.flags = CACHE_FLAG_DATA;
+    info.data.append(data);
+    cache.put(&dpp, name, info, nullptr);
+  }
+
+  size_t count() {
+    size_t n = 0;
+    cache.for_each([&n] (const std::string&, const ObjectCacheEntry&) { ++n; });
+    return n;
+  }
+};
+
+TEST_F(ObjectCacheTest, GetPut)
+{
+  configure("4", "1000", "900", "0");
+
+  ObjectCacheInfo info;
+  EXPECT_EQ(-ENOENT, cache.get(&dpp, "a", info, CACHE_FLAG_DATA, nullptr));
+
+  put("a", "data");
+  ASSERT_EQ(0, cache.get(&dpp, "a", info, CACHE_FLAG_DATA, nullptr));
+  EXPECT_EQ("data", info.data.to_str());
+  // not cached with its xattrs
+  EXPECT_EQ(-ENOENT, cache.get(&dpp, "a", info, CACHE_FLAG_XATTRS, nullptr));
+
+  ObjectCacheInfo negative;
+  negative.status = -ENOENT;
+  cache.put(&dpp, "b", negative, nullptr);
+  EXPECT_EQ(-ENODATA, cache.get(&dpp, "b", info, 0, nullptr));
+
+  EXPECT_TRUE(cache.invalidate_remove(&dpp, "a"));
+  EXPECT_FALSE(cache.invalidate_remove(&dpp, "a"));
+  EXPECT_EQ(-ENOENT, cache.get(&dpp, "a", info, CACHE_FLAG_DATA, nullptr));
+}
+
+TEST_F(ObjectCacheTest, LruBoundedPerShard)
+{
+  configure("4", "40", "900", "0");
+
+  for (int i = 0; i < 1000; i++) {
+    put("obj" + std::to_string(i), "data");
+  }
+  // each shard holds up to its share of the lru, plus the entry that
+  // was being added when it was full
+  EXPECT_LE(count(), 40u + 4u);
+  EXPECT_GE(count(), 4u);
+
+  cache.invalidate_all();
+  EXPECT_EQ(0u, count());
+}
+
+TEST_F(ObjectCacheTest, ConcurrentGets)
+{
+  configure("8", "1000", "900", "0");
+
+  for (int i = 0; i < 100; i++) {
+    put("obj" + std::to_string(i), std::to_string(i));
+  }
+
+  std::vector<std::thread> threads;
+  std::atomic<int> misses{0};
+  for (int t = 0; t < 8; t++) {
+    threads.emplace_back([&] {
+      ObjectCacheInfo info;
+      for (int n = 0; n < 10000; n++) {
+        const int i = n % 100;
+        if (cache.get(&dpp, "obj" + std::to_string(i), info,
+                      CACHE_FLAG_DATA, nullptr) < 0 ||
+            info.data.to_str() != std::to_string(i)) {
+          ++misses;
+        }
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  EXPECT_EQ(0, misses);
+}
+
+TEST_F(ObjectCacheTest, RefreshAhead)
+{
+  configure("4", "1000", "3", "2");
+
+  put("a", "data");
+  ObjectCacheInfo info;
+  bool refresh = false;
+  ASSERT_EQ(0, cache.get(&dpp, "a", info, CACHE_FLAG_DATA, nullptr, &refresh));
+  EXPECT_FALSE(refresh); // still fresh
+
+  std::this_thread::sleep_for(1100ms);
+  ASSERT_EQ(0, cache.get(&dpp, "a", info, CACHE_FLAG_DATA, nullptr, &refresh));
+  EXPECT_TRUE(refresh);
+  // only one lookup is asked to refresh
+  refresh = false;
+  ASSERT_EQ(0, cache.get(&dpp, "a", info, CACHE_FLAG_DATA, nullptr, &refresh));
+  EXPECT_FALSE(refresh);
+
+  // an unchanged refresh renews the entry past its original expiry
+  ObjectCacheInfo reread;
+  reread.status = 0;
+  reread.flags = CACHE_FLAG_DATA;
+  reread.data.append("data");
+  cache.refresh(&dpp, "a", reread);
+  std::this_thread::sleep_for(2000ms);
+  ASSERT_EQ(0, cache.get(&dpp, "a", info, CACHE_FLAG_DATA, nullptr, &refresh));
+  EXPECT_EQ("data", info.data.to_str());
+  EXPECT_TRUE(refresh);
+
+  // a changed one replaces it
+  reread.data.clear();
+  reread.data.append("new");
+  cache.refresh(&dpp, "a", reread);
+  ASSERT_EQ(0, cache.get(&dpp, "a", info, CACHE_FLAG_DATA, nullptr));
+  EXPECT_EQ("new", info.data.to_str());
+}
+
+TEST_F(ObjectCacheTest, RefreshSuperseded)
+{
+  configure("4", "1000", "2", "1");
+
+  put("a", "data");
+  std::this_thread::sleep_for(1100ms);
+  ObjectCacheInfo info;
+  bool refresh = false;
+  ASSERT_EQ(0, cache.get(&dpp, "a", info, CACHE_FLAG_DATA, nullptr, &refresh));
+  ASSERT_TRUE(refresh);
+
+  // a put while the refresh was reading wins over the refresh
+  put("a", "newer");
+  ObjectCacheInfo reread;
+  reread.status = 0;
+  reread.flags = CACHE_FLAG_DATA;
+  reread.data.append("stale");
+  cache.refresh(&dpp, "a", reread);
+  ASSERT_EQ(0, cache.get(&dpp, "a", info, CACHE_FLAG_DATA, nullptr));
+  EXPECT_EQ("newer", info.data.to_str());
+
+  // as does an invalidation, which the refresh doesn't undo
+  std::this_thread::sleep_for(1100ms);
+  refresh = false;
+  ASSERT_EQ(0, cache.get(&dpp, "a", info, CACHE_FLAG_DATA, nullptr, &refresh));
+  ASSERT_TRUE(refresh);
+  cache.invalidate_remove(&dpp, "a");
+  cache.refresh(&dpp, "a", reread);
+  EXPECT_EQ(-ENOENT, cache.get(&dpp, "a", info, CACHE_FLAG_DATA, nullptr));
+}
+
+TEST_F(ObjectCacheTest, RefreshDropped)
+{
+  configure("4", "1000", "3", "2");
+
+  put("a", "data");
+  std::this_thread::sleep_for(1100ms);
+  ObjectCacheInfo info;
+  bool refresh = false;
+  ASSERT_EQ(0, cache.get(&dpp, "a", info, CACHE_FLAG_DATA, nullptr, &refresh));
+  ASSERT_TRUE(refresh);
+  refresh = false;
+  ASSERT_EQ(0, cache.get(&dpp, "a", info, CACHE_FLAG_DATA, nullptr, &refresh));
+  ASSERT_FALSE(refresh);
+
+  // a refresh that was dropped can be asked for again
+  cache.refresh_dropped("a");
+  ASSERT_EQ(0, cache.get(&dpp, "a", info, CACHE_FLAG_DATA, nullptr, &refresh));
+  EXPECT_TRUE(refresh);
+}
+
+TEST_F(ObjectCacheTest, RefreshAllFlags)
+{
+  configure("4", "1000", "3", "2");
+
+  ObjectCacheInfo full;
+  full.status = 0;
+  full.flags = CACHE_FLAG_DATA | CACHE_FLAG_XATTRS;
+  full.data.append("data");
+  full.xattrs["user.x"].append("x");
+  cache.put(&dpp, "a", full, nullptr);
+  std::this_thread::sleep_for(1100ms);
+  ObjectCacheInfo info;
+  bool refresh = false;
+  ASSERT_EQ(0, cache.get(&dpp, "a", info, CACHE_FLAG_DATA, nullptr, &refresh));
+  ASSERT_TRUE(refresh);
+  // the refresh re-reads everything the entry holds, not just the data
+  EXPECT_EQ(CACHE_FLAG_DATA | CACHE_FLAG_XATTRS, info.flags & CACHE_FLAGS_REFRESH);
+
+  ObjectCacheInfo reread = full;
+  cache.refresh(&dpp, "a", reread);
+  std::this_thread::sleep_for(2000ms);
+  ASSERT_EQ(0, cache.get(&dpp, "a", info, CACHE_FLAG_DATA | CACHE_FLAG_XATTRS, nullptr));
+  EXPECT_EQ("x", info.xattrs["user.x"].to_str());
+}
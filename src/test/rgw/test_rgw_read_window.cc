@@ -0,0 +1,73 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab ft=cpp
+
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ */
+
+#include "rgw/rgw_read_window.h"
+#include <gtest/gtest.h>
+
+using namespace std::chrono_literals;
+
+static constexpr uint64_t MB = 1024 * 1024;
+
+TEST(ReadWindow, StartsAtMin)
+{
+  rgw::ReadWindow window(16 * MB, 128 * MB, 4 * MB);
+  EXPECT_EQ(16 * MB, window.size());
+  // no drain rate yet
+  window.read_complete(10ms);
+  EXPECT_EQ(16 * MB, window.size());
+}
+
+TEST(ReadWindow, SlowReadsOpen)
+{
+  rgw::ReadWindow window(16 * MB, 128 * MB, 4 * MB);
+  // the client takes 4MB in 4ms (1GB/s) and reads take 20ms: 2 * 20MB + 4MB
+  for (int i = 0; i < 100; i++) {
+    window.client_drained(4 * MB, 4ms);
+    window.read_complete(20ms);
+  }
+  EXPECT_NEAR(44 * MB, window.size(), MB);
+}
+
+TEST(ReadWindow, Max)
+{
+  rgw::ReadWindow window(16 * MB, 128 * MB, 4 * MB);
+  for (int i = 0; i < 100; i++) {
+    window.client_drained(4 * MB, 0ms);
+    window.read_complete(50ms);
+  }
+  EXPECT_EQ(128 * MB, window.size());
+}
+
+TEST(ReadWindow, SlowClientCloses)
+{
+  rgw::ReadWindow window(16 * MB, 128 * MB, 4 * MB);
+  for (int i = 0; i < 100; i++) {
+    window.client_drained(4 * MB, 0ms);
+    window.read_complete(50ms);
+  }
+  // the client now takes 4MB per second
+  for (int i = 0; i < 100; i++) {
+    window.client_drained(4 * MB, 1s);
+    window.read_complete(5ms);
+  }
+  EXPECT_EQ(16 * MB, window.size());
+}
+
+TEST(ReadWindow, FixedWhenMaxBelowMin)
+{
+  rgw::ReadWindow window(16 * MB, 4 * MB, 4 * MB);
+  for (int i = 0; i < 100; i++) {
+    window.client_drained(4 * MB, 0ms);
+    window.read_complete(50ms);
+  }
+  EXPECT_EQ(16 * MB, window.size());
+}
@@ -0,0 +1,87 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab ft=cpp
+
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ */
+
+#include "rgw/rgw_shard_executor.h"
+#include <gtest/gtest.h>
+
+using namespace std::chrono_literals;
+
+TEST(ForEachShard, VisitsEachShardOnce)
+{
+  for (unsigned workers : {1, 4, 64}) {
+    std::vector<std::atomic<int>> visits(32);
+    std::atomic<unsigned> max_worker{0};
+    int r = rgw::for_each_shard("test", workers, visits.size(), 5,
+                                [&] (unsigned worker, int shard) {
+                                  visits[shard]++;
+                                  unsigned m = max_worker;
+                                  while (worker > m && !max_worker.compare_exchange_weak(m, worker));
+                                  return 0;
+                                });
+    EXPECT_EQ(0, r);
+    for (auto& v : visits) {
+      EXPECT_EQ(1, v);
+    }
+    EXPECT_LT(max_worker, std::min<unsigned>(workers, visits.size()));
+  }
+}
+
+TEST(ForEachShard, StartsAtStart)
+{
+  std::vector<int> order;
+  rgw::for_each_shard("test", 1, 4, 2, [&] (unsigned, int shard) {
+    order.push_back(shard);
+    return 0;
+  });
+  EXPECT_EQ((std::vector<int>{2, 3, 0, 1}), order);
+}
+
+TEST(ForEachShard, StopsOnError)
+{
+  int calls = 0;
+  int r = rgw::for_each_shard("test", 1, 10, 0, [&] (unsigned, int shard) {
+    calls++;
+    return shard == 3 ? -EIO : 0;
+  });
+  EXPECT_EQ(-EIO, r);
+  EXPECT_EQ(4, calls);
+}
+
+TEST(Pacer, Unlimited)
+{
+  rgw::Pacer pacer;
+  const auto start = ceph::mono_clock::now();
+  for (int i = 0; i < 1000; i++) {
+    EXPECT_TRUE(pacer.wait(1, [] { return false; }));
+  }
+  EXPECT_TRUE(ceph::mono_clock::now() - start < 1s);
+}
+
+TEST(Pacer, Rate)
+{
+  rgw::Pacer pacer(100);
+  const auto start = ceph::mono_clock::now();
+  // the first item goes right away, the other 10 take 10ms each
+  for (int i = 0; i < 11; i++) {
+    EXPECT_TRUE(pacer.wait(1, [] { return false; }));
+  }
+  EXPECT_TRUE(ceph::mono_clock::now() - start >= 100ms);
+}
+
+TEST(Pacer, Stop)
+{
+  rgw::Pacer pacer(1);
+  EXPECT_TRUE(pacer.wait(10, [] { return false; }));
+  const auto start = ceph::mono_clock::now();
+  EXPECT_FALSE(pacer.wait(1, [] { return true; }));
+  EXPECT_TRUE(ceph::mono_clock::now() - start < 1s);
+}
@@ -0,0 +1,154 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab ft=cpp
+
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ */
+
+#include "rgw/rgw_sync_window.h"
+#include <optional>
+#include <gtest/gtest.h>
+
+using namespace std::chrono_literals;
+using rgw::sync::AdaptiveWindow;
+
+TEST(AdaptiveWindow, StartsAtMin)
+{
+  AdaptiveWindow window(20, 512);
+  EXPECT_EQ(20u, window.size());
+  EXPECT_EQ(20u, window.share());
+}
+
+TEST(AdaptiveWindow, OpensToMax)
+{
+  AdaptiveWindow window(20, 512);
+  for (int i = 0; i < 10000; i++) {
+    window.sample(10ms, 0, 0);
+  }
+  EXPECT_EQ(512u, window.size());
+}
+
+TEST(AdaptiveWindow, SlowStartThenLinear)
+{
+  AdaptiveWindow window(10, 1000);
+  // one round trip's worth of fast fetches doubles the window
+  for (int i = 0; i < 10; i++) {
+    window.sample(10ms, 0, 0);
+  }
+  EXPECT_EQ(20u, window.size());
+
+  // queueing at the source ends slow start
+  for (int i = 0; i < 20; i++) {
+    window.sample(50ms, 0, 0);
+  }
+  const uint64_t backed_off = window.size();
+  EXPECT_EQ(15u, backed_off);
+
+  // after which a round trip of fast fetches only adds about one
+  for (uint64_t i = 0; i <= backed_off; i++) {
+    window.sample(10ms, 0, 0);
+  }
+  EXPECT_EQ(backed_off + 1, window.size());
+}
+
+TEST(AdaptiveWindow, BacksOffOncePerRoundTrip)
+{
+  AdaptiveWindow window(10, 1000);
+  for (int i = 0; i < 90; i++) {
+    window.sample(10ms, 0, 0);
+  }
+  ASSERT_EQ(100u, window.size());
+
+  // a burst of errors from the same round trip closes it only once
+  for (int i = 0; i < 10; i++) {
+    window.sample(10ms, -EBUSY, 0);
+  }
+  EXPECT_EQ(75u, window.size());
+}
+
+TEST(AdaptiveWindow, StaysAboveMin)
+{
+  AdaptiveWindow window(10, 1000);
+  for (int i = 0; i < 10000; i++) {
+    window.sample(10ms, -ETIMEDOUT, 0);
+  }
+  EXPECT_EQ(10u, window.size());
+}
+
+TEST(AdaptiveWindow, OtherErrorsDontCount)
+{
+  AdaptiveWindow window(10, 1000);
+  for (int i = 0; i < 100; i++) {
+    window.sample(10ms, -ENOENT, 0);
+  }
+  EXPECT_EQ(10u, window.size());
+}
+
+TEST(AdaptiveWindow, SharedEvenly)
+{
+  AdaptiveWindow window(10, 100);
+  {
+    AdaptiveWindow::Share a(window);
+    EXPECT_EQ(10u, window.share());
+    for (int i = 0; i < 10000; i++) {
+      window.sample(10ms, 0, 0);
+    }
+    EXPECT_EQ(100u, window.share());
+    {
+      AdaptiveWindow::Share b(window);
+      AdaptiveWindow::Share c(window);
+      EXPECT_EQ(33u, window.share());
+      std::optional<AdaptiveWindow::Share> more[200];
+      for (auto& s : more) {
+        s.emplace(window);
+      }
+      // every bucket shard can still sync as many objects at a time as
+      // it would without the window
+      EXPECT_EQ(10u, window.share());
+    }
+  }
+}
+
+TEST(AdaptiveWindow, StartsAtMinPerShard)
+{
+  AdaptiveWindow window(20, 512);
+  AdaptiveWindow::Share a(window);
+  AdaptiveWindow::Share b(window);
+  AdaptiveWindow::Share c(window);
+  EXPECT_EQ(60u, window.size());
+  EXPECT_EQ(20u, window.share());
+
+  // and doesn't back off below that
+  for (int i = 0; i < 10000; i++) {
+    window.sample(10ms, -EBUSY, 0);
+  }
+  EXPECT_EQ(60u, window.size());
+  EXPECT_EQ(20u, window.share());
+}
+
+TEST(AdaptiveWindow, ComparesSimilarSizes)
+{
+  AdaptiveWindow window(10, 1000);
+  // small objects set the baseline
+  for (int i = 0; i < 10; i++) {
+    window.sample(10ms, 0, 4096);
+  }
+  ASSERT_EQ(20u, window.size());
+
+  // large ones take longer without any queueing
+  for (int i = 0; i < 20; i++) {
+    window.sample(500ms, 0, 64 << 20);
+  }
+  EXPECT_EQ(40u, window.size());
+
+  // but small ones that slow down are a sign of congestion
+  for (int i = 0; i < 20; i++) {
+    window.sample(50ms, 0, 4096);
+  }
+  EXPECT_EQ(30u, window.size());
+}
@@ -23,6 +23,7 @@
 #include "gtest/gtest.h"
 
 #include "include/denc.h"
+#include "include/object.h"
 
 using namespace std;
 
@@ -269,6 +270,37 @@ TEST(denc, vector)
   }
 }
 
+TEST(denc, vector_raw_layout)
+{
+  // vectors of raw-layout types are copied in bulk; the bytes must
+  // match the element-by-element encoding used for lists
+  static_assert(_denc::is_raw_contiguous_v<vector<uint32_t>>);
+  static_assert(_denc::is_raw_contiguous_v<vector<snapid_t>>);
+  static_assert(!_denc::is_raw_contiguous_v<list<uint32_t>>);
+  static_assert(!_denc::is_raw_contiguous_v<vector<bool>>);
+  vector<snapid_t> v;
+  list<snapid_t> l;
+  for (uint64_t i = 0; i < 1000; ++i) {
+    v.push_back(i * 0x10001);
+    l.push_back(i * 0x10001);
+  }
+  bufferlist vbl, lbl;
+  encode(v, vbl);
+  encode(l, lbl);
+  ASSERT_TRUE(vbl.contents_equal(lbl));
+  test_denc(v);
+  test_denc(vector<uint32_t>{1, 2, 0xffffffff});
+  test_denc(vector<int16_t>{});
+
+  // a truncated input must not size the vector before failing
+  vector<uint64_t> out;
+  bufferlist bad;
+  encode((uint32_t)1000000, bad);
+  encode((uint64_t)1, bad);
+  auto p = bad.cbegin();
+  ASSERT_THROW(decode(out, p), buffer::end_of_buffer);
+}
+
 template<typename T>
 using default_list = std::list<T>;
 
@@ -15,6 +15,8 @@
 
 #include <errno.h>
 
+#include <algorithm>
+#include <chrono>
 #include <filesystem>
 #include <iomanip>
 
@@ -60,6 +62,29 @@ void usage(ostream &out)
   out << "  count_tests         print number of generated test objects (to stdout)\n";
   out << "  select_test <n>     select generated test object as in-memory object\n";
   out << "  is_deterministic    exit w/ success if type encodes deterministically\n";
+  out << "\n";
+  out << "  bench <n>           time n encode and n decode passes of the in-memory\n";
+  out << "                      object and print throughput (to stdout)\n";
+}
+
+// run @p op @p iterations times and report the rate at which it processes
+// @p bytes per call
+template <typename Op>
+static void bench_one(const char* what, uint64_t iterations, size_t bytes,
+		      Op&& op)
+{
+  using clock = std::chrono::steady_clock;
+  auto start = clock::now();
+  for (uint64_t n = 0; n < iterations; ++n) {
+    op();
+  }
+  std::chrono::duration<double> secs = clock::now() - start;
+  double elapsed = std::max(secs.count(), 1e-9);
+  cout << what << ": " << iterations << " ops, " << bytes << " bytes/op, "
+       << std::fixed << std::setprecision(3) << elapsed << " s, "
+       << std::setprecision(0) << iterations / elapsed << " ops/s, "
+       << std::setprecision(2) << iterations * bytes / elapsed / MB(1)
+       << " MB/s" << std::defaultfloat << std::endl;
 }
 
 vector<DencoderPlugin> load_plugins()
@@ -263,6 +288,31 @@ int main(int argc, const char **argv)
 	return 0;
       else
 	return 1;
+    } else if (*i == string("bench")) {
+      if (!den) {
+	cerr << "must first select type with 'type <name>'" << std::endl;
+	return 1;
+      }
+      ++i;
+      if (i == args.end()) {
+	cerr << "expecting iteration count" << std::endl;
+	return 1;
+      }
+      uint64_t iterations = strtoull(*i, nullptr, 10);
+      if (iterations == 0) {
+	cerr << "iteration count must be positive" << std::endl;
+	return 1;
+      }
+      bufferlist bl;
+      den->encode(bl, features | CEPH_FEATURE_RESERVED);
+      const size_t len = bl.length();
+      bench_one("encode", iterations, len, [&] {
+	bufferlist out;
+	den->encode(out, features | CEPH_FEATURE_RESERVED);
+      });
+      bench_one("decode", iterations, len, [&] {
+	err = den->decode(bl, 0);
+      });
     } else {
       cerr << "unknown option '" << *i << "'" << std::endl;
       return 1;
@@ -0,0 +1,142 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+/*
+ * ceph-log-decode -- render a log written with log_file_format=binary
+ *
+ * USAGE
+ *
+ *     ceph-log-decode [file ...]
+ *
+ * Reads stdin if no file is given.  Binary records are printed in the
+ * same form the text log uses; anything that is not a binary record
+ * (crash dumps, text written before the format was switched) is passed
+ * through unchanged.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "log/BinaryFormat.h"
+#include "log/LogClock.h"
+
+using namespace ceph::logging;
+
+static void usage(std::ostream& out)
+{
+  out << "usage: ceph-log-decode [file ...]\n"
+      << "  render a binary (log_file_format=binary) ceph log as text\n";
+}
+
+static void print_record(const binary::record_header& h, const char* msg)
+{
+  char head[128];
+  int n = append_time(binary::stamp_of(h), head, sizeof(head));
+  n += snprintf(head + n, sizeof(head) - n, " %lx %2d ",
+		(unsigned long)h.thread, (int)(int16_t)h.prio);
+  fwrite(head, 1, n, stdout);
+  fwrite(msg, 1, h.len, stdout);
+  fputc('\n', stdout);
+}
+
+/// consume as much of [buf, buf+len) as possible; return bytes consumed
+static size_t decode(const char* buf, size_t len, bool eof)
+{
+  size_t pos = 0;
+  while (pos < len) {
+    binary::record_header h;
+    const size_t avail = len - pos;
+    if (binary::decode_header(buf + pos, avail, &h)) {
+      if (avail < sizeof(h) + h.len) {
+	if (!eof) {
+	  break;
+	}
+	std::cerr << "ceph-log-decode: truncated record at end of input"
+		  << std::endl;
+	return len;
+      }
+      print_record(h, buf + pos + sizeof(h));
+      pos += sizeof(h) + h.len;
+      continue;
+    }
+    const ceph_le32 magic{binary::RECORD_MAGIC};
+    if (avail < sizeof(h) && !eof &&
+	memcmp(buf + pos, &magic, std::min(avail, sizeof(magic))) == 0) {
+      break;  // may be the start of a header; wait for more input
+    }
+    // plain text: pass through up to and including the next newline
+    auto nl = static_cast<const char*>(memchr(buf + pos, '\n', avail));
+    if (!nl && !eof) {
+      break;
+    }
+    size_t n = nl ? (nl - (buf + pos)) + 1 : avail;
+    fwrite(buf + pos, 1, n, stdout);
+    pos += n;
+  }
+  return pos;
+}
+
+static int decode_file(FILE* in, const char* name)
+{
+  std::vector<char> buf;
+  size_t filled = 0;
+  buf.resize(1 << 20);
+  for (;;) {
+    if (filled == buf.size()) {
+      buf.resize(buf.size() * 2);  // a single record or line larger than buf
+    }
+    size_t r = fread(buf.data() + filled, 1, buf.size() - filled, in);
+    filled += r;
+    const bool eof = r == 0;
+    if (eof && ferror(in)) {
+      std::cerr << "ceph-log-decode: error reading " << name << ": "
+		<< strerror(errno) << std::endl;
+      return 1;
+    }
+    size_t used = decode(buf.data(), filled, eof);
+    memmove(buf.data(), buf.data() + used, filled - used);
+    filled -= used;
+    if (eof) {
+      return 0;
+    }
+  }
+}
+
+int main(int argc, const char** argv)
+{
+  if (argc > 1 && (!strcmp(argv[1], "-h") || !strcmp(argv[1], "--help"))) {
+    usage(std::cout);
+    return 0;
+  }
+  if (argc == 1) {
+    return decode_file(stdin, "stdin");
+  }
+  int ret = 0;
+  for (int i = 1; i < argc; ++i) {
+    FILE* in = fopen(argv[i], "rb");
+    if (!in) {
+      std::cerr << "ceph-log-decode: unable to open " << argv[i] << ": "
+		<< strerror(errno) << std::endl;
+      ret = 1;
+      continue;
+    }
+    if (decode_file(in, argv[i])) {
+      ret = 1;
+    }
+    fclose(in);
+  }
+  return ret;
+}